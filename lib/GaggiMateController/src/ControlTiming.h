@@ -0,0 +1,21 @@
+#ifndef CONTROLTIMING_H
+#define CONTROLTIMING_H
+
+// Measured dt is handed to the control math once the period deviates by more than this fraction
+constexpr float CONTROL_JITTER_BOUND = 0.2f;
+// Upper bound for the measured dt in periods, keeps a single stall from throwing integrators off
+constexpr float CONTROL_MAX_DT_PERIODS = 4.0f;
+
+// Returns the dt in seconds the control math should use for a cycle that took `actual` µs instead of `nominal` µs
+inline float getControlDt(unsigned long actual, unsigned long nominal) {
+    const unsigned long deviation = actual > nominal ? actual - nominal : nominal - actual;
+    const float nominalSeconds = static_cast<float>(nominal) / 1000000.0f;
+    if (static_cast<float>(deviation) <= static_cast<float>(nominal) * CONTROL_JITTER_BOUND) {
+        return nominalSeconds;
+    }
+    const float actualSeconds = static_cast<float>(actual) / 1000000.0f;
+    const float maxSeconds = nominalSeconds * CONTROL_MAX_DT_PERIODS;
+    return actualSeconds < maxSeconds ? actualSeconds : maxSeconds;
+}
+
+#endif // CONTROLTIMING_H
@@ -0,0 +1,14 @@
+#include "CyclicExecutive.h"
+
+void CyclicExecutive::start() {
+    xTaskCreate(loopTask, "CyclicExecutive::loop", configMINIMAL_STACK_SIZE * 8, this, 1, &taskHandle);
+}
+
+void CyclicExecutive::loopTask(void *arg) {
+    auto *executive = static_cast<CyclicExecutive *>(arg);
+    while (true) {
+        executive->monitor.beginCycle();
+        executive->runFrame(micros());
+        executive->monitor.endCycle();
+    }
+}
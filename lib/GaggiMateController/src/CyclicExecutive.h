@@ -0,0 +1,100 @@
+#ifndef CYCLICEXECUTIVE_H
+#define CYCLICEXECUTIVE_H
+
+#include "ControlTiming.h"
+#include <cstdint>
+#include <functional>
+#ifdef ARDUINO
+#include "TaskMonitor.h"
+#endif
+
+constexpr unsigned long CYCLIC_FRAME_MS = 10;
+constexpr uint8_t CYCLIC_MAX_SLOTS = 12;
+
+// Rate groups in frames
+constexpr uint16_t CYCLIC_RATE_10MS = 1;
+constexpr uint16_t CYCLIC_RATE_30MS = 3;
+constexpr uint16_t CYCLIC_RATE_100MS = 10;
+
+// Receives the time since the slot last ran in seconds, the nominal period while the jitter stays within
+// CONTROL_JITTER_BOUND
+using cyclic_slot_t = std::function<void(float dt)>;
+
+struct CyclicSlot {
+    const char *name = "";
+    uint16_t frames = 1;
+    uint16_t offset = 0;
+    cyclic_slot_t run = nullptr;
+    unsigned long lastRun = 0; // µs
+    bool started = false;
+};
+
+// Runs the periodic work of the controller board in one task instead of one task per peripheral. Time is split
+// into CYCLIC_FRAME_MS frames, a slot runs in every frame where frame % frames == offset and the slots of a frame
+// run in the order they were added. Adding them as read, filter, control, actuate means a controller always works
+// on the sample taken in the same frame. The schedule itself has no platform dependencies, runFrame() is driven by
+// the executive task on the board and by a simulated clock on the host.
+// Used by the controller with -DGAGGIMATE_CYCLIC_EXECUTIVE, without the flag every peripheral keeps its own task.
+class CyclicExecutive {
+  public:
+    // Returns false if the slot table is full or the offset is outside the period
+    bool add(const char *name, uint16_t frames, uint16_t offset, const cyclic_slot_t &run) {
+        if (slotCount >= CYCLIC_MAX_SLOTS || frames == 0 || offset >= frames)
+            return false;
+        CyclicSlot &slot = slots[slotCount++];
+        slot.name = name;
+        slot.frames = frames;
+        slot.offset = offset;
+        slot.run = run;
+        hyperperiod = lcm(hyperperiod, frames);
+        return true;
+    }
+
+    // Runs the slots due in the current frame and advances to the next one, now is in µs
+    void runFrame(unsigned long now) {
+        for (uint8_t i = 0; i < slotCount; i++) {
+            CyclicSlot &slot = slots[i];
+            if (frame % slot.frames != slot.offset)
+                continue;
+            const unsigned long nominal = slot.frames * CYCLIC_FRAME_MS * 1000UL;
+            const float dt = slot.started ? getControlDt(now - slot.lastRun, nominal) : static_cast<float>(nominal) / 1000000.0f;
+            slot.started = true;
+            slot.lastRun = now;
+            slot.run(dt);
+        }
+        frame = (frame + 1) % hyperperiod;
+    }
+
+    uint16_t getFrame() const { return frame; }
+    uint16_t getHyperperiod() const { return hyperperiod; }
+    uint8_t getSlotCount() const { return slotCount; }
+    const CyclicSlot &getSlot(uint8_t index) const { return slots[index]; }
+
+#ifdef ARDUINO
+    void start();
+#endif
+
+  private:
+    static uint16_t lcm(uint16_t a, uint16_t b) {
+        uint16_t x = a, y = b;
+        while (y != 0) {
+            const uint16_t t = x % y;
+            x = y;
+            y = t;
+        }
+        return a / x * b;
+    }
+
+    CyclicSlot slots[CYCLIC_MAX_SLOTS];
+    uint8_t slotCount = 0;
+    uint16_t frame = 0;
+    uint16_t hyperperiod = 1;
+
+#ifdef ARDUINO
+    xTaskHandle taskHandle = nullptr;
+    TaskMonitor monitor{"executive", CYCLIC_FRAME_MS};
+    static void loopTask(void *arg);
+#endif
+};
+
+#endif // CYCLICEXECUTIVE_H
@@ -1,4 +1,5 @@
 #include "GaggiMateController.h"
+#include "BootTrace.h"
 #include "utilities.h"
 #include <Arduino.h>
 #include <SPI.h>
@@ -12,13 +13,16 @@ GaggiMateController::GaggiMateController() {
     configs.push_back(GM_PRO_LEGO);
 }
 
+// Nothing in here waits, the display scans continuously and connects as soon as the server advertises
 void GaggiMateController::setup() {
-    delay(5000);
+    BootTrace::mark("setup");
     detectBoard();
     detectAddon();
+    BootTrace::mark("board");
 
     String systemInfo = make_system_info(_config);
     _ble.initServer(systemInfo);
+    BootTrace::mark("ble:advertising");
 
     this->thermocouple = new Max31855Thermocouple(
         _config.maxCsPin, _config.maxMisoPin, _config.maxSckPin, [this](float temperature) { /* noop */ },
@@ -36,6 +40,8 @@ void GaggiMateController::setup() {
     } else {
         pump = new SimplePump(_config.pumpPin, _config.pumpOn, _config.capabilites.ssrPump ? 1000.0f : 5000.0f);
     }
+    this->executor = new ProfileExecutor(valve, pump, pressureSensor, _config.capabilites.dimming,
+                                         [this](const ProgramProgress &progress) { _ble.sendProgramProgress(progress); });
     this->brewBtn = new DigitalInput(_config.brewButtonPin, [this](const bool state) { _ble.sendBrewBtnState(state); });
     this->steamBtn = new DigitalInput(_config.steamButtonPin, [this](const bool state) { _ble.sendSteamBtnState(state); });
     this->thermocouple->setup();
@@ -45,18 +51,28 @@ void GaggiMateController::setup() {
     this->pump->setup();
     this->brewBtn->setup();
     this->steamBtn->setup();
+    this->executor->setup();
     if (_config.capabilites.pressure) {
         pressureSensor->setup();
         _ble.registerPressureScaleCallback([this](float scale) { this->pressureSensor->setScale(scale); });
     }
+#ifdef GAGGIMATE_CYCLIC_EXECUTIVE
+    setupExecutive();
+#endif
+
+    BootTrace::mark("peripherals");
 
     // Initialize last ping time
     lastPingTime = millis();
 
     _ble.registerOutputControlCallback([this](bool valve, float pumpSetpoint, float heaterSetpoint) {
+        this->heater->setSetpoint(heaterSetpoint);
+        if (executor->ownsOutputs()) {
+            // Pump and valve belong to the running program, the display only keeps the boiler target fresh
+            return;
+        }
         this->pump->setPower(pumpSetpoint);
         this->valve->set(valve);
-        this->heater->setSetpoint(heaterSetpoint);
         if (!_config.capabilites.dimming) {
             return;
         }
@@ -65,8 +81,11 @@ void GaggiMateController::setup() {
     });
     _ble.registerAdvancedOutputControlCallback(
         [this](bool valve, float heaterSetpoint, bool pressureTarget, float pressure, float flow) {
-            this->valve->set(valve);
             this->heater->setSetpoint(heaterSetpoint);
+            if (executor->ownsOutputs()) {
+                return;
+            }
+            this->valve->set(valve);
             if (!_config.capabilites.dimming) {
                 return;
             }
@@ -82,6 +101,12 @@ void GaggiMateController::setup() {
     _ble.registerPidControlCallback([this](float Kp, float Ki, float Kd) { this->heater->setTunings(Kp, Ki, Kd); });
     _ble.registerPingCallback([this]() {
         lastPingTime = millis();
+        if (!bootReported) {
+            // First ping means the display is fully connected, the trace is complete
+            bootReported = true;
+            BootTrace::mark("display:ping");
+            BootTrace::print();
+        }
         ESP_LOGV(LOG_TAG, "Ping received, system is alive");
     });
     _ble.registerAutotuneCallback([this](int goal, int windowSize) { this->heater->autotune(goal, windowSize); });
@@ -92,16 +117,76 @@ void GaggiMateController::setup() {
         auto dimmedPump = static_cast<DimmedPump *>(pump);
         dimmedPump->tare();
     });
+    _ble.registerProgramUploadCallback([this](const ProfileProgram &program) { executor->load(program); });
+    _ble.registerProgramControlCallback([this](ProgramCommand command, uint8_t phase) {
+        switch (command) {
+        case ProgramCommand::START:
+            executor->start();
+            break;
+        case ProgramCommand::ADVANCE:
+            executor->advance(phase);
+            break;
+        case ProgramCommand::STOP:
+            executor->stop();
+            break;
+        }
+    });
+    BootTrace::mark("ready");
+    BootTrace::print();
     ESP_LOGI(LOG_TAG, "Initialization done");
 }
 
 void GaggiMateController::loop() {
+    telemetryMonitor.beginCycle();
     unsigned long now = millis();
-    if ((now - lastPingTime) / 1000 > PING_TIMEOUT_SECONDS) {
-        handlePingTimeout();
+    if (now - lastPingCheck >= PING_CHECK_INTERVAL_MS) {
+        lastPingCheck = now;
+        if ((now - lastPingTime) / 1000 > PING_TIMEOUT_SECONDS) {
+            handlePingTimeout();
+        }
+    }
+    sendSensorData(now);
+    if (now - lastTaskReport > TASK_MONITOR_REPORT_INTERVAL_MS) {
+        lastTaskReport = now;
+        reportTaskDiagnostics();
+    }
+    telemetryMonitor.endCycle();
+}
+
+// Slots are added as read, filter, control and actuate, so the pump works on the pressure sample of the same frame.
+// The thermocouple keeps its own read interval, the temperature filter is tuned for it.
+void GaggiMateController::setupExecutive() {
+    if (pressureSensor != nullptr) {
+        executive.add("pressure", CYCLIC_RATE_30MS, 0, [this](float) { pressureSensor->loop(); });
+    }
+    executive.add("thermocouple", MAX31855_UPDATE_INTERVAL / CYCLIC_FRAME_MS, 5, [this](float) { thermocouple->loop(); });
+    executive.add("executor", CYCLIC_RATE_30MS, 0, [this](float) { executor->loop(); });
+    if (_config.capabilites.dimming) {
+        auto *dimmedPump = static_cast<DimmedPump *>(pump);
+        executive.add("pump", CYCLIC_RATE_30MS, 0, [dimmedPump](float dt) {
+            dimmedPump->setControlInterval(dt);
+            dimmedPump->loop();
+        });
+    } else {
+        executive.add("pump", CYCLIC_RATE_10MS, 0, [this](float) { pump->loop(); });
+    }
+    executive.add("heater", CYCLIC_RATE_10MS, 0, [this](float) { heater->loop(); });
+    executive.add("brew button", CYCLIC_RATE_100MS, 1, [this](float) { brewBtn->loop(); });
+    executive.add("steam button", CYCLIC_RATE_100MS, 2, [this](float) { steamBtn->loop(); });
+    executive.start();
+    ESP_LOGI(LOG_TAG, "Cyclic executive started with %d slots, hyperperiod %d frames", executive.getSlotCount(),
+             executive.getHyperperiod());
+}
+
+void GaggiMateController::reportTaskDiagnostics() {
+    for (uint8_t i = 0; i < TaskMonitor::getCount(); i++) {
+        const TaskDiagnostics diagnostics = TaskMonitor::get(i)->collect();
+        if (diagnostics.missed > 0) {
+            ESP_LOGW(LOG_TAG, "Task %s missed %lu of %lu deadlines, max period %luus, max execution %luus", diagnostics.name,
+                     diagnostics.missed, diagnostics.count, diagnostics.periodMax, diagnostics.execMax);
+        }
+        _ble.sendTaskDiagnostics(diagnostics);
     }
-    sendSensorData();
-    delay(250);
 }
 
 void GaggiMateController::registerBoardConfig(ControllerConfig config) { configs.push_back(config); }
@@ -132,6 +217,9 @@ void GaggiMateController::detectAddon() {
 
 void GaggiMateController::handlePingTimeout() {
     ESP_LOGE(LOG_TAG, "Ping timeout detected. Turning off heater and pump for safety.\n");
+    if (executor != nullptr) {
+        executor->stop();
+    }
     // Turn off the heater and pump as a safety measure
     this->heater->setSetpoint(0);
     this->pump->setPower(0);
@@ -142,6 +230,9 @@ void GaggiMateController::handlePingTimeout() {
 
 void GaggiMateController::thermalRunawayShutdown() {
     ESP_LOGE(LOG_TAG, "Thermal runaway detected! Turning off heater and pump!\n");
+    if (executor != nullptr) {
+        executor->stop();
+    }
     // Turn off the heater and pump immediately
     this->heater->setSetpoint(0);
     this->pump->setPower(0);
@@ -150,12 +241,62 @@ void GaggiMateController::thermalRunawayShutdown() {
     _ble.sendError(ERROR_CODE_RUNAWAY);
 }
 
-void GaggiMateController::sendSensorData() {
+SensorSample GaggiMateController::readSensors(unsigned long now) {
+    SensorSample sample;
+    sample.time = now;
+    sample.temperature = this->thermocouple->read();
     if (_config.capabilites.pressure) {
         auto dimmedPump = static_cast<DimmedPump *>(pump);
-        _ble.sendSensorData(this->thermocouple->read(), this->pressureSensor->getPressure(), dimmedPump->getFlow());
-        _ble.sendVolumetricMeasurement(dimmedPump->getCoffeeVolume());
-    } else {
-        _ble.sendSensorData(this->thermocouple->read(), 0.0f, 0.0f);
+        sample.pressure = this->pressureSensor->getPressure();
+        sample.flow = dimmedPump->getFlow();
+        sample.volume = dimmedPump->getCoffeeVolume();
+    }
+    return sample;
+}
+
+bool GaggiMateController::isBrewing() const { return executor->isRunning() || valve->getState(); }
+
+bool GaggiMateController::sensorsChanged(const SensorSample &sample) const {
+    return fabsf(sample.temperature - lastSent.temperature) >= SENSOR_DEADBAND_TEMPERATURE ||
+           fabsf(sample.pressure - lastSent.pressure) >= SENSOR_DEADBAND_PRESSURE ||
+           fabsf(sample.flow - lastSent.flow) >= SENSOR_DEADBAND_FLOW ||
+           fabsf(sample.volume - lastSent.volume) >= SENSOR_DEADBAND_VOLUME;
+}
+
+// Frames need a pressure sensor, without one there is only the temperature and that changes slowly
+void GaggiMateController::sendSensorData(unsigned long now) {
+    const uint8_t capacity = _config.capabilites.pressure ? _ble.getSensorFrameCapacity() : 0;
+    if (capacity > 0 && isBrewing()) {
+        frame[frameCount++] = readSensors(now);
+        if (frameCount >= capacity || now - frame[0].time >= SENSOR_FRAME_MAX_AGE_MS) {
+            sendSensorFrame();
+        }
+        return;
+    }
+    sendSensorFrame();
+    if (now - lastIdleSample < SENSOR_IDLE_INTERVAL_MS) {
+        return;
+    }
+    lastIdleSample = now;
+    const SensorSample sample = readSensors(now);
+    if (lastSensorSent != 0 && now - lastSensorSent < SENSOR_IDLE_KEEPALIVE_MS && !sensorsChanged(sample)) {
+        return;
+    }
+    _ble.sendSensorData(sample.temperature, sample.pressure, sample.flow);
+    if (_config.capabilites.pressure) {
+        _ble.sendVolumetricMeasurement(sample.volume);
+    }
+    lastSent = sample;
+    lastSensorSent = now;
+}
+
+// Sends the buffered samples, if any
+void GaggiMateController::sendSensorFrame() {
+    if (frameCount == 0) {
+        return;
     }
+    _ble.sendSensorFrame(frame, frameCount);
+    lastSent = frame[frameCount - 1];
+    lastSensorSent = lastSent.time;
+    frameCount = 0;
 }
@@ -1,7 +1,10 @@
 #ifndef GAGGIMATECONTROLLER_H
 #define GAGGIMATECONTROLLER_H
 #include "ControllerConfig.h"
+#include "CyclicExecutive.h"
 #include "NimBLEServerController.h"
+#include "ProfileExecutor.h"
+#include "TaskMonitor.h"
 #include <MAX31855.h>
 #include <peripherals/DigitalInput.h>
 #include <peripherals/DimmedPump.h>
@@ -13,6 +16,19 @@
 #include <vector>
 
 constexpr double PING_TIMEOUT_SECONDS = 20.0;
+constexpr unsigned long PING_CHECK_INTERVAL_MS = 250;
+
+// Sensors are sampled at the pump loop rate. While brewing the samples go out in batched frames, sent when the frame
+// is full or its first sample gets too old. Otherwise a single sample goes out at the idle interval if a value moved
+// past its deadband, or at the keep-alive interval.
+constexpr unsigned long SENSOR_SAMPLE_INTERVAL_MS = DIMMED_PUMP_INTERVAL_MS;
+constexpr unsigned long SENSOR_FRAME_MAX_AGE_MS = 240; // stays below the idle interval
+constexpr unsigned long SENSOR_IDLE_INTERVAL_MS = 250;
+constexpr unsigned long SENSOR_IDLE_KEEPALIVE_MS = 1000;
+constexpr float SENSOR_DEADBAND_TEMPERATURE = 0.1f; // °C
+constexpr float SENSOR_DEADBAND_PRESSURE = 0.05f;   // bar
+constexpr float SENSOR_DEADBAND_FLOW = 0.05f;       // ml/s
+constexpr float SENSOR_DEADBAND_VOLUME = 0.1f;      // ml
 
 constexpr int DETECT_EN_PIN = 40;
 constexpr int DETECT_VALUE_PIN = 11;
@@ -32,7 +48,13 @@ class GaggiMateController {
     void thermalRunawayShutdown(void);
     void startPidAutotune(void);
     void stopPidAutotune(void);
-    void sendSensorData(void);
+    SensorSample readSensors(unsigned long now);
+    bool isBrewing() const;
+    bool sensorsChanged(const SensorSample &sample) const;
+    void sendSensorData(unsigned long now);
+    void sendSensorFrame(void);
+    void reportTaskDiagnostics(void);
+    void setupExecutive(void);
 
     ControllerConfig _config = ControllerConfig{};
     NimBLEServerController _ble;
@@ -45,10 +67,21 @@ class GaggiMateController {
     DigitalInput *brewBtn = nullptr;
     DigitalInput *steamBtn = nullptr;
     PressureSensor *pressureSensor = nullptr;
+    ProfileExecutor *executor = nullptr;
+    CyclicExecutive executive;
+    TaskMonitor telemetryMonitor{"telemetry", SENSOR_SAMPLE_INTERVAL_MS};
 
     std::vector<ControllerConfig> configs;
 
     unsigned long lastPingTime = 0;
+    unsigned long lastPingCheck = 0;
+    SensorSample frame[SENSOR_FRAME_MAX_SAMPLES];
+    uint8_t frameCount = 0;
+    SensorSample lastSent{};
+    unsigned long lastSensorSent = 0;
+    unsigned long lastIdleSample = 0;
+    unsigned long lastTaskReport = 0;
+    bool bootReported = false;
 
     const char *LOG_TAG = "GaggiMateController";
 };
@@ -0,0 +1,199 @@
+#include "ProfileExecutor.h"
+
+ProfileExecutor::ProfileExecutor(SimpleRelay *valve, Pump *pump, PressureSensor *pressureSensor, bool dimming,
+                                 const program_progress_report_t &progressCallback)
+    : valve(valve), pump(pump), pressureSensor(pressureSensor), dimming(dimming), progressCallback(progressCallback) {}
+
+void ProfileExecutor::setup() {
+#ifndef GAGGIMATE_CYCLIC_EXECUTIVE
+    xTaskCreate(loopTask, "ProfileExecutor::loop", configMINIMAL_STACK_SIZE * 4, this, 1, &taskHandle);
+#endif
+}
+
+void ProfileExecutor::load(const ProfileProgram &program) {
+    if (isRunning()) {
+        ESP_LOGW(LOG_TAG, "Ignoring program upload while a program is running");
+        return;
+    }
+    this->program = program;
+    loaded = program.phaseCount > 0;
+    ESP_LOGI(LOG_TAG, "Loaded program %lu with %d phases", static_cast<unsigned long>(program.id), program.phaseCount);
+}
+
+void ProfileExecutor::start() {
+    if (!loaded) {
+        ESP_LOGW(LOG_TAG, "Start requested without a program");
+        return;
+    }
+    stopRequest = false;
+    startRequest = true;
+}
+
+void ProfileExecutor::advance(uint8_t fromPhase) { advanceRequest = fromPhase; }
+
+void ProfileExecutor::stop() {
+    startRequest = false;
+    if (running) {
+        stopRequest = true;
+    }
+}
+
+void ProfileExecutor::loop() {
+    const unsigned long now = millis();
+    if (stopRequest) {
+        stopRequest = false;
+        finish(false);
+        return;
+    }
+    if (startRequest) {
+        startRequest = false;
+        advanceRequest = -1;
+        finishedAt = 0;
+        running = true;
+        programStarted = now;
+        startPump = 0.0f;
+        startPressure = getPressure();
+        startFlow = getFlow();
+        enterPhase(0, now);
+    }
+    if (!running) {
+        return;
+    }
+    if (now - programStarted > PROFILE_EXECUTOR_SAFETY_MS) {
+        ESP_LOGW(LOG_TAG, "Program exceeded the safety duration");
+        finish(false);
+        return;
+    }
+    const int requested = advanceRequest;
+    if (isPhaseFinished(now) || requested == phaseIndex) {
+        advanceRequest = -1;
+        if (phaseIndex + 1 >= program.phaseCount) {
+            finish(true);
+            return;
+        }
+        startPump = currentPump;
+        startPressure = program.phases[phaseIndex].advanced ? currentPressureTarget : getPressure();
+        startFlow = program.phases[phaseIndex].advanced ? currentFlowTarget : getFlow();
+        enterPhase(phaseIndex + 1, now);
+    }
+    applyOutputs(now);
+}
+
+void ProfileExecutor::enterPhase(uint8_t index, unsigned long now) {
+    phaseIndex = index;
+    phaseStarted = now;
+    ESP_LOGI(LOG_TAG, "Entering phase %d", phaseIndex);
+    reportProgress(now);
+}
+
+void ProfileExecutor::finish(bool handover) {
+    running = false;
+    finishedAt = handover ? millis() : 0;
+    pump->setPower(0);
+    valve->set(false);
+    if (dimming) {
+        static_cast<DimmedPump *>(pump)->setValveState(false);
+    }
+    ESP_LOGI(LOG_TAG, "Program finished");
+    reportProgress(millis());
+}
+
+void ProfileExecutor::applyOutputs(unsigned long now) {
+    const ProgramPhase &phase = program.phases[phaseIndex];
+    float progress = 1.0f;
+    if (phase.transition != PROGRAM_TRANSITION_INSTANT && phase.transitionDuration > 0.0f) {
+        progress = evaluateTransition(phase.transition, (now - phaseStarted) / 1000.0f / phase.transitionDuration);
+    }
+    valve->set(phase.valve);
+    if (phase.advanced && dimming) {
+        auto dimmedPump = static_cast<DimmedPump *>(pump);
+        currentPressureTarget = startPressure + (phase.pressure - startPressure) * progress;
+        currentFlowTarget = startFlow + (phase.flow - startFlow) * progress;
+        currentPump = 100.0f;
+        if (phase.pressureTarget) {
+            dimmedPump->setPressureTarget(currentPressureTarget, currentFlowTarget);
+        } else {
+            dimmedPump->setFlowTarget(currentFlowTarget, currentPressureTarget);
+        }
+        dimmedPump->setValveState(phase.valve);
+        return;
+    }
+    currentPump = phase.advanced ? 100.0f : startPump + (phase.pump - startPump) * progress;
+    pump->setPower(currentPump);
+    if (dimming) {
+        static_cast<DimmedPump *>(pump)->setValveState(phase.valve);
+    }
+}
+
+bool ProfileExecutor::isPhaseFinished(unsigned long now) {
+    const ProgramPhase &phase = program.phases[phaseIndex];
+    const float elapsed = (now - phaseStarted) / 1000.0f;
+    for (uint8_t i = 0; i < phase.exitCount; i++) {
+        const ProgramExit &exit = phase.exits[i];
+        float value;
+        switch (exit.type) {
+        case PROGRAM_EXIT_TIME:
+            value = elapsed;
+            break;
+        case PROGRAM_EXIT_PRESSURE:
+            value = getPressure();
+            break;
+        case PROGRAM_EXIT_FLOW:
+            value = getFlow();
+            break;
+        default:
+            continue; // volumetric exits are decided by the display
+        }
+        if (isExitMet(exit.lte, value, exit.value)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+float ProfileExecutor::getPressure() const { return pressureSensor != nullptr ? pressureSensor->getPressure() : 0.0f; }
+
+float ProfileExecutor::getFlow() const { return dimming ? static_cast<DimmedPump *>(pump)->getFlow() : 0.0f; }
+
+// Same shapes the display uses to preview transitions, evaluated exactly instead of from tabulated segments
+float ProfileExecutor::evaluateTransition(uint8_t transition, float progress) {
+    if (progress >= 1.0f) {
+        return 1.0f;
+    }
+    if (progress <= 0.0f) {
+        return 0.0f;
+    }
+    switch (transition) {
+    case PROGRAM_TRANSITION_LINEAR:
+        return progress;
+    case PROGRAM_TRANSITION_EASE_IN_OUT:
+        return progress * progress * (3.0f - 2.0f * progress);
+    case PROGRAM_TRANSITION_EXPONENTIAL: {
+        const float k = PROFILE_EXECUTOR_EXPONENTIAL_RATE;
+        return (1.0f - expf(-k * progress)) / (1.0f - expf(-k));
+    }
+    default:
+        return 1.0f;
+    }
+}
+
+void ProfileExecutor::reportProgress(unsigned long now) {
+    if (progressCallback == nullptr) {
+        return;
+    }
+    ProgramProgress progress;
+    progress.id = program.id;
+    progress.phase = phaseIndex;
+    progress.phaseElapsed = now - phaseStarted;
+    progress.running = running;
+    progressCallback(progress);
+}
+
+void ProfileExecutor::loopTask(void *arg) {
+    auto *executor = static_cast<ProfileExecutor *>(arg);
+    while (true) {
+        executor->monitor.beginCycle();
+        executor->loop();
+        executor->monitor.endCycle();
+    }
+}
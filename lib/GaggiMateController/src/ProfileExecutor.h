@@ -0,0 +1,82 @@
+#ifndef PROFILEEXECUTOR_H
+#define PROFILEEXECUTOR_H
+
+#include "ProfileProgram.h"
+#include "TaskMonitor.h"
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <functional>
+#include <peripherals/DimmedPump.h>
+#include <peripherals/PressureSensor.h>
+#include <peripherals/Pump.h>
+#include <peripherals/SimpleRelay.h>
+
+constexpr int PROFILE_EXECUTOR_INTERVAL_MS = 30; // runs in step with the pump and pressure loops
+constexpr unsigned long PROFILE_EXECUTOR_SAFETY_MS = 120000;
+constexpr float PROFILE_EXECUTOR_EXPONENTIAL_RATE = 5.0f;
+// Output commands from the display are ignored this long after a program ended on its own, until the display
+// has seen the final progress report and stopped sending the setpoints of the last phase
+constexpr unsigned long PROFILE_EXECUTOR_HANDOVER_MS = 500;
+
+using program_progress_report_t = std::function<void(const ProgramProgress &progress)>;
+
+// Runs an uploaded profile program on the controller board. Phase changes are decided against the local
+// sensors every PROFILE_EXECUTOR_INTERVAL_MS, the display only receives progress and supervises.
+class ProfileExecutor {
+  public:
+    ProfileExecutor(SimpleRelay *valve, Pump *pump, PressureSensor *pressureSensor, bool dimming,
+                    const program_progress_report_t &progressCallback);
+
+    void setup();
+    void loop();
+
+    void load(const ProfileProgram &program);
+    void start();
+    void advance(uint8_t fromPhase);
+    void stop();
+    bool isRunning() const { return running || startRequest; }
+    bool ownsOutputs() const { return isRunning() || (finishedAt != 0 && millis() - finishedAt < PROFILE_EXECUTOR_HANDOVER_MS); }
+
+  private:
+    void enterPhase(uint8_t index, unsigned long now);
+    void finish(bool handover);
+    void applyOutputs(unsigned long now);
+    bool isPhaseFinished(unsigned long now);
+    float getFlow() const;
+    float getPressure() const;
+    static float evaluateTransition(uint8_t transition, float progress);
+    void reportProgress(unsigned long now);
+
+    SimpleRelay *valve;
+    Pump *pump;
+    PressureSensor *pressureSensor;
+    bool dimming;
+    program_progress_report_t progressCallback;
+    xTaskHandle taskHandle;
+    TaskMonitor monitor{"executor", PROFILE_EXECUTOR_INTERVAL_MS};
+
+    ProfileProgram program{};
+    bool loaded = false;
+    // Requests come from the BLE task and are applied by the executor task
+    volatile bool running = false;
+    volatile bool startRequest = false;
+    volatile bool stopRequest = false;
+    volatile int advanceRequest = -1; // phase the display asked to leave
+    uint8_t phaseIndex = 0;
+    unsigned long phaseStarted = 0;
+    unsigned long programStarted = 0;
+    unsigned long finishedAt = 0; // 0 if the last program was stopped by the display
+    // Setpoints when the current phase started, transitions move from these to the phase targets
+    float startPump = 0.0f;
+    float startPressure = 0.0f;
+    float startFlow = 0.0f;
+    float currentPump = 0.0f;
+    float currentPressureTarget = 0.0f;
+    float currentFlowTarget = 0.0f;
+
+    const char *LOG_TAG = "ProfileExecutor";
+    static void loopTask(void *arg);
+};
+
+#endif // PROFILEEXECUTOR_H
@@ -0,0 +1,92 @@
+#include "TaskMonitor.h"
+
+namespace {
+TaskMonitor *monitors[TASK_DIAGNOSTICS_MAX_TASKS] = {};
+volatile uint8_t monitorCount = 0;
+portMUX_TYPE monitorsMux = portMUX_INITIALIZER_UNLOCKED;
+} // namespace
+
+TaskMonitor::TaskMonitor(const char *name, unsigned long period) : name(name), period(period) {}
+
+float TaskMonitor::beginCycle() {
+    const unsigned long now = micros();
+    const unsigned long nominal = period * 1000UL;
+    float dt = static_cast<float>(period) / 1000.0f;
+    if (!registered) {
+        registered = true;
+        lastWake = xTaskGetTickCount();
+        portENTER_CRITICAL(&monitorsMux);
+        if (monitorCount < TASK_DIAGNOSTICS_MAX_TASKS) {
+            monitors[monitorCount++] = this;
+        }
+        portEXIT_CRITICAL(&monitorsMux);
+    }
+    if (lastStart != 0) {
+        const unsigned long actual = now - lastStart;
+        const unsigned long deviation = actual > nominal ? actual - nominal : nominal - actual;
+        late = actual > nominal + nominal / 2;
+        portENTER_CRITICAL(&mux);
+        periods++;
+        periodTotal += actual;
+        periodMax = max(periodMax, actual);
+        uint16_t &bucket = jitter[getTaskDiagnosticsBucket(deviation)];
+        if (bucket < UINT16_MAX)
+            bucket++;
+        portEXIT_CRITICAL(&mux);
+        dt = getControlDt(actual, nominal);
+    }
+    lastStart = now;
+    cycleStart = now;
+    return dt;
+}
+
+void TaskMonitor::endCycle() {
+    const unsigned long duration = micros() - cycleStart;
+    portENTER_CRITICAL(&mux);
+    count++;
+    if (late || duration > period * 1000UL)
+        missed++;
+    execTotal += duration;
+    execMax = max(execMax, duration);
+    uint16_t &bucket = exec[getTaskDiagnosticsBucket(duration)];
+    if (bucket < UINT16_MAX)
+        bucket++;
+    portEXIT_CRITICAL(&mux);
+
+    const TickType_t periodTicks = pdMS_TO_TICKS(period);
+    // After an overrun start a new period instead of running the missed cycles back to back
+    if (xTaskGetTickCount() - lastWake > periodTicks) {
+        lastWake = xTaskGetTickCount();
+    }
+    vTaskDelayUntil(&lastWake, periodTicks);
+}
+
+TaskDiagnostics TaskMonitor::collect() {
+    TaskDiagnostics diagnostics;
+    strlcpy(diagnostics.name, name, sizeof(diagnostics.name));
+    diagnostics.period = period;
+    portENTER_CRITICAL(&mux);
+    diagnostics.count = count;
+    diagnostics.missed = missed;
+    diagnostics.periodAvg = periods > 0 ? periodTotal / periods : 0;
+    diagnostics.periodMax = periodMax;
+    diagnostics.execAvg = count > 0 ? execTotal / count : 0;
+    diagnostics.execMax = execMax;
+    memcpy(diagnostics.jitter, jitter, sizeof(jitter));
+    memcpy(diagnostics.exec, exec, sizeof(exec));
+    count = 0;
+    missed = 0;
+    periods = 0;
+    periodTotal = 0;
+    periodMax = 0;
+    execTotal = 0;
+    execMax = 0;
+    memset(jitter, 0, sizeof(jitter));
+    memset(exec, 0, sizeof(exec));
+    portEXIT_CRITICAL(&mux);
+    return diagnostics;
+}
+
+uint8_t TaskMonitor::getCount() { return monitorCount; }
+
+TaskMonitor *TaskMonitor::get(uint8_t index) { return index < monitorCount ? monitors[index] : nullptr; }
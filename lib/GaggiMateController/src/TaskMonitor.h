@@ -0,0 +1,51 @@
+#ifndef TASKMONITOR_H
+#define TASKMONITOR_H
+
+#include "ControlTiming.h"
+#include "TaskDiagnostics.h"
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+constexpr unsigned long TASK_MONITOR_REPORT_INTERVAL_MS = 5000;
+
+// Paces a periodic task and records its timing. The task calls beginCycle() before and endCycle() after its work,
+// endCycle() sleeps until the next release so the period doesn't drift with the execution time. A monitor is listed
+// for reporting from its first cycle on, monitors of tasks that never run stay out of the reports.
+class TaskMonitor {
+  public:
+    TaskMonitor(const char *name, unsigned long period);
+
+    // Returns the time since the previous cycle in seconds, the nominal period while the jitter stays within
+    // CONTROL_JITTER_BOUND
+    float beginCycle();
+    void endCycle();
+
+    // Statistics since the previous call, resets them
+    TaskDiagnostics collect();
+
+    static uint8_t getCount();
+    static TaskMonitor *get(uint8_t index);
+
+  private:
+    const char *name;
+    const unsigned long period; // ms
+    TickType_t lastWake = 0;
+    unsigned long cycleStart = 0; // µs
+    unsigned long lastStart = 0;
+    bool late = false;
+    bool registered = false;
+
+    portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+    unsigned long count = 0;
+    unsigned long missed = 0;
+    unsigned long periods = 0;
+    uint64_t periodTotal = 0;
+    unsigned long periodMax = 0;
+    uint64_t execTotal = 0;
+    unsigned long execMax = 0;
+    uint16_t jitter[TASK_DIAGNOSTICS_BUCKETS] = {};
+    uint16_t exec[TASK_DIAGNOSTICS_BUCKETS] = {};
+};
+
+#endif // TASKMONITOR_H
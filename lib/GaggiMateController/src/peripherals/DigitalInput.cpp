@@ -4,7 +4,9 @@ DigitalInput::DigitalInput(uint8_t pin, const input_callback_t &callback) : _pin
 
 void DigitalInput::setup() {
     pinMode(_pin, INPUT_PULLUP);
+#ifndef GAGGIMATE_CYCLIC_EXECUTIVE
     xTaskCreate(loopTask, "DigitalInput::loop", configMINIMAL_STACK_SIZE * 4, this, 1, &taskHandle);
+#endif
 }
 
 void DigitalInput::loop() {
@@ -4,7 +4,8 @@
 
 DimmedPump::DimmedPump(uint8_t ssr_pin, uint8_t sense_pin, PressureSensor *pressure_sensor)
     : _ssr_pin(ssr_pin), _sense_pin(sense_pin), _psm(_sense_pin, _ssr_pin, 100, FALLING, 1, 4), _pressureSensor(pressure_sensor),
-      _pressureController(0.03f, &_targetPressure, &_currentPressure, &_controllerPower, &_valveStatus) {
+      _pressureController(DIMMED_PUMP_INTERVAL_MS / 1000.0f, &_targetPressure, &_currentPressure, &_controllerPower,
+                          &_valveStatus) {
     _psm.set(0);
 }
 
@@ -13,7 +14,9 @@ void DimmedPump::setup() {
     if (_cps > 70) {
         _cps = _cps / 2;
     }
+#ifndef GAGGIMATE_CYCLIC_EXECUTIVE
     xTaskCreate(loopTask, "DimmedPump::loop", configMINIMAL_STACK_SIZE * 4, this, 1, &taskHandle);
+#endif
 }
 
 void DimmedPump::loop() {
@@ -42,8 +45,9 @@ void DimmedPump::tare() {
 void DimmedPump::loopTask(void *arg) {
     auto *pump = static_cast<DimmedPump *>(arg);
     while (true) {
+        pump->setControlInterval(pump->monitor.beginCycle());
         pump->loop();
-        vTaskDelay(30 / portTICK_PERIOD_MS);
+        pump->monitor.endCycle();
     }
 }
 
@@ -101,3 +105,5 @@ void DimmedPump::setPressureTarget(float targetPressure, float flowLimit) {
 }
 
 void DimmedPump::setValveState(bool open) { _valveStatus = open; }
+
+void DimmedPump::setControlInterval(float dt) { _pressureController.setDt(dt); }
@@ -5,6 +5,9 @@
 #include "PressureSensor.h"
 #include "Pump.h"
 #include <Arduino.h>
+#include <TaskMonitor.h>
+
+constexpr unsigned long DIMMED_PUMP_INTERVAL_MS = 30;
 
 class DimmedPump : public Pump {
   public:
@@ -26,6 +29,8 @@ class DimmedPump : public Pump {
     void stop();
     void fullPower();
     void setValveState(bool open);
+    // Time since the previous loop() in seconds, used by the pressure controller
+    void setControlInterval(float dt);
 
   private:
     uint8_t _ssr_pin;
@@ -34,6 +39,7 @@ class DimmedPump : public Pump {
     PressureSensor *_pressureSensor;
     PressureController _pressureController;
     xTaskHandle taskHandle;
+    TaskMonitor monitor{"pump", DIMMED_PUMP_INTERVAL_MS};
 
     ControlMode _mode = ControlMode::POWER;
     float _power = 0.0f;
@@ -13,7 +13,9 @@ Heater::Heater(TemperatureSensor *sensor, uint8_t heaterPin, const heater_error_
 void Heater::setup() {
     pinMode(heaterPin, OUTPUT);
     setupPid();
+#ifndef GAGGIMATE_CYCLIC_EXECUTIVE
     xTaskCreate(loopTask, "Heater::loop", configMINIMAL_STACK_SIZE * 4, this, 1, &taskHandle);
+#endif
 }
 
 void Heater::setupPid() {
@@ -30,6 +32,9 @@ void Heater::setupAutotune(int goal, int windowSize) {
     autotuner->setRequiredConfirmations(3);
     autotuner->setTuningGoal(goal);
     autotuner->reset();
+#ifdef GAGGIMATE_CYCLIC_EXECUTIVE
+    autotuneCycleStarted = 0;
+#endif
 }
 
 void Heater::loop() {
@@ -77,6 +82,38 @@ void Heater::loopPid() {
     }
 }
 
+#ifdef GAGGIMATE_CYCLIC_EXECUTIVE
+// Runs one step per call so the heater slot keeps its period while tuning, a tuner cycle starts every
+// TUNER_OUTPUT_SPAN ms and the output is held by the soft PWM in between
+void Heater::loopAutotune() {
+    simplePid->setMode(SimplePID::Control::manual);
+    softPwm(TUNER_OUTPUT_SPAN);
+    const unsigned long loopInterval = (static_cast<unsigned long>(TUNER_OUTPUT_SPAN) - 1UL) * 1000UL;
+    const unsigned long now = micros();
+    if (autotuneCycleStarted != 0 && now - autotuneCycleStarted < loopInterval) {
+        return;
+    }
+    if (temperature > 160.0f) {
+        output = 0.0f;
+        autotuning = false;
+        softPwm(TUNER_OUTPUT_SPAN);
+        pid_callback(0, 0, 0);
+        return;
+    }
+    if (!autotuner->isFinished()) {
+        autotuneCycleStarted = now;
+        temperature = sensor->read();
+        output = 0.0f;
+        if (autotuner->maxPowerOn) {
+            output = TUNER_OUTPUT_SPAN;
+        }
+        ESP_LOGI(LOG_TAG, "Autotuner Cycle: Temperature=%.2f", temperature);
+        autotuner->update(temperature, millis() / 1000.0f);
+        return;
+    }
+    finishAutotune();
+}
+#else
 void Heater::loopAutotune() {
     simplePid->setMode(SimplePID::Control::manual);
     autotuner->reset();
@@ -103,6 +140,11 @@ void Heater::loopAutotune() {
             return;
         }
     }
+    finishAutotune();
+}
+#endif
+
+void Heater::finishAutotune() {
     output = 0.0f;
     autotuning = false;
     softPwm(TUNER_OUTPUT_SPAN);
@@ -161,7 +203,9 @@ void Heater::plot(float optimumOutput, float outputScale, uint8_t everyNth) {
 void Heater::loopTask(void *arg) {
     auto *heater = static_cast<Heater *>(arg);
     while (true) {
+        // The PID paces itself on millis(), only the timing is recorded here
+        heater->monitor.beginCycle();
         heater->loop();
-        vTaskDelay(10 / portTICK_PERIOD_MS);
+        heater->monitor.endCycle();
     }
 }
@@ -4,6 +4,7 @@
 #include "Max31855Thermocouple.h"
 #include "SimplePID.h"
 #include "TemperatureSensor.h"
+#include <TaskMonitor.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 
@@ -11,6 +12,7 @@ enum class PIDLibrary { Legacy, Nimrod };
 
 constexpr float TUNER_INPUT_SPAN = 160.0f;
 constexpr float TUNER_OUTPUT_SPAN = 1000.0f;
+constexpr unsigned long HEATER_INTERVAL_MS = 10;
 
 using heater_error_callback_t = std::function<void()>;
 using pid_result_callback_t = std::function<void(float Kp, float Ki, float Kd)>;
@@ -31,12 +33,14 @@ class Heater {
     void setupAutotune(int goal, int windowSize);
     void loopPid();
     void loopAutotune();
+    void finishAutotune();
     float softPwm(uint32_t windowSize);
     void plot(float optimumOutput, float outputScale, uint8_t everyNth);
     void setTuningGoal(float percent);
     TemperatureSensor *sensor;
     uint8_t heaterPin;
     xTaskHandle taskHandle;
+    TaskMonitor monitor{"heater", HEATER_INTERVAL_MS};
     SimplePID *simplePid = nullptr;
     Autotune *autotuner = nullptr;
 
@@ -58,6 +62,9 @@ class Heater {
     // Autotune variables
     bool startup = true;
     bool autotuning = false;
+#ifdef GAGGIMATE_CYCLIC_EXECUTIVE
+    unsigned long autotuneCycleStarted = 0; // µs
+#endif
 
     const char *LOG_TAG = "Heater";
     static void loopTask(void *arg);
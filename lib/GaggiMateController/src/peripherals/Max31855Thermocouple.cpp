@@ -23,7 +23,9 @@ void Max31855Thermocouple::setup() {
     max31855->begin();
     max31855->setSPIspeed(1000000);
 
+#ifndef GAGGIMATE_CYCLIC_EXECUTIVE
     xTaskCreate(monitorTask, "Max31855Thermocouple::monitor", configMINIMAL_STACK_SIZE * 4, this, 1, &taskHandle);
+#endif
 }
 
 void Max31855Thermocouple::loop() {
@@ -51,7 +53,8 @@ void Max31855Thermocouple::loop() {
 [[noreturn]] void Max31855Thermocouple::monitorTask(void *arg) {
     auto *thermocouple = static_cast<Max31855Thermocouple *>(arg);
     while (true) {
+        thermocouple->monitor.beginCycle();
         thermocouple->loop();
-        vTaskDelay(MAX31855_UPDATE_INTERVAL / portTICK_PERIOD_MS);
+        thermocouple->monitor.endCycle();
     }
 }
@@ -3,6 +3,7 @@
 
 #include "TemperatureSensor.h"
 #include <MAX31855.h>
+#include <TaskMonitor.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 
@@ -26,6 +27,7 @@ class Max31855Thermocouple : public TemperatureSensor {
   private:
     MAX31855 *max31855;
     xTaskHandle taskHandle;
+    TaskMonitor monitor{"thermocouple", MAX31855_UPDATE_INTERVAL};
 
     float errors = .0f;
     float temperature = .0f;
@@ -21,7 +21,9 @@ void PressureSensor::setup() {
     ads->setDataRate(4);
     ads->setMode(0);
     ads->readADC(0);
-    xTaskCreate(loopTask, "Heater::loop", configMINIMAL_STACK_SIZE * 4, this, 1, &taskHandle);
+#ifndef GAGGIMATE_CYCLIC_EXECUTIVE
+    xTaskCreate(loopTask, "PressureSensor::loop", configMINIMAL_STACK_SIZE * 4, this, 1, &taskHandle);
+#endif
 }
 
 void PressureSensor::loop() {
@@ -47,7 +49,8 @@ void PressureSensor::setScale(float pressure_scale) {
 [[noreturn]] void PressureSensor::loopTask(void *arg) {
     auto *sensor = static_cast<PressureSensor *>(arg);
     while (true) {
+        sensor->monitor.beginCycle();
         sensor->loop();
-        vTaskDelay(PRESSURE_READ_INTERVAL_MS / portTICK_PERIOD_MS);
+        sensor->monitor.endCycle();
     }
 }
@@ -3,6 +3,7 @@
 
 #include <ADS1X15.h>
 #include <Arduino.h>
+#include <TaskMonitor.h>
 
 constexpr int PRESSURE_READ_INTERVAL_MS = 30;
 constexpr float ADC_STEP = 6.144f / 32767.0f;
@@ -33,6 +34,7 @@ class PressureSensor {
     ADS1115 *ads = nullptr;
     pressure_callback_t _callback;
     xTaskHandle taskHandle;
+    TaskMonitor monitor{"pressure", PRESSURE_READ_INTERVAL_MS};
 
     const char *LOG_TAG = "PressureSensor";
     static void loopTask(void *arg);
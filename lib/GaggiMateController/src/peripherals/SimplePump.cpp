@@ -6,7 +6,9 @@ SimplePump::SimplePump(int pin, uint8_t pumpOn, float windowSize)
 void SimplePump::setup() {
     pinMode(_pin, OUTPUT);
     digitalWrite(_pin, !_pumpOn);
+#ifndef GAGGIMATE_CYCLIC_EXECUTIVE
     xTaskCreate(loopTask, "SimplePump::loop", configMINIMAL_STACK_SIZE * 8, this, 1, &taskHandle);
+#endif
 }
 
 void SimplePump::loop() {
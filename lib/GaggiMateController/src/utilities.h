@@ -3,6 +3,7 @@
 #include "ControllerConfig.h"
 #include <Arduino.h>
 #include <ArduinoJson.h>
+#include "BinaryCodec.h"
 
 inline String make_system_info(ControllerConfig config) {
     JsonDocument doc;
@@ -11,6 +12,8 @@ inline String make_system_info(ControllerConfig config) {
     JsonDocument capabilities;
     capabilities["ps"] = config.capabilites.pressure;
     capabilities["dm"] = config.capabilites.dimming;
+    capabilities["pe"] = true;
+    capabilities["pv"] = BLE_PROTOCOL_VERSION;
     doc["cp"] = capabilities;
     return doc.as<String>();
 }
@@ -16,6 +16,15 @@ PressureController::PressureController(float dt, float *rawSetpoint, float *sens
     this->pressureKF = new SimpleKalmanFilter(0.1f, 10.0f, powf(3 * _dt, 2));
     this->_P_previous = *sensorOutput;
     this->R_estimator = new RLSFilter();
+    this->R_estimator->setDt(_dt);
+}
+
+void PressureController::setDt(float dt) {
+    if (dt == _dt)
+        return;
+    _dt = dt;
+    pressureKF->setProcessNoise(powf(3 * _dt, 2));
+    R_estimator->setDt(_dt);
 }
 
 void PressureController::filterSetpoint() {
@@ -17,6 +17,8 @@ class PressureController {
     float getFilteredSetpointDeriv() const { return _dr; };
 
     void update();
+    // Measured control period, also moves the sensor filter noise and the estimator delay with it
+    void setDt(float dt);
     void filterSensor();
     void tare();
 
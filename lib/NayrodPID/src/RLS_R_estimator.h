@@ -98,6 +98,11 @@ class RLSFilter {
      */
     float getConfidence() const { return 1.0f / (P_cov + epsilon); }
 
+    /**
+     * @brief Période d'échantillonnage mesurée, utilisée pour le délai de convergence
+     */
+    void setDt(float dt) { _dt = dt; }
+
     /**
      * @brief Réinitialise le filtre avec les valeurs initiales
      */
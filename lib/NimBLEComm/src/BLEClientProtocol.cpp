@@ -0,0 +1,487 @@
+#include "BLEClientProtocol.h"
+
+#include <cstdio>
+#include <cstring>
+
+// In the order of BLEChannel
+const BLEClientProtocol::notify_decoder_t BLEClientProtocol::decoders[BLE_CHANNEL_COUNT] = {
+    nullptr, // OUTPUT_CONTROL
+    nullptr, // ALT_CONTROL
+    nullptr, // PING
+    nullptr, // PID_CONTROL
+    nullptr, // AUTOTUNE
+    nullptr, // PRESSURE_SCALE
+    nullptr, // VOLUMETRIC_TARE
+    nullptr, // PROGRAM_UPLOAD
+    nullptr, // PROGRAM_CONTROL
+    nullptr, // PROTOCOL
+    &BLEClientProtocol::onError,
+    &BLEClientProtocol::onAutotuneResult,
+    &BLEClientProtocol::onBrewButton,
+    &BLEClientProtocol::onSteamButton,
+    &BLEClientProtocol::onSensorData,
+    &BLEClientProtocol::onSensorFrame,
+    &BLEClientProtocol::onVolumetricMeasurement,
+    &BLEClientProtocol::onProgramProgress,
+    &BLEClientProtocol::onTaskDiagnostics,
+    &BLEClientProtocol::onPong,
+    nullptr, // INFO
+};
+
+void BLEClientProtocol::tare() {
+    if (canSend(BLEChannel::VOLUMETRIC_TARE)) {
+        if (isBinary()) {
+            write(BLEChannel::VOLUMETRIC_TARE, BinaryWriter());
+            return;
+        }
+        write(BLEChannel::VOLUMETRIC_TARE, "1");
+    }
+}
+
+// Writes with response so the phases arrive complete and in order before the commit message
+bool BLEClientProtocol::sendProgram(const ProfileProgram &program) {
+    if (!canSend(BLEChannel::PROGRAM_UPLOAD)) {
+        return false;
+    }
+    if (isBinary()) {
+        BinaryWriter begin;
+        encodeProgramBegin(begin, program);
+        if (!write(BLEChannel::PROGRAM_UPLOAD, begin, true)) {
+            return false;
+        }
+        for (uint8_t i = 0; i < program.phaseCount; i++) {
+            BinaryWriter phase;
+            encodeProgramPhase(phase, i, program.phases[i]);
+            if (!write(BLEChannel::PROGRAM_UPLOAD, phase, true)) {
+                return false;
+            }
+        }
+        BinaryWriter commit;
+        encodeProgramCommit(commit);
+        return write(BLEChannel::PROGRAM_UPLOAD, commit, true);
+    }
+    TextWriter begin;
+    encodeProgramBegin(begin, program);
+    if (!write(BLEChannel::PROGRAM_UPLOAD, begin, true)) {
+        return false;
+    }
+    for (uint8_t i = 0; i < program.phaseCount; i++) {
+        TextWriter phase;
+        encodeProgramPhase(phase, i, program.phases[i]);
+        if (!write(BLEChannel::PROGRAM_UPLOAD, phase, true)) {
+            return false;
+        }
+    }
+    TextWriter commit;
+    encodeProgramCommit(commit);
+    return write(BLEChannel::PROGRAM_UPLOAD, commit, true);
+}
+
+void BLEClientProtocol::sendProgramCommand(ProgramCommand command, uint8_t phase) {
+    if (!canSend(BLEChannel::PROGRAM_CONTROL)) {
+        return;
+    }
+    if (isBinary()) {
+        BinaryWriter writer;
+        encodeProgramCommand(writer, command, phase);
+        write(BLEChannel::PROGRAM_CONTROL, writer, true);
+        return;
+    }
+    char str[12];
+    switch (command) {
+    case ProgramCommand::START:
+        snprintf(str, sizeof(str), "s");
+        break;
+    case ProgramCommand::ADVANCE:
+        snprintf(str, sizeof(str), "n,%d", phase);
+        break;
+    default:
+        snprintf(str, sizeof(str), "x");
+        break;
+    }
+    write(BLEChannel::PROGRAM_CONTROL, str, true);
+}
+
+void BLEClientProtocol::registerRemoteErrorCallback(const remote_err_callback_t &callback) { remoteErrorCallback = callback; }
+void BLEClientProtocol::registerBrewBtnCallback(const brew_callback_t &callback) { brewBtnCallback = callback; }
+void BLEClientProtocol::registerSteamBtnCallback(const brew_callback_t &callback) { steamBtnCallback = callback; }
+
+void BLEClientProtocol::registerSensorCallback(const sensor_read_callback_t &callback) { sensorCallback = callback; }
+
+void BLEClientProtocol::registerSensorFrameCallback(const sensor_frame_callback_t &callback) { sensorFrameCallback = callback; }
+
+void BLEClientProtocol::registerAutotuneResultCallback(const pid_control_callback_t &callback) {
+    autotuneResultCallback = callback;
+}
+
+void BLEClientProtocol::registerVolumetricMeasurementCallback(const float_callback_t &callback) {
+    volumetricMeasurementCallback = callback;
+}
+
+void BLEClientProtocol::registerProgramProgressCallback(const program_progress_callback_t &callback) {
+    programProgressCallback = callback;
+}
+
+void BLEClientProtocol::registerTaskDiagnosticsCallback(const task_diagnostics_callback_t &callback) {
+    taskDiagnosticsCallback = callback;
+}
+
+void BLEClientProtocol::registerPongCallback(const pong_callback_t &callback) { pongCallback = callback; }
+
+void BLEClientProtocol::negotiateProtocol(uint8_t serverVersion) {
+    const uint8_t version = serverVersion < BLE_PROTOCOL_VERSION ? serverVersion : BLE_PROTOCOL_VERSION;
+    protocolVersion = BLE_PROTOCOL_TEXT;
+    if (version < BLE_PROTOCOL_BINARY || !canSend(BLEChannel::PROTOCOL)) {
+        return;
+    }
+    char str[4];
+    snprintf(str, sizeof(str), "%d", version);
+    if (write(BLEChannel::PROTOCOL, str, true)) {
+        protocolVersion = version;
+        // The last output state was sent in the old encoding, send it again in the new one
+        _lastOutputControlLength = 0;
+        _lastAltControl = -1;
+    }
+    ESP_LOGI(LOG_TAG, "Using protocol version %d", protocolVersion);
+}
+
+void BLEClientProtocol::resetConnection() {
+    // The controller board starts from a safe state, send the full output state after reconnecting
+    _lastOutputControlLength = 0;
+    _lastAltControl = -1;
+    protocolVersion = BLE_PROTOCOL_TEXT;
+    // Applied by the next setLinkMode, so only the task that sets the mode renegotiates
+    linkModePending = true;
+}
+
+void BLEClientProtocol::setLinkMode(BLELinkMode mode) {
+    if (mode != linkMode) {
+        linkMode = mode;
+        linkModePending = true;
+    }
+    if (linkModePending && transport.isConnected()) {
+        linkModePending = false;
+        applyLinkMode();
+    }
+}
+
+void BLEClientProtocol::applyLinkMode() {
+    const BLEConnectionParams &params = getLinkModeParams(linkMode);
+    if (!transport.updateConnectionParams(params)) {
+        ESP_LOGW(LOG_TAG, "Failed to switch the link to %s", getLinkModeName(linkMode));
+        return;
+    }
+    linkModeChanged = nowMillis();
+    ESP_LOGI(LOG_TAG, "Link switched to %s, interval %.2f-%.2fms, latency %d", getLinkModeName(linkMode),
+             params.minInterval * 1.25f, params.maxInterval * 1.25f, params.latency);
+}
+
+bool BLEClientProtocol::write(BLEChannel channel, const BinaryWriter &writer, bool response) {
+    if (!writer.ok()) {
+        ESP_LOGE(LOG_TAG, "Binary message exceeds %d bytes", static_cast<int>(BLE_BINARY_MAX_LENGTH));
+        return false;
+    }
+    return transport.send(channel, writer.data(), writer.size(), response);
+}
+
+bool BLEClientProtocol::write(BLEChannel channel, const TextWriter &writer, bool response) {
+    if (!writer.ok()) {
+        ESP_LOGE(LOG_TAG, "Text message exceeds %d bytes", static_cast<int>(TEXT_MESSAGE_MAX_LENGTH));
+        return false;
+    }
+    return transport.send(channel, writer.data(), writer.size(), response);
+}
+
+bool BLEClientProtocol::write(BLEChannel channel, const char *text, bool response) {
+    return transport.send(channel, reinterpret_cast<const uint8_t *>(text), strlen(text), response);
+}
+
+std::string BLEClientProtocol::readInfo() const {
+    if (transport.has(BLEChannel::INFO)) {
+        return transport.read(BLEChannel::INFO);
+    }
+    return "";
+}
+
+void BLEClientProtocol::sendAdvancedOutputControl(bool valve, float boilerSetpoint, bool pressureTarget, float pressure,
+                                                  float flow) {
+    if (canSend(BLEChannel::OUTPUT_CONTROL)) {
+        if (isBinary()) {
+            BinaryWriter writer;
+            OutputControl control;
+            control.valve = valve;
+            control.advanced = true;
+            control.pressureTarget = pressureTarget;
+            control.boilerSetpoint = boilerSetpoint;
+            control.pressure = pressure;
+            control.flow = flow;
+            encodeOutputControl(writer, control);
+            writeOutputControl(writer.data(), writer.size());
+            return;
+        }
+        char str[48];
+        snprintf(str, sizeof(str), "%d,%d,%.1f,%.1f,%d,%.2f,%.2f", 1, valve ? 1 : 0, 100.0f, boilerSetpoint,
+                 pressureTarget ? 1 : 0, pressure, flow);
+        writeOutputControl(reinterpret_cast<const uint8_t *>(str), strlen(str));
+    }
+}
+
+void BLEClientProtocol::sendOutputControl(bool valve, float pumpSetpoint, float boilerSetpoint) {
+    if (canSend(BLEChannel::OUTPUT_CONTROL)) {
+        if (isBinary()) {
+            BinaryWriter writer;
+            OutputControl control;
+            control.valve = valve;
+            control.pump = pumpSetpoint;
+            control.boilerSetpoint = boilerSetpoint;
+            encodeOutputControl(writer, control);
+            writeOutputControl(writer.data(), writer.size());
+            return;
+        }
+        char str[30];
+        snprintf(str, sizeof(str), "%d,%d,%.1f,%.1f", 0, valve ? 1 : 0, pumpSetpoint, boilerSetpoint);
+        writeOutputControl(reinterpret_cast<const uint8_t *>(str), strlen(str));
+    }
+}
+
+void BLEClientProtocol::writeOutputControl(const uint8_t *data, size_t length) {
+    const unsigned long now = nowMillis();
+    if (length > sizeof(_lastOutputControl)) {
+        return;
+    }
+    if (length == _lastOutputControlLength && memcmp(_lastOutputControl, data, length) == 0 &&
+        now - _lastOutputControlSent < outputKeepAliveInterval) {
+        return;
+    }
+    memcpy(_lastOutputControl, data, length);
+    _lastOutputControlLength = length;
+    _lastOutputControlSent = now;
+    transport.send(BLEChannel::OUTPUT_CONTROL, _lastOutputControl, _lastOutputControlLength);
+}
+
+void BLEClientProtocol::sendPidSettings(const char *pid) {
+    if (canSend(BLEChannel::PID_CONTROL)) {
+        if (isBinary()) {
+            const TextMessage message(reinterpret_cast<const uint8_t *>(pid), strlen(pid));
+            BinaryWriter writer;
+            encodePidSettings(writer, PidSettings{message.getFloat(0), message.getFloat(1), message.getFloat(2)});
+            write(BLEChannel::PID_CONTROL, writer);
+            return;
+        }
+        write(BLEChannel::PID_CONTROL, pid);
+    }
+}
+
+void BLEClientProtocol::setPressureScale(float scale) {
+    if (canSend(BLEChannel::PRESSURE_SCALE)) {
+        if (isBinary()) {
+            BinaryWriter writer;
+            encodeFloat(writer, scale);
+            write(BLEChannel::PRESSURE_SCALE, writer);
+            return;
+        }
+        char str[16];
+        snprintf(str, sizeof(str), "%.2f", scale);
+        write(BLEChannel::PRESSURE_SCALE, str);
+    }
+}
+
+void BLEClientProtocol::sendAltControl(bool pinState) {
+    if (canSend(BLEChannel::ALT_CONTROL)) {
+        const unsigned long now = nowMillis();
+        if (_lastAltControl == (pinState ? 1 : 0) && now - _lastAltControlSent < outputKeepAliveInterval) {
+            return;
+        }
+        _lastAltControl = pinState ? 1 : 0;
+        _lastAltControlSent = now;
+        if (isBinary()) {
+            BinaryWriter writer;
+            encodeBool(writer, pinState);
+            write(BLEChannel::ALT_CONTROL, writer);
+            return;
+        }
+        write(BLEChannel::ALT_CONTROL, pinState ? "1" : "0");
+    }
+}
+
+void BLEClientProtocol::sendPing() {
+    if (canSend(BLEChannel::PING)) {
+        if (isBinary()) {
+            BinaryWriter writer;
+            encodePing(writer, transport.now());
+            write(BLEChannel::PING, writer);
+            return;
+        }
+        write(BLEChannel::PING, "1");
+    }
+}
+
+void BLEClientProtocol::sendAutotune(int testTime, int samples) {
+    if (canSend(BLEChannel::AUTOTUNE)) {
+        if (isBinary()) {
+            BinaryWriter writer;
+            encodeAutotune(writer, testTime, samples);
+            write(BLEChannel::AUTOTUNE, writer);
+            return;
+        }
+        char autotuneStr[20];
+        snprintf(autotuneStr, sizeof(autotuneStr), "%d,%d", testTime, samples);
+        write(BLEChannel::AUTOTUNE, autotuneStr);
+    }
+}
+
+// Runs on the BLE host task on the boards
+void BLEClientProtocol::onReceive(BLEChannel channel, const uint8_t *data, size_t length, uint64_t received) const {
+    const notify_decoder_t decoder = channel < BLEChannel::COUNT ? decoders[channelIndex(channel)] : nullptr;
+    if (decoder != nullptr) {
+        (this->*decoder)(data, length, received);
+    }
+}
+
+void BLEClientProtocol::onError(const uint8_t *data, size_t length, uint64_t) const {
+    int32_t errorCode = 0;
+    if (isBinaryMessage(data, length)) {
+        BinaryReader reader(data, length);
+        if (!decodeInt(reader, errorCode))
+            return;
+    } else {
+        errorCode = TextMessage(data, length).getInt(0);
+    }
+    ESP_LOGV(LOG_TAG, "Error read: %d", errorCode);
+    if (remoteErrorCallback != nullptr) {
+        remoteErrorCallback(errorCode);
+    }
+}
+
+void BLEClientProtocol::onBrewButton(const uint8_t *data, size_t length, uint64_t) const {
+    bool brewButtonStatus = false;
+    if (isBinaryMessage(data, length)) {
+        BinaryReader reader(data, length);
+        if (!decodeBool(reader, brewButtonStatus))
+            return;
+    } else {
+        brewButtonStatus = TextMessage(data, length).getInt(0) != 0;
+    }
+    ESP_LOGV(LOG_TAG, "brew button: %d", brewButtonStatus);
+    if (brewBtnCallback != nullptr) {
+        brewBtnCallback(brewButtonStatus);
+    }
+}
+
+void BLEClientProtocol::onSteamButton(const uint8_t *data, size_t length, uint64_t) const {
+    bool steamButtonStatus = false;
+    if (isBinaryMessage(data, length)) {
+        BinaryReader reader(data, length);
+        if (!decodeBool(reader, steamButtonStatus))
+            return;
+    } else {
+        steamButtonStatus = TextMessage(data, length).getInt(0) != 0;
+    }
+    ESP_LOGV(LOG_TAG, "steam button: %d", steamButtonStatus);
+    if (steamBtnCallback != nullptr) {
+        steamBtnCallback(steamButtonStatus);
+    }
+}
+
+void BLEClientProtocol::onSensorData(const uint8_t *data, size_t length, uint64_t) const {
+    SensorData sensor;
+    if (isBinaryMessage(data, length)) {
+        BinaryReader reader(data, length);
+        if (!decodeSensorData(reader, sensor))
+            return;
+    } else {
+        const TextMessage message(data, length);
+        sensor.temperature = message.getFloat(0);
+        sensor.pressure = message.getFloat(1);
+        sensor.flow = message.getFloat(2);
+    }
+    ESP_LOGV(LOG_TAG, "Received sensor data: temperature=%.1f, pressure=%.1f, flow=%.1f", sensor.temperature, sensor.pressure,
+             sensor.flow);
+    if (sensorCallback != nullptr) {
+        sensorCallback(sensor.temperature, sensor.pressure, sensor.flow);
+    }
+}
+
+void BLEClientProtocol::onSensorFrame(const uint8_t *data, size_t length, uint64_t) const {
+    BinaryReader reader(data, length);
+    SensorFrame frame;
+    if (!decodeSensorFrame(reader, frame))
+        return;
+    ESP_LOGV(LOG_TAG, "Received sensor frame: %d samples", frame.count);
+    if (sensorFrameCallback != nullptr) {
+        sensorFrameCallback(frame);
+    }
+}
+
+void BLEClientProtocol::onAutotuneResult(const uint8_t *data, size_t length, uint64_t) const {
+    PidSettings pid;
+    if (isBinaryMessage(data, length)) {
+        BinaryReader reader(data, length);
+        if (!decodePidSettings(reader, pid))
+            return;
+    } else {
+        const TextMessage message(data, length);
+        pid.Kp = message.getFloat(0);
+        pid.Ki = message.getFloat(1);
+        pid.Kd = message.getFloat(2);
+    }
+    ESP_LOGV(LOG_TAG, "autotune result: %.3f, %.3f, %.3f", pid.Kp, pid.Ki, pid.Kd);
+    if (autotuneResultCallback != nullptr) {
+        autotuneResultCallback(pid.Kp, pid.Ki, pid.Kd);
+    }
+}
+
+void BLEClientProtocol::onVolumetricMeasurement(const uint8_t *data, size_t length, uint64_t) const {
+    float value = 0.0f;
+    if (isBinaryMessage(data, length)) {
+        BinaryReader reader(data, length);
+        if (!decodeFloat(reader, value))
+            return;
+    } else {
+        value = TextMessage(data, length).getFloat(0);
+    }
+    ESP_LOGV(LOG_TAG, "Volumetric measurement: %.2f", value);
+    if (volumetricMeasurementCallback != nullptr) {
+        volumetricMeasurementCallback(value);
+    }
+}
+
+void BLEClientProtocol::onProgramProgress(const uint8_t *data, size_t length, uint64_t) const {
+    ProgramProgress progress;
+    if (isBinaryMessage(data, length)) {
+        BinaryReader reader(data, length);
+        if (!decodeProgramProgress(reader, progress))
+            return;
+    } else {
+        decodeProgramProgress(TextMessage(data, length), progress);
+    }
+    ESP_LOGV(LOG_TAG, "Program progress: %lu, phase %d", static_cast<unsigned long>(progress.id), progress.phase);
+    if (programProgressCallback != nullptr) {
+        programProgressCallback(progress);
+    }
+}
+
+void BLEClientProtocol::onTaskDiagnostics(const uint8_t *data, size_t length, uint64_t) const {
+    if (taskDiagnosticsCallback == nullptr) {
+        return;
+    }
+    // Only sent in binary
+    TaskDiagnostics diagnostics;
+    BinaryReader reader(data, length);
+    if (!isBinaryMessage(data, length) || !decodeTaskDiagnostics(reader, diagnostics)) {
+        return;
+    }
+    taskDiagnosticsCallback(diagnostics);
+}
+
+void BLEClientProtocol::onPong(const uint8_t *data, size_t length, uint64_t received) const {
+    BinaryReader reader(data, length);
+    ClockExchange exchange;
+    if (!decodePong(reader, exchange))
+        return;
+    exchange.returned = received;
+    ESP_LOGV(LOG_TAG, "Pong: round trip %lldus", static_cast<long long>(exchange.roundTrip()));
+    if (pongCallback != nullptr) {
+        pongCallback(exchange);
+    }
+}
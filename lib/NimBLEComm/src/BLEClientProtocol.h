@@ -0,0 +1,148 @@
+#ifndef BLECLIENTPROTOCOL_H
+#define BLECLIENTPROTOCOL_H
+
+#include "BLEProtocol.h"
+#include <string>
+
+constexpr unsigned long OUTPUT_KEEPALIVE_DEFAULT_MS = 1000;
+// Time the peer gets to switch to the connection parameters of a new link mode, at the slowest interval the update
+// procedure takes several hundred milliseconds
+constexpr unsigned long LINK_MODE_SETTLE_MS = 2000;
+
+// How responsive the link has to be, each mode has its own connection parameters
+enum class BLELinkMode : uint8_t {
+    STANDBY, // nothing to control, slow interval and the controller board may skip events
+    IDLE,    // awake without a process expected soon
+    ACTIVE,  // a process is running or about to be started
+};
+constexpr uint8_t BLE_LINK_MODE_COUNT = 3;
+
+inline const BLEConnectionParams &getLinkModeParams(BLELinkMode mode) {
+    // The supervision timeout has to cover more than two of the longest gaps, interval * (latency + 1)
+    static constexpr BLEConnectionParams params[BLE_LINK_MODE_COUNT] = {
+        {80, 100, 4, 600}, // 100-125ms, up to 625ms between listening windows of the controller board
+        {24, 40, 0, 400},  // 30-50ms
+        {6, 8, 0, 400},    // 7.5-10ms
+    };
+    return params[static_cast<uint8_t>(mode)];
+}
+
+inline const char *getLinkModeName(BLELinkMode mode) {
+    switch (mode) {
+    case BLELinkMode::STANDBY:
+        return "standby";
+    case BLELinkMode::IDLE:
+        return "idle";
+    case BLELinkMode::ACTIVE:
+        return "active";
+    }
+    return "";
+}
+
+// Display side of the protocol: encodes the commands for the controller board and decodes its notifications. Only
+// talks to the transport, the owner connects it and forwards what the transport receives to onReceive.
+class BLEClientProtocol {
+  public:
+    explicit BLEClientProtocol(BLETransport &transport) : transport(transport) {}
+
+    // Switches to the highest protocol version both sides support, serverVersion is "pv" from the info capabilities
+    void negotiateProtocol(uint8_t serverVersion);
+    uint8_t getProtocolVersion() const { return protocolVersion; }
+
+    void sendAdvancedOutputControl(bool valve, float boilerSetpoint, bool pressureTarget, float pressure, float flow);
+
+    void sendOutputControl(bool valve, float pumpSetpoint, float boilerSetpoint);
+    void sendAltControl(bool pinState);
+    void setOutputKeepAlive(unsigned long interval) { outputKeepAliveInterval = interval; }
+    void sendPing();
+    void sendAutotune(int testTime, int samples);
+    // "<Kp>,<Ki>,<Kd>" as stored in the settings
+    void sendPidSettings(const char *pid);
+    void setPressureScale(float scale);
+    bool isConnected() const { return transport.isConnected(); }
+    void tare();
+    bool sendProgram(const ProfileProgram &program);
+    void sendProgramCommand(ProgramCommand command, uint8_t phase = 0);
+    void registerRemoteErrorCallback(const remote_err_callback_t &callback);
+    void registerBrewBtnCallback(const brew_callback_t &callback);
+    void registerSteamBtnCallback(const steam_callback_t &callback);
+    void registerSensorCallback(const sensor_read_callback_t &callback);
+    void registerSensorFrameCallback(const sensor_frame_callback_t &callback);
+    void registerAutotuneResultCallback(const pid_control_callback_t &callback);
+    void registerVolumetricMeasurementCallback(const float_callback_t &callback);
+    void registerProgramProgressCallback(const program_progress_callback_t &callback);
+    void registerTaskDiagnosticsCallback(const task_diagnostics_callback_t &callback);
+    // Called with the timestamps of every answered ping, only controller boards with the pong characteristic answer
+    void registerPongCallback(const pong_callback_t &callback);
+    std::string readInfo() const;
+    // Renegotiates the connection parameters when the mode changes or the connection is new. Call it regularly from
+    // one task, a new connection only switches to the current mode on the next call.
+    void setLinkMode(BLELinkMode mode);
+    BLELinkMode getLinkMode() const { return linkMode; }
+    // False while the peer may still be on the parameters of the previous mode, time in ms of the transport clock
+    bool isLinkModeSettled(unsigned long time) const { return time - linkModeChanged >= LINK_MODE_SETTLE_MS; }
+
+    // Dispatches a notification to the decoder of its channel
+    void onReceive(BLEChannel channel, const uint8_t *data, size_t length, uint64_t received) const;
+
+  protected:
+    // Back to text with the full output state resent, for every new connection
+    void resetConnection();
+
+    BLETransport &transport;
+
+  private:
+    using notify_decoder_t = void (BLEClientProtocol::*)(const uint8_t *data, size_t length, uint64_t received) const;
+
+    // Decoder of every channel, nullptr for the ones the client doesn't receive
+    static const notify_decoder_t decoders[BLE_CHANNEL_COUNT];
+
+    uint8_t protocolVersion = BLE_PROTOCOL_TEXT;
+    BLELinkMode linkMode = BLELinkMode::ACTIVE;
+    unsigned long linkModeChanged = 0;
+    bool linkModePending = false;
+
+    remote_err_callback_t remoteErrorCallback = nullptr;
+    brew_callback_t brewBtnCallback = nullptr;
+    steam_callback_t steamBtnCallback = nullptr;
+    pid_control_callback_t autotuneResultCallback = nullptr;
+    sensor_read_callback_t sensorCallback = nullptr;
+    sensor_frame_callback_t sensorFrameCallback = nullptr;
+    float_callback_t volumetricMeasurementCallback = nullptr;
+    program_progress_callback_t programProgressCallback = nullptr;
+    task_diagnostics_callback_t taskDiagnosticsCallback = nullptr;
+    pong_callback_t pongCallback = nullptr;
+
+    // Output writes are skipped while they repeat the last state, except for a keep-alive in case a write got lost
+    uint8_t _lastOutputControl[BLE_BINARY_MAX_LENGTH];
+    size_t _lastOutputControlLength = 0;
+    unsigned long _lastOutputControlSent = 0;
+    int _lastAltControl = -1;
+    unsigned long _lastAltControlSent = 0;
+    unsigned long outputKeepAliveInterval = OUTPUT_KEEPALIVE_DEFAULT_MS;
+
+    bool isBinary() const { return protocolVersion >= BLE_PROTOCOL_BINARY; }
+    bool canSend(BLEChannel channel) const { return transport.isConnected() && transport.has(channel); }
+    unsigned long nowMillis() const { return transport.now() / 1000; }
+    bool write(BLEChannel channel, const BinaryWriter &writer, bool response = false);
+    bool write(BLEChannel channel, const TextWriter &writer, bool response = false);
+    bool write(BLEChannel channel, const char *text, bool response = false);
+    void writeOutputControl(const uint8_t *data, size_t length);
+    void applyLinkMode();
+
+    // Decoders of the notify channels, each accepts the text and the binary encoding
+    void onError(const uint8_t *data, size_t length, uint64_t received) const;
+    void onBrewButton(const uint8_t *data, size_t length, uint64_t received) const;
+    void onSteamButton(const uint8_t *data, size_t length, uint64_t received) const;
+    void onSensorData(const uint8_t *data, size_t length, uint64_t received) const;
+    void onSensorFrame(const uint8_t *data, size_t length, uint64_t received) const; // binary only
+    void onAutotuneResult(const uint8_t *data, size_t length, uint64_t received) const;
+    void onVolumetricMeasurement(const uint8_t *data, size_t length, uint64_t received) const;
+    void onProgramProgress(const uint8_t *data, size_t length, uint64_t received) const;
+    void onTaskDiagnostics(const uint8_t *data, size_t length, uint64_t received) const;
+    void onPong(const uint8_t *data, size_t length, uint64_t received) const; // binary only
+
+    const char *LOG_TAG = "BLEClientProtocol";
+};
+
+#endif // BLECLIENTPROTOCOL_H
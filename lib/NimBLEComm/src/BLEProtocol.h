@@ -0,0 +1,47 @@
+#ifndef BLEPROTOCOL_H
+#define BLEPROTOCOL_H
+
+#include "BLETransport.h"
+#include "BinaryCodec.h"
+#include "TextCodec.h"
+#include <functional>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+// The protocol layers also run on the host, where there is nothing to log to
+#define ESP_LOGE(tag, format, ...) ((void)(tag))
+#define ESP_LOGW(tag, format, ...) ((void)(tag))
+#define ESP_LOGI(tag, format, ...) ((void)(tag))
+#define ESP_LOGV(tag, format, ...) ((void)(tag))
+#endif
+
+constexpr size_t ERROR_CODE_COMM_SEND = 1;
+constexpr size_t ERROR_CODE_COMM_RCV = 2;
+constexpr size_t ERROR_CODE_PROTO_ERR = 3;
+constexpr size_t ERROR_CODE_RUNAWAY = 4;
+constexpr size_t ERROR_CODE_TIMEOUT = 5;
+
+using pin_control_callback_t = std::function<void(bool isActive)>;
+using pid_control_callback_t = std::function<void(float Kp, float Ki, float Kd)>;
+using ping_callback_t = std::function<void()>;
+using remote_err_callback_t = std::function<void(int errorCode)>;
+using autotune_callback_t = std::function<void(int testTime, int samples)>;
+using brew_callback_t = std::function<void(bool brewButtonStatus)>;
+using steam_callback_t = std::function<void(bool steamButtonStatus)>;
+using void_callback_t = std::function<void()>;
+
+// New combined callbacks
+using float_callback_t = std::function<void(float val)>;
+using simple_output_callback_t = std::function<void(bool valve, float pumpSetpoint, float boilerSetpoint)>;
+using advanced_output_callback_t =
+    std::function<void(bool valve, float boilerSetpoint, bool pressureTarget, float pumpPressure, float pumpFlow)>;
+using sensor_read_callback_t = std::function<void(float temperature, float pressure, float flow)>;
+using sensor_frame_callback_t = std::function<void(const SensorFrame &frame)>;
+using program_upload_callback_t = std::function<void(const ProfileProgram &program)>;
+using program_control_callback_t = std::function<void(ProgramCommand command, uint8_t phase)>;
+using program_progress_callback_t = std::function<void(const ProgramProgress &progress)>;
+using task_diagnostics_callback_t = std::function<void(const TaskDiagnostics &diagnostics)>;
+using pong_callback_t = std::function<void(const ClockExchange &exchange)>;
+
+#endif // BLEPROTOCOL_H
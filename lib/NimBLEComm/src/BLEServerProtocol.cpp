@@ -0,0 +1,366 @@
+#include "BLEServerProtocol.h"
+
+void BLEServerProtocol::sendSensorData(float temperature, float pressure, float flow) {
+    if (canSend(BLEChannel::SENSOR_DATA)) {
+        if (isBinary()) {
+            BinaryWriter writer;
+            encodeSensorData(writer, SensorData{temperature, pressure, flow});
+            notify(BLEChannel::SENSOR_DATA, writer);
+            return;
+        }
+        TextWriter writer;
+        writer.print("%.3f,%.3f,%.3f", temperature, pressure, flow);
+        notify(BLEChannel::SENSOR_DATA, writer);
+    }
+}
+
+uint8_t BLEServerProtocol::getSensorFrameCapacity() const {
+    if (!canSend(BLEChannel::SENSOR_FRAME) || protocolVersion < BLE_PROTOCOL_SENSOR_FRAMES)
+        return 0;
+    return sensorFrameCapacity(transport.getPayloadSize());
+}
+
+void BLEServerProtocol::sendSensorFrame(const SensorSample *samples, uint8_t count) {
+    if (count == 0 || getSensorFrameCapacity() == 0)
+        return;
+    BinaryWriter writer;
+    encodeSensorFrame(writer, samples, count);
+    notify(BLEChannel::SENSOR_FRAME, writer);
+}
+
+void BLEServerProtocol::sendError(int errorCode) {
+    if (canSend(BLEChannel::REMOTE_ERROR)) {
+        if (isBinary()) {
+            BinaryWriter writer;
+            encodeInt(writer, errorCode);
+            notify(BLEChannel::REMOTE_ERROR, writer);
+            return;
+        }
+        TextWriter writer;
+        writer.print("%d", errorCode);
+        notify(BLEChannel::REMOTE_ERROR, writer);
+    }
+}
+
+void BLEServerProtocol::sendBrewBtnState(bool brewButtonStatus) {
+    if (canSend(BLEChannel::BREW_BUTTON)) {
+        if (isBinary()) {
+            BinaryWriter writer;
+            encodeBool(writer, brewButtonStatus);
+            notify(BLEChannel::BREW_BUTTON, writer);
+            return;
+        }
+        TextWriter writer;
+        writer.print("%d", brewButtonStatus);
+        notify(BLEChannel::BREW_BUTTON, writer);
+    }
+}
+
+void BLEServerProtocol::sendSteamBtnState(bool steamButtonStatus) {
+    if (canSend(BLEChannel::STEAM_BUTTON)) {
+        if (isBinary()) {
+            BinaryWriter writer;
+            encodeBool(writer, steamButtonStatus);
+            notify(BLEChannel::STEAM_BUTTON, writer);
+            return;
+        }
+        TextWriter writer;
+        writer.print("%d", steamButtonStatus);
+        notify(BLEChannel::STEAM_BUTTON, writer);
+    }
+}
+
+void BLEServerProtocol::sendAutotuneResult(float Kp, float Ki, float Kd) {
+    if (canSend(BLEChannel::AUTOTUNE_RESULT)) {
+        if (isBinary()) {
+            BinaryWriter writer;
+            encodePidSettings(writer, PidSettings{Kp, Ki, Kd});
+            notify(BLEChannel::AUTOTUNE_RESULT, writer);
+            return;
+        }
+        TextWriter writer;
+        writer.print("%.3f,%.3f,%.3f", Kp, Ki, Kd);
+        notify(BLEChannel::AUTOTUNE_RESULT, writer);
+    }
+}
+
+void BLEServerProtocol::sendVolumetricMeasurement(float value) {
+    if (canSend(BLEChannel::VOLUMETRIC_MEASUREMENT)) {
+        if (isBinary()) {
+            BinaryWriter writer;
+            encodeFloat(writer, value);
+            notify(BLEChannel::VOLUMETRIC_MEASUREMENT, writer);
+            return;
+        }
+        TextWriter writer;
+        writer.print("%.2f", value);
+        notify(BLEChannel::VOLUMETRIC_MEASUREMENT, writer);
+    }
+}
+
+void BLEServerProtocol::sendProgramProgress(const ProgramProgress &progress) {
+    if (canSend(BLEChannel::PROGRAM_PROGRESS)) {
+        if (isBinary()) {
+            BinaryWriter writer;
+            encodeProgramProgress(writer, progress);
+            notify(BLEChannel::PROGRAM_PROGRESS, writer);
+            return;
+        }
+        TextWriter writer;
+        encodeProgramProgress(writer, progress);
+        notify(BLEChannel::PROGRAM_PROGRESS, writer);
+    }
+}
+
+// Binary only, in text a report with large counters doesn't fit into one notification
+void BLEServerProtocol::sendTaskDiagnostics(const TaskDiagnostics &diagnostics) {
+    if (canSend(BLEChannel::TASK_DIAGNOSTICS) && isBinary()) {
+        BinaryWriter writer;
+        encodeTaskDiagnostics(writer, diagnostics);
+        notify(BLEChannel::TASK_DIAGNOSTICS, writer);
+    }
+}
+
+void BLEServerProtocol::notify(BLEChannel channel, const BinaryWriter &writer) {
+    if (!writer.ok()) {
+        ESP_LOGE(LOG_TAG, "Binary message exceeds %d bytes", static_cast<int>(BLE_BINARY_MAX_LENGTH));
+        return;
+    }
+    notify(channel, writer.data(), writer.size());
+}
+
+void BLEServerProtocol::notify(BLEChannel channel, const TextWriter &writer) {
+    if (!writer.ok()) {
+        ESP_LOGE(LOG_TAG, "Text message exceeds %d bytes", static_cast<int>(TEXT_MESSAGE_MAX_LENGTH));
+        return;
+    }
+    notify(channel, writer.data(), writer.size());
+}
+
+// A notification longer than the payload would be cut off by the stack, the receiver can't tell
+void BLEServerProtocol::notify(BLEChannel channel, const uint8_t *data, size_t length) {
+    if (length > transport.getPayloadSize()) {
+        ESP_LOGE(LOG_TAG, "Notification of %d bytes exceeds the payload of %d bytes", static_cast<int>(length),
+                 static_cast<int>(transport.getPayloadSize()));
+        return;
+    }
+    transport.send(channel, data, length);
+}
+
+void BLEServerProtocol::registerOutputControlCallback(const simple_output_callback_t &callback) {
+    outputControlCallback = callback;
+}
+
+void BLEServerProtocol::registerAdvancedOutputControlCallback(const advanced_output_callback_t &callback) {
+    advancedControlCallback = callback;
+}
+
+void BLEServerProtocol::registerAltControlCallback(const pin_control_callback_t &callback) { altControlCallback = callback; }
+void BLEServerProtocol::registerPingCallback(const ping_callback_t &callback) { pingCallback = callback; }
+void BLEServerProtocol::registerAutotuneCallback(const autotune_callback_t &callback) { autotuneCallback = callback; }
+void BLEServerProtocol::registerPressureScaleCallback(const float_callback_t &callback) { pressureScaleCallback = callback; }
+
+void BLEServerProtocol::registerTareCallback(const void_callback_t &callback) { tareCallback = callback; }
+
+void BLEServerProtocol::registerProgramUploadCallback(const program_upload_callback_t &callback) {
+    programUploadCallback = callback;
+}
+
+void BLEServerProtocol::registerProgramControlCallback(const program_control_callback_t &callback) {
+    programControlCallback = callback;
+}
+
+void BLEServerProtocol::registerPidControlCallback(const pid_control_callback_t &callback) { pidControlCallback = callback; }
+
+void BLEServerProtocol::resetConnection() { protocolVersion = BLE_PROTOCOL_TEXT; }
+
+void BLEServerProtocol::onReceive(BLEChannel channel, const uint8_t *data, size_t length, uint64_t received) {
+    ESP_LOGV(LOG_TAG, "Write received!");
+    if (isBinaryMessage(data, length)) {
+        BinaryReader reader(data, length);
+        onBinaryWrite(channel, reader, received);
+        return;
+    }
+    onTextWrite(channel, TextMessage(data, length));
+}
+
+void BLEServerProtocol::onTextWrite(BLEChannel channel, const TextMessage &message) {
+    switch (channel) {
+    case BLEChannel::PROTOCOL: {
+        const long version = message.getInt(0);
+        protocolVersion = version < BLE_PROTOCOL_TEXT      ? BLE_PROTOCOL_TEXT
+                          : version > BLE_PROTOCOL_VERSION ? BLE_PROTOCOL_VERSION
+                                                           : static_cast<uint8_t>(version);
+        ESP_LOGI(LOG_TAG, "Client selected protocol version %d", protocolVersion);
+        break;
+    }
+    case BLEChannel::OUTPUT_CONTROL: {
+        const long type = message.getInt(0);
+        const bool valve = message.getInt(1) == 1;
+        const float boilerSetpoint = message.getFloat(3);
+        if (type == 0) {
+            const float pumpSetpoint = message.getFloat(2);
+            ESP_LOGV(LOG_TAG, "Received output control: valve=%d, pump=%.1f, boiler=%.1f", valve, pumpSetpoint, boilerSetpoint);
+            if (outputControlCallback != nullptr) {
+                outputControlCallback(valve, pumpSetpoint, boilerSetpoint);
+            }
+        } else if (type == 1) {
+            const bool pressureTarget = message.getInt(4) == 1;
+            const float pumpPressure = message.getFloat(5);
+            const float pumpFlow = message.getFloat(6);
+            ESP_LOGV(LOG_TAG, "Received advanced output control: valve=%d, pressure_target=%d, pressure=%.1f, flow=%.1f", valve,
+                     pressureTarget, pumpPressure, pumpFlow);
+            if (advancedControlCallback != nullptr) {
+                advancedControlCallback(valve, boilerSetpoint, pressureTarget, pumpPressure, pumpFlow);
+            }
+        }
+        break;
+    }
+    case BLEChannel::ALT_CONTROL: {
+        const bool pinState = message.getText()[0] == '1';
+        ESP_LOGV(LOG_TAG, "Received ALT control: %s", pinState ? "ON" : "OFF");
+        if (altControlCallback != nullptr) {
+            altControlCallback(pinState);
+        }
+        break;
+    }
+    case BLEChannel::PING:
+        ESP_LOGV(LOG_TAG, "Received ping");
+        if (pingCallback != nullptr) {
+            pingCallback();
+        }
+        break;
+    case BLEChannel::AUTOTUNE:
+        ESP_LOGV(LOG_TAG, "Received autotune");
+        if (autotuneCallback != nullptr) {
+            autotuneCallback(message.getInt(0), message.getInt(1));
+        }
+        break;
+    case BLEChannel::PID_CONTROL: {
+        const float Kp = message.getFloat(0);
+        const float Ki = message.getFloat(1);
+        const float Kd = message.getFloat(2);
+        ESP_LOGV(LOG_TAG, "Received PID settings: %.2f, %.2f, %.2f", Kp, Ki, Kd);
+        if (pidControlCallback != nullptr) {
+            pidControlCallback(Kp, Ki, Kd);
+        }
+        break;
+    }
+    case BLEChannel::PRESSURE_SCALE: {
+        const float scale = message.getFloat(0);
+        ESP_LOGV(LOG_TAG, "Received pressure scale: %.2f", scale);
+        if (pressureScaleCallback != nullptr) {
+            pressureScaleCallback(scale);
+        }
+        break;
+    }
+    case BLEChannel::VOLUMETRIC_TARE:
+        ESP_LOGV(LOG_TAG, "Received tare");
+        if (tareCallback != nullptr) {
+            tareCallback();
+        }
+        break;
+    case BLEChannel::PROGRAM_UPLOAD:
+        ESP_LOGV(LOG_TAG, "Received program upload: %s", message.getText());
+        if (decodeProgramMessage(message, pendingProgram) && programUploadCallback != nullptr) {
+            programUploadCallback(pendingProgram);
+        }
+        break;
+    case BLEChannel::PROGRAM_CONTROL: {
+        // "s", "n,<phase>" or "x"
+        const char command = message.getText()[0];
+        ESP_LOGV(LOG_TAG, "Received program control: %s", message.getText());
+        if (programControlCallback != nullptr) {
+            if (command == 's') {
+                programControlCallback(ProgramCommand::START, 0);
+            } else if (command == 'n') {
+                programControlCallback(ProgramCommand::ADVANCE, message.getInt(1));
+            } else if (command == 'x') {
+                programControlCallback(ProgramCommand::STOP, 0);
+            }
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void BLEServerProtocol::onBinaryWrite(BLEChannel channel, BinaryReader &reader, uint64_t received) {
+    switch (channel) {
+    case BLEChannel::OUTPUT_CONTROL: {
+        OutputControl control;
+        if (!decodeOutputControl(reader, control))
+            return;
+        if (!control.advanced && outputControlCallback != nullptr) {
+            outputControlCallback(control.valve, control.pump, control.boilerSetpoint);
+        } else if (control.advanced && advancedControlCallback != nullptr) {
+            advancedControlCallback(control.valve, control.boilerSetpoint, control.pressureTarget, control.pressure,
+                                    control.flow);
+        }
+        break;
+    }
+    case BLEChannel::ALT_CONTROL: {
+        bool pinState;
+        if (decodeBool(reader, pinState) && altControlCallback != nullptr) {
+            altControlCallback(pinState);
+        }
+        break;
+    }
+    case BLEChannel::PING: {
+        ClockExchange exchange;
+        if (transport.has(BLEChannel::PONG) && decodePing(reader, exchange.sent)) {
+            exchange.received = received;
+            exchange.replied = transport.now();
+            BinaryWriter writer;
+            encodePong(writer, exchange);
+            notify(BLEChannel::PONG, writer);
+        }
+        if (pingCallback != nullptr) {
+            pingCallback();
+        }
+        break;
+    }
+    case BLEChannel::AUTOTUNE: {
+        int32_t testTime, samples;
+        if (decodeAutotune(reader, testTime, samples) && autotuneCallback != nullptr) {
+            autotuneCallback(testTime, samples);
+        }
+        break;
+    }
+    case BLEChannel::PID_CONTROL: {
+        PidSettings pid;
+        if (decodePidSettings(reader, pid) && pidControlCallback != nullptr) {
+            pidControlCallback(pid.Kp, pid.Ki, pid.Kd);
+        }
+        break;
+    }
+    case BLEChannel::PRESSURE_SCALE: {
+        float scale;
+        if (decodeFloat(reader, scale) && pressureScaleCallback != nullptr) {
+            pressureScaleCallback(scale);
+        }
+        break;
+    }
+    case BLEChannel::VOLUMETRIC_TARE:
+        if (tareCallback != nullptr) {
+            tareCallback();
+        }
+        break;
+    case BLEChannel::PROGRAM_UPLOAD:
+        if (decodeProgramMessage(reader, pendingProgram) && programUploadCallback != nullptr) {
+            programUploadCallback(pendingProgram);
+        }
+        break;
+    case BLEChannel::PROGRAM_CONTROL: {
+        ProgramCommand command;
+        uint8_t phase;
+        if (decodeProgramCommand(reader, command, phase) && programControlCallback != nullptr) {
+            programControlCallback(command, command == ProgramCommand::ADVANCE ? phase : 0);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
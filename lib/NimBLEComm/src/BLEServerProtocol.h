@@ -0,0 +1,71 @@
+#ifndef BLESERVERPROTOCOL_H
+#define BLESERVERPROTOCOL_H
+
+#include "BLEProtocol.h"
+
+// Controller board side of the protocol: decodes the commands of the display and encodes the notifications for it.
+// Only talks to the transport, the owner connects it and forwards what the transport receives to onReceive.
+class BLEServerProtocol {
+  public:
+    explicit BLEServerProtocol(BLETransport &transport) : transport(transport) {}
+
+    void sendSensorData(float temperature, float pressure, float flow);
+    // Samples that fit into one sensor frame, 0 while the client doesn't take frames
+    uint8_t getSensorFrameCapacity() const;
+    void sendSensorFrame(const SensorSample *samples, uint8_t count);
+    void sendError(int errorCode);
+    void sendBrewBtnState(bool brewButtonStatus);
+    void sendSteamBtnState(bool steamButtonStatus);
+    void sendAutotuneResult(float Kp, float Ki, float Kd);
+    void sendVolumetricMeasurement(float value);
+    void sendProgramProgress(const ProgramProgress &progress);
+    void sendTaskDiagnostics(const TaskDiagnostics &diagnostics);
+    void registerOutputControlCallback(const simple_output_callback_t &callback);
+    void registerAdvancedOutputControlCallback(const advanced_output_callback_t &callback);
+    void registerAltControlCallback(const pin_control_callback_t &callback);
+    void registerPidControlCallback(const pid_control_callback_t &callback);
+    void registerPingCallback(const ping_callback_t &callback);
+    void registerAutotuneCallback(const autotune_callback_t &callback);
+    void registerPressureScaleCallback(const float_callback_t &callback);
+    void registerTareCallback(const void_callback_t &callback);
+    void registerProgramUploadCallback(const program_upload_callback_t &callback);
+    void registerProgramControlCallback(const program_control_callback_t &callback);
+    uint8_t getProtocolVersion() const { return protocolVersion; }
+
+    // Decodes a write of the client, received is the transport time it arrived at for answering timestamped pings
+    void onReceive(BLEChannel channel, const uint8_t *data, size_t length, uint64_t received);
+
+  protected:
+    // Back to text until the client picks a protocol again, for every new connection
+    void resetConnection();
+
+    BLETransport &transport;
+
+  private:
+    uint8_t protocolVersion = BLE_PROTOCOL_TEXT; // picked by the client, text until it writes the protocol characteristic
+
+    ProfileProgram pendingProgram{}; // program being assembled from upload messages
+
+    simple_output_callback_t outputControlCallback = nullptr;
+    advanced_output_callback_t advancedControlCallback = nullptr;
+    pin_control_callback_t altControlCallback = nullptr;
+    pid_control_callback_t pidControlCallback = nullptr;
+    ping_callback_t pingCallback = nullptr;
+    autotune_callback_t autotuneCallback = nullptr;
+    float_callback_t pressureScaleCallback = nullptr;
+    void_callback_t tareCallback = nullptr;
+    program_upload_callback_t programUploadCallback = nullptr;
+    program_control_callback_t programControlCallback = nullptr;
+
+    bool isBinary() const { return protocolVersion >= BLE_PROTOCOL_BINARY; }
+    bool canSend(BLEChannel channel) const { return transport.isConnected() && transport.has(channel); }
+    void notify(BLEChannel channel, const BinaryWriter &writer);
+    void notify(BLEChannel channel, const TextWriter &writer);
+    void notify(BLEChannel channel, const uint8_t *data, size_t length);
+    void onTextWrite(BLEChannel channel, const TextMessage &message);
+    void onBinaryWrite(BLEChannel channel, BinaryReader &reader, uint64_t received);
+
+    const char *LOG_TAG = "BLEServerProtocol";
+};
+
+#endif // BLESERVERPROTOCOL_H
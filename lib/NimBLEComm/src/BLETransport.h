@@ -0,0 +1,93 @@
+#ifndef BLETRANSPORT_H
+#define BLETRANSPORT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// Characteristics of the GaggiMate service, independent of how they are carried. The client writes the first group,
+// the server notifies the second one and serves reads of the last one.
+enum class BLEChannel : uint8_t {
+    OUTPUT_CONTROL,
+    ALT_CONTROL,
+    PING,
+    PID_CONTROL,
+    AUTOTUNE,
+    PRESSURE_SCALE,
+    VOLUMETRIC_TARE,
+    PROGRAM_UPLOAD,
+    PROGRAM_CONTROL,
+    PROTOCOL,
+
+    REMOTE_ERROR,
+    AUTOTUNE_RESULT,
+    BREW_BUTTON,
+    STEAM_BUTTON,
+    SENSOR_DATA,
+    SENSOR_FRAME,
+    VOLUMETRIC_MEASUREMENT,
+    PROGRAM_PROGRESS,
+    TASK_DIAGNOSTICS,
+    PONG,
+
+    INFO,
+
+    COUNT
+};
+
+constexpr uint8_t BLE_CHANNEL_COUNT = static_cast<uint8_t>(BLEChannel::COUNT);
+
+inline uint8_t channelIndex(BLEChannel channel) { return static_cast<uint8_t>(channel); }
+inline bool isWriteChannel(BLEChannel channel) { return channel <= BLEChannel::PROTOCOL; }
+inline bool isNotifyChannel(BLEChannel channel) { return channel >= BLEChannel::REMOTE_ERROR && channel <= BLEChannel::PONG; }
+
+// Connection parameters in the units of the BLE spec: intervals in 1.25ms steps, latency in connection events the
+// peripheral may skip while it has nothing to send, supervision timeout in 10ms steps
+struct BLEConnectionParams {
+    uint16_t minInterval;
+    uint16_t maxInterval;
+    uint16_t latency;
+    uint16_t timeout;
+};
+
+// received is the transport time in µs the message arrived at
+using ble_receive_callback_t = std::function<void(BLEChannel channel, const uint8_t *data, size_t length, uint64_t received)>;
+
+// Carries the messages of the protocol between display and controller board. On the boards that is NimBLE GATT, on
+// the host a loopback link so both protocol layers can run against each other in one process.
+class BLETransport {
+  public:
+    virtual ~BLETransport() = default;
+
+    virtual bool isConnected() const = 0;
+    // False if the peer lacks the characteristic, older controller boards don't have all of them
+    virtual bool has(BLEChannel channel) const = 0;
+    // Writes on the client, notifies on the server. Writes with response only return once the peer acknowledged them.
+    virtual bool send(BLEChannel channel, const uint8_t *data, size_t length, bool response = false) = 0;
+    // Value of a read characteristic, client only
+    virtual std::string read(BLEChannel) { return ""; }
+    // Value served to reads, server only
+    virtual void setValue(BLEChannel, const uint8_t *, size_t) {}
+    // Renegotiates the connection, client only. The peer switches over a few connection events later.
+    virtual bool updateConnectionParams(const BLEConnectionParams &) { return false; }
+    // Largest message that fits into one write or notification
+    virtual size_t getPayloadSize() const = 0;
+    // µs since boot, the simulated time of the link on the host
+    virtual uint64_t now() const = 0;
+
+    // Called for every write on the server and every notification on the client
+    void setReceiveCallback(const ble_receive_callback_t &callback) { receiveCallback = callback; }
+
+  protected:
+    void receive(BLEChannel channel, const uint8_t *data, size_t length, uint64_t received) const {
+        if (receiveCallback != nullptr) {
+            receiveCallback(channel, data, length, received);
+        }
+    }
+
+  private:
+    ble_receive_callback_t receiveCallback = nullptr;
+};
+
+#endif // BLETRANSPORT_H
@@ -0,0 +1,358 @@
+#include "BinaryCodec.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace {
+constexpr uint8_t OUTPUT_FLAG_VALVE = 1 << 0;
+constexpr uint8_t OUTPUT_FLAG_ADVANCED = 1 << 1;
+constexpr uint8_t OUTPUT_FLAG_PRESSURE_TARGET = 1 << 2;
+
+constexpr uint8_t PHASE_FLAG_VALVE = 1 << 0;
+constexpr uint8_t PHASE_FLAG_ADVANCED = 1 << 1;
+constexpr uint8_t PHASE_FLAG_PRESSURE_TARGET = 1 << 2;
+
+constexpr uint8_t EXIT_FLAG_LTE = 1 << 7;
+
+constexpr uint8_t PROGRAM_MESSAGE_BEGIN = 'b';
+constexpr uint8_t PROGRAM_MESSAGE_PHASE = 'p';
+constexpr uint8_t PROGRAM_MESSAGE_COMMIT = 'c';
+
+uint16_t toFixed(float value, float scale) {
+    const float scaled = value * scale + 0.5f;
+    if (!(scaled > 0.0f))
+        return 0;
+    if (scaled >= 65535.0f)
+        return 65535;
+    return static_cast<uint16_t>(scaled);
+}
+
+int16_t toSignedFixed(float value, float scale) {
+    if (std::isnan(value))
+        return 0;
+    float scaled = value * scale;
+    scaled += scaled < 0.0f ? -0.5f : 0.5f;
+    if (scaled <= -32768.0f)
+        return -32768;
+    if (scaled >= 32767.0f)
+        return 32767;
+    return static_cast<int16_t>(scaled);
+}
+} // namespace
+
+void BinaryWriter::f32(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    u32(bits);
+}
+
+void BinaryWriter::str(const char *value, uint8_t maxLength) {
+    size_t size = strlen(value);
+    if (size > maxLength)
+        size = maxLength;
+    u8(static_cast<uint8_t>(size));
+    for (size_t i = 0; i < size; i++) {
+        u8(static_cast<uint8_t>(value[i]));
+    }
+}
+
+float BinaryReader::f32() {
+    const uint32_t bits = u32();
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void BinaryReader::str(char *out, size_t size) {
+    const uint8_t length = u8();
+    size_t written = 0;
+    for (uint8_t i = 0; i < length; i++) {
+        const char c = static_cast<char>(u8());
+        if (written + 1 < size)
+            out[written++] = c;
+    }
+    if (size > 0)
+        out[written] = '\0';
+}
+
+void encodeBool(BinaryWriter &writer, bool value) { writer.u8(value ? 1 : 0); }
+
+bool decodeBool(BinaryReader &reader, bool &value) {
+    value = reader.u8() != 0;
+    return reader.ok();
+}
+
+void encodeFloat(BinaryWriter &writer, float value) { writer.f32(value); }
+
+bool decodeFloat(BinaryReader &reader, float &value) {
+    value = reader.f32();
+    return reader.ok();
+}
+
+void encodeInt(BinaryWriter &writer, int32_t value) { writer.i32(value); }
+
+bool decodeInt(BinaryReader &reader, int32_t &value) {
+    value = reader.i32();
+    return reader.ok();
+}
+
+void encodePing(BinaryWriter &writer, uint64_t sent) { writer.u64(sent); }
+
+bool decodePing(BinaryReader &reader, uint64_t &sent) {
+    sent = reader.u64();
+    return reader.ok();
+}
+
+void encodePong(BinaryWriter &writer, const ClockExchange &exchange) {
+    writer.u64(exchange.sent);
+    writer.u64(exchange.received);
+    writer.u64(exchange.replied);
+}
+
+bool decodePong(BinaryReader &reader, ClockExchange &exchange) {
+    exchange.sent = reader.u64();
+    exchange.received = reader.u64();
+    exchange.replied = reader.u64();
+    return reader.ok();
+}
+
+void encodeSensorData(BinaryWriter &writer, const SensorData &data) {
+    writer.f32(data.temperature);
+    writer.f32(data.pressure);
+    writer.f32(data.flow);
+}
+
+bool decodeSensorData(BinaryReader &reader, SensorData &data) {
+    data.temperature = reader.f32();
+    data.pressure = reader.f32();
+    data.flow = reader.f32();
+    return reader.ok();
+}
+
+void encodeSensorFrame(BinaryWriter &writer, const SensorSample *samples, uint8_t count) {
+    const uint32_t base = count > 0 ? samples[0].time : 0;
+    writer.u32(base);
+    writer.u8(count);
+    for (uint8_t i = 0; i < count; i++) {
+        const SensorSample &sample = samples[i];
+        const uint32_t offset = sample.time - base;
+        writer.u16(offset > 0xFFFF ? 0xFFFF : offset);
+        writer.u16(toFixed(sample.temperature, 100.0f));
+        writer.u16(static_cast<uint16_t>(toSignedFixed(sample.pressure, 1000.0f)));
+        writer.u16(static_cast<uint16_t>(toSignedFixed(sample.flow, 100.0f)));
+        writer.u16(toFixed(sample.volume, 10.0f));
+    }
+}
+
+bool decodeSensorFrame(BinaryReader &reader, SensorFrame &frame) {
+    const uint32_t base = reader.u32();
+    const uint8_t count = reader.u8();
+    frame.count = 0;
+    for (uint8_t i = 0; i < count && reader.ok(); i++) {
+        SensorSample sample;
+        sample.time = base + reader.u16();
+        sample.temperature = reader.u16() / 100.0f;
+        sample.pressure = static_cast<int16_t>(reader.u16()) / 1000.0f;
+        sample.flow = static_cast<int16_t>(reader.u16()) / 100.0f;
+        sample.volume = reader.u16() / 10.0f;
+        if (reader.ok() && frame.count < SENSOR_FRAME_MAX_SAMPLES)
+            frame.samples[frame.count++] = sample;
+    }
+    return reader.ok() && frame.count > 0;
+}
+
+void encodeOutputControl(BinaryWriter &writer, const OutputControl &control) {
+    uint8_t flags = 0;
+    if (control.valve)
+        flags |= OUTPUT_FLAG_VALVE;
+    if (control.advanced)
+        flags |= OUTPUT_FLAG_ADVANCED;
+    if (control.pressureTarget)
+        flags |= OUTPUT_FLAG_PRESSURE_TARGET;
+    writer.u8(flags);
+    writer.f32(control.boilerSetpoint);
+    if (control.advanced) {
+        writer.f32(control.pressure);
+        writer.f32(control.flow);
+    } else {
+        writer.f32(control.pump);
+    }
+}
+
+bool decodeOutputControl(BinaryReader &reader, OutputControl &control) {
+    const uint8_t flags = reader.u8();
+    control.valve = flags & OUTPUT_FLAG_VALVE;
+    control.advanced = flags & OUTPUT_FLAG_ADVANCED;
+    control.pressureTarget = flags & OUTPUT_FLAG_PRESSURE_TARGET;
+    control.boilerSetpoint = reader.f32();
+    if (control.advanced) {
+        control.pump = 0.0f;
+        control.pressure = reader.f32();
+        control.flow = reader.f32();
+    } else {
+        control.pump = reader.f32();
+        control.pressure = 0.0f;
+        control.flow = 0.0f;
+    }
+    return reader.ok();
+}
+
+void encodePidSettings(BinaryWriter &writer, const PidSettings &pid) {
+    writer.f32(pid.Kp);
+    writer.f32(pid.Ki);
+    writer.f32(pid.Kd);
+}
+
+bool decodePidSettings(BinaryReader &reader, PidSettings &pid) {
+    pid.Kp = reader.f32();
+    pid.Ki = reader.f32();
+    pid.Kd = reader.f32();
+    return reader.ok();
+}
+
+void encodeAutotune(BinaryWriter &writer, int32_t testTime, int32_t samples) {
+    writer.i32(testTime);
+    writer.i32(samples);
+}
+
+bool decodeAutotune(BinaryReader &reader, int32_t &testTime, int32_t &samples) {
+    testTime = reader.i32();
+    samples = reader.i32();
+    return reader.ok();
+}
+
+void encodeProgramBegin(BinaryWriter &writer, const ProfileProgram &program) {
+    writer.u8(PROGRAM_MESSAGE_BEGIN);
+    writer.u32(program.id);
+    writer.u8(program.phaseCount);
+}
+
+void encodeProgramPhase(BinaryWriter &writer, uint8_t index, const ProgramPhase &phase) {
+    writer.u8(PROGRAM_MESSAGE_PHASE);
+    writer.u8(index);
+    uint8_t flags = 0;
+    if (phase.valve)
+        flags |= PHASE_FLAG_VALVE;
+    if (phase.advanced)
+        flags |= PHASE_FLAG_ADVANCED;
+    if (phase.pressureTarget)
+        flags |= PHASE_FLAG_PRESSURE_TARGET;
+    writer.u8(flags);
+    writer.f32(phase.pump);
+    writer.f32(phase.pressure);
+    writer.f32(phase.flow);
+    writer.u8(phase.transition);
+    writer.f32(phase.transitionDuration);
+    writer.u8(phase.exitCount);
+    for (uint8_t i = 0; i < phase.exitCount && i < PROGRAM_MAX_EXITS; i++) {
+        writer.u8(phase.exits[i].type | (phase.exits[i].lte ? EXIT_FLAG_LTE : 0));
+        writer.f32(phase.exits[i].value);
+    }
+}
+
+void encodeProgramCommit(BinaryWriter &writer) { writer.u8(PROGRAM_MESSAGE_COMMIT); }
+
+bool decodeProgramMessage(BinaryReader &reader, ProfileProgram &program) {
+    const uint8_t type = reader.u8();
+    if (type == PROGRAM_MESSAGE_BEGIN) {
+        program = ProfileProgram{};
+        program.id = reader.u32();
+        const uint8_t phaseCount = reader.u8();
+        program.phaseCount = phaseCount < PROGRAM_MAX_PHASES ? phaseCount : PROGRAM_MAX_PHASES;
+    } else if (type == PROGRAM_MESSAGE_PHASE) {
+        const uint8_t index = reader.u8();
+        if (index >= program.phaseCount) {
+            return false;
+        }
+        ProgramPhase phase;
+        const uint8_t flags = reader.u8();
+        phase.valve = flags & PHASE_FLAG_VALVE;
+        phase.advanced = flags & PHASE_FLAG_ADVANCED;
+        phase.pressureTarget = flags & PHASE_FLAG_PRESSURE_TARGET;
+        phase.pump = reader.f32();
+        phase.pressure = reader.f32();
+        phase.flow = reader.f32();
+        phase.transition = reader.u8();
+        phase.transitionDuration = reader.f32();
+        const uint8_t exitCount = reader.u8();
+        phase.exitCount = exitCount < PROGRAM_MAX_EXITS ? exitCount : PROGRAM_MAX_EXITS;
+        for (uint8_t i = 0; i < phase.exitCount; i++) {
+            const uint8_t exitType = reader.u8();
+            phase.exits[i].type = exitType & ~EXIT_FLAG_LTE;
+            phase.exits[i].lte = exitType & EXIT_FLAG_LTE;
+            phase.exits[i].value = reader.f32();
+        }
+        // A truncated phase must not replace the previous content
+        if (reader.ok()) {
+            program.phases[index] = phase;
+            program.receivedPhases |= 1 << index;
+        }
+    } else if (type == PROGRAM_MESSAGE_COMMIT) {
+        return reader.ok() && program.isComplete();
+    }
+    return false;
+}
+
+void encodeProgramCommand(BinaryWriter &writer, ProgramCommand command, uint8_t phase) {
+    writer.u8(static_cast<uint8_t>(command));
+    writer.u8(phase);
+}
+
+bool decodeProgramCommand(BinaryReader &reader, ProgramCommand &command, uint8_t &phase) {
+    const uint8_t value = reader.u8();
+    phase = reader.u8();
+    if (!reader.ok() || value > static_cast<uint8_t>(ProgramCommand::STOP))
+        return false;
+    command = static_cast<ProgramCommand>(value);
+    return true;
+}
+
+void encodeProgramProgress(BinaryWriter &writer, const ProgramProgress &progress) {
+    writer.u32(progress.id);
+    writer.u8(progress.phase);
+    writer.u32(static_cast<uint32_t>(progress.phaseElapsed));
+    writer.u8(progress.running ? 1 : 0);
+}
+
+bool decodeProgramProgress(BinaryReader &reader, ProgramProgress &progress) {
+    progress.id = reader.u32();
+    progress.phase = reader.u8();
+    progress.phaseElapsed = reader.u32();
+    progress.running = reader.u8() != 0;
+    return reader.ok();
+}
+
+void encodeTaskDiagnostics(BinaryWriter &writer, const TaskDiagnostics &diagnostics) {
+    writer.str(diagnostics.name, TASK_DIAGNOSTICS_NAME_LENGTH - 1);
+    writer.u32(diagnostics.period);
+    writer.u32(diagnostics.count);
+    writer.u32(diagnostics.missed);
+    writer.u32(diagnostics.periodAvg);
+    writer.u32(diagnostics.periodMax);
+    writer.u32(diagnostics.execAvg);
+    writer.u32(diagnostics.execMax);
+    for (uint8_t i = 0; i < TASK_DIAGNOSTICS_BUCKETS; i++) {
+        writer.u16(diagnostics.jitter[i]);
+    }
+    for (uint8_t i = 0; i < TASK_DIAGNOSTICS_BUCKETS; i++) {
+        writer.u16(diagnostics.exec[i]);
+    }
+}
+
+bool decodeTaskDiagnostics(BinaryReader &reader, TaskDiagnostics &diagnostics) {
+    reader.str(diagnostics.name, sizeof(diagnostics.name));
+    diagnostics.period = reader.u32();
+    diagnostics.count = reader.u32();
+    diagnostics.missed = reader.u32();
+    diagnostics.periodAvg = reader.u32();
+    diagnostics.periodMax = reader.u32();
+    diagnostics.execAvg = reader.u32();
+    diagnostics.execMax = reader.u32();
+    for (uint8_t i = 0; i < TASK_DIAGNOSTICS_BUCKETS; i++) {
+        diagnostics.jitter[i] = reader.u16();
+    }
+    for (uint8_t i = 0; i < TASK_DIAGNOSTICS_BUCKETS; i++) {
+        diagnostics.exec[i] = reader.u16();
+    }
+    return reader.ok();
+}
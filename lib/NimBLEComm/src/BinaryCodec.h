@@ -0,0 +1,199 @@
+#ifndef BINARYCODEC_H
+#define BINARYCODEC_H
+
+#include "ClockSync.h"
+#include "ProfileProgram.h"
+#include "TaskDiagnostics.h"
+#include <cstddef>
+#include <cstdint>
+
+// Packed little-endian encoding of the BLE messages, used instead of the text messages once both sides support it.
+// The controller board announces the highest version it understands as "pv" in the capabilities of the info
+// characteristic, the display writes the version it picked to the protocol characteristic. Each side then sends
+// binary messages but keeps accepting text ones, since the first byte tells them apart. Peers without "pv" keep
+// using text in both directions.
+//
+// Every binary message starts with BLE_BINARY_MARKER followed by the fields of the message, the characteristic
+// defines which message it is. Fields may be appended in later versions, decoders ignore trailing bytes.
+
+constexpr uint8_t BLE_PROTOCOL_TEXT = 1;
+constexpr uint8_t BLE_PROTOCOL_BINARY = 2;
+constexpr uint8_t BLE_PROTOCOL_SENSOR_FRAMES = 3; // binary, plus batched sensor frames while brewing
+constexpr uint8_t BLE_PROTOCOL_VERSION = BLE_PROTOCOL_SENSOR_FRAMES; // highest version this build supports
+
+constexpr uint8_t BLE_BINARY_MARKER = 0xB2;    // outside of ASCII, so text messages never start with it
+constexpr size_t BLE_BINARY_MAX_LENGTH = 125; // MTU of 128 minus the ATT header
+
+inline bool isBinaryMessage(const uint8_t *data, size_t length) { return length > 0 && data[0] == BLE_BINARY_MARKER; }
+
+class BinaryWriter {
+  public:
+    BinaryWriter() { u8(BLE_BINARY_MARKER); }
+
+    void u8(uint8_t value) {
+        if (length < BLE_BINARY_MAX_LENGTH)
+            buffer[length++] = value;
+        else
+            overflow = true;
+    }
+    void u16(uint16_t value) {
+        u8(value & 0xFF);
+        u8(value >> 8);
+    }
+    void u32(uint32_t value) {
+        u16(value & 0xFFFF);
+        u16(value >> 16);
+    }
+    void u64(uint64_t value) {
+        u32(value & 0xFFFFFFFF);
+        u32(value >> 32);
+    }
+    void i32(int32_t value) { u32(static_cast<uint32_t>(value)); }
+    void f32(float value);
+    void str(const char *value, uint8_t maxLength);
+
+    const uint8_t *data() const { return buffer; }
+    size_t size() const { return length; }
+    bool ok() const { return !overflow; }
+
+  private:
+    uint8_t buffer[BLE_BINARY_MAX_LENGTH];
+    size_t length = 0;
+    bool overflow = false;
+};
+
+class BinaryReader {
+  public:
+    BinaryReader(const uint8_t *data, size_t length) : buffer(data), length(length) {
+        failed = !isBinaryMessage(data, length);
+        offset = 1;
+    }
+
+    uint8_t u8() {
+        if (offset >= length) {
+            failed = true;
+            return 0;
+        }
+        return buffer[offset++];
+    }
+    uint16_t u16() {
+        const uint16_t low = u8();
+        return low | static_cast<uint16_t>(u8()) << 8;
+    }
+    uint32_t u32() {
+        const uint32_t low = u16();
+        return low | static_cast<uint32_t>(u16()) << 16;
+    }
+    uint64_t u64() {
+        const uint64_t low = u32();
+        return low | static_cast<uint64_t>(u32()) << 32;
+    }
+    int32_t i32() { return static_cast<int32_t>(u32()); }
+    float f32();
+    // Copies a string of at most size - 1 characters into out, always terminated
+    void str(char *out, size_t size);
+
+    // False if the marker was missing or a field was read past the end of the message
+    bool ok() const { return !failed; }
+
+  private:
+    const uint8_t *buffer;
+    size_t length;
+    size_t offset;
+    bool failed;
+};
+
+struct SensorData {
+    float temperature = 0.0f;
+    float pressure = 0.0f;
+    float flow = 0.0f;
+};
+
+// Output control, simple messages set the pump power, advanced ones a pressure or flow target
+struct OutputControl {
+    bool valve = false;
+    bool advanced = false;
+    bool pressureTarget = false;
+    float pump = 0.0f; // simple only
+    float boilerSetpoint = 0.0f;
+    float pressure = 0.0f; // advanced only
+    float flow = 0.0f;     // advanced only
+};
+
+// One sample of the sensor frame, time in ms on the clock of the controller board
+struct SensorSample {
+    uint32_t time = 0;
+    float temperature = 0.0f;
+    float pressure = 0.0f;
+    float flow = 0.0f;
+    float volume = 0.0f;
+};
+
+constexpr size_t SENSOR_FRAME_HEADER_LENGTH = 6;  // marker, base time, count
+constexpr size_t SENSOR_FRAME_SAMPLE_LENGTH = 10; // time offset, temperature, pressure, flow, volume
+constexpr uint8_t SENSOR_FRAME_MAX_SAMPLES = (BLE_BINARY_MAX_LENGTH - SENSOR_FRAME_HEADER_LENGTH) / SENSOR_FRAME_SAMPLE_LENGTH;
+
+// Samples taken at the pump loop rate, sent together in one notification
+struct SensorFrame {
+    uint8_t count = 0;
+    SensorSample samples[SENSOR_FRAME_MAX_SAMPLES];
+};
+
+// Number of samples that fit into a notification with the given payload size (MTU minus the ATT header)
+inline uint8_t sensorFrameCapacity(size_t payload) {
+    if (payload > BLE_BINARY_MAX_LENGTH)
+        payload = BLE_BINARY_MAX_LENGTH;
+    if (payload < SENSOR_FRAME_HEADER_LENGTH + SENSOR_FRAME_SAMPLE_LENGTH)
+        return 0;
+    return (payload - SENSOR_FRAME_HEADER_LENGTH) / SENSOR_FRAME_SAMPLE_LENGTH;
+}
+
+struct PidSettings {
+    float Kp = 0.0f;
+    float Ki = 0.0f;
+    float Kd = 0.0f;
+};
+
+// Tare carries no fields, a writer with just the marker is the whole message
+void encodeBool(BinaryWriter &writer, bool value);
+bool decodeBool(BinaryReader &reader, bool &value);
+void encodeFloat(BinaryWriter &writer, float value);
+bool decodeFloat(BinaryReader &reader, float &value);
+void encodeInt(BinaryWriter &writer, int32_t value);
+bool decodeInt(BinaryReader &reader, int32_t &value);
+
+// The ping carries the time it was sent, the pong echoes it with the times the ping was received and answered.
+// Older controller boards ignore the time and don't answer, pings without it are still accepted.
+void encodePing(BinaryWriter &writer, uint64_t sent);
+bool decodePing(BinaryReader &reader, uint64_t &sent);
+void encodePong(BinaryWriter &writer, const ClockExchange &exchange);
+bool decodePong(BinaryReader &reader, ClockExchange &exchange);
+
+void encodeSensorData(BinaryWriter &writer, const SensorData &data);
+bool decodeSensorData(BinaryReader &reader, SensorData &data);
+// Samples are stored as offsets from the first one and fixed point values: temperature in 0.01 °C, pressure in
+// mbar, flow in 0.01 ml/s and volume in 0.1 ml, clamped to the range of the field. Samples must be in time order and
+// span less than 65 s.
+void encodeSensorFrame(BinaryWriter &writer, const SensorSample *samples, uint8_t count);
+bool decodeSensorFrame(BinaryReader &reader, SensorFrame &frame);
+void encodeOutputControl(BinaryWriter &writer, const OutputControl &control);
+bool decodeOutputControl(BinaryReader &reader, OutputControl &control);
+void encodePidSettings(BinaryWriter &writer, const PidSettings &pid);
+bool decodePidSettings(BinaryReader &reader, PidSettings &pid);
+void encodeAutotune(BinaryWriter &writer, int32_t testTime, int32_t samples);
+bool decodeAutotune(BinaryReader &reader, int32_t &testTime, int32_t &samples);
+
+// Same begin, phase and commit sequence as the text upload
+void encodeProgramBegin(BinaryWriter &writer, const ProfileProgram &program);
+void encodeProgramPhase(BinaryWriter &writer, uint8_t index, const ProgramPhase &phase);
+void encodeProgramCommit(BinaryWriter &writer);
+bool decodeProgramMessage(BinaryReader &reader, ProfileProgram &program);
+void encodeProgramCommand(BinaryWriter &writer, ProgramCommand command, uint8_t phase);
+bool decodeProgramCommand(BinaryReader &reader, ProgramCommand &command, uint8_t &phase);
+void encodeProgramProgress(BinaryWriter &writer, const ProgramProgress &progress);
+bool decodeProgramProgress(BinaryReader &reader, ProgramProgress &progress);
+
+void encodeTaskDiagnostics(BinaryWriter &writer, const TaskDiagnostics &diagnostics);
+bool decodeTaskDiagnostics(BinaryReader &reader, TaskDiagnostics &diagnostics);
+
+#endif // BINARYCODEC_H
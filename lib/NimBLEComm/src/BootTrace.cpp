@@ -0,0 +1,40 @@
+#include "BootTrace.h"
+
+namespace {
+BootStage stages[BOOT_TRACE_MAX_STAGES];
+uint8_t stageCount = 0;
+portMUX_TYPE stagesMux = portMUX_INITIALIZER_UNLOCKED;
+} // namespace
+
+void BootTrace::mark(const char *stage) {
+    const unsigned long now = millis();
+    portENTER_CRITICAL(&stagesMux);
+    bool known = false;
+    for (uint8_t i = 0; i < stageCount; i++) {
+        if (strcmp(stages[i].name, stage) == 0) {
+            known = true;
+            break;
+        }
+    }
+    if (!known && stageCount < BOOT_TRACE_MAX_STAGES) {
+        stages[stageCount++] = BootStage{stage, now};
+    }
+    portEXIT_CRITICAL(&stagesMux);
+}
+
+uint8_t BootTrace::getCount() { return stageCount; }
+
+BootStage BootTrace::get(uint8_t index) {
+    portENTER_CRITICAL(&stagesMux);
+    const BootStage stage = index < stageCount ? stages[index] : BootStage{"", 0};
+    portEXIT_CRITICAL(&stagesMux);
+    return stage;
+}
+
+void BootTrace::print() {
+    ESP_LOGI("BootTrace", "Boot stages:");
+    for (uint8_t i = 0; i < getCount(); i++) {
+        const BootStage stage = get(i);
+        ESP_LOGI("BootTrace", "%6lums %s", stage.time, stage.name);
+    }
+}
@@ -0,0 +1,23 @@
+#ifndef BOOTTRACE_H
+#define BOOTTRACE_H
+
+#include <Arduino.h>
+
+constexpr uint8_t BOOT_TRACE_MAX_STAGES = 16;
+
+struct BootStage {
+    const char *name;
+    unsigned long time; // ms since power on
+};
+
+// Records when each boot stage was reached, shared by both firmwares. Only the first mark of a stage counts, so
+// stages that repeat on reconnects keep their boot time. Safe to call from any task.
+class BootTrace {
+  public:
+    static void mark(const char *stage);
+    static uint8_t getCount();
+    static BootStage get(uint8_t index);
+    static void print();
+};
+
+#endif // BOOTTRACE_H
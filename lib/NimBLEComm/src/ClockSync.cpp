@@ -0,0 +1,30 @@
+#include "ClockSync.h"
+
+#include <cmath>
+
+bool ClockSync::add(const ClockExchange &exchange) {
+    const int64_t trip = exchange.roundTrip();
+    if (trip < 0 || trip > UINT32_MAX)
+        return false;
+    samples[next] = Sample{exchange.offset(), static_cast<uint32_t>(trip)};
+    next = (next + 1) % CLOCK_SYNC_SAMPLES;
+    if (count < CLOCK_SYNC_SAMPLES)
+        count++;
+    exchanges++;
+
+    uint8_t best = 0;
+    for (uint8_t i = 1; i < count; i++) {
+        if (samples[i].roundTrip < samples[best].roundTrip)
+            best = i;
+    }
+    offset = samples[best].offset;
+    roundTrip = samples[best].roundTrip;
+
+    double squares = 0.0;
+    for (uint8_t i = 0; i < count; i++) {
+        const double deviation = static_cast<double>(samples[i].offset - offset);
+        squares += deviation * deviation;
+    }
+    jitter = count > 1 ? static_cast<uint32_t>(sqrt(squares / (count - 1))) : 0;
+    return true;
+}
@@ -0,0 +1,59 @@
+#ifndef CLOCKSYNC_H
+#define CLOCKSYNC_H
+
+#include <cstdint>
+
+constexpr uint8_t CLOCK_SYNC_SAMPLES = 8;
+
+// Timestamps of one ping and its pong in µs. sent and returned are taken on the clock of the side that pings,
+// received and replied on the clock of the side that answers.
+struct ClockExchange {
+    uint64_t sent = 0;
+    uint64_t received = 0;
+    uint64_t replied = 0;
+    uint64_t returned = 0;
+
+    // Remote minus local clock, exact if both directions took the same time
+    int64_t offset() const {
+        return (static_cast<int64_t>(received - sent) + static_cast<int64_t>(replied - returned)) / 2;
+    }
+    // Time spent on the link, without the time the remote side took to answer
+    int64_t roundTrip() const { return static_cast<int64_t>(returned - sent) - static_cast<int64_t>(replied - received); }
+};
+
+// Offset of a remote clock estimated like the NTP clock filter: of the last CLOCK_SYNC_SAMPLES exchanges the one
+// with the shortest round trip is used. Queuing delays only ever add to a direction, so the shortest round trip is
+// the one least skewed by an asymmetric path. The error of the estimate is at most half of its round trip.
+class ClockSync {
+  public:
+    // Drops exchanges with a negative round trip, those mix up timestamps of different pings
+    bool add(const ClockExchange &exchange);
+    void reset() { *this = ClockSync{}; }
+
+    bool isSynced() const { return count > 0; }
+    int64_t getOffset() const { return offset; }        // µs, remote minus local
+    uint32_t getRoundTrip() const { return roundTrip; } // µs, of the exchange the offset comes from
+    uint32_t getJitter() const { return jitter; }       // µs, RMS deviation of the offsets in the window
+    uint32_t getExchanges() const { return exchanges; }
+
+    uint64_t toLocal(uint64_t remote) const { return remote - offset; }
+    uint64_t toRemote(uint64_t local) const { return local + offset; }
+    // For millis() timestamps, both clocks wrap at the same point so the difference survives the truncation
+    uint32_t toLocalMillis(uint32_t remote) const { return remote - static_cast<uint32_t>(offset / 1000); }
+
+  private:
+    struct Sample {
+        int64_t offset;
+        uint32_t roundTrip;
+    };
+
+    Sample samples[CLOCK_SYNC_SAMPLES] = {};
+    uint8_t next = 0;
+    uint8_t count = 0;
+    int64_t offset = 0;
+    uint32_t roundTrip = 0;
+    uint32_t jitter = 0;
+    uint32_t exchanges = 0;
+};
+
+#endif // CLOCKSYNC_H
@@ -0,0 +1,116 @@
+#include "LoopbackTransport.h"
+
+bool LoopbackTransport::isConnected() const { return link.connected; }
+
+bool LoopbackTransport::has(BLEChannel channel) const { return !link.removed[channelIndex(channel)]; }
+
+bool LoopbackTransport::send(BLEChannel channel, const uint8_t *data, size_t length, bool response) {
+    if (!link.connected || !has(channel) || length > getPayloadSize()) {
+        return false;
+    }
+    return link.transmit(server, channel, data, length, response);
+}
+
+std::string LoopbackTransport::read(BLEChannel channel) { return has(channel) ? link.values[channelIndex(channel)] : ""; }
+
+bool LoopbackTransport::updateConnectionParams(const BLEConnectionParams &params) {
+    if (server || !link.connected) {
+        return false;
+    }
+    link.conditions.interval = params.maxInterval * 1250;
+    link.conditions.latency = params.latency;
+    link.stats.parameterUpdates++;
+    return true;
+}
+
+void LoopbackTransport::setValue(BLEChannel channel, const uint8_t *data, size_t length) {
+    link.values[channelIndex(channel)].assign(reinterpret_cast<const char *>(data), length);
+}
+
+size_t LoopbackTransport::getPayloadSize() const { return link.mtu - 3; }
+
+uint64_t LoopbackTransport::now() const { return server ? link.time + link.clockOffset : link.time; }
+
+void LoopbackLink::disconnect() {
+    connected = false;
+    toServer.clear();
+    toClient.clear();
+    lastDue[0] = lastDue[1] = 0;
+}
+
+bool LoopbackLink::transmit(bool fromServer, BLEChannel channel, const uint8_t *data, size_t length, bool response) {
+    stats.sent++;
+    const uint64_t interval = conditions.interval;
+    // Events the server listens at, for the writes of the client
+    const uint64_t period = fromServer ? interval : interval * (conditions.latency + 1);
+    uint64_t event = period > 0 ? (time / period + 1) * period : time;
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    for (uint8_t attempt = 1; chance(random) < conditions.loss; attempt++) {
+        if (attempt >= conditions.attempts) {
+            stats.dropped++;
+            if (response) {
+                // The write waits for its acknowledgement until the link gives up
+                advance(event + period);
+            }
+            return false;
+        }
+        event += period;
+        stats.retransmissions++;
+    }
+
+    uint64_t due = event + conditions.delay;
+    if (conditions.jitter > 0) {
+        due += std::uniform_int_distribution<uint32_t>(0, conditions.jitter)(random);
+    }
+    uint64_t &last = lastDue[fromServer ? 1 : 0];
+    if (due < last) {
+        due = last;
+    }
+    last = due;
+    (fromServer ? toClient : toServer).push_back(Packet{due, channel, std::vector<uint8_t>(data, data + length)});
+    stats.bytes += length;
+    if (response) {
+        advance(due + interval);
+    }
+    return true;
+}
+
+void LoopbackLink::advance(uint64_t until) {
+    while (true) {
+        std::deque<Packet> *queue = nullptr;
+        if (!toServer.empty() && toServer.front().due <= until) {
+            queue = &toServer;
+        }
+        if (!toClient.empty() && toClient.front().due <= until &&
+            (queue == nullptr || toClient.front().due < queue->front().due)) {
+            queue = &toClient;
+        }
+        if (queue == nullptr) {
+            break;
+        }
+        const Packet packet = std::move(queue->front());
+        queue->pop_front();
+        if (packet.due > time) {
+            time = packet.due;
+        }
+        stats.delivered++;
+        // Handlers may send on the link again, the packet is out of the queue by now
+        (queue == &toServer ? server : client).deliver(packet.channel, packet.data.data(), packet.data.size());
+    }
+    if (until > time) {
+        time = until;
+    }
+}
+
+void LoopbackLink::flush() {
+    while (!toServer.empty() || !toClient.empty()) {
+        uint64_t until = time;
+        if (!toServer.empty() && toServer.back().due > until) {
+            until = toServer.back().due;
+        }
+        if (!toClient.empty() && toClient.back().due > until) {
+            until = toClient.back().due;
+        }
+        advance(until);
+    }
+}
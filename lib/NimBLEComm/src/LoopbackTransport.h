@@ -0,0 +1,121 @@
+#ifndef LOOPBACKTRANSPORT_H
+#define LOOPBACKTRANSPORT_H
+
+#include "BLETransport.h"
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+
+// In-process stand-in for the BLE link, so the protocol layers of both firmwares can run against each other on the
+// host. Time is simulated: nothing arrives until the owner advances the link.
+//
+// Packets go out at the next connection event. A failed transmission is retried at the following event like the
+// link layer does, so loss mostly shows up as delay, and only packets that fail every attempt are gone. Each
+// direction delivers in order, a retried packet holds back the ones behind it. With slave latency the server only
+// listens every latency + 1 events, it still notifies at the next one.
+
+struct LinkConditions {
+    uint32_t interval = 7500; // µs, connection interval
+    uint32_t delay = 0;       // µs, added to every packet
+    uint32_t jitter = 0;      // µs, uniformly distributed on top of the delay
+    double loss = 0.0;        // probability of a transmission attempt failing
+    uint8_t attempts = 4;     // transmissions before a packet is dropped
+    uint16_t latency = 0;     // connection events the server may skip listening, delays the writes of the client
+};
+
+struct LinkStats {
+    unsigned long sent = 0;
+    unsigned long delivered = 0;
+    unsigned long dropped = 0;
+    unsigned long retransmissions = 0;
+    unsigned long bytes = 0;
+    unsigned long parameterUpdates = 0;
+};
+
+class LoopbackLink;
+
+// One end of the link, the client writes and reads, the server notifies and serves reads
+class LoopbackTransport : public BLETransport {
+  public:
+    LoopbackTransport(LoopbackLink &link, bool server) : link(link), server(server) {}
+
+    bool isConnected() const override;
+    bool has(BLEChannel channel) const override;
+    bool send(BLEChannel channel, const uint8_t *data, size_t length, bool response = false) override;
+    std::string read(BLEChannel channel) override;
+    // Client only, takes effect right away with the longest interval of the range
+    bool updateConnectionParams(const BLEConnectionParams &params) override;
+    void setValue(BLEChannel channel, const uint8_t *data, size_t length) override;
+    size_t getPayloadSize() const override;
+    uint64_t now() const override;
+
+  private:
+    friend class LoopbackLink;
+
+    LoopbackLink &link;
+    bool server;
+
+    void deliver(BLEChannel channel, const uint8_t *data, size_t length) const { receive(channel, data, length, now()); }
+};
+
+class LoopbackLink {
+  public:
+    explicit LoopbackLink(uint32_t seed = 1) : random(seed) {}
+
+    LoopbackTransport &getClient() { return client; }
+    LoopbackTransport &getServer() { return server; }
+
+    void setConditions(const LinkConditions &conditions) { this->conditions = conditions; }
+    const LinkConditions &getConditions() const { return conditions; }
+    void setMTU(uint16_t mtu) { this->mtu = mtu; }
+    // Server clock minus client clock in µs
+    void setClockOffset(int64_t offset) { clockOffset = offset; }
+    // Stands in for an older controller board without the characteristic
+    void remove(BLEChannel channel) { removed[channelIndex(channel)] = true; }
+
+    // Packets in flight are lost on disconnect
+    void connect() { connected = true; }
+    void disconnect();
+    bool isConnected() const { return connected; }
+
+    uint64_t now() const { return time; }
+    // Delivers every packet due until the given time and moves the clock there
+    void advance(uint64_t until);
+    void run(uint64_t duration) { advance(time + duration); }
+    // Delivers everything in flight
+    void flush();
+
+    const LinkStats &getStats() const { return stats; }
+    void resetStats() { stats = LinkStats{}; }
+
+  private:
+    friend class LoopbackTransport;
+
+    struct Packet {
+        uint64_t due;
+        BLEChannel channel;
+        std::vector<uint8_t> data;
+    };
+
+    LoopbackTransport client{*this, false};
+    LoopbackTransport server{*this, true};
+    LinkConditions conditions{};
+    uint16_t mtu = 128;
+    int64_t clockOffset = 0;
+    bool connected = true;
+    bool removed[BLE_CHANNEL_COUNT] = {};
+    std::string values[BLE_CHANNEL_COUNT];
+    std::deque<Packet> toServer;
+    std::deque<Packet> toClient;
+    uint64_t lastDue[2] = {};
+    uint64_t time = 0;
+    std::mt19937 random;
+    LinkStats stats;
+
+    // Queues a packet from the given end, false if every attempt failed. Writes with response wait for the
+    // acknowledgement, which comes back at the connection event after the write.
+    bool transmit(bool fromServer, BLEChannel channel, const uint8_t *data, size_t length, bool response);
+};
+
+#endif // LOOPBACKTRANSPORT_H
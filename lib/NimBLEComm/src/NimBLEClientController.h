@@ -1,78 +1,41 @@
 #ifndef NIMBLECLIENTCONTROLLER_H
 #define NIMBLECLIENTCONTROLLER_H
 
+#include "BLEClientProtocol.h"
 #include "NimBLEComm.h"
-#include "cstring"
+#include "NimBLETransport.h"
 
-class NimBLEClientController : public NimBLEAdvertisedDeviceCallbacks, NimBLEClientCallbacks {
+// Finds and connects to the controller board, the protocol runs over the GATT characteristics of its service
+class NimBLEClientController : public BLEClientProtocol, NimBLEAdvertisedDeviceCallbacks, NimBLEClientCallbacks {
   public:
     NimBLEClientController();
     void initClient();
+    // Detaches the transport before an attempt, on the task that sends, so it never writes to deleted characteristics
+    void beginConnection();
+    // Connects and looks up the service, blocks for up to the connect timeout
     bool connectToServer();
-
-    void sendAdvancedOutputControl(bool valve, float boilerSetpoint, bool pressureTarget, float pressure, float flow);
-
-    void sendOutputControl(bool valve, float pumpSetpoint, float boilerSetpoint);
-    void sendAltControl(bool pinState);
-    void sendPing();
-    void sendAutotune(int testTime, int samples);
-    void sendPidSettings(const String &pid);
-    void setPressureScale(float scale);
+    // After a failed attempt, false once the retries are used up and the scan started again
+    bool retryConnection();
+    // Attaches the transport to the connected service, on the task that sends
+    void finishConnection();
     bool isReadyForConnection() const;
-    bool isConnected();
     void scan();
-    void tare();
-    void registerRemoteErrorCallback(const remote_err_callback_t &callback);
-    void registerBrewBtnCallback(const brew_callback_t &callback);
-    void registerSteamBtnCallback(const steam_callback_t &callback);
-    void registerSensorCallback(const sensor_read_callback_t &callback);
-    void registerAutotuneResultCallback(const pid_control_callback_t &callback);
-    void registerVolumetricMeasurementCallback(const float_callback_t &callback);
-    std::string readInfo() const;
     NimBLEClient *getClient() const { return client; };
 
   private:
+    NimBLEClientTransport bleTransport;
     NimBLEClient *client;
-
-    NimBLERemoteCharacteristic *tempControlChar = nullptr;
-    NimBLERemoteCharacteristic *pumpControlChar = nullptr;
-    NimBLERemoteCharacteristic *valveControlChar = nullptr;
-    NimBLERemoteCharacteristic *altControlChar = nullptr;
-    NimBLERemoteCharacteristic *tempReadChar = nullptr;
-    NimBLERemoteCharacteristic *pingChar = nullptr;
-    NimBLERemoteCharacteristic *pidControlChar = nullptr;
-    NimBLERemoteCharacteristic *errorChar = nullptr;
-    NimBLERemoteCharacteristic *autotuneChar = nullptr;
-    NimBLERemoteCharacteristic *autotuneResultChar = nullptr;
-    NimBLERemoteCharacteristic *brewBtnChar = nullptr;
-    NimBLERemoteCharacteristic *steamBtnChar = nullptr;
-    NimBLERemoteCharacteristic *infoChar = nullptr;
-    NimBLERemoteCharacteristic *sensorChar = nullptr;
-    NimBLERemoteCharacteristic *outputControlChar = nullptr;
-    NimBLERemoteCharacteristic *pressureScaleChar = nullptr;
-    NimBLERemoteCharacteristic *volumetricMeasurementChar;
-    NimBLERemoteCharacteristic *volumetricTareChar;
     NimBLEAdvertisedDevice *serverDevice = nullptr;
+    NimBLERemoteService *remoteService = nullptr;
+    uint8_t connectTries = 0;
     bool readyForConnection = false;
 
-    remote_err_callback_t remoteErrorCallback = nullptr;
-    brew_callback_t brewBtnCallback = nullptr;
-    steam_callback_t steamBtnCallback = nullptr;
-    pid_control_callback_t autotuneResultCallback = nullptr;
-    sensor_read_callback_t sensorCallback = nullptr;
-    float_callback_t volumetricMeasurementCallback = nullptr;
-
-    String _lastOutputControl = "";
-
     // BLEAdvertisedDeviceCallbacks override
     void onResult(NimBLEAdvertisedDevice *advertisedDevice) override;
 
     // NimBLEClientCallbacks override
     void onDisconnect(NimBLEClient *pServer) override;
 
-    // Notification callback
-    void notifyCallback(NimBLERemoteCharacteristic *pRemoteCharacteristic, uint8_t *pData, size_t length, bool isNotify) const;
-
     const char *LOG_TAG = "NimBLEClientController";
 };
 
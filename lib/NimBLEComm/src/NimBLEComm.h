@@ -1,6 +1,8 @@
 #ifndef NIMBLECOMM_H
 #define NIMBLECOMM_H
 
+#include "BLEProtocol.h"
+#include "BootTrace.h"
 #include <Arduino.h>
 #include <NimBLEDevice.h>
 
@@ -18,35 +20,24 @@
 
 #define PRESSURE_SCALE_UUID "3aa65ab6-2dda-4c95-9cf3-58b2a0480623"
 #define SENSOR_DATA_UUID "62b69e72-ac19-4d4b-bd53-2edd65330c93"
+#define SENSOR_FRAME_UUID "6db7d4a9-37ef-40dc-9afc-8a03affd8f51"
 #define OUTPUT_CONTROL_UUID "77fbb08f-c29c-4f2e-8e1d-ed0a9afa5e1a"
 #define VOLUMETRIC_MEASUREMENT_UUID "b0080557-3865-4a9c-be37-492d77ee5951"
 #define VOLUMETRIC_TARE_UUID "a8bd52e0-77c3-412c-847c-4e802c3982f9"
 
-constexpr size_t ERROR_CODE_COMM_SEND = 1;
-constexpr size_t ERROR_CODE_COMM_RCV = 2;
-constexpr size_t ERROR_CODE_PROTO_ERR = 3;
-constexpr size_t ERROR_CODE_RUNAWAY = 4;
-constexpr size_t ERROR_CODE_TIMEOUT = 5;
-
-using pin_control_callback_t = std::function<void(bool isActive)>;
-using pid_control_callback_t = std::function<void(float Kp, float Ki, float Kd)>;
-using ping_callback_t = std::function<void()>;
-using remote_err_callback_t = std::function<void(int errorCode)>;
-using autotune_callback_t = std::function<void(int testTime, int samples)>;
-using brew_callback_t = std::function<void(bool brewButtonStatus)>;
-using steam_callback_t = std::function<void(bool steamButtonStatus)>;
-using void_callback_t = std::function<void()>;
-
-// New combined callbacks
-using float_callback_t = std::function<void(float val)>;
-using simple_output_callback_t = std::function<void(bool valve, float pumpSetpoint, float boilerSetpoint)>;
-using advanced_output_callback_t =
-    std::function<void(bool valve, float boilerSetpoint, bool pressureTarget, float pumpPressure, float pumpFlow)>;
-using sensor_read_callback_t = std::function<void(float temperature, float pressure, float flow)>;
+#define PROGRAM_UPLOAD_UUID "fa389968-9c9e-4ac0-884a-555fc85ddd14"
+#define PROGRAM_CONTROL_UUID "29a447ed-e909-4205-be25-f712693ff94a"
+#define PROGRAM_PROGRESS_UUID "05165bf9-ca47-44fa-ad81-118ca811d4c9"
+
+#define TASK_DIAGNOSTICS_UUID "81d63c25-4985-43ca-8cfe-e6e3938cf5f8"
+
+#define PROTOCOL_UUID "bcf2a7bc-c1f7-499a-8e8f-96d46522927a"
+#define PONG_UUID "1a703fd0-e906-4b38-9cb4-6ca28482bea6"
 
 struct SystemCapabilities {
     bool dimming;
     bool pressure;
+    bool programs; // controller executes uploaded profiles itself
 };
 
 struct SystemInfo {
@@ -55,6 +46,4 @@ struct SystemInfo {
     SystemCapabilities capabilities;
 };
 
-String get_token(const String &from, uint8_t index, char separator);
-
 #endif // NIMBLECOMM_H
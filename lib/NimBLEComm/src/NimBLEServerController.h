@@ -1,63 +1,26 @@
 #ifndef NIMBLESERVERCONTROLLER_H
 #define NIMBLESERVERCONTROLLER_H
 
+#include "BLEServerProtocol.h"
 #include "NimBLEComm.h"
-#include "cstring"
+#include "NimBLETransport.h"
 #include <ble_ota_dfu.hpp>
 
-class NimBLEServerController : public NimBLEServerCallbacks, public NimBLECharacteristicCallbacks {
+// Advertises the GaggiMate service to the display, the protocol runs over the GATT characteristics of the service
+class NimBLEServerController : public BLEServerProtocol, public NimBLEServerCallbacks {
   public:
     NimBLEServerController();
     void initServer(String infoString);
-    void sendSensorData(float temperature, float pressure, float flow);
-    void sendError(int errorCode);
-    void sendBrewBtnState(bool brewButtonStatus);
-    void sendSteamBtnState(bool steamButtonStatus);
-    void sendAutotuneResult(float Kp, float Ki, float Kd);
-    void sendVolumetricMeasurement(float value);
-    void registerOutputControlCallback(const simple_output_callback_t &callback);
-    void registerAdvancedOutputControlCallback(const advanced_output_callback_t &callback);
-    void registerAltControlCallback(const pin_control_callback_t &callback);
-    void registerPidControlCallback(const pid_control_callback_t &callback);
-    void registerPingCallback(const ping_callback_t &callback);
-    void registerAutotuneCallback(const autotune_callback_t &callback);
-    void registerPressureScaleCallback(const float_callback_t &callback);
-    void registerTareCallback(const void_callback_t &callback);
     void setInfo(String infoString);
 
   private:
-    bool deviceConnected = false;
+    NimBLEServerTransport bleTransport;
     String infoString = "";
-    NimBLECharacteristic *outputControlChar = nullptr;
-    NimBLECharacteristic *pressureScaleChar = nullptr;
-    NimBLECharacteristic *altControlChar = nullptr;
-    NimBLECharacteristic *pingChar = nullptr;
-    NimBLECharacteristic *pidControlChar = nullptr;
-    NimBLECharacteristic *errorChar = nullptr;
-    NimBLECharacteristic *autotuneChar = nullptr;
-    NimBLECharacteristic *autotuneResultChar = nullptr;
-    NimBLECharacteristic *brewBtnChar = nullptr;
-    NimBLECharacteristic *steamBtnChar = nullptr;
-    NimBLECharacteristic *infoChar = nullptr;
-    NimBLECharacteristic *sensorChar = nullptr;
-    NimBLECharacteristic *volumetricMeasurementChar;
-    NimBLECharacteristic *volumetricTareChar;
-
-    simple_output_callback_t outputControlCallback = nullptr;
-    advanced_output_callback_t advancedControlCallback = nullptr;
-    pin_control_callback_t altControlCallback = nullptr;
-    pid_control_callback_t pidControlCallback = nullptr;
-    ping_callback_t pingCallback = nullptr;
-    autotune_callback_t autotuneCallback = nullptr;
-    float_callback_t pressureScaleCallback = nullptr;
-    void_callback_t tareCallback = nullptr;
 
     // BLEServerCallbacks overrides
     void onConnect(NimBLEServer *pServer) override;
     void onDisconnect(NimBLEServer *pServer) override;
-
-    // BLECharacteristicCallbacks overrides
-    void onWrite(NimBLECharacteristic *pCharacteristic) override;
+    void onMTUChange(uint16_t MTU, ble_gap_conn_desc *desc) override;
 
     BLE_OTA_DFU ota_dfu_ble;
 
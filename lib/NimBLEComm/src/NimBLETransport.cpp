@@ -0,0 +1,122 @@
+#include "NimBLETransport.h"
+
+// In the order of BLEChannel
+static const char *const CHANNEL_UUIDS[BLE_CHANNEL_COUNT] = {
+    OUTPUT_CONTROL_UUID,
+    ALT_CONTROL_CHAR_UUID,
+    PING_CHAR_UUID,
+    PID_CONTROL_CHAR_UUID,
+    AUTOTUNE_CHAR_UUID,
+    PRESSURE_SCALE_UUID,
+    VOLUMETRIC_TARE_UUID,
+    PROGRAM_UPLOAD_UUID,
+    PROGRAM_CONTROL_UUID,
+    PROTOCOL_UUID,
+    ERROR_CHAR_UUID,
+    AUTOTUNE_RESULT_UUID,
+    BREW_BTN_UUID,
+    STEAM_BTN_UUID,
+    SENSOR_DATA_UUID,
+    SENSOR_FRAME_UUID,
+    VOLUMETRIC_MEASUREMENT_UUID,
+    PROGRAM_PROGRESS_UUID,
+    TASK_DIAGNOSTICS_UUID,
+    PONG_UUID,
+    INFO_UUID,
+};
+
+void NimBLEClientTransport::attach(NimBLERemoteService *service) {
+    for (uint8_t i = 0; i < BLE_CHANNEL_COUNT; i++) {
+        const auto channel = static_cast<BLEChannel>(i);
+        NimBLERemoteCharacteristic *characteristic = service->getCharacteristic(NimBLEUUID(CHANNEL_UUIDS[i]));
+        characteristics[i] = characteristic;
+        if (characteristic != nullptr && isNotifyChannel(channel) && characteristic->canNotify()) {
+            characteristic->subscribe(true, std::bind(&NimBLEClientTransport::onNotify, this, std::placeholders::_1,
+                                                      std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+        }
+    }
+}
+
+void NimBLEClientTransport::detach() {
+    for (auto &characteristic : characteristics) {
+        characteristic = nullptr;
+    }
+}
+
+bool NimBLEClientTransport::send(BLEChannel channel, const uint8_t *data, size_t length, bool response) {
+    NimBLERemoteCharacteristic *characteristic = characteristics[channelIndex(channel)];
+    return characteristic != nullptr && characteristic->writeValue(data, length, response);
+}
+
+std::string NimBLEClientTransport::read(BLEChannel channel) {
+    NimBLERemoteCharacteristic *characteristic = characteristics[channelIndex(channel)];
+    if (characteristic != nullptr && characteristic->canRead()) {
+        return characteristic->readValue();
+    }
+    return "";
+}
+
+bool NimBLEClientTransport::updateConnectionParams(const BLEConnectionParams &params) {
+    if (!isConnected()) {
+        return false;
+    }
+    client->updateConnParams(params.minInterval, params.maxInterval, params.latency, params.timeout);
+    return true;
+}
+
+void NimBLEClientTransport::onNotify(NimBLERemoteCharacteristic *characteristic, uint8_t *data, size_t length, bool) const {
+    const uint64_t received = esp_timer_get_time();
+    for (uint8_t i = channelIndex(BLEChannel::REMOTE_ERROR); i <= channelIndex(BLEChannel::PONG); i++) {
+        if (characteristics[i] == characteristic) {
+            receive(static_cast<BLEChannel>(i), data, length, received);
+            return;
+        }
+    }
+}
+
+void NimBLEServerTransport::createCharacteristics(NimBLEService *service) {
+    for (uint8_t i = 0; i < BLE_CHANNEL_COUNT; i++) {
+        const auto channel = static_cast<BLEChannel>(i);
+        if (isWriteChannel(channel)) {
+            characteristics[i] = service->createCharacteristic(CHANNEL_UUIDS[i], NIMBLE_PROPERTY::WRITE);
+            characteristics[i]->setCallbacks(this);
+        } else if (isNotifyChannel(channel)) {
+            characteristics[i] = service->createCharacteristic(CHANNEL_UUIDS[i], NIMBLE_PROPERTY::NOTIFY);
+        } else {
+            characteristics[i] = service->createCharacteristic(CHANNEL_UUIDS[i], NIMBLE_PROPERTY::READ);
+        }
+    }
+}
+
+void NimBLEServerTransport::setConnected(bool connected) {
+    this->connected = connected;
+    mtu = BLE_ATT_MTU_DFLT;
+}
+
+bool NimBLEServerTransport::send(BLEChannel channel, const uint8_t *data, size_t length, bool) {
+    NimBLECharacteristic *characteristic = characteristics[channelIndex(channel)];
+    if (!connected || characteristic == nullptr) {
+        return false;
+    }
+    characteristic->setValue(data, length);
+    characteristic->notify();
+    return true;
+}
+
+void NimBLEServerTransport::setValue(BLEChannel channel, const uint8_t *data, size_t length) {
+    NimBLECharacteristic *characteristic = characteristics[channelIndex(channel)];
+    if (characteristic != nullptr) {
+        characteristic->setValue(data, length);
+    }
+}
+
+void NimBLEServerTransport::onWrite(NimBLECharacteristic *characteristic) {
+    const uint64_t received = esp_timer_get_time();
+    for (uint8_t i = 0; i <= channelIndex(BLEChannel::PROTOCOL); i++) {
+        if (characteristics[i] == characteristic) {
+            const auto value = characteristic->getValue();
+            receive(static_cast<BLEChannel>(i), reinterpret_cast<const uint8_t *>(value.data()), value.length(), received);
+            return;
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef NIMBLETRANSPORT_H
+#define NIMBLETRANSPORT_H
+
+#include "NimBLEComm.h"
+
+// GATT characteristics of the GaggiMate service as the transport of the protocol. Each channel is one
+// characteristic, looked up by UUID.
+
+class NimBLEClientTransport : public BLETransport {
+  public:
+    void setClient(NimBLEClient *client) { this->client = client; }
+    // Looks up the characteristic of every channel and subscribes to the notify ones, missing ones stay unset
+    void attach(NimBLERemoteService *service);
+    // Forgets the characteristics of the previous connection, a new connection deletes them
+    void detach();
+
+    bool isConnected() const override { return client != nullptr && client->isConnected(); }
+    bool has(BLEChannel channel) const override { return characteristics[channelIndex(channel)] != nullptr; }
+    bool send(BLEChannel channel, const uint8_t *data, size_t length, bool response = false) override;
+    std::string read(BLEChannel channel) override;
+    bool updateConnectionParams(const BLEConnectionParams &params) override;
+    // ATT default until the client is set, like the server before the MTU exchange
+    size_t getPayloadSize() const override { return (client != nullptr ? client->getMTU() : BLE_ATT_MTU_DFLT) - 3; }
+    uint64_t now() const override { return esp_timer_get_time(); }
+
+  private:
+    NimBLEClient *client = nullptr;
+    NimBLERemoteCharacteristic *characteristics[BLE_CHANNEL_COUNT] = {};
+
+    // Notification callback, runs on the BLE host task
+    void onNotify(NimBLERemoteCharacteristic *characteristic, uint8_t *data, size_t length, bool isNotify) const;
+};
+
+class NimBLEServerTransport : public BLETransport, public NimBLECharacteristicCallbacks {
+  public:
+    // Creates the characteristic of every channel, written ones report to this transport
+    void createCharacteristics(NimBLEService *service);
+    void setConnected(bool connected);
+    void setMTU(uint16_t mtu) { this->mtu = mtu; }
+
+    bool isConnected() const override { return connected; }
+    bool has(BLEChannel channel) const override { return characteristics[channelIndex(channel)] != nullptr; }
+    bool send(BLEChannel channel, const uint8_t *data, size_t length, bool response = false) override;
+    void setValue(BLEChannel channel, const uint8_t *data, size_t length) override;
+    size_t getPayloadSize() const override { return mtu - 3; }
+    uint64_t now() const override { return esp_timer_get_time(); }
+
+  private:
+    bool connected = false;
+    uint16_t mtu = BLE_ATT_MTU_DFLT; // ATT default until the client exchanges a larger one
+    NimBLECharacteristic *characteristics[BLE_CHANNEL_COUNT] = {};
+
+    // NimBLECharacteristicCallbacks override
+    void onWrite(NimBLECharacteristic *characteristic) override;
+};
+
+#endif // NIMBLETRANSPORT_H
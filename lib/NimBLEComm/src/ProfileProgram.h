@@ -0,0 +1,66 @@
+#ifndef PROFILEPROGRAM_H
+#define PROFILEPROGRAM_H
+
+#include <cstdint>
+
+constexpr uint8_t PROGRAM_MAX_PHASES = 12;
+constexpr uint8_t PROGRAM_MAX_EXITS = 6;
+
+// Exit condition types, same values as TargetType on the display
+constexpr uint8_t PROGRAM_EXIT_VOLUMETRIC = 0;
+constexpr uint8_t PROGRAM_EXIT_PRESSURE = 1;
+constexpr uint8_t PROGRAM_EXIT_FLOW = 2;
+constexpr uint8_t PROGRAM_EXIT_TIME = 3;
+
+// Transition shapes, same values as TransitionType on the display
+constexpr uint8_t PROGRAM_TRANSITION_INSTANT = 0;
+constexpr uint8_t PROGRAM_TRANSITION_LINEAR = 1;
+constexpr uint8_t PROGRAM_TRANSITION_EXPONENTIAL = 2;
+constexpr uint8_t PROGRAM_TRANSITION_EASE_IN_OUT = 3;
+
+struct ProgramExit {
+    uint8_t type = PROGRAM_EXIT_TIME;
+    bool lte = false;
+    float value = 0.0f;
+};
+
+// Comparison of every exit condition, on both boards. An LTE exit that already holds when its phase starts ends the
+// phase right away, like a GTE exit does.
+inline bool isExitMet(bool lte, float input, float value) { return lte ? input <= value : input >= value; }
+
+// Setpoints and exit conditions of one phase as executed by the controller board
+struct ProgramPhase {
+    bool valve = false;
+    bool advanced = false; // pump follows pressure / flow targets instead of a fixed power
+    bool pressureTarget = false;
+    float pump = 0.0f; // power in percent for simple phases
+    float pressure = 0.0f;
+    float flow = 0.0f;
+    uint8_t transition = PROGRAM_TRANSITION_INSTANT;
+    float transitionDuration = 0.0f; // seconds
+    uint8_t exitCount = 0;
+    ProgramExit exits[PROGRAM_MAX_EXITS];
+};
+
+// Profile uploaded from the display so the controller can run the phases against its own pump loop.
+// Volumetric exits are not part of the program, the display owns the scale and requests phase changes for them.
+struct ProfileProgram {
+    uint32_t id = 0;
+    uint8_t phaseCount = 0;
+    ProgramPhase phases[PROGRAM_MAX_PHASES];
+    uint16_t receivedPhases = 0; // one bit per phase index that arrived during the upload
+
+    // A phase that never arrived has no exits and would only end on the safety timeout
+    bool isComplete() const { return phaseCount > 0 && receivedPhases == (1u << phaseCount) - 1; }
+};
+
+struct ProgramProgress {
+    uint32_t id = 0;
+    uint8_t phase = 0;
+    unsigned long phaseElapsed = 0; // ms
+    bool running = false;
+};
+
+enum class ProgramCommand { START, ADVANCE, STOP };
+
+#endif // PROFILEPROGRAM_H
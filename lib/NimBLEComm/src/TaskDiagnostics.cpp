@@ -0,0 +1,10 @@
+#include "TaskDiagnostics.h"
+
+uint8_t getTaskDiagnosticsBucket(unsigned long micros) {
+    uint8_t bucket = 0;
+    while (micros >= 4 && bucket < TASK_DIAGNOSTICS_BUCKETS - 1) {
+        micros >>= 2;
+        bucket++;
+    }
+    return bucket;
+}
@@ -0,0 +1,27 @@
+#ifndef TASKDIAGNOSTICS_H
+#define TASKDIAGNOSTICS_H
+
+#include <cstdint>
+
+constexpr uint8_t TASK_DIAGNOSTICS_MAX_TASKS = 8;
+constexpr uint8_t TASK_DIAGNOSTICS_BUCKETS = 8;
+constexpr uint8_t TASK_DIAGNOSTICS_NAME_LENGTH = 16;
+
+// Timing of one periodic task on the controller board since its previous report. Times are in µs, the histograms
+// count cycles in buckets that grow by a factor of 4: <4µs, <16µs, <64µs, ... , >=16ms.
+struct TaskDiagnostics {
+    char name[TASK_DIAGNOSTICS_NAME_LENGTH] = "";
+    unsigned long period = 0; // nominal period in ms
+    unsigned long count = 0;
+    unsigned long missed = 0; // cycles that started more than half a period late or ran longer than a period
+    unsigned long periodAvg = 0;
+    unsigned long periodMax = 0;
+    unsigned long execAvg = 0;
+    unsigned long execMax = 0;
+    uint16_t jitter[TASK_DIAGNOSTICS_BUCKETS] = {}; // deviation of the actual from the nominal period
+    uint16_t exec[TASK_DIAGNOSTICS_BUCKETS] = {};
+};
+
+uint8_t getTaskDiagnosticsBucket(unsigned long micros);
+
+#endif // TASKDIAGNOSTICS_H
@@ -0,0 +1,97 @@
+#include "TextCodec.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+void TextWriter::print(const char *format, ...) {
+    if (overflow)
+        return;
+    va_list args;
+    va_start(args, format);
+    const int written = vsnprintf(text + length, sizeof(text) - length, format, args);
+    va_end(args);
+    if (written < 0 || static_cast<size_t>(written) >= sizeof(text) - length) {
+        overflow = true;
+        length = sizeof(text) - 1;
+        return;
+    }
+    length += written;
+}
+
+TextMessage::TextMessage(const uint8_t *data, size_t length, char separator) {
+    if (length > TEXT_MESSAGE_MAX_LENGTH)
+        length = TEXT_MESSAGE_MAX_LENGTH;
+    memcpy(text, data, length);
+    text[length] = '\0';
+    size_t index = 0;
+    while (index < length && count < TEXT_MESSAGE_MAX_FIELDS) {
+        fields[count++] = index;
+        while (index < length && text[index] != separator)
+            index++;
+        while (index < length && text[index] == separator)
+            index++;
+    }
+}
+
+void encodeProgramBegin(TextWriter &writer, const ProfileProgram &program) {
+    writer.print("b,%lu,%d", static_cast<unsigned long>(program.id), program.phaseCount);
+}
+
+void encodeProgramPhase(TextWriter &writer, uint8_t index, const ProgramPhase &phase) {
+    writer.print("p,%d,%d,%d,%d,%.1f,%.2f,%.2f,%d,%.2f,%d", index, phase.valve ? 1 : 0, phase.advanced ? 1 : 0,
+                 phase.pressureTarget ? 1 : 0, phase.pump, phase.pressure, phase.flow, phase.transition,
+                 phase.transitionDuration, phase.exitCount);
+    for (uint8_t i = 0; i < phase.exitCount && i < PROGRAM_MAX_EXITS; i++) {
+        writer.print(",%d,%d,%.2f", phase.exits[i].type, phase.exits[i].lte ? 1 : 0, phase.exits[i].value);
+    }
+}
+
+void encodeProgramCommit(TextWriter &writer) { writer.print("c"); }
+
+bool decodeProgramMessage(const TextMessage &message, ProfileProgram &program) {
+    const char type = message.getField(0)[0];
+    if (type == 'b') {
+        program = ProfileProgram{};
+        program.id = message.getUnsigned(1);
+        const long phaseCount = message.getInt(2);
+        program.phaseCount = phaseCount < 0 ? 0 : phaseCount < PROGRAM_MAX_PHASES ? phaseCount : PROGRAM_MAX_PHASES;
+    } else if (type == 'p') {
+        const long index = message.getInt(1);
+        if (index < 0 || index >= program.phaseCount) {
+            return false;
+        }
+        ProgramPhase &phase = program.phases[index];
+        phase.valve = message.getInt(2) == 1;
+        phase.advanced = message.getInt(3) == 1;
+        phase.pressureTarget = message.getInt(4) == 1;
+        phase.pump = message.getFloat(5);
+        phase.pressure = message.getFloat(6);
+        phase.flow = message.getFloat(7);
+        phase.transition = message.getInt(8);
+        phase.transitionDuration = message.getFloat(9);
+        const long exitCount = message.getInt(10);
+        phase.exitCount = exitCount < 0 ? 0 : exitCount < PROGRAM_MAX_EXITS ? exitCount : PROGRAM_MAX_EXITS;
+        for (uint8_t i = 0; i < phase.exitCount; i++) {
+            phase.exits[i].type = message.getInt(11 + i * 3);
+            phase.exits[i].lte = message.getInt(12 + i * 3) == 1;
+            phase.exits[i].value = message.getFloat(13 + i * 3);
+        }
+        program.receivedPhases |= 1 << index;
+    } else if (type == 'c') {
+        return program.isComplete();
+    }
+    return false;
+}
+
+void encodeProgramProgress(TextWriter &writer, const ProgramProgress &progress) {
+    writer.print("%lu,%d,%lu,%d", static_cast<unsigned long>(progress.id), progress.phase, progress.phaseElapsed,
+                 progress.running ? 1 : 0);
+}
+
+void decodeProgramProgress(const TextMessage &message, ProgramProgress &progress) {
+    progress.id = message.getUnsigned(0);
+    progress.phase = message.getInt(1);
+    progress.phaseElapsed = message.getUnsigned(2);
+    progress.running = message.getInt(3) == 1;
+}
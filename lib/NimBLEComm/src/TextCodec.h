@@ -0,0 +1,65 @@
+#ifndef TEXTCODEC_H
+#define TEXTCODEC_H
+
+#include "ProfileProgram.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+// Comma separated text encoding of the BLE messages, the only one older peers understand. Built in fixed buffers so
+// it works the same without Arduino String on the host.
+
+constexpr size_t TEXT_MESSAGE_MAX_LENGTH = 200; // program phases with every exit are the longest messages
+constexpr uint8_t TEXT_MESSAGE_MAX_FIELDS = 32;
+
+class TextWriter {
+  public:
+    // Appends like snprintf, text that doesn't fit is cut off and the writer marked as overflowed
+    void print(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+    const uint8_t *data() const { return reinterpret_cast<const uint8_t *>(text); }
+    const char *c_str() const { return text; }
+    size_t size() const { return length; }
+    bool ok() const { return !overflow; }
+
+  private:
+    char text[TEXT_MESSAGE_MAX_LENGTH + 1] = "";
+    size_t length = 0;
+    bool overflow = false;
+};
+
+// Numeric fields of a text message read without allocating, consecutive separators count as one. Missing fields
+// read as 0.
+class TextMessage {
+  public:
+    TextMessage(const uint8_t *data, size_t length, char separator = ',');
+
+    const char *getText() const { return text; }
+    uint8_t getCount() const { return count; }
+    // Start of the field, runs until the end of the message
+    const char *getField(uint8_t index) const { return index < count ? text + fields[index] : ""; }
+    float getFloat(uint8_t index) const { return index < count ? strtof(text + fields[index], nullptr) : 0.0f; }
+    long getInt(uint8_t index) const { return index < count ? strtol(text + fields[index], nullptr, 10) : 0; }
+    unsigned long getUnsigned(uint8_t index) const { return index < count ? strtoul(text + fields[index], nullptr, 10) : 0; }
+
+  private:
+    char text[TEXT_MESSAGE_MAX_LENGTH + 1];
+    uint8_t fields[TEXT_MESSAGE_MAX_FIELDS]; // offset of every field in text
+    uint8_t count = 0;
+};
+
+// The program is uploaded as one begin message, one message per phase and a commit message, so every write
+// stays below the MTU: "b,<id>,<phaseCount>", "p,<index>,<phase fields...>", "c"
+void encodeProgramBegin(TextWriter &writer, const ProfileProgram &program);
+void encodeProgramPhase(TextWriter &writer, uint8_t index, const ProgramPhase &phase);
+void encodeProgramCommit(TextWriter &writer);
+// Applies an upload message to program, returns true once the commit message for a complete program arrived
+bool decodeProgramMessage(const TextMessage &message, ProfileProgram &program);
+
+// "<id>,<phase>,<phaseElapsed>,<running>"
+void encodeProgramProgress(TextWriter &writer, const ProgramProgress &progress);
+void decodeProgramProgress(const TextMessage &message, ProgramProgress &progress);
+
+// "<name>,<period>,<count>,<missed>,<periodAvg>,<periodMax>,<execAvg>,<execMax>,<j0;..;j7>,<e0;..;e7>"
+
+#endif // TEXTCODEC_H
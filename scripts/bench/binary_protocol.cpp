@@ -0,0 +1,166 @@
+// Compares the binary BLE codec with the text messages it replaces. Measures encode and decode time and message size of
+// the two most frequent messages, sensor data and output control. The codec itself is checked by test/test_binary_codec.
+//
+// The text side is reproduced with std::string in place of the Arduino String, using the same snprintf formats and
+// a copy of every token like the String based parsing the firmware used. String allocates for every token, so the
+// text numbers are a lower bound of that cost on the device.
+//
+// Usage: scripts/bench/run.sh binary_protocol [--iterations n]
+
+// run.sh builds a single translation unit, the codec is compiled in directly
+#include <BinaryCodec.cpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace text {
+// String token splitting on std::string, consecutive separators count as one
+static std::string getToken(const std::string &from, uint8_t index, char separator) {
+    size_t start = 0;
+    size_t idx = 0;
+    uint8_t cur = 0;
+    while (idx < from.length()) {
+        if (from[idx] == separator) {
+            if (cur == index)
+                return from.substr(start, idx - start);
+            cur++;
+            while (idx < from.length() - 1 && from[idx + 1] == separator)
+                idx++;
+            start = idx + 1;
+        }
+        idx++;
+    }
+    if (cur == index && start < from.length())
+        return from.substr(start);
+    return "";
+}
+
+static float toFloat(const std::string &value) { return strtof(value.c_str(), nullptr); }
+} // namespace text
+
+// Makes the compiler assume the bytes behind pointer are read, so an encoder writing them can't be dropped
+static inline void doNotOptimize(const void *pointer) { asm volatile("" : : "r"(pointer) : "memory"); }
+
+// Makes the compiler assume all memory changed, so a decoder reading an unchanged buffer can't be hoisted out of a loop
+static inline void clobberMemory() { asm volatile("" : : : "memory"); }
+
+struct Result {
+    double encode;
+    double decode;
+    size_t size;
+};
+
+template <typename Encode, typename Decode> static Result measure(unsigned long iterations, Encode &&encode, Decode &&decode) {
+    Result result{};
+    volatile size_t sizes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < iterations; i++) {
+        sizes = sizes + encode(static_cast<float>(i & 0xFF) * 0.1f);
+    }
+    auto end = std::chrono::steady_clock::now();
+    result.encode = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+    result.size = sizes / iterations;
+    start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < iterations; i++) {
+        clobberMemory();
+        decode();
+    }
+    end = std::chrono::steady_clock::now();
+    result.decode = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+    return result;
+}
+
+static void print(const char *name, const Result &result) {
+    printf("%-28s %10.1f %10.1f %8zu\n", name, result.encode, result.decode, result.size);
+}
+
+int main(int argc, char **argv) {
+    unsigned long iterations = 1000000;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--iterations") && i + 1 < argc) {
+            iterations = strtoul(argv[++i], nullptr, 10);
+        } else {
+            fprintf(stderr, "Unknown argument %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    volatile float sink = 0.0f;
+    char textBuffer[48];
+    BinaryWriter binaryBuffer;
+
+    const Result sensorText = measure(
+        iterations,
+        [&](float value) {
+            snprintf(textBuffer, sizeof(textBuffer), "%.3f,%.3f,%.3f", 90.0f + value, value, value * 0.5f);
+            doNotOptimize(textBuffer);
+            return strlen(textBuffer);
+        },
+        [&]() {
+            const std::string data(textBuffer);
+            sink = sink + text::toFloat(text::getToken(data, 0, ',')) + text::toFloat(text::getToken(data, 1, ',')) +
+                   text::toFloat(text::getToken(data, 2, ','));
+        });
+    const Result sensorBinary = measure(
+        iterations,
+        [&](float value) {
+            binaryBuffer = BinaryWriter();
+            encodeSensorData(binaryBuffer, SensorData{90.0f + value, value, value * 0.5f});
+            doNotOptimize(binaryBuffer.data());
+            return binaryBuffer.size();
+        },
+        [&]() {
+            BinaryReader reader(binaryBuffer.data(), binaryBuffer.size());
+            SensorData data;
+            decodeSensorData(reader, data);
+            sink = sink + data.temperature + data.pressure + data.flow;
+        });
+
+    const Result outputText = measure(
+        iterations,
+        [&](float value) {
+            snprintf(textBuffer, sizeof(textBuffer), "%d,%d,%.1f,%.1f,%d,%.2f,%.2f", 1, 1, 100.0f, 93.0f + value, 1, value,
+                     value * 0.5f);
+            doNotOptimize(textBuffer);
+            return strlen(textBuffer);
+        },
+        [&]() {
+            const std::string control(textBuffer);
+            sink = sink + text::toFloat(text::getToken(control, 0, ',')) + text::toFloat(text::getToken(control, 1, ',')) +
+                   text::toFloat(text::getToken(control, 3, ',')) + text::toFloat(text::getToken(control, 4, ',')) +
+                   text::toFloat(text::getToken(control, 5, ',')) + text::toFloat(text::getToken(control, 6, ','));
+        });
+    const Result outputBinary = measure(
+        iterations,
+        [&](float value) {
+            OutputControl control;
+            control.valve = true;
+            control.advanced = true;
+            control.pressureTarget = true;
+            control.boilerSetpoint = 93.0f + value;
+            control.pressure = value;
+            control.flow = value * 0.5f;
+            binaryBuffer = BinaryWriter();
+            encodeOutputControl(binaryBuffer, control);
+            doNotOptimize(binaryBuffer.data());
+            return binaryBuffer.size();
+        },
+        [&]() {
+            BinaryReader reader(binaryBuffer.data(), binaryBuffer.size());
+            OutputControl control;
+            decodeOutputControl(reader, control);
+            sink = sink + control.boilerSetpoint + control.pressure + control.flow;
+        });
+
+    printf("%lu messages per row\n\n", iterations);
+    printf("%-28s %10s %10s %8s\n", "", "encode ns", "decode ns", "bytes");
+    print("sensor data, text", sensorText);
+    print("sensor data, binary", sensorBinary);
+    print("advanced output, text", outputText);
+    print("advanced output, binary", outputBinary);
+    return 0;
+}
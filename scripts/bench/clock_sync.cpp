@@ -0,0 +1,129 @@
+// Simulates the timestamped ping exchange between display and controller board and compares the offset estimate of
+// ClockSync with taking every exchange as is.
+//
+// The controller clock runs ahead by a fixed offset and drifts by a few ppm. Each direction of the link takes a
+// connection event alignment of up to one interval plus an exponentially distributed queuing delay, independently,
+// so the path is asymmetric most of the time. The error of an estimate is its distance from the true offset at the
+// time of the exchange. Exits with status 1 if the filtered estimate ever violates the half round trip bound or is
+// not better than the raw one.
+//
+// Usage: scripts/bench/run.sh clock_sync [--pings n] [--interval ms] [--queue ms] [--seed n]
+
+#include <ClockSync.cpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+struct Errors {
+    std::vector<double> values;
+
+    void add(double error) { values.push_back(fabs(error)); }
+
+    double percentile(double p) {
+        std::sort(values.begin(), values.end());
+        return values[static_cast<size_t>(p * (values.size() - 1))];
+    }
+    double mean() const {
+        double total = 0.0;
+        for (double value : values)
+            total += value;
+        return total / values.size();
+    }
+};
+
+int main(int argc, char **argv) {
+    unsigned long pings = 3600;
+    double interval = 7.5; // ms, connection interval
+    double queue = 5.0;    // ms, mean queuing delay per direction
+    unsigned long seed = 1;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--pings") && i + 1 < argc) {
+            pings = strtoul(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--interval") && i + 1 < argc) {
+            interval = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--queue") && i + 1 < argc) {
+            queue = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            seed = strtoul(argv[++i], nullptr, 10);
+        } else {
+            fprintf(stderr, "Unknown argument %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    std::mt19937_64 random(seed);
+    std::uniform_real_distribution<double> alignment(0.0, interval * 1000.0);
+    std::exponential_distribution<double> queuing(1.0 / (queue * 1000.0));
+    std::uniform_real_distribution<double> processing(100.0, 400.0);
+
+    const double trueOffset = 3723456789.0; // µs, controller booted about an hour earlier
+    const double drift = 20e-6;
+    auto remote = [&](double local) { return local + trueOffset + local * drift; };
+
+    ClockSync sync;
+    Errors raw;
+    Errors filtered;
+    int failures = 0;
+    double local = 10e6;
+    for (unsigned long i = 0; i < pings; i++) {
+        local += 1e6; // one ping per second
+        ClockExchange exchange;
+        exchange.sent = static_cast<uint64_t>(local);
+        const double arrival = local + alignment(random) + queuing(random);
+        exchange.received = static_cast<uint64_t>(remote(arrival));
+        const double answer = arrival + processing(random);
+        exchange.replied = static_cast<uint64_t>(remote(answer));
+        const double back = answer + alignment(random) + queuing(random);
+        exchange.returned = static_cast<uint64_t>(back);
+        if (!sync.add(exchange)) {
+            fprintf(stderr, "exchange %lu rejected\n", i);
+            failures++;
+            continue;
+        }
+        const double actual = remote(back) - back;
+        raw.add(static_cast<double>(exchange.offset()) - actual);
+        const double error = static_cast<double>(sync.getOffset()) - actual;
+        filtered.add(error);
+        // Drift over the filter window and the rounding to whole µs on top of the half round trip
+        const double bound = sync.getRoundTrip() / 2.0 + CLOCK_SYNC_SAMPLES * 1e6 * drift + 2.0;
+        if (fabs(error) > bound) {
+            fprintf(stderr, "exchange %lu: error %.0fus exceeds %.0fus\n", i, error, bound);
+            failures++;
+        }
+    }
+
+    // An exchange with the answer before the ping is nonsense and must not replace the estimate
+    ClockExchange bogus;
+    bogus.sent = 1000;
+    bogus.received = 5000;
+    bogus.replied = 9000;
+    bogus.returned = 2000;
+    const int64_t before = sync.getOffset();
+    if (sync.add(bogus) || sync.getOffset() != before) {
+        fprintf(stderr, "negative round trip accepted\n");
+        failures++;
+    }
+
+    printf("%lu pings, %.1fms connection interval, %.1fms mean queuing per direction\n\n", pings, interval, queue);
+    printf("%-12s %10s %10s %10s %10s\n", "offset", "mean us", "p50 us", "p95 us", "max us");
+    printf("%-12s %10.0f %10.0f %10.0f %10.0f\n", "raw", raw.mean(), raw.percentile(0.5), raw.percentile(0.95),
+           raw.percentile(1.0));
+    printf("%-12s %10.0f %10.0f %10.0f %10.0f\n", "filtered", filtered.mean(), filtered.percentile(0.5),
+           filtered.percentile(0.95), filtered.percentile(1.0));
+    printf("\nlast round trip %uus, jitter %uus\n", sync.getRoundTrip(), sync.getJitter());
+
+    if (filtered.percentile(0.95) >= raw.percentile(0.95)) {
+        fprintf(stderr, "filter does not improve on raw exchanges\n");
+        failures++;
+    }
+    if (failures > 0) {
+        fprintf(stderr, "%d clock sync checks failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,120 @@
+// Runs the controller board schedule of the cyclic executive against a simulated clock and compares the age of the
+// pressure sample the pump controller works on with the separate task per peripheral setup.
+//
+// The schedule below mirrors GaggiMateController::setupExecutive. Frame start times get uniform jitter of up to
+// --jitter µs. For the task per peripheral model the pressure and pump tasks run free with their own phase and the
+// same jitter, so the pump sees a sample that is up to one period old.
+//
+// Usage: scripts/bench/run.sh cyclic_executive [--frames n] [--jitter us] [--seed n]
+
+#include <CyclicExecutive.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+struct SlotStats {
+    unsigned long runs = 0;
+    float dtMin = 1e9f;
+    float dtMax = 0.0f;
+};
+
+static double percentile(std::vector<double> values, double p) {
+    if (values.empty())
+        return 0.0;
+    std::sort(values.begin(), values.end());
+    const size_t index = std::min(values.size() - 1, static_cast<size_t>(p * (values.size() - 1) + 0.5));
+    return values[index];
+}
+
+int main(int argc, char **argv) {
+    unsigned long frames = 100000;
+    unsigned long jitter = 2000;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+            frames = strtoul(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--jitter") && i + 1 < argc) {
+            jitter = strtoul(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            seed = static_cast<unsigned>(atoi(argv[++i]));
+        } else {
+            fprintf(stderr, "Unknown argument %s\n", argv[i]);
+            return 1;
+        }
+    }
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<unsigned long> jitterDist(0, jitter);
+
+    CyclicExecutive executive;
+    std::vector<SlotStats> stats(CYCLIC_MAX_SLOTS);
+    std::vector<double> sampleAge;
+    unsigned long now = 0;
+    unsigned long pressureSampled = 0;
+    uint8_t perFrame = 0;
+    auto slot = [&](uint8_t index, const std::function<void()> &work) {
+        return [&, index, work](float dt) {
+            SlotStats &s = stats[index];
+            s.runs++;
+            s.dtMin = std::min(s.dtMin, dt);
+            s.dtMax = std::max(s.dtMax, dt);
+            perFrame++;
+            if (work)
+                work();
+        };
+    };
+    executive.add("pressure", CYCLIC_RATE_30MS, 0, slot(0, [&]() { pressureSampled = now; }));
+    executive.add("thermocouple", 250 / CYCLIC_FRAME_MS, 5, slot(1, nullptr));
+    executive.add("executor", CYCLIC_RATE_30MS, 0, slot(2, nullptr));
+    executive.add("pump", CYCLIC_RATE_30MS, 0, slot(3, [&]() { sampleAge.push_back((now - pressureSampled) / 1000.0); }));
+    executive.add("heater", CYCLIC_RATE_10MS, 0, slot(4, nullptr));
+    executive.add("brew button", CYCLIC_RATE_100MS, 1, slot(5, nullptr));
+    executive.add("steam button", CYCLIC_RATE_100MS, 2, slot(6, nullptr));
+
+    std::vector<uint8_t> load(executive.getHyperperiod());
+    for (unsigned long f = 0; f < frames; f++) {
+        const uint16_t frame = executive.getFrame();
+        now = f * CYCLIC_FRAME_MS * 1000UL + jitterDist(rng);
+        perFrame = 0;
+        executive.runFrame(now);
+        load[frame] = perFrame;
+    }
+
+    // Separate tasks: both run every 30ms from their own start time, the pump reads whatever sample is newest
+    std::vector<double> taskSampleAge;
+    const unsigned long period = 30000;
+    std::uniform_int_distribution<unsigned long> phaseDist(0, period - 1);
+    const unsigned long pressurePhase = phaseDist(rng);
+    const unsigned long pumpPhase = phaseDist(rng);
+    unsigned long lastPressure = 0;
+    unsigned long nextPressure = pressurePhase + jitterDist(rng);
+    for (unsigned long cycle = 1; cycle < frames / 3; cycle++) {
+        const unsigned long pumpTime = pumpPhase + cycle * period + jitterDist(rng);
+        while (nextPressure <= pumpTime) {
+            lastPressure = nextPressure;
+            nextPressure += period + jitterDist(rng) / 4;
+        }
+        taskSampleAge.push_back((pumpTime - lastPressure) / 1000.0);
+    }
+
+    printf("Simulated %lu frames of %lums, jitter up to %luus, hyperperiod %d frames\n\n", frames, CYCLIC_FRAME_MS,
+           jitter, executive.getHyperperiod());
+    printf("%-14s %6s %7s %9s %9s %9s\n", "slot", "period", "offset", "runs", "dt min", "dt max");
+    for (uint8_t i = 0; i < executive.getSlotCount(); i++) {
+        const CyclicSlot &s = executive.getSlot(i);
+        printf("%-14s %4lums %7d %9lu %7.1fms %7.1fms\n", s.name, s.frames * CYCLIC_FRAME_MS, s.offset, stats[i].runs,
+               stats[i].dtMin * 1000.0f, stats[i].dtMax * 1000.0f);
+    }
+    printf("\nslots per frame:");
+    for (uint8_t slots : load)
+        printf(" %d", slots);
+    printf("\n\n%-22s %8s %8s %8s\n", "pump sample age", "p50", "p90", "max");
+    printf("%-22s %6.1fms %6.1fms %6.1fms\n", "cyclic executive", percentile(sampleAge, 0.5), percentile(sampleAge, 0.9),
+           percentile(sampleAge, 1.0));
+    printf("%-22s %6.1fms %6.1fms %6.1fms\n", "task per peripheral", percentile(taskSampleAge, 0.5),
+           percentile(taskSampleAge, 0.9), percentile(taskSampleAge, 1.0));
+    return 0;
+}
@@ -0,0 +1,161 @@
+// Measures the cost of triggering a sensor event with the string keyed event map the plugin manager used before and
+// with the typed EventBus, including the heap allocations per trigger.
+//
+// The legacy path is reproduced with std::string in place of the Arduino String. std::string keeps short strings
+// inline while String always allocates, so the legacy numbers here are a lower bound of the cost on the device.
+// Both paths dispatch to the same listeners the display registers for boiler:pressure:change and pump:flow:change.
+//
+// Usage: scripts/bench/run.sh event_dispatch [--iterations n]
+
+#include <display/core/EventBus.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+static unsigned long allocations = 0;
+
+void *operator new(size_t size) {
+    allocations++;
+    if (void *ptr = malloc(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+
+namespace legacy {
+enum class EventDataType { EVENT_TYPE_INT, EVENT_TYPE_FLOAT, EVENT_TYPE_STRING, EVENT_TYPE_NONE };
+
+struct EventDataEntry {
+    std::string key;
+    EventDataType type = EventDataType::EVENT_TYPE_NONE;
+    int intValue = 0;
+    float floatValue = 0.0f;
+    std::string stringValue = "";
+
+    EventDataEntry(const std::string &k, float value) : key(k), type(EventDataType::EVENT_TYPE_FLOAT), floatValue(value) {}
+};
+
+struct Event {
+    std::string id;
+    std::vector<EventDataEntry> data;
+    bool stopPropagation = false;
+
+    void setFloat(const std::string &key, float value) { data.emplace_back(key, value); }
+
+    float getFloat(const std::string &key) const {
+        for (const auto &entry : data) {
+            if (entry.key == key && entry.type == EventDataType::EVENT_TYPE_FLOAT) {
+                return entry.floatValue;
+            }
+        }
+        return 0.0f;
+    }
+};
+
+using EventCallback = std::function<void(Event &)>;
+
+class PluginManager {
+  public:
+    void on(const std::string &eventId, const EventCallback &callback) {
+        listeners[std::string(eventId.c_str())].push_back(callback);
+    }
+
+    Event trigger(const std::string &eventId, const std::string &key, float value) {
+        Event event;
+        event.id = eventId;
+        event.setFloat(key, value);
+        trigger(event);
+        return event;
+    }
+
+    void trigger(Event &event) {
+        if (listeners.count(std::string(event.id.c_str()))) {
+            for (auto const &callback : listeners[std::string(event.id.c_str())]) {
+                callback(event);
+                if (event.stopPropagation) {
+                    break;
+                }
+            }
+        }
+    }
+
+  private:
+    std::map<std::string, std::vector<EventCallback>> listeners = {};
+};
+} // namespace legacy
+
+struct Result {
+    double nanos;
+    double allocations;
+};
+
+template <typename F> static Result measure(unsigned long iterations, F &&trigger) {
+    const unsigned long allocationsBefore = allocations;
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < iterations; i++) {
+        trigger(static_cast<float>(i & 0xFF) * 0.1f);
+    }
+    const auto end = std::chrono::steady_clock::now();
+    const double nanos = std::chrono::duration<double, std::nano>(end - start).count();
+    return Result{nanos / iterations, static_cast<double>(allocations - allocationsBefore) / iterations};
+}
+
+int main(int argc, char **argv) {
+    unsigned long iterations = 2000000;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--iterations") && i + 1 < argc) {
+            iterations = strtoul(argv[++i], nullptr, 10);
+        } else {
+            fprintf(stderr, "Unknown argument %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    volatile float sink = 0.0f;
+    legacy::PluginManager legacyManager;
+    EventBus bus;
+    // Listener set of a display with the default UI, MQTT and Homekit, plus some unrelated events in the map
+    const char *otherEvents[] = {"controller:mode:change", "controller:brew:start", "controller:grind:start",
+                                 "boiler:currentTemperature:change", "boiler:targetTemperature:change",
+                                 "controller:wifi:connect", "ota:update:start", "profiles:profile:select"};
+    for (const char *id : otherEvents) {
+        legacyManager.on(id, [&sink](legacy::Event &event) { sink = sink + event.getFloat("value"); });
+    }
+    legacyManager.on("boiler:pressure:change", [&sink](legacy::Event &event) { sink = sink + event.getFloat("value"); });
+    legacyManager.on("pump:flow:change", [&sink](legacy::Event &event) { sink = sink + event.getFloat("value"); });
+    for (uint8_t id = 0; id < EVENT_ID_COUNT; id += 4) {
+        bus.on(static_cast<EventId>(id), [&sink](Event &event) { sink = sink + event.getFloat("value"); });
+    }
+    bus.on(EventId::BOILER_PRESSURE_CHANGE, [&sink](Event &event) { sink = sink + event.getFloat("value"); });
+    bus.on(EventId::PUMP_FLOW_CHANGE, [&sink](Event &event) { sink = sink + event.getFloat("value"); });
+
+    const Result before = measure(iterations, [&legacyManager](float value) {
+        legacyManager.trigger("boiler:pressure:change", "value", value);
+        legacyManager.trigger("pump:flow:change", "value", value);
+    });
+    const Result after = measure(iterations, [&bus](float value) {
+        Event pressure;
+        pressure.id = EventId::BOILER_PRESSURE_CHANGE;
+        pressure.setFloat("value", value);
+        bus.dispatch(pressure);
+        Event flow;
+        flow.id = EventId::PUMP_FLOW_CHANGE;
+        flow.setFloat("value", value);
+        bus.dispatch(flow);
+    });
+
+    printf("%lu sensor notifications, each triggering boiler:pressure:change and pump:flow:change\n\n", iterations);
+    printf("%-22s %12s %14s\n", "", "ns/sample", "allocs/sample");
+    printf("%-22s %12.1f %14.1f\n", "string keyed map", before.nanos, before.allocations);
+    printf("%-22s %12.1f %14.1f\n", "typed event bus", after.nanos, after.allocations);
+    printf("\nspeedup %.1fx\n", before.nanos / after.nanos);
+    return 0;
+}
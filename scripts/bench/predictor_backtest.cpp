@@ -0,0 +1,188 @@
+// Replays recorded weight streams through the volume predictors and reports the stop weight error of each.
+//
+// Input files are CSV with one "time_ms,weight" sample per line, recorded from a shot that was allowed to run past
+// the target. Lines that do not start with a number are ignored. Without input files a set of synthetic shots with
+// accelerating, constant and tapering flow is generated instead.
+//
+// For every sample the predictor is asked for the weight expected after the stop delay. Once that reaches the target
+// the shot is stopped and the final weight is read from the recording at stop time + delay, which includes the drip
+// after the pump has been switched off.
+//
+// Usage: scripts/bench/run.sh predictor_backtest [--target g] [--delay ms] [--synthetic n] [--seed n] [files...]
+
+#include <display/core/predictive.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct Sample {
+    double time;
+    double weight;
+};
+
+using Shot = std::vector<Sample>;
+
+static bool loadShot(const char *path, Shot &shot) {
+    std::ifstream file(path);
+    if (!file)
+        return false;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || !(isdigit(line[0]) || line[0] == '-' || line[0] == '.'))
+            continue;
+        std::replace(line.begin(), line.end(), ',', ' ');
+        std::istringstream stream(line);
+        Sample sample{};
+        if (stream >> sample.time >> sample.weight)
+            shot.push_back(sample);
+    }
+    return shot.size() > 2;
+}
+
+// Flow in g/s follows a ramp up into a profile specific shape, the scale adds noise and reports at ~10Hz with jitter
+static Shot generateShot(std::mt19937 &rng, int variant, double target) {
+    std::normal_distribution<double> noise(0.0, 0.05);
+    std::uniform_real_distribution<double> jitter(-15.0, 15.0);
+    std::uniform_real_distribution<double> scale(0.7, 1.4);
+    const double baseFlow = 2.0 * scale(rng);
+    Shot shot;
+    double weight = 0.0;
+    double time = 0.0;
+    const double dt = 100.0;
+    while (weight < target * 1.6) {
+        const double seconds = time / 1000.0;
+        double flow;
+        switch (variant % 3) {
+        case 0: // accelerating, channeling puck
+            flow = baseFlow * (0.3 + 0.06 * seconds);
+            break;
+        case 1: // steady
+            flow = baseFlow;
+            break;
+        default: // tapering, declining pressure profile
+            flow = baseFlow * std::max(0.25, 1.6 - 0.05 * seconds);
+            break;
+        }
+        if (seconds < 5.0)
+            flow *= seconds / 5.0; // preinfusion ramp
+        const double step = dt + jitter(rng);
+        weight += flow * step / 1000.0;
+        time += step;
+        shot.push_back(Sample{time, weight + noise(rng)});
+    }
+    return shot;
+}
+
+static double weightAt(const Shot &shot, double time) {
+    if (time <= shot.front().time)
+        return shot.front().weight;
+    for (size_t i = 1; i < shot.size(); i++) {
+        if (shot[i].time >= time) {
+            const double f = (time - shot[i - 1].time) / (shot[i].time - shot[i - 1].time);
+            return shot[i - 1].weight + f * (shot[i].weight - shot[i - 1].weight);
+        }
+    }
+    return shot.back().weight;
+}
+
+struct Result {
+    std::vector<double> errors;
+    int missed = 0;
+};
+
+static void replay(const Shot &shot, VolumePredictorType type, double target, double delay, Result &result) {
+    auto predictor = createVolumePredictor(type, 4000.0);
+    for (const auto &sample : shot) {
+        predictor->addMeasurement(sample.weight, sample.time);
+        if (predictor->predictVolume(sample.time, delay) >= target) {
+            result.errors.push_back(weightAt(shot, sample.time + delay) - target);
+            return;
+        }
+    }
+    result.missed++;
+}
+
+static double percentile(std::vector<double> values, double p) {
+    if (values.empty())
+        return 0.0;
+    std::sort(values.begin(), values.end());
+    const size_t index = std::min(values.size() - 1, static_cast<size_t>(p * (values.size() - 1) + 0.5));
+    return values[index];
+}
+
+int main(int argc, char **argv) {
+    double target = 36.0;
+    double delay = 1000.0;
+    int synthetic = 300;
+    unsigned seed = 1;
+    std::vector<Shot> shots;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--target") && i + 1 < argc) {
+            target = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--delay") && i + 1 < argc) {
+            delay = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--synthetic") && i + 1 < argc) {
+            synthetic = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            seed = static_cast<unsigned>(atoi(argv[++i]));
+        } else {
+            Shot shot;
+            if (!loadShot(argv[i], shot)) {
+                fprintf(stderr, "Could not read shot from %s\n", argv[i]);
+                return 1;
+            }
+            shots.push_back(shot);
+        }
+    }
+
+    if (shots.empty()) {
+        std::mt19937 rng(seed);
+        for (int i = 0; i < synthetic; i++)
+            shots.push_back(generateShot(rng, i, target));
+        printf("Replaying %d synthetic shots", synthetic);
+    } else {
+        printf("Replaying %zu recorded shots", shots.size());
+    }
+    printf(", target %.1fg, stop delay %.0fms\n\n", target, delay);
+
+    const struct {
+        VolumePredictorType type;
+        const char *name;
+    } predictors[] = {
+        {VolumePredictorType::LINEAR, "linear"},
+        {VolumePredictorType::QUADRATIC, "quadratic"},
+        {VolumePredictorType::KALMAN, "kalman"},
+    };
+
+    printf("%-10s %6s %8s %8s %8s %8s %8s %8s %7s\n", "predictor", "shots", "mean", "stddev", "p10", "p50", "p90", "max|e|",
+           "missed");
+    for (const auto &predictor : predictors) {
+        Result result;
+        for (const auto &shot : shots)
+            replay(shot, predictor.type, target, delay, result);
+        double mean = 0.0;
+        double maxAbs = 0.0;
+        for (double e : result.errors) {
+            mean += e;
+            maxAbs = std::max(maxAbs, std::fabs(e));
+        }
+        mean = result.errors.empty() ? 0.0 : mean / result.errors.size();
+        double variance = 0.0;
+        for (double e : result.errors)
+            variance += (e - mean) * (e - mean);
+        variance = result.errors.size() > 1 ? variance / (result.errors.size() - 1) : 0.0;
+        printf("%-10s %6zu %+8.2f %8.2f %+8.2f %+8.2f %+8.2f %8.2f %7d\n", predictor.name, result.errors.size(), mean,
+               std::sqrt(variance), percentile(result.errors, 0.1), percentile(result.errors, 0.5),
+               percentile(result.errors, 0.9), maxAbs, result.missed);
+    }
+    return 0;
+}
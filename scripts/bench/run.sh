@@ -0,0 +1,21 @@
+#!/usr/bin/env bash
+# Builds and runs one of the host side benchmark tools in this directory.
+# Usage: scripts/bench/run.sh <tool> [arguments...]
+# Example: scripts/bench/run.sh predictor_backtest --target 36 shots/*.csv
+
+set -e
+
+if [ -z "$1" ]; then
+    echo "Usage: $0 <tool> [arguments...]"
+    exit 1
+fi
+
+ROOT="$(cd "$(dirname "$0")/../.." && pwd)"
+TOOL="$1"
+shift
+
+OUT="${TMPDIR:-/tmp}/gaggimate-bench"
+
+mkdir -p "$OUT"
+${CXX:-g++} -std=gnu++17 -O2 -Wall -I"$ROOT/src" -I"$ROOT/lib/NimBLEComm/src" -I"$ROOT/lib/GaggiMateController/src" -o "$OUT/$TOOL" "$ROOT/scripts/bench/$TOOL.cpp"
+"$OUT/$TOOL" "$@"
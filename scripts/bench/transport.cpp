@@ -0,0 +1,589 @@
+// Runs the display and controller board protocol layers against each other over the loopback transport.
+//
+// The first part checks the conversation end to end: reading the info, negotiating the protocol, every command in
+// the text and the binary encoding, the program upload, clock synchronisation over timestamped pings and the
+// fallbacks for controller boards without the newer characteristics. It exits with status 1 if any check fails.
+//
+// The second part runs a shot under different link conditions on the simulated clock: output control writes from
+// the display every CONTROL_MIN_INTERVAL and sensor frames batched like GaggiMateController::sendSensorData. It
+// reports the share of messages delivered and their latency. The third part pings over the connection parameters of
+// each link mode and reports the latency of the write and of the notification answering it. The last part measures
+// host time for a message through encoder, transport and decoder.
+//
+// Usage: scripts/bench/run.sh transport [--seconds n] [--seed n] [--iterations n]
+
+// run.sh builds a single translation unit, the protocol layers are compiled in directly
+#include <BLEClientProtocol.cpp>
+#include <BLEServerProtocol.cpp>
+#include <BinaryCodec.cpp>
+#include <ClockSync.cpp>
+#include <LoopbackTransport.cpp>
+#include <TextCodec.cpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(condition)                                                                                                     \
+    do {                                                                                                                     \
+        if (!(condition)) {                                                                                                  \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);                                  \
+            failures++;                                                                                                      \
+        }                                                                                                                    \
+    } while (0)
+
+// Same batching as the controller board while brewing, see GaggiMateController.h
+constexpr unsigned long SENSOR_SAMPLE_INTERVAL_MS = 30;
+constexpr unsigned long SENSOR_FRAME_MAX_AGE_MS = 240;
+// Output control rate of the display while a profile ramps, see CONTROL_MIN_INTERVAL
+constexpr unsigned long CONTROL_INTERVAL_MS = 20;
+
+// Both protocol layers wired to the two ends of one link, the way the NimBLE controllers wire their transports
+struct Session {
+    LoopbackLink link;
+    BLEClientProtocol client;
+    BLEServerProtocol server;
+
+    explicit Session(uint32_t seed = 1) : link(seed), client(link.getClient()), server(link.getServer()) {
+        link.getClient().setReceiveCallback([this](BLEChannel channel, const uint8_t *data, size_t length, uint64_t received) {
+            client.onReceive(channel, data, length, received);
+        });
+        link.getServer().setReceiveCallback([this](BLEChannel channel, const uint8_t *data, size_t length, uint64_t received) {
+            server.onReceive(channel, data, length, received);
+        });
+    }
+};
+
+static ProfileProgram makeProgram() {
+    ProfileProgram program;
+    program.id = 4242;
+    program.phaseCount = 3;
+    program.phases[0].valve = true;
+    program.phases[0].pump = 40.0f;
+    program.phases[0].exitCount = 1;
+    program.phases[0].exits[0] = ProgramExit{PROGRAM_EXIT_TIME, false, 8.0f};
+    program.phases[1].valve = true;
+    program.phases[1].advanced = true;
+    program.phases[1].pressureTarget = true;
+    program.phases[1].pressure = 9.0f;
+    program.phases[1].flow = 4.5f;
+    program.phases[1].transition = PROGRAM_TRANSITION_LINEAR;
+    program.phases[1].transitionDuration = 2.5f;
+    program.phases[1].exitCount = PROGRAM_MAX_EXITS;
+    for (uint8_t i = 0; i < PROGRAM_MAX_EXITS; i++) {
+        program.phases[1].exits[i] = ProgramExit{static_cast<uint8_t>(i % 3), i % 2 == 0, 1.25f * i};
+    }
+    program.phases[2].valve = false;
+    program.phases[2].pump = 0.0f;
+    return program;
+}
+
+static bool sameProgram(const ProfileProgram &a, const ProfileProgram &b) {
+    if (a.id != b.id || a.phaseCount != b.phaseCount)
+        return false;
+    for (uint8_t i = 0; i < a.phaseCount; i++) {
+        const ProgramPhase &x = a.phases[i];
+        const ProgramPhase &y = b.phases[i];
+        if (x.valve != y.valve || x.advanced != y.advanced || x.pressureTarget != y.pressureTarget ||
+            fabsf(x.pump - y.pump) > 0.05f || fabsf(x.pressure - y.pressure) > 0.005f || fabsf(x.flow - y.flow) > 0.005f ||
+            x.transition != y.transition || fabsf(x.transitionDuration - y.transitionDuration) > 0.005f ||
+            x.exitCount != y.exitCount)
+            return false;
+        for (uint8_t j = 0; j < x.exitCount; j++) {
+            if (x.exits[j].type != y.exits[j].type || x.exits[j].lte != y.exits[j].lte ||
+                fabsf(x.exits[j].value - y.exits[j].value) > 0.005f)
+                return false;
+        }
+    }
+    return true;
+}
+
+// Every command and notification once, in the encoding the session negotiated
+static void testConversation(Session &session) {
+    BLEClientProtocol &client = session.client;
+    BLEServerProtocol &server = session.server;
+    LoopbackLink &link = session.link;
+
+    bool valve = false;
+    float pump = 0.0f, boiler = 0.0f, pressure = 0.0f, flow = 0.0f;
+    bool pressureTarget = false;
+    server.registerOutputControlCallback([&](bool v, float p, float b) {
+        valve = v;
+        pump = p;
+        boiler = b;
+    });
+    server.registerAdvancedOutputControlCallback([&](bool v, float b, bool target, float p, float f) {
+        valve = v;
+        boiler = b;
+        pressureTarget = target;
+        pressure = p;
+        flow = f;
+    });
+    client.sendOutputControl(true, 55.5f, 93.0f);
+    link.flush();
+    CHECK(valve && pump == 55.5f && boiler == 93.0f);
+    client.sendAdvancedOutputControl(false, 94.0f, true, 8.5f, 2.25f);
+    link.flush();
+    CHECK(!valve && boiler == 94.0f && pressureTarget && pressure == 8.5f && flow == 2.25f);
+
+    // The same output state again is held back until the keep-alive is due
+    const unsigned long sent = link.getStats().sent;
+    client.sendAdvancedOutputControl(false, 94.0f, true, 8.5f, 2.25f);
+    CHECK(link.getStats().sent == sent);
+    link.run(OUTPUT_KEEPALIVE_DEFAULT_MS * 1000);
+    client.sendAdvancedOutputControl(false, 94.0f, true, 8.5f, 2.25f);
+    CHECK(link.getStats().sent == sent + 1);
+
+    int alt = -1;
+    server.registerAltControlCallback([&](bool state) { alt = state; });
+    client.sendAltControl(true);
+    link.flush();
+    CHECK(alt == 1);
+
+    float Kp = 0.0f, Ki = 0.0f, Kd = 0.0f;
+    server.registerPidControlCallback([&](float p, float i, float d) {
+        Kp = p;
+        Ki = i;
+        Kd = d;
+    });
+    client.sendPidSettings("2.4,0.035,30.5");
+    link.flush();
+    CHECK(Kp == 2.4f && Ki == 0.035f && Kd == 30.5f);
+
+    float scale = 0.0f;
+    server.registerPressureScaleCallback([&](float value) { scale = value; });
+    client.setPressureScale(16.5f);
+    link.flush();
+    CHECK(scale == 16.5f);
+
+    int testTime = 0, samples = 0;
+    server.registerAutotuneCallback([&](int time, int count) {
+        testTime = time;
+        samples = count;
+    });
+    client.sendAutotune(600, 4);
+    link.flush();
+    CHECK(testTime == 600 && samples == 4);
+
+    bool tared = false;
+    server.registerTareCallback([&]() { tared = true; });
+    client.tare();
+    link.flush();
+    CHECK(tared);
+
+    ProfileProgram received;
+    server.registerProgramUploadCallback([&](const ProfileProgram &program) { received = program; });
+    const ProfileProgram program = makeProgram();
+    CHECK(client.sendProgram(program));
+    CHECK(sameProgram(program, received));
+
+    ProgramCommand command = ProgramCommand::STOP;
+    uint8_t phase = 0;
+    server.registerProgramControlCallback([&](ProgramCommand c, uint8_t p) {
+        command = c;
+        phase = p;
+    });
+    client.sendProgramCommand(ProgramCommand::ADVANCE, 2);
+    CHECK(command == ProgramCommand::ADVANCE && phase == 2);
+
+    float temperature = 0.0f, sensorPressure = 0.0f, sensorFlow = 0.0f;
+    client.registerSensorCallback([&](float t, float p, float f) {
+        temperature = t;
+        sensorPressure = p;
+        sensorFlow = f;
+    });
+    server.sendSensorData(92.125f, 8.75f, 1.5f);
+    link.flush();
+    CHECK(temperature == 92.125f && sensorPressure == 8.75f && sensorFlow == 1.5f);
+
+    int error = 0;
+    bool brew = false, steam = false;
+    float volume = 0.0f;
+    client.registerRemoteErrorCallback([&](int code) { error = code; });
+    client.registerBrewBtnCallback([&](bool state) { brew = state; });
+    client.registerSteamBtnCallback([&](bool state) { steam = state; });
+    client.registerVolumetricMeasurementCallback([&](float value) { volume = value; });
+    client.registerAutotuneResultCallback([&](float p, float i, float d) {
+        Kp = p;
+        Ki = i;
+        Kd = d;
+    });
+    server.sendError(ERROR_CODE_RUNAWAY);
+    server.sendBrewBtnState(true);
+    server.sendSteamBtnState(true);
+    server.sendVolumetricMeasurement(36.5f);
+    server.sendAutotuneResult(1.5f, 0.25f, 12.0f);
+    link.flush();
+    CHECK(error == ERROR_CODE_RUNAWAY && brew && steam && volume == 36.5f);
+    CHECK(Kp == 1.5f && Ki == 0.25f && Kd == 12.0f);
+
+    ProgramProgress progress;
+    client.registerProgramProgressCallback([&](const ProgramProgress &p) { progress = p; });
+    server.sendProgramProgress(ProgramProgress{4242, 2, 12345, true});
+    link.flush();
+    CHECK(progress.id == 4242 && progress.phase == 2 && progress.phaseElapsed == 12345 && progress.running);
+
+    TaskDiagnostics diagnostics;
+    strcpy(diagnostics.name, "pump");
+    diagnostics.period = 30;
+    diagnostics.count = 33;
+    diagnostics.missed = 1;
+    diagnostics.periodAvg = 30012;
+    diagnostics.periodMax = 31800;
+    diagnostics.execAvg = 410;
+    diagnostics.execMax = 1900;
+    for (uint8_t i = 0; i < TASK_DIAGNOSTICS_BUCKETS; i++) {
+        diagnostics.jitter[i] = i * 3;
+        diagnostics.exec[i] = 100 - i;
+    }
+    TaskDiagnostics reported;
+    client.registerTaskDiagnosticsCallback([&](const TaskDiagnostics &d) { reported = d; });
+    server.sendTaskDiagnostics(diagnostics);
+    link.flush();
+    if (server.getProtocolVersion() < BLE_PROTOCOL_BINARY) {
+        // Reports don't fit into a text notification, they are only sent in binary
+        CHECK(reported.count == 0);
+        return;
+    }
+    CHECK(strcmp(reported.name, "pump") == 0 && reported.count == 33 && reported.execMax == 1900);
+    CHECK(memcmp(reported.jitter, diagnostics.jitter, sizeof(diagnostics.jitter)) == 0);
+    CHECK(memcmp(reported.exec, diagnostics.exec, sizeof(diagnostics.exec)) == 0);
+}
+
+static void testText() {
+    Session session;
+    const char info[] = "{\"hw\":\"GaggiMate Standard 1.x\",\"cp\":{\"pv\":1}}";
+    session.link.getServer().setValue(BLEChannel::INFO, reinterpret_cast<const uint8_t *>(info), strlen(info));
+    CHECK(session.client.readInfo() == info);
+    // A controller board announcing the text protocol keeps both sides on text
+    session.client.negotiateProtocol(BLE_PROTOCOL_TEXT);
+    session.link.flush();
+    CHECK(session.client.getProtocolVersion() == BLE_PROTOCOL_TEXT);
+    CHECK(session.server.getProtocolVersion() == BLE_PROTOCOL_TEXT);
+    CHECK(session.server.getSensorFrameCapacity() == 0);
+    testConversation(session);
+}
+
+static void testBinary() {
+    Session session;
+    session.client.negotiateProtocol(BLE_PROTOCOL_VERSION + 1);
+    session.link.flush();
+    CHECK(session.client.getProtocolVersion() == BLE_PROTOCOL_VERSION);
+    CHECK(session.server.getProtocolVersion() == BLE_PROTOCOL_VERSION);
+    CHECK(session.server.getSensorFrameCapacity() == sensorFrameCapacity(session.link.getServer().getPayloadSize()));
+    testConversation(session);
+
+    // Sensor frames only leave the board once negotiated
+    SensorFrame frame;
+    session.client.registerSensorFrameCallback([&](const SensorFrame &f) { frame = f; });
+    SensorSample samples[3];
+    for (uint8_t i = 0; i < 3; i++) {
+        samples[i] = SensorSample{1000u + i * 30u, 93.0f, 9.0f - i, 2.0f, 10.0f + i};
+    }
+    session.server.sendSensorFrame(samples, 3);
+    session.link.flush();
+    CHECK(frame.count == 3 && frame.samples[2].time == 1060 && frame.samples[2].volume == 12.0f);
+}
+
+// Older controller boards lack the protocol, frame and pong characteristics, the display has to get along with text
+static void testOlderBoard() {
+    Session session;
+    session.link.remove(BLEChannel::PROTOCOL);
+    session.link.remove(BLEChannel::SENSOR_FRAME);
+    session.link.remove(BLEChannel::PONG);
+    session.client.negotiateProtocol(BLE_PROTOCOL_VERSION);
+    CHECK(session.client.getProtocolVersion() == BLE_PROTOCOL_TEXT);
+    CHECK(session.server.getSensorFrameCapacity() == 0);
+
+    int pings = 0;
+    int pongs = 0;
+    session.server.registerPingCallback([&]() { pings++; });
+    session.client.registerPongCallback([&](const ClockExchange &) { pongs++; });
+    session.client.sendPing();
+    session.link.flush();
+    CHECK(pings == 1 && pongs == 0);
+
+    // The board answers pings without the pong characteristic but never sends one, even in binary
+    Session binary;
+    binary.link.remove(BLEChannel::PONG);
+    binary.client.negotiateProtocol(BLE_PROTOCOL_VERSION);
+    binary.link.flush();
+    binary.server.registerPingCallback([&]() { pings++; });
+    binary.client.registerPongCallback([&](const ClockExchange &) { pongs++; });
+    binary.client.sendPing();
+    binary.link.flush();
+    CHECK(pings == 2 && pongs == 0);
+
+    // Nothing goes out while disconnected
+    session.link.disconnect();
+    const unsigned long sent = session.link.getStats().sent;
+    session.client.sendOutputControl(true, 10.0f, 90.0f);
+    CHECK(!session.client.sendProgram(makeProgram()));
+    CHECK(session.link.getStats().sent == sent);
+}
+
+static void testClockSync(uint32_t seed) {
+    Session session(seed);
+    LinkConditions conditions;
+    conditions.delay = 1500;
+    conditions.jitter = 4000;
+    conditions.loss = 0.1;
+    session.link.setConditions(conditions);
+    const int64_t offset = 3723456789; // controller board booted an hour before the display
+    session.link.setClockOffset(offset);
+    session.client.negotiateProtocol(BLE_PROTOCOL_VERSION);
+    session.link.flush();
+
+    ClockSync sync;
+    session.client.registerPongCallback([&](const ClockExchange &exchange) { sync.add(exchange); });
+    for (int i = 0; i < 60; i++) {
+        session.client.sendPing();
+        session.link.run(1000000);
+    }
+    CHECK(sync.isSynced() && sync.getExchanges() > 50);
+    // Only the delays make an exchange asymmetric, the estimate can't be further off than half its round trip
+    CHECK(llabs(sync.getOffset() - offset) <= static_cast<int64_t>(sync.getRoundTrip() / 2 + 1));
+}
+
+static void testLinkModes() {
+    for (uint8_t i = 0; i < BLE_LINK_MODE_COUNT; i++) {
+        const BLEConnectionParams &params = getLinkModeParams(static_cast<BLELinkMode>(i));
+        // Valid ranges of the BLE spec, the timeout has to outlast two of the longest gaps between listening windows
+        CHECK(params.minInterval >= 6 && params.minInterval <= params.maxInterval && params.maxInterval <= 3200);
+        CHECK(params.latency <= 499 && params.timeout >= 10 && params.timeout <= 3200);
+        CHECK(params.timeout * 10000u > 2u * params.maxInterval * 1250u * (params.latency + 1u));
+    }
+
+    Session session;
+    session.client.setLinkMode(BLELinkMode::STANDBY);
+    CHECK(session.link.getStats().parameterUpdates == 1);
+    CHECK(session.link.getConditions().interval == getLinkModeParams(BLELinkMode::STANDBY).maxInterval * 1250u);
+    CHECK(session.link.getConditions().latency == getLinkModeParams(BLELinkMode::STANDBY).latency);
+    // Only a change renegotiates
+    session.client.setLinkMode(BLELinkMode::STANDBY);
+    CHECK(session.link.getStats().parameterUpdates == 1);
+    CHECK(!session.client.isLinkModeSettled(session.link.now() / 1000));
+    session.link.run(LINK_MODE_SETTLE_MS * 1000);
+    CHECK(session.client.isLinkModeSettled(session.link.now() / 1000));
+    // Without a connection the mode is only remembered
+    session.link.disconnect();
+    session.client.setLinkMode(BLELinkMode::ACTIVE);
+    CHECK(session.client.getLinkMode() == BLELinkMode::ACTIVE);
+    CHECK(session.link.getStats().parameterUpdates == 1);
+    // and applied by the next call once connected again
+    session.link.connect();
+    session.client.setLinkMode(BLELinkMode::ACTIVE);
+    CHECK(session.link.getStats().parameterUpdates == 2);
+    CHECK(session.link.getConditions().latency == getLinkModeParams(BLELinkMode::ACTIVE).latency);
+}
+
+struct Latencies {
+    std::vector<double> values;
+
+    double percentile(double p) {
+        if (values.empty())
+            return 0.0;
+        std::sort(values.begin(), values.end());
+        return values[static_cast<size_t>(p * (values.size() - 1))];
+    }
+};
+
+struct Scenario {
+    const char *name;
+    LinkConditions conditions;
+};
+
+struct ShotResult {
+    unsigned long controlSent = 0;
+    Latencies control; // ms from the write to the callback on the board
+    unsigned long samplesTaken = 0;
+    Latencies samples; // ms from the sample on the board to the frame callback on the display
+    unsigned long retransmissions = 0;
+};
+
+// A shot of the given length: the display changes the pump setpoint every control cycle, the board samples at the
+// pump loop rate and sends frames when full or old enough
+static ShotResult runShot(const LinkConditions &conditions, unsigned long seconds, uint32_t seed) {
+    Session session(seed);
+    session.client.negotiateProtocol(BLE_PROTOCOL_VERSION);
+    session.link.flush();
+    session.link.setConditions(conditions);
+    session.link.resetStats();
+
+    ShotResult result;
+    std::vector<uint64_t> controlTimes;
+    session.server.registerOutputControlCallback([&](bool, float pump, float) {
+        const auto index = static_cast<size_t>(lroundf(pump * 10.0f));
+        if (index < controlTimes.size()) {
+            result.control.values.push_back((session.link.now() - controlTimes[index]) / 1000.0);
+        }
+    });
+    session.client.registerSensorFrameCallback([&](const SensorFrame &frame) {
+        const double now = session.link.now() / 1000.0;
+        for (uint8_t i = 0; i < frame.count; i++) {
+            result.samples.values.push_back(now - frame.samples[i].time);
+        }
+    });
+
+    const uint8_t capacity = session.server.getSensorFrameCapacity();
+    SensorSample frame[SENSOR_FRAME_MAX_SAMPLES];
+    uint8_t frameCount = 0;
+    const unsigned long end = session.link.now() / 1000 + seconds * 1000;
+    unsigned long nextControl = session.link.now() / 1000;
+    unsigned long nextSample = nextControl;
+    while (session.link.now() / 1000 < end) {
+        const unsigned long now = session.link.now() / 1000;
+        if (now >= nextControl) {
+            session.client.sendOutputControl(true, controlTimes.size() * 0.1f, 93.0f);
+            controlTimes.push_back(session.link.now());
+            nextControl += CONTROL_INTERVAL_MS;
+        }
+        if (now >= nextSample) {
+            frame[frameCount++] = SensorSample{static_cast<uint32_t>(now), 93.0f, 9.0f, 2.0f, 0.1f * result.samplesTaken};
+            result.samplesTaken++;
+            if (frameCount >= capacity || now - frame[0].time >= SENSOR_FRAME_MAX_AGE_MS) {
+                session.server.sendSensorFrame(frame, frameCount);
+                frameCount = 0;
+            }
+            nextSample += SENSOR_SAMPLE_INTERVAL_MS;
+        }
+        session.link.advance(std::min(nextControl, nextSample) * 1000);
+    }
+    // The board sends what is left once the shot ends
+    session.server.sendSensorFrame(frame, frameCount);
+    session.link.flush();
+    result.controlSent = controlTimes.size();
+    result.retransmissions = session.link.getStats().retransmissions;
+    return result;
+}
+
+struct LinkModeResult {
+    Latencies write;  // ms from the ping leaving the display to its arrival on the board
+    Latencies notify; // ms from the pong leaving the board to its arrival on the display
+};
+
+// Pings once a second, at a random phase to the connection events like the ping timer of the display
+static LinkModeResult runLinkMode(BLELinkMode mode, unsigned long seconds, uint32_t seed) {
+    Session session(seed);
+    session.client.negotiateProtocol(BLE_PROTOCOL_VERSION);
+    session.link.flush();
+    // A connection starts on the parameters of the current mode, like after resetConnection on the display
+    session.client.setLinkMode(mode);
+    session.link.getClient().updateConnectionParams(getLinkModeParams(mode));
+    session.link.run(LINK_MODE_SETTLE_MS * 1000);
+
+    LinkModeResult result;
+    session.client.registerPongCallback([&](const ClockExchange &exchange) {
+        result.write.values.push_back((exchange.received - exchange.sent) / 1000.0);
+        result.notify.values.push_back((exchange.returned - exchange.replied) / 1000.0);
+    });
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<uint32_t> phase(0, 1000000);
+    for (unsigned long i = 0; i < seconds; i++) {
+        session.link.run(phase(random));
+        session.client.sendPing();
+        session.link.flush();
+    }
+    return result;
+}
+
+// Host time of one message from encoder through the transport into the decoder and its callback
+static double measureThroughput(uint8_t version, unsigned long iterations) {
+    Session session;
+    LinkConditions conditions;
+    conditions.interval = 0;
+    session.link.setConditions(conditions);
+    session.client.negotiateProtocol(version);
+    session.link.flush();
+    session.link.resetStats();
+    volatile float sink = 0.0f;
+    session.server.registerOutputControlCallback([&](bool, float pump, float boiler) { sink = sink + pump + boiler; });
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < iterations; i++) {
+        session.client.sendOutputControl(true, static_cast<float>(i & 0x3FF) * 0.1f, 93.0f);
+        session.link.flush();
+    }
+    const auto end = std::chrono::steady_clock::now();
+    CHECK(session.link.getStats().delivered == iterations);
+    return iterations / std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char **argv) {
+    unsigned long seconds = 60;
+    unsigned long seed = 1;
+    unsigned long iterations = 200000;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--seconds") && i + 1 < argc) {
+            seconds = strtoul(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            seed = strtoul(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--iterations") && i + 1 < argc) {
+            iterations = strtoul(argv[++i], nullptr, 10);
+        } else {
+            fprintf(stderr, "Unknown argument %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    testText();
+    testBinary();
+    testOlderBoard();
+    testClockSync(seed);
+    testLinkModes();
+    if (failures > 0) {
+        fprintf(stderr, "%d transport checks failed\n", failures);
+        return 1;
+    }
+    printf("Transport checks passed\n\n");
+
+    Scenario scenarios[] = {
+        {"7.5ms interval", LinkConditions{}},
+        {"+ 2-7ms delay", LinkConditions{7500, 2000, 5000, 0.0, 4}},
+        {"5% loss", LinkConditions{7500, 0, 0, 0.05, 4}},
+        {"20% loss", LinkConditions{7500, 0, 0, 0.2, 4}},
+        {"40% loss, delay", LinkConditions{7500, 2000, 5000, 0.4, 4}},
+        {"30ms interval", LinkConditions{30000, 0, 0, 0.0, 4}},
+    };
+    printf("%lus shot, output control every %lums, sensor samples every %lums\n\n", seconds, CONTROL_INTERVAL_MS,
+           SENSOR_SAMPLE_INTERVAL_MS);
+    printf("%-18s %9s %8s %8s %8s   %9s %8s %8s %8s %8s\n", "", "control", "p50 ms", "p95 ms", "p99 ms", "samples", "p50 ms",
+           "p95 ms", "p99 ms", "retx");
+    for (Scenario &scenario : scenarios) {
+        ShotResult result = runShot(scenario.conditions, seconds, seed);
+        printf("%-18s %8.2f%% %8.1f %8.1f %8.1f   %8.2f%% %8.1f %8.1f %8.1f %8lu\n", scenario.name,
+               100.0 * result.control.values.size() / result.controlSent, result.control.percentile(0.5),
+               result.control.percentile(0.95), result.control.percentile(0.99),
+               100.0 * result.samples.values.size() / result.samplesTaken, result.samples.percentile(0.5),
+               result.samples.percentile(0.95), result.samples.percentile(0.99), result.retransmissions);
+    }
+
+    printf("\n%lu pings per link mode\n\n", seconds);
+    printf("%-18s %10s %8s %8s %8s   %8s %8s %8s\n", "", "interval", "write", "p95 ms", "p99 ms", "notify", "p95 ms",
+           "p99 ms");
+    for (uint8_t i = 0; i < BLE_LINK_MODE_COUNT; i++) {
+        const auto mode = static_cast<BLELinkMode>(i);
+        const BLEConnectionParams &params = getLinkModeParams(mode);
+        LinkModeResult result = runLinkMode(mode, seconds, seed);
+        CHECK(result.notify.values.size() == seconds);
+        char interval[16];
+        snprintf(interval, sizeof(interval), "%.1fms/%d", params.maxInterval * 1.25, params.latency);
+        printf("%-18s %10s %8.1f %8.1f %8.1f   %8.1f %8.1f %8.1f\n", getLinkModeName(mode), interval,
+               result.write.percentile(0.5), result.write.percentile(0.95), result.write.percentile(0.99),
+               result.notify.percentile(0.5), result.notify.percentile(0.95), result.notify.percentile(0.99));
+    }
+
+    printf("\n%-18s %12s\n", "output control", "messages/s");
+    printf("%-18s %12.0f\n", "text", measureThroughput(BLE_PROTOCOL_TEXT, iterations));
+    printf("%-18s %12.0f\n", "binary", measureThroughput(BLE_PROTOCOL_VERSION, iterations));
+    if (failures > 0) {
+        fprintf(stderr, "%d transport checks failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
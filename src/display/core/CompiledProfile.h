@@ -0,0 +1,88 @@
+#ifndef COMPILEDPROFILE_H
+#define COMPILEDPROFILE_H
+
+#include <cstring>
+#include <display/models/profile.h>
+#include <memory>
+
+#include "PhaseExit.h"
+#include "TransitionCurve.h"
+
+constexpr uint8_t COMPILED_PROFILE_MAX_PHASES = 12;
+constexpr uint8_t COMPILED_PROFILE_ID_LENGTH = 40;
+constexpr uint8_t COMPILED_PROFILE_LABEL_LENGTH = 48;
+constexpr uint8_t COMPILED_PHASE_NAME_LENGTH = 32;
+
+// Flattened, string-free copy of a Phase with everything a running process needs precomputed.
+struct CompiledPhase {
+    char name[COMPILED_PHASE_NAME_LENGTH] = {};
+    PhaseType phase = PhaseType::PHASE_TYPE_BREW;
+    bool valve = false;
+    float duration = 0.0f;
+    bool pumpIsSimple = true;
+    float pumpSimple = 0.0f;
+    PumpAdvanced pumpAdvanced{};
+    TransitionCurve transition{};
+    float volumetricTarget = 0.0f; // 0 if the phase has no volumetric target
+    PhaseExit timeExit{};          // Exit conditions used by time based processes
+    PhaseExit volumetricExit{};    // Exit conditions used by volumetric processes
+
+    bool hasVolumetricTarget() const { return volumetricTarget > 0.0f; }
+
+    const PhaseExit &getExit(bool volumetric) const { return volumetric ? volumetricExit : timeExit; }
+};
+
+// Immutable representation of a profile, compiled once when the profile is selected and shared
+// between all processes started from it.
+struct CompiledProfile {
+    char id[COMPILED_PROFILE_ID_LENGTH] = {};
+    char label[COMPILED_PROFILE_LABEL_LENGTH] = {};
+    float temperature = 0.0f;
+    unsigned long totalDuration = 0; // seconds
+    float brewVolume = 0.0f;         // volumetric target of the last phase that has one
+    uint8_t phaseCount = 0;
+    CompiledPhase phases[COMPILED_PROFILE_MAX_PHASES];
+};
+
+inline std::shared_ptr<const CompiledProfile> compileProfile(const Profile &profile) {
+    auto compiled = std::make_shared<CompiledProfile>();
+    strncpy(compiled->id, profile.id.c_str(), COMPILED_PROFILE_ID_LENGTH - 1);
+    strncpy(compiled->label, profile.label.c_str(), COMPILED_PROFILE_LABEL_LENGTH - 1);
+    compiled->temperature = profile.temperature;
+    if (profile.phases.size() > COMPILED_PROFILE_MAX_PHASES) {
+        // The editor and the schema don't allow more, this only catches profiles saved around them
+        ESP_LOGW("CompiledProfile", "Profile %s has %d phases, only running the first %d", profile.id.c_str(),
+                 static_cast<int>(profile.phases.size()), COMPILED_PROFILE_MAX_PHASES);
+    }
+    for (const auto &phase : profile.phases) {
+        if (compiled->phaseCount >= COMPILED_PROFILE_MAX_PHASES) {
+            break;
+        }
+        CompiledPhase &out = compiled->phases[compiled->phaseCount++];
+        strncpy(out.name, phase.name.c_str(), COMPILED_PHASE_NAME_LENGTH - 1);
+        out.phase = phase.phase;
+        out.valve = phase.valve;
+        out.duration = phase.duration;
+        // From the compiled phases only, so progress and the remaining time match what actually runs
+        compiled->totalDuration += phase.duration;
+        out.pumpIsSimple = phase.pumpIsSimple;
+        out.pumpSimple = phase.pumpSimple;
+        out.pumpAdvanced = phase.pumpAdvanced;
+        out.transition = compileTransition(phase.transition);
+        if (phase.hasVolumetricTarget()) {
+            out.volumetricTarget = phase.getVolumetricTarget().value;
+            compiled->brewVolume = out.volumetricTarget;
+        }
+        out.timeExit = compilePhaseExit(phase, false);
+        out.volumetricExit = compilePhaseExit(phase, true);
+    }
+    if (compiled->phaseCount == 0) {
+        // Processes always need a current phase, fall back to an empty one that finishes immediately
+        CompiledPhase &out = compiled->phases[compiled->phaseCount++];
+        out.timeExit.add(TargetType::TARGET_TYPE_TIME, TargetOperator::OPERATOR_GTE, 0.0f);
+        out.volumetricExit = out.timeExit;
+    }
+    return compiled;
+}
+
+#endif // COMPILEDPROFILE_H
@@ -3,8 +3,10 @@
 #include <SPIFFS.h>
 #include <ctime>
 #include <display/config.h>
+#include <display/core/ProfileProgramCompiler.h>
 #include <display/core/constants.h>
 #include <display/core/static_profiles.h>
+#include <display/core/Trace.h>
 #include <display/core/zones.h>
 #include <display/plugins/BLEScalePlugin.h>
 #include <display/plugins/BoilerFillPlugin.h>
@@ -15,48 +17,63 @@
 #include <display/plugins/mDNSPlugin.h>
 
 void Controller::setup() {
+    BootTrace::mark("setup");
+#ifdef GAGGIMATE_TRACE
+    Trace::begin();
+#endif
     mode = settings.getStartupMode();
 
     if (!SPIFFS.begin(true)) {
         Serial.println("An Error has occurred while mounting LittleFS");
     }
 
+    jobWorker.setup();
+    bleWorker.setup();
     pluginManager = new PluginManager();
     profileManager = new ProfileManager(SPIFFS, "/p", settings, pluginManager);
     profileManager->setup();
+    routineManager = new RoutineManager(SPIFFS, "/r", pluginManager);
+    routineManager->setup();
+    routineEngine = new RoutineEngine(this, pluginManager);
     ui = new DefaultUI(this, pluginManager);
     if (settings.isHomekit())
-        pluginManager->registerPlugin(new HomekitPlugin(settings.getWifiSsid(), settings.getWifiPassword()));
+        pluginManager->registerPlugin(new HomekitPlugin(settings.getWifiSsid(), settings.getWifiPassword()), "homekit");
     else
-        pluginManager->registerPlugin(new mDNSPlugin());
+        pluginManager->registerPlugin(new mDNSPlugin(), "mdns");
     if (settings.isBoilerFillActive()) {
-        pluginManager->registerPlugin(new BoilerFillPlugin());
+        pluginManager->registerPlugin(new BoilerFillPlugin(), "boilerfill");
     }
     if (settings.isSmartGrindActive()) {
-        pluginManager->registerPlugin(new SmartGrindPlugin());
+        pluginManager->registerPlugin(new SmartGrindPlugin(), "smartgrind");
     }
     if (settings.isHomeAssistant()) {
-        pluginManager->registerPlugin(new MQTTPlugin());
+        pluginManager->registerPlugin(new MQTTPlugin(), "mqtt");
     }
-    pluginManager->registerPlugin(new WebUIPlugin());
-    pluginManager->registerPlugin(&BLEScales);
+    pluginManager->registerPlugin(new WebUIPlugin(), "webui");
+    pluginManager->registerPlugin(&BLEScales, "blescales");
     pluginManager->setup(this);
 
-    pluginManager->on("profiles:profile:save", [this](Event const &event) {
+    pluginManager->on(EventId::PROFILES_PROFILE_SAVE, [this](Event const &event) {
         String id = event.getString("id");
         if (id == profileManager->getSelectedProfile().id) {
             this->handleProfileUpdate();
         }
     });
 
-    pluginManager->on("profiles:profile:select", [this](Event const &event) { this->handleProfileUpdate(); });
+    pluginManager->on(EventId::PROFILES_PROFILE_SELECT, [this](Event const &event) { this->handleProfileUpdate(); });
 
+    // The UI reads its initial state from the snapshot, the loop task has not run yet
+    publishState();
+    publishControl();
     ui->init();
 
     xTaskCreatePinnedToCore(loopTask, "DefaultUI::loopControl", configMINIMAL_STACK_SIZE * 6, this, 1, &taskHandle, 1);
 }
 
-void Controller::onScreenReady() { screenReady = true; }
+void Controller::onScreenReady() {
+    BootTrace::mark("ui:ready");
+    screenReady = true;
+}
 
 void Controller::onTargetChange(ProcessTarget target) { settings.setVolumetricTarget(target == ProcessTarget::VOLUMETRIC); }
 
@@ -64,10 +81,11 @@ void Controller::connect() {
     if (initialized)
         return;
     lastPing = millis();
-    pluginManager->trigger("controller:startup");
+    pluginManager->trigger(EventId::CONTROLLER_STARTUP);
 
-    setupWifi();
+    // Both only start their connection here and finish from loop(), the UI keeps running in the meantime
     setupBluetooth();
+    setupWifi();
 
     updateLastAction();
     initialized = true;
@@ -76,21 +94,43 @@ void Controller::connect() {
 void Controller::setupBluetooth() {
     clientController.initClient();
     clientController.registerSensorCallback([this](const float temp, const float pressure, const float flow) {
-        onTempRead(temp);
-        this->pressure = pressure;
-        this->currentFlow = flow;
-        pluginManager->trigger("boiler:pressure:change", "value", pressure);
-        pluginManager->trigger("pump:flow:change", "value", flow);
+        TRACE_SCOPE("ble", "sensor");
+        onSensorRead(temp, pressure, flow);
     });
-    clientController.registerBrewBtnCallback([this](const int brewButtonStatus) { handleBrewButton(brewButtonStatus); });
-    clientController.registerSteamBtnCallback([this](const int steamButtonStatus) { handleSteamButton(steamButtonStatus); });
-    clientController.registerRemoteErrorCallback([this](const int error) {
-        if (error != ERROR_CODE_TIMEOUT && error != this->error) {
-            this->error = error;
-            deactivate();
-            setMode(MODE_STANDBY);
-            pluginManager->trigger("controller:error");
+    clientController.registerSensorFrameCallback([this](const SensorFrame &frame) {
+        TRACE_SCOPE("ble", "sensor frame");
+        const unsigned long received = millis();
+        const SensorSample &newest = frame.samples[frame.count - 1];
+        // Sample times are on the clock of the controller board. Once the clocks are synchronised they are moved to
+        // ours, before that the newest sample is taken as just arrived.
+        unsigned long newestTime = received;
+        if (toLocalMillis(newest.time, newestTime)) {
+            // The estimate is off by up to half a round trip, a sample must not end up in the future
+            if (static_cast<long>(received - newestTime) < 0) {
+                newestTime = received;
+            }
+            sensorLatency.add((received - newestTime) * 1000);
+        }
+        if (!volumetricOverride) {
+            for (uint8_t i = 0; i < frame.count; i++) {
+                const SensorSample &sample = frame.samples[i];
+                onVolumetricMeasurement(sample.volume, newestTime - (newest.time - sample.time));
+            }
         }
+        onSensorRead(newest.temperature, newest.pressure, newest.flow);
+    });
+    clientController.registerBrewBtnCallback([this](const int brewButtonStatus) {
+        TRACE_SCOPE("ble", "brew button");
+        queueButton(false, brewButtonStatus);
+    });
+    clientController.registerSteamBtnCallback([this](const int steamButtonStatus) {
+        TRACE_SCOPE("ble", "steam button");
+        queueButton(true, steamButtonStatus);
+    });
+    clientController.registerRemoteErrorCallback([this](const int error) {
+        TRACE_SCOPE("ble", "error");
+        remoteError = error;
+        remoteErrorPending = true;
         ESP_LOGE("Controller", "Received error %d", error);
     });
     clientController.registerAutotuneResultCallback([this](const float Kp, const float Ki, const float Kd) {
@@ -98,15 +138,88 @@ void Controller::setupBluetooth() {
         char pid[30];
         snprintf(pid, sizeof(pid), "%.3f,%.3f,%.3f", Kp, Ki, Kd);
         settings.setPid(String(pid));
-        pluginManager->trigger("controller:autotune:result");
+        pluginManager->trigger(EventId::CONTROLLER_AUTOTUNE_RESULT);
         autotuning = false;
     });
+    // Only sensor frames carry the time of the controller board. Volumetric measurements, program progress and button
+    // events have no timestamp to convert, they are stamped when they arrive, as before the clocks were synchronised.
     clientController.registerVolumetricMeasurementCallback([this](const float value) {
+        TRACE_SCOPE("ble", "volumetric");
         if (!volumetricOverride) {
             onVolumetricMeasurement(value);
         }
     });
-    pluginManager->trigger("controller:bluetooth:init");
+    clientController.registerProgramProgressCallback([this](const ProgramProgress &progress) {
+        TRACE_SCOPE("ble", "program progress");
+        portENTER_CRITICAL(&remoteProgressMux);
+        remoteProgress = progress;
+        remoteProgressPending = true;
+        portEXIT_CRITICAL(&remoteProgressMux);
+        progressRequested = true;
+    });
+    clientController.registerPongCallback([this](const ClockExchange &exchange) {
+        portENTER_CRITICAL(&clockSyncMux);
+        const bool added = clockSync.add(exchange);
+        const uint64_t replied = clockSync.toLocal(exchange.replied);
+        portEXIT_CRITICAL(&clockSyncMux);
+        if (!added) {
+            return;
+        }
+        roundTripLatency.add(static_cast<uint32_t>(exchange.roundTrip()));
+        if (clientController.isLinkModeSettled(exchange.returned / 1000)) {
+            // Like the sensor frames, the estimated clock may put the reply slightly after its arrival
+            const int64_t latency = static_cast<int64_t>(exchange.returned - replied);
+            LatencyStats &stats = notifyLatency[static_cast<uint8_t>(clientController.getLinkMode())];
+            stats.add(static_cast<uint32_t>(latency > 0 ? latency : 0));
+        }
+    });
+    clientController.registerTaskDiagnosticsCallback([this](const TaskDiagnostics &diagnostics) {
+        portENTER_CRITICAL(&taskDiagnosticsMux);
+        uint8_t index = 0;
+        while (index < taskDiagnosticsCount && strcmp(taskDiagnostics[index].name, diagnostics.name) != 0) {
+            index++;
+        }
+        if (index < TASK_DIAGNOSTICS_MAX_TASKS) {
+            taskDiagnostics[index] = diagnostics;
+            if (index == taskDiagnosticsCount) {
+                taskDiagnosticsCount++;
+            }
+        }
+        portEXIT_CRITICAL(&taskDiagnosticsMux);
+    });
+    pluginManager->trigger(EventId::CONTROLLER_BLUETOOTH_INIT);
+}
+
+ClockSync Controller::getClockSync() const {
+    portENTER_CRITICAL(&clockSyncMux);
+    const ClockSync clock = clockSync;
+    portEXIT_CRITICAL(&clockSyncMux);
+    return clock;
+}
+
+// False until the first exchange, the pong callback and the reset after a reconnect change the estimate concurrently
+bool Controller::toLocalMillis(uint32_t remote, unsigned long &local) const {
+    portENTER_CRITICAL(&clockSyncMux);
+    const bool synced = clockSync.isSynced();
+    if (synced) {
+        local = clockSync.toLocalMillis(remote);
+    }
+    portEXIT_CRITICAL(&clockSyncMux);
+    return synced;
+}
+
+uint8_t Controller::getTaskDiagnosticsCount() const {
+    portENTER_CRITICAL(&taskDiagnosticsMux);
+    const uint8_t count = taskDiagnosticsCount;
+    portEXIT_CRITICAL(&taskDiagnosticsMux);
+    return count;
+}
+
+TaskDiagnostics Controller::getTaskDiagnostics(uint8_t index) const {
+    portENTER_CRITICAL(&taskDiagnosticsMux);
+    const TaskDiagnostics diagnostics = taskDiagnostics[index];
+    portEXIT_CRITICAL(&taskDiagnosticsMux);
+    return diagnostics;
 }
 
 void Controller::setupInfos() {
@@ -116,16 +229,25 @@ void Controller::setupInfos() {
     DeserializationError err = deserializeJson(doc, info);
     if (err) {
         printf("Error deserializing JSON: %s\n", err.c_str());
-        systemInfo = SystemInfo{
-            .hardware = "GaggiMate Standard 1.x", .version = "v1.0.0", .capabilities = {.dimming = false, .pressure = false}};
+        systemInfo = SystemInfo{.hardware = "GaggiMate Standard 1.x",
+                                .version = "v1.0.0",
+                                .capabilities = {.dimming = false, .pressure = false, .programs = false}};
     } else {
         systemInfo = SystemInfo{.hardware = doc["hw"].as<String>(),
                                 .version = doc["v"].as<String>(),
                                 .capabilities = SystemCapabilities{
                                     .dimming = doc["cp"]["dm"].as<bool>(),
                                     .pressure = doc["cp"]["ps"].as<bool>(),
+                                    .programs = doc["cp"]["pe"].as<bool>(),
                                 }};
     }
+    clientController.negotiateProtocol(err ? BLE_PROTOCOL_TEXT : (doc["cp"]["pv"] | BLE_PROTOCOL_TEXT));
+    // The controller board may have restarted, its clock starts over
+    portENTER_CRITICAL(&clockSyncMux);
+    clockSync.reset();
+    portEXIT_CRITICAL(&clockSyncMux);
+    // A reconnected controller board has lost the uploaded program
+    uploadedProfile = nullptr;
 }
 
 void Controller::setupWifi() {
@@ -133,26 +255,34 @@ void Controller::setupWifi() {
         WiFi.mode(WIFI_STA);
         WiFi.begin(settings.getWifiSsid(), settings.getWifiPassword());
         WiFi.setTxPower(WIFI_POWER_19_5dBm);
-        for (int attempts = 0; attempts < WIFI_CONNECT_ATTEMPTS; attempts++) {
-            if (WiFi.status() == WL_CONNECTED) {
-                break;
-            }
-            delay(500);
-            Serial.print(".");
-        }
-        if (WiFi.status() == WL_CONNECTED) {
-            Serial.println("");
-            Serial.print("Connected to ");
-            Serial.println(settings.getWifiSsid());
-            Serial.print("IP address: ");
-            Serial.println(WiFi.localIP());
+        BootTrace::mark("wifi:begin");
+        wifiStarted = millis();
+        wifiPending = true;
+        return;
+    }
+    finishWifi();
+}
 
-            configTzTime(resolve_timezone(settings.getTimezone()), NTP_SERVER);
-        } else {
-            WiFi.disconnect(true, true);
-            Serial.println("Timed out while connecting to WiFi");
-        }
+void Controller::loopWifi() {
+    if (!wifiPending)
+        return;
+    if (WiFi.status() == WL_CONNECTED) {
+        Serial.print("Connected to ");
+        Serial.println(settings.getWifiSsid());
+        Serial.print("IP address: ");
+        Serial.println(WiFi.localIP());
+
+        configTzTime(resolve_timezone(settings.getTimezone()), NTP_SERVER);
+        finishWifi();
+    } else if (millis() - wifiStarted > WIFI_CONNECT_TIMEOUT) {
+        WiFi.disconnect(true, true);
+        Serial.println("Timed out while connecting to WiFi");
+        finishWifi();
     }
+}
+
+void Controller::finishWifi() {
+    wifiPending = false;
     if (WiFi.status() != WL_CONNECTED) {
         isApConnection = true;
         WiFi.mode(WIFI_AP);
@@ -166,82 +296,298 @@ void Controller::setupWifi() {
         Serial.println(WiFi.localIP());
     }
 
-    pluginManager->on("ota:update:start", [this](Event const &) { this->updating = true; });
-    pluginManager->on("ota:update:end", [this](Event const &) { this->updating = false; });
+    pluginManager->on(EventId::OTA_UPDATE_START, [this](Event const &) { this->updating = true; });
+    pluginManager->on(EventId::OTA_UPDATE_END, [this](Event const &) { this->updating = false; });
+
+    BootTrace::mark("wifi:ready");
+    pluginManager->trigger(EventId::CONTROLLER_WIFI_CONNECT, "AP", isApConnection ? 1 : 0);
+    reportBoot();
+}
+
+// Each attempt blocks for up to the connect timeout, so it runs on the BLE worker. Retries are scheduled from here and
+// the transport is only attached on the loop task, which is the one sending.
+void Controller::connectBluetooth(unsigned long delay) {
+    bleConnecting = true;
+    clientController.beginConnection();
+    const bool posted = bleWorker.post(
+        "ble:connect", [this]() { return clientController.connectToServer(); },
+        [this](bool success) {
+            bleConnecting = false;
+            if (success) {
+                clientController.finishConnection();
+                onBluetoothConnected();
+            } else if (clientController.retryConnection()) {
+                connectBluetooth(BLE_CONNECT_RETRY_DELAY);
+            }
+        },
+        delay, BLE_CONNECT_JOB_TIMEOUT);
+    if (!posted) {
+        bleConnecting = false;
+    }
+}
+
+void Controller::onBluetoothConnected() {
+    setupInfos();
+    pluginManager->trigger(EventId::CONTROLLER_BLUETOOTH_CONNECT);
+    if (!loaded) {
+        loaded = true;
+        if (settings.getStartupMode() == MODE_STANDBY)
+            activateStandby();
+
+        ESP_LOGI("Controller", "setting pressure scale to %.2f\n", settings.getPressureScaling());
+        setPressureScale();
+        clientController.sendPidSettings(settings.getPid().c_str());
+
+        BootTrace::mark("controller:ready");
+        pluginManager->trigger(EventId::CONTROLLER_READY);
+        reportBoot();
+    }
+}
 
-    pluginManager->trigger("controller:wifi:connect", "AP", isApConnection ? 1 : 0);
+// Prints the boot trace once the controller board is connected and the network is up
+void Controller::reportBoot() {
+    if (bootReported || !loaded || wifiPending)
+        return;
+    bootReported = true;
+    BootTrace::print();
 }
 
 void Controller::loop() {
     pluginManager->loop();
+    jobWorker.loop();
+    bleWorker.loop();
 
     if (screenReady) {
         connect();
     }
 
-    if (clientController.isReadyForConnection()) {
-        clientController.connectToServer();
-        setupInfos();
-        pluginManager->trigger("controller:bluetooth:connect");
-        if (!loaded) {
-            loaded = true;
-            if (settings.getStartupMode() == MODE_STANDBY)
-                activateStandby();
-
-            ESP_LOGI("Controller", "setting pressure scale to %.2f\n", settings.getPressureScaling());
-            setPressureScale();
-            clientController.sendPidSettings(settings.getPid());
+    loopWifi();
 
-            pluginManager->trigger("controller:ready");
-        }
+    if (clientController.isReadyForConnection() && !bleConnecting) {
+        connectBluetooth();
     }
 
+    // The only place the link mode is applied, also after a reconnect
+    clientController.setLinkMode(getLinkMode());
+
     unsigned long now = millis();
     if (now - lastPing > PING_INTERVAL) {
         lastPing = now;
         clientController.sendPing();
     }
 
+    // Button presses and errors start and stop processes here, the outputs follow once the control state is published
+    applyRemoteError();
+    bool controlRequested = applyButtons();
+
     if (isErrorState()) {
+        publishState();
+        if (publishControl() || controlRequested) {
+            requestControlUpdate();
+        }
         return;
     }
 
-    if (now - lastProgress > PROGRESS_INTERVAL) {
-        if (currentProcess != nullptr) {
-            currentProcess->progress();
-            if (!isActive()) {
-                deactivate();
+    applyRemoteStart();
+
+    // New measurements are checked against the phase exits right away instead of waiting for the next interval
+    if (progressRequested || now - lastProgress > PROGRESS_INTERVAL) {
+        PROFILE_SCOPE("controller:progress");
+        progressRequested = false;
+        applyMeasurements();
+        applyRemoteProgress();
+        for (auto &slot : processes) {
+            if (slot.process == nullptr) {
+                continue;
             }
-        }
-        if (lastProcess != nullptr && !lastProcess->isComplete()) {
-            lastProcess->progress();
-        }
-        if (lastProcess != nullptr && lastProcess->isComplete() && !processCompleted && settings.isDelayAdjust()) {
-            processCompleted = true;
-            if (lastProcess->getType() == MODE_BREW) {
-                if (auto const *brewProcess = static_cast<BrewProcess *>(lastProcess);
-                    brewProcess->target == ProcessTarget::VOLUMETRIC) {
-                    settings.setBrewDelay(brewProcess->getNewDelayTime());
+            if (slot.running) {
+                slot.process->progress();
+                if (!slot.process->isActive()) {
+                    stopProcess(slot);
                 }
-            } else if (lastProcess->getType() == MODE_GRIND) {
-                if (auto const *grindProcess = static_cast<GrindProcess *>(lastProcess);
-                    grindProcess->target == ProcessTarget::VOLUMETRIC) {
-                    settings.setGrindDelay(grindProcess->getNewDelayTime());
+            }
+            if (!slot.running && !slot.completed) {
+                if (!slot.process->isComplete()) {
+                    slot.process->progress();
+                } else {
+                    completeProcess(slot);
                 }
             }
         }
+        if (Process *process = getProcess(MODE_BREW); process != nullptr) {
+            auto *brewProcess = static_cast<BrewProcess *>(process);
+            if (brewProcess->remote && brewProcess->takeAdvanceRequest()) {
+                clientController.sendProgramCommand(ProgramCommand::ADVANCE, brewProcess->phaseIndex);
+            }
+        }
         lastProgress = now;
+        controlRequested = true;
     }
 
+    routineEngine->loop();
+
     if (grindActiveUntil != 0 && now > grindActiveUntil)
         deactivateGrind();
     if (mode != MODE_STANDBY && now > lastAction + settings.getStandbyTimeout())
         activateStandby();
+
+    publishState();
+    // Processes started or stopped from the UI or the web server reach the outputs through the changed control state
+    if (publishControl() || controlRequested) {
+        requestControlUpdate();
+    }
+}
+
+// Only called from the loop task. The pump and flow setpoints of a transition follow with the next control update,
+// true if anything else the outputs depend on changed.
+bool Controller::publishControl() {
+    ControlState next{};
+    next.targetTemp = getTargetTemp();
+    next.active = isActive();
+    next.grindActive = isGrindActive();
+    for (uint8_t i = 0; i < MAX_PROCESSES; i++) {
+        const ProcessSlot &slot = processes[i];
+        if (!slot.running) {
+            continue;
+        }
+        ProcessControl &out = next.slots[i];
+        out.running = true;
+        out.type = slot.process->getType();
+        out.resources = slot.process->getResources();
+        out.active = slot.process->isActive();
+        out.relay = slot.process->isRelayActive();
+        out.altRelay = slot.process->isAltRelayActive();
+        out.pump = slot.process->getPumpValue();
+        if (out.type == MODE_BREW) {
+            auto *brewProcess = static_cast<BrewProcess *>(slot.process);
+            out.advancedPump = brewProcess->isAdvancedPump();
+            out.pressureTarget = brewProcess->isPressureTarget();
+            out.targetPressure = brewProcess->getPumpTargetPressure();
+            out.targetFlow = brewProcess->getPumpTargetFlow();
+        }
+    }
+    control.write(next);
+
+    bool changed = next.targetTemp != publishedControl.targetTemp || next.active != publishedControl.active ||
+                   next.grindActive != publishedControl.grindActive;
+    for (uint8_t i = 0; i < MAX_PROCESSES; i++) {
+        const ProcessControl &a = next.slots[i];
+        const ProcessControl &b = publishedControl.slots[i];
+        changed |= a.running != b.running || a.type != b.type || a.active != b.active || a.relay != b.relay ||
+                   a.altRelay != b.altRelay || a.advancedPump != b.advancedPump || a.pressureTarget != b.pressureTarget;
+    }
+    publishedControl = next;
+    return changed;
+}
+
+// Only called from the loop task, which makes it the single writer of the state
+void Controller::publishState() {
+    PROFILE_SCOPE("controller:publish");
+    MachineState next{};
+    next.version = ++stateVersion;
+    next.mode = mode;
+    next.currentTemp = currentTemp;
+    next.targetTemp = getTargetTemp();
+    next.targetDuration = getTargetDuration();
+    if (const auto selected = profileManager->getCompiledProfile(); selected != nullptr) {
+        memcpy(next.profileLabel, selected->label, sizeof(next.profileLabel));
+    }
+    next.pressure = pressure;
+    next.targetPressure = targetPressure;
+    next.flow = currentFlow;
+    next.active = isActive();
+    next.grindActive = isGrindActive();
+    next.autotuning = autotuning;
+    next.connected = clientController.isConnected();
+    next.error = error;
+    for (const auto &slot : processes) {
+        if (slot.running && next.processCount < SNAPSHOT_MAX_PROCESSES) {
+            ProcessSnapshot &process = next.processes[next.processCount++];
+            process.type = slot.process->getType();
+            process.active = slot.process->isActive();
+            process.resources = slot.process->getResources();
+        }
+    }
+    Process *process = getProcess();
+    if (process == nullptr) {
+        process = getLastProcess();
+    }
+    if (process != nullptr && process->getType() == MODE_BREW) {
+        auto *brewProcess = static_cast<BrewProcess *>(process);
+        const CompiledPhase &phase = *brewProcess->currentPhase;
+        BrewSnapshot &brew = next.brew;
+        brew.valid = true;
+        brew.active = brewProcess->isActive();
+        brew.volumetric = brewProcess->target == ProcessTarget::VOLUMETRIC;
+        brew.advancedPump = brewProcess->isAdvancedPump();
+        brew.phaseType = phase.phase;
+        memcpy(brew.phaseName, phase.name, sizeof(brew.phaseName));
+        brew.processStarted = brewProcess->processStarted;
+        brew.phaseStarted = brewProcess->currentPhaseStarted;
+        brew.finished = brewProcess->finished;
+        brew.phaseDuration = brewProcess->getPhaseDuration();
+        brew.totalDuration = brewProcess->getTotalDuration();
+        brew.phaseVolumetricTarget = phase.volumetricTarget;
+        brew.brewVolume = static_cast<float>(brewProcess->getBrewVolume());
+        brew.currentVolume = static_cast<float>(brewProcess->currentVolume);
+        brew.targetPressure = brewProcess->getPumpTargetPressure();
+    }
+    if (routineEngine->isRunning()) {
+        RoutineSnapshot &routine = next.routine;
+        routine.running = true;
+        routine.waiting = routineEngine->getState() == RoutineState::PREPARING;
+        routine.step = static_cast<uint8_t>(routineEngine->getStepIndex());
+        strncpy(routine.id, routineEngine->getRoutine().id.c_str(), sizeof(routine.id) - 1);
+        strncpy(routine.label, routineEngine->getRoutine().label.c_str(), sizeof(routine.label) - 1);
+    }
+    state.write(next);
+}
+
+// Brew and grind screens already get the active link, a shot then starts on the short interval instead of waiting for
+// the renegotiation. Updates of the controller board go over the link as well.
+BLELinkMode Controller::getLinkMode() const {
+    if (updating || isActive() || isGrindActive() || mode == MODE_BREW || mode == MODE_GRIND) {
+        return BLELinkMode::ACTIVE;
+    }
+    return mode == MODE_STANDBY ? BLELinkMode::STANDBY : BLELinkMode::IDLE;
 }
 
 void Controller::loopControl() {
     if (initialized) {
         updateControl();
+        recordControlLatency();
+    }
+}
+
+// Wakes the control task so the outputs follow an event immediately, safe to call from any task
+void Controller::requestControlUpdate() {
+    if (taskHandle != nullptr) {
+        xTaskNotifyGive(taskHandle);
+    }
+}
+
+void Controller::markControlEvent(ControlEvent event, unsigned long received) {
+    volatile unsigned long &pending = controlEventReceived[static_cast<uint8_t>(event)];
+    if (pending == 0) {
+        pending = received;
+    }
+}
+
+void Controller::recordControlLatency() {
+    const unsigned long now = micros();
+    for (uint8_t i = 0; i < CONTROL_EVENT_COUNT; i++) {
+        const unsigned long received = controlEventReceived[i];
+        if (received == 0) {
+            continue;
+        }
+        controlEventReceived[i] = 0;
+        LatencyStats &stats = controlLatency[i];
+        stats.add(now - received);
+        if (stats.count % CONTROL_LATENCY_LOG_SAMPLES == 0) {
+            ESP_LOGI("Controller", "%s to control latency: avg %luus, max %luus over %lu events", i == 0 ? "Sensor" : "Button",
+                     static_cast<unsigned long>(stats.average()), static_cast<unsigned long>(stats.max),
+                     static_cast<unsigned long>(stats.count));
+        }
     }
 }
 
@@ -262,15 +608,218 @@ void Controller::autotune(int testTime, int samples) {
     }
     autotuning = true;
     clientController.sendAutotune(testTime, samples);
-    pluginManager->trigger("controller:autotune:start");
+    pluginManager->trigger(EventId::CONTROLLER_AUTOTUNE_START);
 }
 
-void Controller::startProcess(Process *process) {
-    if (isActive() || !isReady())
-        return;
-    processCompleted = false;
-    this->currentProcess = process;
+bool Controller::startProcess(Process *process) {
+    if (process == nullptr) {
+        return false;
+    }
+    if (!isReady()) {
+        delete process;
+        return false;
+    }
+    if (Process *conflict = findConflict(process); conflict != nullptr) {
+        ESP_LOGW("Controller", "Process %d conflicts with running process %d", process->getType(), conflict->getType());
+        Event event;
+        event.id = EventId::CONTROLLER_PROCESS_CONFLICT;
+        event.setInt("type", process->getType());
+        event.setInt("conflict", conflict->getType());
+        pluginManager->trigger(event);
+        delete process;
+        return false;
+    }
+
+    // Prefer replacing a finished process of the same type, then a free slot, then the oldest finished process
+    ProcessSlot *target = nullptr;
+    for (auto &slot : processes) {
+        if (slot.process != nullptr && !slot.running && slot.process->getType() == process->getType()) {
+            target = &slot;
+            break;
+        }
+    }
+    if (target == nullptr) {
+        for (auto &slot : processes) {
+            if (slot.process == nullptr) {
+                target = &slot;
+                break;
+            }
+        }
+    }
+    if (target == nullptr) {
+        for (auto &slot : processes) {
+            if (!slot.running && (target == nullptr || slot.stopped < target->stopped)) {
+                target = &slot;
+            }
+        }
+    }
+    if (target == nullptr) {
+        ESP_LOGW("Controller", "No free process slot for process %d", process->getType());
+        delete process;
+        return false;
+    }
+    releaseProcess(*target);
+    target->process = process;
+    target->completed = false;
+    target->running = true;
+    pluginManager->trigger(EventId::CONTROLLER_PROCESS_START, "type", process->getType());
+    updateLastAction();
+    requestControlUpdate();
+    return true;
+}
+
+Process *Controller::findConflict(Process *process) const {
+    const uint8_t resources = process->getResources();
+    for (const auto &slot : processes) {
+        if (slot.running && (slot.process->getType() == process->getType() || (slot.process->getResources() & resources))) {
+            return slot.process;
+        }
+    }
+    return nullptr;
+}
+
+bool Controller::isResourceBusy(uint8_t resources) const { return getResourceOwner(resources) != nullptr; }
+
+void Controller::stopProcess(ProcessSlot &slot) {
+    slot.running = false;
+    slot.stopped = millis();
+    const int type = slot.process->getType();
+    if (type == MODE_BREW) {
+        if (static_cast<BrewProcess *>(slot.process)->remote) {
+            clientController.sendProgramCommand(ProgramCommand::STOP);
+        }
+        pluginManager->trigger(EventId::CONTROLLER_BREW_END);
+    }
+    if (type == MODE_GRIND) {
+        pluginManager->trigger(EventId::CONTROLLER_GRIND_END);
+    }
+    pluginManager->trigger(EventId::CONTROLLER_PROCESS_END, "type", type);
     updateLastAction();
+    requestControlUpdate();
+}
+
+// The upload writes with response, which must not run on the BLE host task, so brews started from any task are only
+// handed to the controller board here on the loop task
+void Controller::applyRemoteStart() {
+    if (!remoteStartRequested) {
+        return;
+    }
+    remoteStartRequested = false;
+    Process *process = getProcess(MODE_BREW);
+    if (process != nullptr && process->isActive() && !static_cast<BrewProcess *>(process)->remote) {
+        startRemoteProgram(static_cast<BrewProcess *>(process));
+    }
+}
+
+// Hands the phases of a brew to the controller board so phase changes don't wait for a BLE round trip.
+// Falls back to running the phases on the display if the board can't execute programs or the upload fails.
+void Controller::startRemoteProgram(BrewProcess *process) {
+    if (!systemInfo.capabilities.programs) {
+        return;
+    }
+    const bool volumetric = process->target == ProcessTarget::VOLUMETRIC;
+    if (uploadedProfile != process->profile || uploadedVolumetric != volumetric) {
+        uploadedProfile = nullptr;
+        if (!clientController.sendProgram(compileProfileProgram(*process->profile, volumetric))) {
+            ESP_LOGW("Controller", "Program upload failed, running profile on the display");
+            return;
+        }
+        uploadedProfile = process->profile;
+        uploadedVolumetric = volumetric;
+    }
+    process->remote = true;
+    clientController.sendProgramCommand(ProgramCommand::START);
+}
+
+void Controller::applyRemoteProgress() {
+    portENTER_CRITICAL(&remoteProgressMux);
+    const bool pending = remoteProgressPending;
+    const ProgramProgress progress = remoteProgress;
+    remoteProgressPending = false;
+    portEXIT_CRITICAL(&remoteProgressMux);
+    if (!pending) {
+        return;
+    }
+    Process *process = getProcess(MODE_BREW);
+    if (process == nullptr || uploadedProfile == nullptr) {
+        return;
+    }
+    auto *brewProcess = static_cast<BrewProcess *>(process);
+    if (brewProcess->remote && progress.id == getProgramId(*brewProcess->profile)) {
+        brewProcess->onRemoteProgress(progress.phase, progress.running);
+    }
+}
+
+void Controller::releaseProcess(ProcessSlot &slot) {
+    if (slot.process == nullptr) {
+        return;
+    }
+    if (slot.process->getType() == MODE_BREW) {
+        pluginManager->trigger(EventId::CONTROLLER_BREW_CLEAR);
+    }
+    Process *process = slot.process;
+    slot = ProcessSlot{};
+    delete process;
+}
+
+void Controller::completeProcess(ProcessSlot &slot) {
+    slot.completed = true;
+    if (!settings.isDelayAdjust()) {
+        return;
+    }
+    if (slot.process->getType() == MODE_BREW) {
+        if (auto const *brewProcess = static_cast<BrewProcess *>(slot.process); brewProcess->target == ProcessTarget::VOLUMETRIC) {
+            if (brewProcess->isDelaySampleValid()) {
+                delayLearner.addSample(brewProcess->profile->id, brewProcess->getNewDelayTime(), settings.getBrewDelay());
+            } else {
+                ESP_LOGW("Controller", "Scale dropped out or delay out of range, not learning from this shot");
+            }
+        }
+    } else if (slot.process->getType() == MODE_GRIND) {
+        if (auto const *grindProcess = static_cast<GrindProcess *>(slot.process);
+            grindProcess->target == ProcessTarget::VOLUMETRIC) {
+            settings.setGrindDelay(grindProcess->getNewDelayTime());
+        }
+    }
+}
+
+Process *Controller::getProcess() const {
+    for (const auto &slot : processes) {
+        if (slot.running && slot.process->getType() != MODE_GRIND) {
+            return slot.process;
+        }
+    }
+    return nullptr;
+}
+
+Process *Controller::getProcess(int type) const {
+    for (const auto &slot : processes) {
+        if (slot.running && slot.process->getType() == type) {
+            return slot.process;
+        }
+    }
+    return nullptr;
+}
+
+Process *Controller::getLastProcess() const {
+    const ProcessSlot *last = nullptr;
+    for (const auto &slot : processes) {
+        if (slot.process != nullptr && !slot.running && slot.process->getType() != MODE_GRIND &&
+            (last == nullptr || slot.stopped > last->stopped)) {
+            last = &slot;
+        }
+    }
+    return last != nullptr ? last->process : nullptr;
+}
+
+std::vector<Process *> Controller::getProcesses() const {
+    std::vector<Process *> result;
+    for (const auto &slot : processes) {
+        if (slot.running) {
+            result.push_back(slot.process);
+        }
+    }
+    return result;
 }
 
 int Controller::getTargetTemp() {
@@ -278,10 +827,20 @@ int Controller::getTargetTemp() {
         return 93;
     }
 
-    switch (mode) {
+    // A running process that owns the heater keeps its setpoint even if the screen changes
+    if (Process *heaterProcess = getResourceOwner(PROCESS_RESOURCE_HEATER); heaterProcess != nullptr) {
+        return getModeTargetTemp(heaterProcess->getType());
+    }
+    return getModeTargetTemp(mode);
+}
+
+int Controller::getModeTargetTemp(int targetMode) {
+    switch (targetMode) {
     case MODE_BREW:
-    case MODE_GRIND:
-        return profileManager->getSelectedProfile().temperature;
+    case MODE_GRIND: {
+        const auto profile = getActiveProfile();
+        return profile != nullptr ? profile->temperature : 0;
+    }
     case MODE_STEAM:
         return settings.getTargetSteamTemp();
     case MODE_WATER:
@@ -292,7 +851,7 @@ int Controller::getTargetTemp() {
 }
 
 void Controller::setTargetTemp(int temperature) {
-    pluginManager->trigger("boiler:targetTemperature:change", "value", temperature);
+    pluginManager->trigger(EventId::BOILER_TARGET_TEMPERATURE_CHANGE, "value", temperature);
     switch (mode) {
     case MODE_BREW:
     case MODE_GRIND:
@@ -318,13 +877,13 @@ void Controller::setPressureScale(void) {
 int Controller::getTargetDuration() const { return settings.getTargetDuration(); }
 
 void Controller::setTargetDuration(int duration) {
-    Event event = pluginManager->trigger("controller:targetDuration:change", "value", duration);
+    Event event = pluginManager->trigger(EventId::CONTROLLER_TARGET_DURATION_CHANGE, "value", duration);
     settings.setTargetDuration(event.getInt("value"));
     updateLastAction();
 }
 
 void Controller::setTargetVolume(int volume) {
-    Event event = pluginManager->trigger("controller:targetVolume:change", "value", volume);
+    Event event = pluginManager->trigger(EventId::CONTROLLER_TARGET_VOLUME_CHANGE, "value", volume);
     settings.setTargetVolume(event.getInt("value"));
     updateLastAction();
 }
@@ -332,13 +891,13 @@ void Controller::setTargetVolume(int volume) {
 int Controller::getTargetGrindDuration() const { return settings.getTargetGrindDuration(); }
 
 void Controller::setTargetGrindDuration(int duration) {
-    Event event = pluginManager->trigger("controller:grindDuration:change", "value", duration);
+    Event event = pluginManager->trigger(EventId::CONTROLLER_GRIND_DURATION_CHANGE, "value", duration);
     settings.setTargetGrindDuration(event.getInt("value"));
     updateLastAction();
 }
 
 void Controller::setTargetGrindVolume(double volume) {
-    Event event = pluginManager->trigger("controller:grindVolume:change", "value", static_cast<float>(volume));
+    Event event = pluginManager->trigger(EventId::CONTROLLER_GRIND_VOLUME_CHANGE, "value", static_cast<float>(volume));
     settings.setTargetGrindVolume(event.getFloat("value"));
     updateLastAction();
 }
@@ -419,98 +978,134 @@ void Controller::lowerGrindTarget() {
     }
 }
 
+// Runs on the control task and only reads the control state the loop task published, never the processes
 void Controller::updateControl() {
-    int targetTemp = getTargetTemp();
+    PROFILE_SCOPE("controller:control");
+    TRACE_SCOPE("controller", "control");
+    const ControlState current = control.read();
+    int targetTemp = current.targetTemp;
     if (targetTemp > 0) {
         targetTemp = targetTemp + settings.getTemperatureOffset();
     }
-    clientController.sendAltControl(isActive() && currentProcess->isAltRelayActive());
-    if (isActive() && currentProcess->getType() == MODE_BREW) {
-        auto *brewProcess = static_cast<BrewProcess *>(currentProcess);
-        if (brewProcess->isAdvancedPump() && systemInfo.capabilities.pressure) {
-            clientController.sendAdvancedOutputControl(brewProcess->isRelayActive(), static_cast<float>(targetTemp), true,
-                                                       brewProcess->getPumpTargetPressure(), 0.0f);
-            targetPressure = brewProcess->getPumpTargetPressure();
-            return;
-        }
+    const ProcessControl *altProcess = current.getOwner(PROCESS_RESOURCE_ALT_RELAY);
+    const ProcessControl *pumpProcess = current.getOwner(PROCESS_RESOURCE_PUMP);
+    const ProcessControl *valveProcess = current.getOwner(PROCESS_RESOURCE_VALVE);
+    // Changes are sent right away, the keep-alive only repeats an unchanged state
+    clientController.setOutputKeepAlive(current.active || current.grindActive ? OUTPUT_KEEPALIVE_ACTIVE_MS
+                                                                              : OUTPUT_KEEPALIVE_IDLE_MS);
+    clientController.sendAltControl(altProcess != nullptr && altProcess->active && altProcess->altRelay);
+    if (pumpProcess != nullptr && pumpProcess->active && pumpProcess->advancedPump && systemInfo.capabilities.pressure) {
+        clientController.sendAdvancedOutputControl(pumpProcess->relay, static_cast<float>(targetTemp),
+                                                   pumpProcess->pressureTarget, pumpProcess->targetPressure,
+                                                   pumpProcess->targetFlow);
+        targetPressure = pumpProcess->targetPressure;
+        return;
     }
     targetPressure = 0.0f;
-    clientController.sendOutputControl(isActive() && currentProcess->isRelayActive(),
-                                       isActive() ? currentProcess->getPumpValue() : 0, static_cast<float>(targetTemp));
+    const bool valveOpen = valveProcess != nullptr && valveProcess->active && valveProcess->relay;
+    const float pumpValue = pumpProcess != nullptr && pumpProcess->active ? pumpProcess->pump : 0;
+    clientController.sendOutputControl(valveOpen, pumpValue, static_cast<float>(targetTemp));
+}
+
+Process *Controller::getResourceOwner(uint8_t resource) const {
+    for (const auto &slot : processes) {
+        if (slot.running && (slot.process->getResources() & resource)) {
+            return slot.process;
+        }
+    }
+    return nullptr;
 }
 
 void Controller::activate() {
     if (isActive())
         return;
     clear();
-    clientController.tare();
-    delay(100);
+    Process *process = nullptr;
     switch (mode) {
-    case MODE_BREW:
-        startProcess(new BrewProcess(profileManager->getSelectedProfile(),
-                                     settings.isVolumetricTarget() && isVolumetricAvailable() ? ProcessTarget::VOLUMETRIC
-                                                                                              : ProcessTarget::TIME,
-                                     settings.getBrewDelay()));
+    case MODE_BREW: {
+        auto profile = getActiveProfile();
+        const double brewDelay = delayLearner.getDelay(profile->id, settings.getBrewDelay());
+        process = new BrewProcess(profile,
+                                  settings.isVolumetricTarget() && isVolumetricAvailable() ? ProcessTarget::VOLUMETRIC
+                                                                                           : ProcessTarget::TIME,
+                                  brewDelay, static_cast<VolumePredictorType>(settings.getVolumePredictor()));
         break;
+    }
     case MODE_STEAM:
-        startProcess(new SteamProcess());
+        process = new SteamProcess();
         break;
     case MODE_WATER:
-        startProcess(new PumpProcess());
+        process = new PumpProcess();
         break;
-    default:;
+    default:
+        return;
     }
-    if (currentProcess->getType() == MODE_BREW) {
-        pluginManager->trigger("controller:brew:start");
+    // Don't tare the scale under a process that is still weighing
+    if (!isResourceBusy(PROCESS_RESOURCE_SCALE)) {
+        clientController.tare();
+        delay(100);
+    }
+    if (startProcess(process) && process->getType() == MODE_BREW) {
+        remoteStartRequested = true;
+        pluginManager->trigger(EventId::CONTROLLER_BREW_START);
     }
 }
 
 void Controller::deactivate() {
-    if (currentProcess == nullptr) {
-        return;
-    }
-    delete lastProcess;
-    lastProcess = currentProcess;
-    currentProcess = nullptr;
-    if (lastProcess->getType() == MODE_BREW) {
-        pluginManager->trigger("controller:brew:end");
-    }
-    if (lastProcess->getType() == MODE_GRIND) {
-        pluginManager->trigger("controller:grind:end");
+    for (auto &slot : processes) {
+        if (slot.running && slot.process->getType() != MODE_GRIND) {
+            stopProcess(slot);
+        }
     }
-    updateLastAction();
 }
 
 void Controller::clear() {
-    processCompleted = true;
-    if (lastProcess != nullptr && lastProcess->getType() == MODE_BREW) {
-        pluginManager->trigger("controller:brew:clear");
+    for (auto &slot : processes) {
+        if (slot.process != nullptr && !slot.running && slot.process->getType() != MODE_GRIND) {
+            releaseProcess(slot);
+        }
+    }
+}
+
+void Controller::clearGrind() {
+    for (auto &slot : processes) {
+        if (slot.process != nullptr && !slot.running && slot.process->getType() == MODE_GRIND) {
+            releaseProcess(slot);
+        }
     }
-    delete lastProcess;
-    lastProcess = nullptr;
 }
 
 void Controller::activateGrind() {
-    pluginManager->trigger("controller:grind:start");
     if (isGrindActive())
         return;
-    clear();
+    clearGrind();
+    Process *process;
     if (settings.isVolumetricTarget() && isVolumetricAvailable()) {
-        startProcess(new GrindProcess(ProcessTarget::VOLUMETRIC, 0, settings.getTargetGrindVolume(), settings.getGrindDelay()));
+        process = new GrindProcess(ProcessTarget::VOLUMETRIC, 0, settings.getTargetGrindVolume(), settings.getGrindDelay());
     } else {
-        startProcess(
-            new GrindProcess(ProcessTarget::TIME, settings.getTargetGrindDuration(), settings.getTargetGrindVolume(), 0.0));
+        process = new GrindProcess(ProcessTarget::TIME, settings.getTargetGrindDuration(), settings.getTargetGrindVolume(), 0.0);
     }
+    if (isReady() && findConflict(process) == nullptr) {
+        // Plugins tare the scale and switch on the grinder before the process starts measuring
+        pluginManager->trigger(EventId::CONTROLLER_GRIND_START);
+    }
+    startProcess(process);
 }
 
 void Controller::deactivateGrind() {
-    deactivate();
-    clear();
+    for (auto &slot : processes) {
+        if (slot.running && slot.process->getType() == MODE_GRIND) {
+            stopProcess(slot);
+        }
+    }
+    clearGrind();
 }
 
 void Controller::activateStandby() {
+    stopRoutine();
     setMode(MODE_STANDBY);
     deactivate();
+    deactivateGrind();
 }
 
 void Controller::deactivateStandby() {
@@ -518,26 +1113,44 @@ void Controller::deactivateStandby() {
     setMode(MODE_BREW);
 }
 
-bool Controller::isActive() const { return currentProcess != nullptr && currentProcess->isActive(); }
+bool Controller::isActive() const {
+    Process *process = getProcess();
+    return process != nullptr && process->isActive();
+}
 
-bool Controller::isGrindActive() const { return isActive() && currentProcess->getType() == MODE_GRIND; }
+bool Controller::isGrindActive() const {
+    Process *process = getProcess(MODE_GRIND);
+    return process != nullptr && process->isActive();
+}
 
 int Controller::getMode() const { return mode; }
 
 void Controller::setMode(int newMode) {
-    Event modeEvent = pluginManager->trigger("controller:mode:change", "value", newMode);
+    Event modeEvent = pluginManager->trigger(EventId::CONTROLLER_MODE_CHANGE, "value", newMode);
     mode = modeEvent.getInt("value");
 
     updateLastAction();
     setTargetTemp(getTargetTemp());
+    requestControlUpdate();
 }
 
 void Controller::onTempRead(float temperature) {
     float temp = temperature - settings.getTemperatureOffset();
-    Event event = pluginManager->trigger("boiler:currentTemperature:change", "value", temp);
+    Event event = pluginManager->trigger(EventId::BOILER_CURRENT_TEMPERATURE_CHANGE, "value", temp);
     currentTemp = event.getFloat("value");
 }
 
+void Controller::onSensorRead(float temperature, float pressure, float flow) {
+    onTempRead(temperature);
+    this->pressure = pressure;
+    this->currentFlow = flow;
+    sensorsPending = true;
+    markControlEvent(ControlEvent::SENSOR, micros());
+    progressRequested = true;
+    pluginManager->trigger(EventId::BOILER_PRESSURE_CHANGE, "value", pressure);
+    pluginManager->trigger(EventId::PUMP_FLOW_CHANGE, "value", flow);
+}
+
 void Controller::updateLastAction() { lastAction = millis(); }
 
 void Controller::onOTAUpdate() {
@@ -545,12 +1158,97 @@ void Controller::onOTAUpdate() {
     updating = true;
 }
 
-void Controller::onVolumetricMeasurement(double measurement) const {
-    if (currentProcess != nullptr) {
-        currentProcess->updateVolume(measurement);
+// Called from the BLE tasks, the samples are queued and handed to the processes by the loop task which owns them
+void Controller::onVolumetricMeasurement(double measurement, unsigned long time) {
+    portENTER_CRITICAL(&measurementMux);
+    if (pendingVolumeCount == VOLUME_QUEUE_SIZE) {
+        // The loop fell behind, the oldest sample is the least useful for the predictor
+        pendingVolumeStart = (pendingVolumeStart + 1) % VOLUME_QUEUE_SIZE;
+        pendingVolumeCount--;
+    }
+    pendingVolumes[(pendingVolumeStart + pendingVolumeCount) % VOLUME_QUEUE_SIZE] = {measurement, time};
+    pendingVolumeCount++;
+    portEXIT_CRITICAL(&measurementMux);
+    progressRequested = true;
+}
+
+void Controller::applyMeasurements() {
+    VolumeSample samples[VOLUME_QUEUE_SIZE];
+    uint8_t count = 0;
+    portENTER_CRITICAL(&measurementMux);
+    for (; count < pendingVolumeCount; count++) {
+        samples[count] = pendingVolumes[(pendingVolumeStart + count) % VOLUME_QUEUE_SIZE];
     }
-    if (lastProcess != nullptr) {
-        lastProcess->updateVolume(measurement);
+    pendingVolumeStart = 0;
+    pendingVolumeCount = 0;
+    portEXIT_CRITICAL(&measurementMux);
+
+    const bool sensors = sensorsPending;
+    sensorsPending = false;
+    for (auto &slot : processes) {
+        if (slot.process == nullptr) {
+            continue;
+        }
+        for (uint8_t i = 0; i < count; i++) {
+            slot.process->updateVolume(samples[i].volume, samples[i].time);
+        }
+        if (sensors && slot.running) {
+            slot.process->updateSensors(pressure, currentFlow);
+        }
+    }
+}
+
+void Controller::queueButton(bool steam, int status) {
+    const unsigned long received = micros();
+    portENTER_CRITICAL(&buttonMux);
+    const bool queued = pendingButtonCount < BUTTON_QUEUE_SIZE;
+    if (queued) {
+        pendingButtons[(pendingButtonStart + pendingButtonCount) % BUTTON_QUEUE_SIZE] = {steam, status, received};
+        pendingButtonCount++;
+    }
+    portEXIT_CRITICAL(&buttonMux);
+    if (!queued) {
+        // Presses and releases have to stay in order, a full queue drops the newest change
+        ESP_LOGW("Controller", "Dropped %s button change, the loop fell behind", steam ? "steam" : "brew");
+    }
+}
+
+// True if a button changed, its latency is measured from arrival to the output write that follows it
+bool Controller::applyButtons() {
+    ButtonEvent events[BUTTON_QUEUE_SIZE];
+    uint8_t count = 0;
+    portENTER_CRITICAL(&buttonMux);
+    for (; count < pendingButtonCount; count++) {
+        events[count] = pendingButtons[(pendingButtonStart + count) % BUTTON_QUEUE_SIZE];
+    }
+    pendingButtonStart = 0;
+    pendingButtonCount = 0;
+    portEXIT_CRITICAL(&buttonMux);
+
+    for (uint8_t i = 0; i < count; i++) {
+        if (events[i].steam) {
+            handleSteamButton(events[i].status);
+        } else {
+            handleBrewButton(events[i].status);
+        }
+        markControlEvent(ControlEvent::BUTTON, events[i].received);
+    }
+    return count > 0;
+}
+
+void Controller::applyRemoteError() {
+    if (!remoteErrorPending) {
+        return;
+    }
+    remoteErrorPending = false;
+    const int error = remoteError;
+    if (error != ERROR_CODE_TIMEOUT && error != this->error) {
+        this->error = error;
+        stopRoutine();
+        deactivate();
+        deactivateGrind();
+        setMode(MODE_STANDBY);
+        pluginManager->trigger(EventId::CONTROLLER_ERROR);
     }
 }
 
@@ -559,12 +1257,49 @@ void Controller::onFlush() {
         return;
     }
     clear();
-    startProcess(new BrewProcess(FLUSH_PROFILE, ProcessTarget::TIME, settings.getBrewDelay()));
-    pluginManager->trigger("controller:brew:start");
+    static const auto flushProfile = compileProfile(FLUSH_PROFILE);
+    auto *process = new BrewProcess(flushProfile, ProcessTarget::TIME, settings.getBrewDelay());
+    if (startProcess(process)) {
+        remoteStartRequested = true;
+        pluginManager->trigger(EventId::CONTROLLER_BREW_START);
+    }
+}
+
+bool Controller::startRoutine(const String &id) {
+    if (!isReady()) {
+        return false;
+    }
+    updateLastAction();
+    return routineEngine->start(id);
+}
+
+void Controller::stopRoutine() { routineEngine->stop(); }
+
+void Controller::setProfileOverride(std::shared_ptr<const CompiledProfile> profile) {
+    if (profile == profileOverride) {
+        return;
+    }
+    profileOverride = std::move(profile);
+    pluginManager->trigger(EventId::BOILER_TARGET_TEMPERATURE_CHANGE, "value", getTargetTemp());
+}
+
+std::shared_ptr<const CompiledProfile> Controller::getActiveProfile() const {
+    return profileOverride != nullptr ? profileOverride : profileManager->getCompiledProfile();
 }
 
 void Controller::handleBrewButton(int brewButtonStatus) {
     printf("current screen %d, brew button %d\n", getMode(), brewButtonStatus);
+    if (const String routine = settings.getBrewButtonRoutine(); !routine.isEmpty()) {
+        if (brewButtonStatus && !routineEngine->isRunning()) {
+            if (getMode() == MODE_STANDBY) {
+                deactivateStandby();
+            }
+            startRoutine(routine);
+        } else if (brewButtonStatus || !settings.isMomentaryButtons()) {
+            stopRoutine();
+        }
+        return;
+    }
     if (brewButtonStatus) {
         switch (getMode()) {
         case MODE_STANDBY:
@@ -620,14 +1355,20 @@ void Controller::handleSteamButton(int steamButtonStatus) {
 }
 
 void Controller::handleProfileUpdate() {
-    pluginManager->trigger("boiler:targetTemperature:change", "value",
+    pluginManager->trigger(EventId::BOILER_TARGET_TEMPERATURE_CHANGE, "value",
                            static_cast<int>(profileManager->getSelectedProfile().temperature));
 }
 
+// Runs whenever an event requests it, or after CONTROL_FALLBACK_INTERVAL without one
 void Controller::loopTask(void *arg) {
     auto *controller = static_cast<Controller *>(arg);
     while (true) {
+        ulTaskNotifyTake(pdTRUE, CONTROL_FALLBACK_INTERVAL / portTICK_PERIOD_MS);
+        const unsigned long sinceLast = millis() - controller->lastControl;
+        if (sinceLast < CONTROL_MIN_INTERVAL) {
+            vTaskDelay((CONTROL_MIN_INTERVAL - sinceLast) / portTICK_PERIOD_MS);
+        }
+        controller->lastControl = millis();
         controller->loopControl();
-        vTaskDelay(100 / portTICK_PERIOD_MS);
     }
 }
@@ -1,9 +1,16 @@
 #ifndef CONTROLLER_H
 #define CONTROLLER_H
 
+#include "ClockSync.h"
+#include "DelayLearner.h"
+#include "JobWorker.h"
+#include "LatencyStats.h"
+#include "MachineSnapshot.h"
 #include "NimBLEClientController.h"
 #include "NimBLEComm.h"
 #include "PluginManager.h"
+#include "RoutineEngine.h"
+#include "RoutineManager.h"
 #include "Settings.h"
 #include <WiFi.h>
 #include <display/core/Process.h>
@@ -13,6 +20,68 @@
 const IPAddress WIFI_AP_IP(4, 4, 4, 1); // the IP address the web server, Samsung requires the IP to be in public space
 const IPAddress WIFI_SUBNET_MASK(255, 255, 255, 0); // no need to change: https://avinetworks.com/glossary/subnet-mask/
 
+constexpr uint8_t MAX_PROCESSES = 3;
+
+// Sources that wake the control task, latency is measured from the event to the output control write
+enum class ControlEvent : uint8_t { SENSOR, BUTTON };
+constexpr uint8_t CONTROL_EVENT_COUNT = 2;
+
+// A process stays in its slot after it stopped running until it is cleared or the slot is needed,
+// so finished shots can still be displayed and learned from.
+struct ProcessSlot {
+    Process *process = nullptr;
+    bool running = false;
+    bool completed = true;
+    unsigned long stopped = 0;
+};
+
+// Outputs a running process asks for, copied by the loop task so the control task never touches the processes
+struct ProcessControl {
+    bool running = false;
+    int type = 0;
+    uint8_t resources = 0;
+    bool active = false;
+    bool relay = false;
+    bool altRelay = false;
+    float pump = 0.0f;
+    bool advancedPump = false; // brew phases with a pressure or flow target
+    bool pressureTarget = false;
+    float targetPressure = 0.0f;
+    float targetFlow = 0.0f;
+};
+
+// Published by the loop task for the control task, one entry per process slot
+struct ControlState {
+    ProcessControl slots[MAX_PROCESSES];
+    int targetTemp = 0; // without the temperature offset
+    bool active = false;
+    bool grindActive = false;
+
+    const ProcessControl *getOwner(uint8_t resource) const {
+        for (const auto &slot : slots) {
+            if (slot.running && (slot.resources & resource)) {
+                return &slot;
+            }
+        }
+        return nullptr;
+    }
+};
+
+// Brew or steam button change waiting for the loop task
+struct ButtonEvent {
+    bool steam = false;
+    int status = 0;
+    unsigned long received = 0; // micros
+};
+constexpr uint8_t BUTTON_QUEUE_SIZE = 8;
+
+// Scale or flow meter reading waiting to be handed to the processes
+struct VolumeSample {
+    double volume = 0.0;
+    unsigned long time = 0;
+};
+constexpr uint8_t VOLUME_QUEUE_SIZE = 32;
+
 class Controller {
   public:
     Controller() = default;
@@ -21,6 +90,7 @@ class Controller {
     void connect();
     void loop();
     void loopControl();
+    void requestControlUpdate();
 
     void setMode(int newMode);
     void setTargetTemp(int temperature);
@@ -46,11 +116,19 @@ class Controller {
     virtual float getCurrentFlow() const { return currentFlow; }
 
     void autotune(int testTime, int samples);
-    void startProcess(Process *process);
-    Process *getProcess() const { return currentProcess; }
-    Process *getLastProcess() const { return lastProcess; }
+    bool startProcess(Process *process);
+    Process *getProcess() const;
+    Process *getProcess(int type) const;
+    Process *getLastProcess() const;
+    std::vector<Process *> getProcesses() const;
+    bool isResourceBusy(uint8_t resources) const;
     Settings &getSettings() { return settings; }
     ProfileManager *getProfileManager() { return profileManager; }
+    RoutineManager *getRoutineManager() { return routineManager; }
+    RoutineEngine *getRoutineEngine() { return routineEngine; }
+    JobWorker *getJobWorker() { return &jobWorker; }
+    // Stop delays learned per profile from volumetric shots
+    DelayLearner &getDelayLearner() { return delayLearner; }
     DefaultUI *getUI() const { return ui; }
     bool isErrorState() const { return error > 0; }
     int getError() const { return error; }
@@ -73,11 +151,36 @@ class Controller {
     void onOTAUpdate();
     void onScreenReady();
     void onTargetChange(ProcessTarget target);
-    void onVolumetricMeasurement(double measurement) const;
+    void onVolumetricMeasurement(double measurement) { onVolumetricMeasurement(measurement, millis()); }
+    // time is when the measurement was taken, on the millis() clock
+    void onVolumetricMeasurement(double measurement, unsigned long time);
     void setVolumetricOverride(bool override) { volumetricOverride = override; }
     void onFlush();
+    // Routines are loaded and started by the next loop call, so these can be called from any task
+    bool startRoutine(const String &id);
+    void stopRoutine();
+    // Brews run with this profile instead of the selected one, without selecting it. nullptr goes back to the
+    // selected profile. Loop task only.
+    void setProfileOverride(std::shared_ptr<const CompiledProfile> profile);
+    std::shared_ptr<const CompiledProfile> getActiveProfile() const;
 
     SystemInfo getSystemInfo() const { return systemInfo; }
+    // Lock free copy of the machine state for readers outside the controller loop
+    MachineState getState() const { return state.read(); }
+    const LatencyStats &getControlLatency(ControlEvent event) const { return controlLatency[static_cast<uint8_t>(event)]; }
+    // Clock of the controller board relative to ours, from the timestamped pings. Copy taken under the lock, the BLE
+    // task updates the estimate with every pong.
+    ClockSync getClockSync() const;
+    const LatencyStats &getRoundTripLatency() const { return roundTripLatency; }
+    // From sampling on the controller board to arrival here, needs the clock synchronisation
+    const LatencyStats &getSensorLatency() const { return sensorLatency; }
+    // From the controller board answering a ping to its arrival here, for each link mode. Needs the clock
+    // synchronisation and leaves out the pings right after a mode change.
+    const LatencyStats &getNotifyLatency(BLELinkMode mode) const { return notifyLatency[static_cast<uint8_t>(mode)]; }
+    // Latest timing report of each control task on the controller board
+    uint8_t getTaskDiagnosticsCount() const;
+    // Copy taken under the lock, the BLE task replaces reports while the web task reads them
+    TaskDiagnostics getTaskDiagnostics(uint8_t index) const;
 
     NimBLEClientController *getClientController() { return &clientController; }
 
@@ -85,14 +188,40 @@ class Controller {
     // Initialization methods
     void setupPanel();
     void setupWifi();
+    void loopWifi();
+    void finishWifi();
     void setupBluetooth();
+    void connectBluetooth(unsigned long delay = 0);
+    void onBluetoothConnected();
     void setupInfos();
+    void reportBoot();
 
     // Functional methods
     void updateControl();
+    void markControlEvent(ControlEvent event, unsigned long received);
+    void recordControlLatency();
+    void publishState();
+    bool publishControl();
+    bool toLocalMillis(uint32_t remote, unsigned long &local) const;
+    BLELinkMode getLinkMode() const;
+    Process *findConflict(Process *process) const;
+    Process *getResourceOwner(uint8_t resource) const;
+    void stopProcess(ProcessSlot &slot);
+    void applyRemoteStart();
+    void startRemoteProgram(BrewProcess *process);
+    void applyRemoteProgress();
+    void applyMeasurements();
+    void queueButton(bool steam, int status);
+    bool applyButtons();
+    void applyRemoteError();
+    void releaseProcess(ProcessSlot &slot);
+    void completeProcess(ProcessSlot &slot);
+    void clearGrind();
+    int getModeTargetTemp(int targetMode);
 
     // Event handlers
     void onTempRead(float temperature);
+    void onSensorRead(float temperature, float pressure, float flow);
 
     // brew button
     void handleBrewButton(int brewButtonStatus);
@@ -106,8 +235,14 @@ class Controller {
     NimBLEClientController clientController;
     hw_timer_t *timer = nullptr;
     Settings settings;
+    DelayLearner delayLearner;
+    JobWorker jobWorker;
+    // Connect attempts only, so plugin jobs never wait behind the connect timeout
+    JobWorker bleWorker;
     PluginManager *pluginManager{};
     ProfileManager *profileManager{};
+    RoutineManager *routineManager{};
+    RoutineEngine *routineEngine{};
 
     int mode = MODE_BREW;
     int currentTemp = 0;
@@ -117,13 +252,62 @@ class Controller {
 
     SystemInfo systemInfo{};
 
-    Process *currentProcess = nullptr;
-    Process *lastProcess = nullptr;
+    // Program last uploaded to the controller board, reuploaded when the profile or target changes
+    std::shared_ptr<const CompiledProfile> uploadedProfile;
+    std::shared_ptr<const CompiledProfile> profileOverride;
+    bool uploadedVolumetric = false;
+    // Set by whichever task started a brew, the program is uploaded and started by the loop task
+    volatile bool remoteStartRequested = false;
+    // Written by the BLE task, applied to the running brew process in loop()
+    ProgramProgress remoteProgress{};
+    bool remoteProgressPending = false;
+    portMUX_TYPE remoteProgressMux = portMUX_INITIALIZER_UNLOCKED;
+
+    // Written by the BLE tasks, handed to the process slots in loop() so only the loop task touches the processes
+    VolumeSample pendingVolumes[VOLUME_QUEUE_SIZE];
+    uint8_t pendingVolumeStart = 0;
+    uint8_t pendingVolumeCount = 0;
+    volatile bool sensorsPending = false;
+    portMUX_TYPE measurementMux = portMUX_INITIALIZER_UNLOCKED;
+
+    // Written by the BLE task, applied in loop() so button presses and errors never start or delete processes there
+    ButtonEvent pendingButtons[BUTTON_QUEUE_SIZE];
+    uint8_t pendingButtonStart = 0;
+    uint8_t pendingButtonCount = 0;
+    portMUX_TYPE buttonMux = portMUX_INITIALIZER_UNLOCKED;
+    volatile int remoteError = 0;
+    volatile bool remoteErrorPending = false;
+
+    // Set from the BLE task when new sensor or scale data should be checked against the phase exits
+    volatile bool progressRequested = false;
+    // Time in micros the oldest unhandled event of each type was received, 0 if none is pending
+    volatile unsigned long controlEventReceived[CONTROL_EVENT_COUNT] = {};
+    LatencyStats controlLatency[CONTROL_EVENT_COUNT];
+    ClockSync clockSync;
+    mutable portMUX_TYPE clockSyncMux = portMUX_INITIALIZER_UNLOCKED;
+    LatencyStats roundTripLatency;
+    LatencyStats sensorLatency;
+    LatencyStats notifyLatency[BLE_LINK_MODE_COUNT];
+    unsigned long lastControl = 0;
+    // Written by the BLE task, each report replaces the previous one of the same task
+    TaskDiagnostics taskDiagnostics[TASK_DIAGNOSTICS_MAX_TASKS];
+    uint8_t taskDiagnosticsCount = 0;
+    mutable portMUX_TYPE taskDiagnosticsMux = portMUX_INITIALIZER_UNLOCKED;
+
+    ProcessSlot processes[MAX_PROCESSES];
+    SeqLock<MachineState> state;
+    uint32_t stateVersion = 0;
+    SeqLock<ControlState> control;
+    ControlState publishedControl; // loop task only, the last state written to control
 
     unsigned long grindActiveUntil = 0;
     unsigned long lastPing = 0;
     unsigned long lastProgress = 0;
     unsigned long lastAction = 0;
+    unsigned long wifiStarted = 0;
+    bool wifiPending = false;
+    bool bleConnecting = false;
+    bool bootReported = false;
     bool loaded = false;
     bool updating = false;
     bool autotuning = false;
@@ -131,10 +315,9 @@ class Controller {
     bool initialized = false;
     bool screenReady = false;
     bool volumetricOverride = false;
-    bool processCompleted = false;
     int error = 0;
 
-    xTaskHandle taskHandle;
+    xTaskHandle taskHandle = nullptr;
     static void loopTask(void *arg);
 };
 
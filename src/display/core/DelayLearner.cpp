@@ -0,0 +1,75 @@
+#include "DelayLearner.h"
+
+double DelayLearner::getDelay(const char *profileId, double fallback) {
+    const LearnedDelay learned = get(profileId);
+    return learned.samples > 0 ? learned.mean : fallback;
+}
+
+LearnedDelay DelayLearner::get(const char *profileId) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return load(profileId);
+}
+
+bool DelayLearner::addSample(const char *profileId, double delay, double fallback) {
+    std::lock_guard<std::mutex> lock(mutex);
+    LearnedDelay learned = load(profileId);
+    if (learned.samples == 0) {
+        // Start from the global delay so the first shot of a new profile does not replace it outright
+        learned.mean = static_cast<float>(fallback);
+        learned.samples = 1;
+    }
+    if (learned.isOutlier(delay)) {
+        ESP_LOGW("DelayLearner", "Ignoring delay %.0fms for profile %s, learned %.0fms ± %.0fms", delay, profileId, learned.mean,
+                 sqrtf(learned.variance));
+        return false;
+    }
+    learned.update(delay);
+    ESP_LOGI("DelayLearner", "Learned delay for profile %s: %.0fms ± %.0fms after %d shots", profileId, learned.mean,
+             sqrtf(learned.variance), learned.samples);
+    store(profileId, learned);
+    return true;
+}
+
+void DelayLearner::reset(const char *profileId) {
+    std::lock_guard<std::mutex> lock(mutex);
+    preferences.begin(DELAY_LEARNER_PREFERENCES_KEY, false);
+    preferences.remove(key(profileId).c_str());
+    preferences.end();
+    ESP_LOGI("DelayLearner", "Reset learned delay for profile %s", profileId);
+}
+
+void DelayLearner::resetAll() {
+    std::lock_guard<std::mutex> lock(mutex);
+    preferences.begin(DELAY_LEARNER_PREFERENCES_KEY, false);
+    preferences.clear();
+    preferences.end();
+    ESP_LOGI("DelayLearner", "Reset learned delays of all profiles");
+}
+
+LearnedDelay DelayLearner::load(const char *profileId) {
+    LearnedDelay learned{};
+    preferences.begin(DELAY_LEARNER_PREFERENCES_KEY, true);
+    const String k = key(profileId);
+    if (preferences.isKey(k.c_str()) && preferences.getBytesLength(k.c_str()) == sizeof(LearnedDelay)) {
+        preferences.getBytes(k.c_str(), &learned, sizeof(LearnedDelay));
+    }
+    preferences.end();
+    return learned;
+}
+
+void DelayLearner::store(const char *profileId, const LearnedDelay &learned) {
+    preferences.begin(DELAY_LEARNER_PREFERENCES_KEY, false);
+    preferences.putBytes(key(profileId).c_str(), &learned, sizeof(LearnedDelay));
+    preferences.end();
+}
+
+String DelayLearner::key(const char *profileId) {
+    // Preference keys are limited to 15 characters, so profile ids are hashed (FNV-1a)
+    uint32_t hash = 2166136261u;
+    for (const char *c = profileId; *c != '\0'; c++) {
+        hash = (hash ^ static_cast<uint8_t>(*c)) * 16777619u;
+    }
+    char k[12];
+    snprintf(k, sizeof(k), "d_%08x", hash);
+    return String(k);
+}
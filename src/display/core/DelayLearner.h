@@ -0,0 +1,67 @@
+#ifndef DELAYLEARNER_H
+#define DELAYLEARNER_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <algorithm>
+#include <mutex>
+
+#define DELAY_LEARNER_PREFERENCES_KEY "delays"
+
+constexpr double DELAY_LEARNER_FORGETTING = 0.2;     // Weight of a new sample once enough shots have been learned
+constexpr double DELAY_LEARNER_OUTLIER_SIGMA = 3.0;  // Samples further than this many deviations from the mean are ignored
+constexpr double DELAY_LEARNER_MIN_DEVIATION = 75.0; // ms, keeps the outlier band open while the variance is still tiny
+constexpr uint16_t DELAY_LEARNER_MIN_SAMPLES = 3;    // Samples needed before outliers are rejected
+
+// Exponentially weighted mean and variance of the stop delay learned for one profile
+struct LearnedDelay {
+    float mean = 0.0f;
+    float variance = 0.0f;
+    uint16_t samples = 0;
+
+    bool isOutlier(double delay) const {
+        if (samples < DELAY_LEARNER_MIN_SAMPLES) {
+            return false;
+        }
+        const double deviation = std::max(static_cast<double>(sqrtf(variance)), DELAY_LEARNER_MIN_DEVIATION);
+        return fabs(delay - mean) > DELAY_LEARNER_OUTLIER_SIGMA * deviation;
+    }
+
+    void update(double delay) {
+        // Plain average for the first shots, then exponential forgetting so the delay follows grind and bean changes
+        const double alpha = std::max(1.0 / (samples + 1), DELAY_LEARNER_FORGETTING);
+        const double diff = delay - mean;
+        mean = static_cast<float>(mean + alpha * diff);
+        variance = static_cast<float>((1.0 - alpha) * (variance + alpha * diff * diff));
+        if (samples < UINT16_MAX) {
+            samples++;
+        }
+    }
+};
+
+// Stores the learned stop delay of every profile in its own preferences namespace. Shots learn on the loop task while
+// the web UI reads and resets from the web server task, so every access holds the lock.
+class DelayLearner {
+  public:
+    // Returns the learned delay of the profile or the fallback if nothing has been learned yet
+    double getDelay(const char *profileId, double fallback);
+    // Everything learned for the profile, samples is 0 if nothing has been learned yet
+    LearnedDelay get(const char *profileId);
+
+    // Adds the delay measured after a shot, returns false if it was rejected as an outlier
+    bool addSample(const char *profileId, double delay, double fallback);
+
+    void reset(const char *profileId);
+    // Forgets the delays of all profiles, they depend on the scale that measured them
+    void resetAll();
+
+  private:
+    Preferences preferences;
+    std::mutex mutex;
+
+    LearnedDelay load(const char *profileId);
+    void store(const char *profileId, const LearnedDelay &learned);
+    static String key(const char *profileId);
+};
+
+#endif // DELAYLEARNER_H
@@ -1,65 +1,84 @@
 #ifndef EVENT_H
 #define EVENT_H
 
+#ifdef ARDUINO
 #include <Arduino.h>
-#include <vector>
+#endif
+#include "EventId.h"
+#include <cstring>
+
+constexpr uint8_t EVENT_MAX_ENTRIES = 4;
 
 enum class EventDataType { EVENT_TYPE_INT, EVENT_TYPE_FLOAT, EVENT_TYPE_STRING, EVENT_TYPE_NONE };
 
+// Keys are string literals. String values are not copied, they point to the caller's data and are only valid while
+// the event is dispatched.
 struct EventDataEntry {
-    String key;
+    const char *key = "";
     EventDataType type = EventDataType::EVENT_TYPE_NONE;
-    int intValue = 0;
-    float floatValue = 0.0f;
-    String stringValue = "";
+    union {
+        int intValue;
+        float floatValue;
+        const char *stringValue;
+    };
 
-    EventDataEntry() = default;
+    EventDataEntry() : intValue(0) {}
 
-    EventDataEntry(const String &k, int value) : key(k), type(EventDataType::EVENT_TYPE_INT), intValue(value) {}
+    EventDataEntry(const char *k, int value) : key(k), type(EventDataType::EVENT_TYPE_INT), intValue(value) {}
 
-    EventDataEntry(const String &k, float value) : key(k), type(EventDataType::EVENT_TYPE_FLOAT), floatValue(value) {}
+    EventDataEntry(const char *k, float value) : key(k), type(EventDataType::EVENT_TYPE_FLOAT), floatValue(value) {}
 
-    EventDataEntry(const String &k, const String &value) : key(k), type(EventDataType::EVENT_TYPE_STRING), stringValue(value) {}
+    EventDataEntry(const char *k, const char *value) : key(k), type(EventDataType::EVENT_TYPE_STRING), stringValue(value) {}
 };
 
-using EventData = std::vector<EventDataEntry>;
-
+// Fixed size so triggering an event never allocates, entries beyond EVENT_MAX_ENTRIES are dropped
 struct Event {
-    String id;
-    EventData data;
+    EventId id = EventId::EVENT_COUNT;
+    EventDataEntry data[EVENT_MAX_ENTRIES];
+    uint8_t size = 0;
     bool stopPropagation = false;
 
-    void setInt(const String &key, int value) { data.emplace_back(key, value); }
+    void setInt(const char *key, int value) { add(EventDataEntry(key, value)); }
 
-    void setFloat(const String &key, float value) { data.emplace_back(key, value); }
+    void setFloat(const char *key, float value) { add(EventDataEntry(key, value)); }
 
-    void setString(const String &key, const String &value) { data.emplace_back(key, value); }
+    void setString(const char *key, const char *value) { add(EventDataEntry(key, value)); }
 
-    int getInt(const String &key) const {
-        for (const auto &entry : data) {
-            if (entry.key == key && entry.type == EventDataType::EVENT_TYPE_INT) {
-                return entry.intValue;
-            }
-        }
-        return 0;
+#ifdef ARDUINO
+    void setString(const char *key, const String &value) { setString(key, value.c_str()); }
+    // The event would point into a temporary
+    void setString(const char *key, String &&value) = delete;
+#endif
+
+    int getInt(const char *key) const {
+        const EventDataEntry *entry = find(key, EventDataType::EVENT_TYPE_INT);
+        return entry != nullptr ? entry->intValue : 0;
     }
 
-    float getFloat(const String &key) const {
-        for (const auto &entry : data) {
-            if (entry.key == key && entry.type == EventDataType::EVENT_TYPE_FLOAT) {
-                return entry.floatValue;
-            }
+    float getFloat(const char *key) const {
+        const EventDataEntry *entry = find(key, EventDataType::EVENT_TYPE_FLOAT);
+        return entry != nullptr ? entry->floatValue : 0.0f;
+    }
+
+    const char *getString(const char *key) const {
+        const EventDataEntry *entry = find(key, EventDataType::EVENT_TYPE_STRING);
+        return entry != nullptr ? entry->stringValue : "";
+    }
+
+  private:
+    void add(const EventDataEntry &entry) {
+        if (size < EVENT_MAX_ENTRIES) {
+            data[size++] = entry;
         }
-        return 0.0f;
     }
 
-    String getString(const String &key) const {
-        for (const auto &entry : data) {
-            if (entry.key == key && entry.type == EventDataType::EVENT_TYPE_STRING) {
-                return entry.stringValue;
+    const EventDataEntry *find(const char *key, EventDataType type) const {
+        for (uint8_t i = 0; i < size; i++) {
+            if (data[i].type == type && strcmp(data[i].key, key) == 0) {
+                return &data[i];
             }
         }
-        return "";
+        return nullptr;
     }
 };
 
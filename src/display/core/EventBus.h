@@ -0,0 +1,34 @@
+#ifndef EVENTBUS_H
+#define EVENTBUS_H
+
+#include "Event.h"
+#include <functional>
+#include <vector>
+
+using EventCallback = std::function<void(Event &)>;
+
+// Listener table indexed by event id. Registering a listener allocates, dispatching does not.
+class EventBus {
+  public:
+    void on(EventId id, const EventCallback &callback) {
+        if (id < EventId::EVENT_COUNT) {
+            listeners[static_cast<uint8_t>(id)].push_back(callback);
+        }
+    }
+
+    void dispatch(Event &event) const {
+        if (event.id >= EventId::EVENT_COUNT)
+            return;
+        for (const auto &callback : listeners[static_cast<uint8_t>(event.id)]) {
+            callback(event);
+            if (event.stopPropagation) {
+                break;
+            }
+        }
+    }
+
+  private:
+    std::vector<EventCallback> listeners[EVENT_ID_COUNT];
+};
+
+#endif // EVENTBUS_H
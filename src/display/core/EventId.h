@@ -0,0 +1,129 @@
+#ifndef EVENTID_H
+#define EVENTID_H
+
+#include <cstdint>
+
+// Every event the plugin manager dispatches. The ids index the listener table, add new events before EVENT_COUNT
+// and give them a name below for logging and the profiler.
+enum class EventId : uint8_t {
+    CONTROLLER_STARTUP,
+    CONTROLLER_READY,
+    CONTROLLER_ERROR,
+    CONTROLLER_WIFI_CONNECT,
+    CONTROLLER_BLUETOOTH_INIT,
+    CONTROLLER_BLUETOOTH_CONNECT,
+    CONTROLLER_MODE_CHANGE,
+    CONTROLLER_AUTOTUNE_START,
+    CONTROLLER_AUTOTUNE_RESULT,
+    CONTROLLER_PROCESS_START,
+    CONTROLLER_PROCESS_END,
+    CONTROLLER_PROCESS_CONFLICT,
+    CONTROLLER_BREW_START,
+    CONTROLLER_BREW_END,
+    CONTROLLER_BREW_CLEAR,
+    CONTROLLER_GRIND_START,
+    CONTROLLER_GRIND_END,
+    CONTROLLER_TARGET_DURATION_CHANGE,
+    CONTROLLER_TARGET_VOLUME_CHANGE,
+    CONTROLLER_GRIND_DURATION_CHANGE,
+    CONTROLLER_GRIND_VOLUME_CHANGE,
+    BOILER_CURRENT_TEMPERATURE_CHANGE,
+    BOILER_TARGET_TEMPERATURE_CHANGE,
+    BOILER_PRESSURE_CHANGE,
+    PUMP_FLOW_CHANGE,
+    PROFILES_PROFILE_SAVE,
+    PROFILES_PROFILE_SELECT,
+    ROUTINES_ROUTINE_START,
+    ROUTINES_ROUTINE_END,
+    ROUTINES_ROUTINE_SAVE,
+    ROUTINES_STEP_CHANGE,
+    OTA_UPDATE_START,
+    OTA_UPDATE_END,
+    OTA_UPDATE_STATUS,
+    OTA_UPDATE_PROGRESS,
+    OTA_UPDATE_PHASE,
+    EVENT_COUNT
+};
+
+constexpr uint8_t EVENT_ID_COUNT = static_cast<uint8_t>(EventId::EVENT_COUNT);
+
+inline const char *getEventName(EventId id) {
+    switch (id) {
+    case EventId::CONTROLLER_STARTUP:
+        return "controller:startup";
+    case EventId::CONTROLLER_READY:
+        return "controller:ready";
+    case EventId::CONTROLLER_ERROR:
+        return "controller:error";
+    case EventId::CONTROLLER_WIFI_CONNECT:
+        return "controller:wifi:connect";
+    case EventId::CONTROLLER_BLUETOOTH_INIT:
+        return "controller:bluetooth:init";
+    case EventId::CONTROLLER_BLUETOOTH_CONNECT:
+        return "controller:bluetooth:connect";
+    case EventId::CONTROLLER_MODE_CHANGE:
+        return "controller:mode:change";
+    case EventId::CONTROLLER_AUTOTUNE_START:
+        return "controller:autotune:start";
+    case EventId::CONTROLLER_AUTOTUNE_RESULT:
+        return "controller:autotune:result";
+    case EventId::CONTROLLER_PROCESS_START:
+        return "controller:process:start";
+    case EventId::CONTROLLER_PROCESS_END:
+        return "controller:process:end";
+    case EventId::CONTROLLER_PROCESS_CONFLICT:
+        return "controller:process:conflict";
+    case EventId::CONTROLLER_BREW_START:
+        return "controller:brew:start";
+    case EventId::CONTROLLER_BREW_END:
+        return "controller:brew:end";
+    case EventId::CONTROLLER_BREW_CLEAR:
+        return "controller:brew:clear";
+    case EventId::CONTROLLER_GRIND_START:
+        return "controller:grind:start";
+    case EventId::CONTROLLER_GRIND_END:
+        return "controller:grind:end";
+    case EventId::CONTROLLER_TARGET_DURATION_CHANGE:
+        return "controller:targetDuration:change";
+    case EventId::CONTROLLER_TARGET_VOLUME_CHANGE:
+        return "controller:targetVolume:change";
+    case EventId::CONTROLLER_GRIND_DURATION_CHANGE:
+        return "controller:grindDuration:change";
+    case EventId::CONTROLLER_GRIND_VOLUME_CHANGE:
+        return "controller:grindVolume:change";
+    case EventId::BOILER_CURRENT_TEMPERATURE_CHANGE:
+        return "boiler:currentTemperature:change";
+    case EventId::BOILER_TARGET_TEMPERATURE_CHANGE:
+        return "boiler:targetTemperature:change";
+    case EventId::BOILER_PRESSURE_CHANGE:
+        return "boiler:pressure:change";
+    case EventId::PUMP_FLOW_CHANGE:
+        return "pump:flow:change";
+    case EventId::PROFILES_PROFILE_SAVE:
+        return "profiles:profile:save";
+    case EventId::PROFILES_PROFILE_SELECT:
+        return "profiles:profile:select";
+    case EventId::ROUTINES_ROUTINE_START:
+        return "routines:routine:start";
+    case EventId::ROUTINES_ROUTINE_END:
+        return "routines:routine:end";
+    case EventId::ROUTINES_ROUTINE_SAVE:
+        return "routines:routine:save";
+    case EventId::ROUTINES_STEP_CHANGE:
+        return "routines:step:change";
+    case EventId::OTA_UPDATE_START:
+        return "ota:update:start";
+    case EventId::OTA_UPDATE_END:
+        return "ota:update:end";
+    case EventId::OTA_UPDATE_STATUS:
+        return "ota:update:status";
+    case EventId::OTA_UPDATE_PROGRESS:
+        return "ota:update:progress";
+    case EventId::OTA_UPDATE_PHASE:
+        return "ota:update:phase";
+    default:
+        return "unknown";
+    }
+}
+
+#endif // EVENTID_H
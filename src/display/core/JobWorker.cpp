@@ -0,0 +1,98 @@
+#include "JobWorker.h"
+#include <algorithm>
+
+void JobWorker::setup() {
+    pending = xQueueCreate(JOB_QUEUE_LENGTH, sizeof(Job *));
+    completed = xQueueCreate(JOB_QUEUE_LENGTH, sizeof(Job *));
+    xTaskCreate(loopTask, "JobWorker::loop", configMINIMAL_STACK_SIZE * 8, this, 1, &taskHandle);
+}
+
+bool JobWorker::post(const char *name, const job_work_t &work, const job_done_t &done, unsigned long delay,
+                     unsigned long timeout, bool expires) {
+    auto *job = new Job{name, work, done, millis() + delay, timeout, expires, false};
+    if (pending == nullptr || xQueueSend(pending, &job, 0) != pdTRUE) {
+        ESP_LOGW("JobWorker", "Job queue full, dropping %s", name);
+        delete job;
+        return false;
+    }
+    return true;
+}
+
+void JobWorker::loop() {
+    Job *job = nullptr;
+    while (completed != nullptr && xQueueReceive(completed, &job, 0) == pdTRUE) {
+        if (job->done != nullptr) {
+            job->done(job->success);
+        }
+        delete job;
+    }
+}
+
+void JobWorker::run(Job *job) const {
+    const unsigned long started = millis();
+    if (job->expires && started - job->notBefore > job->timeout) {
+        ESP_LOGW("JobWorker", "Job %s expired after waiting %lums", job->name, started - job->notBefore);
+        job->success = false;
+        return;
+    }
+    job->success = job->work();
+    const unsigned long duration = millis() - started;
+    if (duration > job->timeout) {
+        ESP_LOGW("JobWorker", "Job %s took %lums, more than its timeout of %lums", job->name, duration, job->timeout);
+        job->success = false;
+    }
+}
+
+void JobWorker::finish(Job *job) const {
+    if (job->done == nullptr) {
+        delete job;
+    } else if (xQueueSend(completed, &job, portMAX_DELAY) != pdTRUE) {
+        delete job;
+    }
+}
+
+// Runs every waiting job that is due, in the order they were posted
+void JobWorker::runDue() {
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < waitingCount; i++) {
+        Job *job = waiting[i];
+        if (static_cast<long>(millis() - job->notBefore) < 0) {
+            waiting[kept++] = job;
+            continue;
+        }
+        run(job);
+        finish(job);
+    }
+    waitingCount = kept;
+}
+
+// Time until the earliest waiting job is due, or forever if nothing is waiting
+TickType_t JobWorker::nextWait() const {
+    if (waitingCount == 0) {
+        return portMAX_DELAY;
+    }
+    const unsigned long now = millis();
+    long earliest = static_cast<long>(waiting[0]->notBefore - now);
+    for (uint8_t i = 1; i < waitingCount; i++) {
+        earliest = std::min(earliest, static_cast<long>(waiting[i]->notBefore - now));
+    }
+    return earliest > 0 ? pdMS_TO_TICKS(earliest) : 0;
+}
+
+void JobWorker::loopTask(void *arg) {
+    auto *worker = static_cast<JobWorker *>(arg);
+    Job *job = nullptr;
+    while (true) {
+        const TickType_t wait = worker->nextWait();
+        if (worker->waitingCount == JOB_QUEUE_LENGTH) {
+            // Every slot holds a delayed job, new ones stay in the queue until one of them ran
+            vTaskDelay(wait);
+        } else if (xQueueReceive(worker->pending, &job, wait) == pdTRUE) {
+            worker->waiting[worker->waitingCount++] = job;
+            while (worker->waitingCount < JOB_QUEUE_LENGTH && xQueueReceive(worker->pending, &job, 0) == pdTRUE) {
+                worker->waiting[worker->waitingCount++] = job;
+            }
+        }
+        worker->runDue();
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef JOBWORKER_H
+#define JOBWORKER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include <functional>
+
+constexpr uint8_t JOB_QUEUE_LENGTH = 8;
+constexpr unsigned long JOB_DEFAULT_TIMEOUT_MS = 5000;
+
+using job_work_t = std::function<bool()>;
+using job_done_t = std::function<void(bool success)>;
+
+struct Job {
+    const char *name = "";
+    job_work_t work = nullptr;
+    job_done_t done = nullptr;
+    unsigned long notBefore = 0; // millis() before which the job is not started, other jobs run in the meantime
+    unsigned long timeout = 0;   // ms from notBefore until the job has to be finished
+    bool expires = true;         // false for jobs that have to run however late they are, like switching something off
+    bool success = false;
+};
+
+// Runs blocking plugin I/O like HTTP requests or reconnects on its own task so the controller loop never waits on
+// the network. Jobs run one at a time in the order they were posted once their notBefore time passed. A job that can't
+// start before its timeout is dropped unless it doesn't expire, a job that runs past it is reported as failed; the work
+// itself has to bound its I/O with the same timeout. Completion callbacks are delivered from loop() on the task that
+// calls it.
+class JobWorker {
+  public:
+    void setup();
+    void loop();
+
+    // Returns false if the queue is full, the done callback is not called in that case
+    bool post(const char *name, const job_work_t &work, const job_done_t &done = nullptr, unsigned long delay = 0,
+              unsigned long timeout = JOB_DEFAULT_TIMEOUT_MS, bool expires = true);
+
+  private:
+    void run(Job *job) const;
+    void finish(Job *job) const;
+    void runDue();
+    TickType_t nextWait() const;
+
+    // Jobs taken from the queue whose notBefore time hasn't passed yet, only touched by the worker task
+    Job *waiting[JOB_QUEUE_LENGTH] = {};
+    uint8_t waitingCount = 0;
+    QueueHandle_t pending = nullptr;
+    QueueHandle_t completed = nullptr;
+    xTaskHandle taskHandle = nullptr;
+
+    static void loopTask(void *arg);
+};
+
+#endif // JOBWORKER_H
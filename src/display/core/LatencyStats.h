@@ -0,0 +1,35 @@
+#ifndef LATENCYSTATS_H
+#define LATENCYSTATS_H
+
+#include <cstdint>
+
+constexpr uint8_t LATENCY_HISTOGRAM_BUCKETS = 20; // bucket i counts latencies below 2^i us, the last one the rest
+
+// Running latency statistics in microseconds, cheap enough to update from a control loop
+struct LatencyStats {
+    uint32_t count = 0;
+    uint32_t last = 0;
+    uint32_t max = 0;
+    uint64_t total = 0;
+    uint32_t histogram[LATENCY_HISTOGRAM_BUCKETS] = {};
+
+    void add(uint32_t latency) {
+        count++;
+        last = latency;
+        total += latency;
+        if (latency > max) {
+            max = latency;
+        }
+        uint8_t bucket = 0;
+        while (bucket < LATENCY_HISTOGRAM_BUCKETS - 1 && latency >= (1u << bucket)) {
+            bucket++;
+        }
+        histogram[bucket]++;
+    }
+
+    uint32_t average() const { return count > 0 ? static_cast<uint32_t>(total / count) : 0; }
+
+    void reset() { *this = LatencyStats{}; }
+};
+
+#endif // LATENCYSTATS_H
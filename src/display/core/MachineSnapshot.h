@@ -0,0 +1,95 @@
+#ifndef MACHINESNAPSHOT_H
+#define MACHINESNAPSHOT_H
+
+#include "CompiledProfile.h"
+#include <atomic>
+#include <cstdint>
+
+constexpr uint8_t SNAPSHOT_MAX_PROCESSES = 3;
+
+struct ProcessSnapshot {
+    int type = 0;
+    bool active = false;
+    uint8_t resources = 0;
+};
+
+// Everything the status screen shows about the current or last brew, copied so readers never touch the process
+struct BrewSnapshot {
+    bool valid = false;
+    bool active = false;
+    bool volumetric = false;
+    bool advancedPump = false;
+    PhaseType phaseType = PhaseType::PHASE_TYPE_BREW;
+    char phaseName[COMPILED_PHASE_NAME_LENGTH] = {};
+    unsigned long processStarted = 0;
+    unsigned long phaseStarted = 0;
+    unsigned long finished = 0;
+    unsigned long phaseDuration = 0; // ms
+    unsigned long totalDuration = 0; // ms
+    float phaseVolumetricTarget = 0.0f;
+    float brewVolume = 0.0f;
+    float currentVolume = 0.0f;
+    float targetPressure = 0.0f;
+};
+
+struct RoutineSnapshot {
+    bool running = false;
+    bool waiting = false; // waiting for the machine to be ready before the next step
+    uint8_t step = 0;
+    char id[COMPILED_PROFILE_ID_LENGTH] = {};
+    char label[COMPILED_PROFILE_LABEL_LENGTH] = {};
+};
+
+// Consistent view of the machine state, published by the controller loop and read by the UI, web and plugins
+struct MachineState {
+    uint32_t version = 0;
+    int mode = 0;
+    int currentTemp = 0;
+    int targetTemp = 0;
+    int targetDuration = 0; // ms
+    char profileLabel[COMPILED_PROFILE_LABEL_LENGTH] = {}; // selected profile
+    float pressure = 0.0f;
+    float targetPressure = 0.0f;
+    float flow = 0.0f;
+    bool active = false;
+    bool grindActive = false;
+    bool autotuning = false;
+    bool connected = false;
+    int error = 0;
+    uint8_t processCount = 0;
+    ProcessSnapshot processes[SNAPSHOT_MAX_PROCESSES];
+    BrewSnapshot brew;
+    RoutineSnapshot routine;
+};
+
+// Single writer sequence lock. The writer makes the sequence odd while it copies, readers retry until they saw the
+// same even sequence before and after their copy. Readers never block the writer and never see a torn state.
+template <typename T> class SeqLock {
+  public:
+    void write(const T &value) {
+        const uint32_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        data = value;
+        std::atomic_thread_fence(std::memory_order_release);
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    T read() const {
+        T copy;
+        uint32_t before, after;
+        do {
+            before = sequence.load(std::memory_order_acquire);
+            copy = data;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+        return copy;
+    }
+
+  private:
+    std::atomic<uint32_t> sequence{0};
+    T data{};
+};
+
+#endif // MACHINESNAPSHOT_H
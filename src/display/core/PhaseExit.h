@@ -0,0 +1,83 @@
+#ifndef PHASEEXIT_H
+#define PHASEEXIT_H
+
+#include <ProfileProgram.h>
+#include <display/models/profile.h>
+
+constexpr uint8_t PHASE_EXIT_MAX_CONDITIONS = 6;
+constexpr uint8_t PHASE_EXIT_INPUT_COUNT = 4; // One slot per TargetType
+
+// Live values the exit conditions of a phase are compared against, indexed by TargetType.
+// Time is the elapsed phase time in seconds, volumetric is the predicted final weight.
+struct PhaseExitInputs {
+    float values[PHASE_EXIT_INPUT_COUNT] = {};
+
+    void set(TargetType type, float value) { values[static_cast<uint8_t>(type)] = value; }
+};
+
+// Exit conditions of a single phase, compiled into parallel arrays once when the process starts.
+// The phase is finished as soon as any of the conditions is met.
+struct PhaseExit {
+    uint8_t count = 0;
+    uint8_t typeMask = 0;
+    uint8_t types[PHASE_EXIT_MAX_CONDITIONS] = {};
+    uint8_t operators[PHASE_EXIT_MAX_CONDITIONS] = {};
+    float values[PHASE_EXIT_MAX_CONDITIONS] = {};
+
+    bool has(TargetType type) const { return typeMask & (1 << static_cast<uint8_t>(type)); }
+
+    bool add(TargetType type, TargetOperator op, float value) {
+        if (count >= PHASE_EXIT_MAX_CONDITIONS) {
+            return false;
+        }
+        types[count] = static_cast<uint8_t>(type);
+        operators[count] = static_cast<uint8_t>(op);
+        values[count] = value;
+        typeMask |= 1 << static_cast<uint8_t>(type);
+        count++;
+        return true;
+    }
+
+    // Only conditions whose type is in typeFilter are checked, by default all of them
+    bool isMet(const PhaseExitInputs &inputs, uint8_t typeFilter = 0xFF) const {
+        for (uint8_t i = 0; i < count; i++) {
+            if (!(typeFilter & (1 << types[i]))) {
+                continue;
+            }
+            const bool lte = operators[i] == static_cast<uint8_t>(TargetOperator::OPERATOR_LTE);
+            if (isExitMet(lte, inputs.values[types[i]], values[i])) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// Volumetric targets only apply to volumetric processes. A phase with an active volumetric target
+// ignores its duration, everything else ends on the duration as a time condition.
+inline PhaseExit compilePhaseExit(const Phase &phase, bool volumetric) {
+    PhaseExit exit{};
+    const bool volumetricExit = volumetric && phase.hasVolumetricTarget();
+    if (!volumetricExit) {
+        exit.add(TargetType::TARGET_TYPE_TIME, TargetOperator::OPERATOR_GTE, phase.duration);
+    } else if (phase.timeExitFolded) {
+        ESP_LOGW("PhaseExit", "Phase %s has a time exit folded into its duration, volumetric shots ignore it",
+                 phase.name.c_str());
+    }
+    for (const auto &target : phase.targets) {
+        if (target.type == TargetType::TARGET_TYPE_TIME) {
+            continue; // the duration is the time condition
+        }
+        if (target.type == TargetType::TARGET_TYPE_VOLUMETRIC && (!volumetricExit || target.value <= 0.0f)) {
+            continue;
+        }
+        if (!exit.add(target.type, target.op, target.value)) {
+            ESP_LOGW("PhaseExit", "Phase %s has more than %d exit conditions, ignoring the rest", phase.name.c_str(),
+                     PHASE_EXIT_MAX_CONDITIONS);
+            break;
+        }
+    }
+    return exit;
+}
+
+#endif // PHASEEXIT_H
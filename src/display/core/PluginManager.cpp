@@ -1,12 +1,13 @@
 #include "PluginManager.h"
+#include "Trace.h"
 
-void PluginManager::registerPlugin(Plugin *plugin) { plugins.push_back(plugin); }
+void PluginManager::registerPlugin(Plugin *plugin, const char *name) {
+    plugins.push_back(plugin);
+    pluginZones.push_back(PROFILER_ENABLED ? Profiler::getZone(std::string("plugin:") + name) : nullptr);
+}
 
 void PluginManager::setup(Controller *controller) {
     ESP_LOGV("PluginManager", "Setting up PluginManager");
-    on("system:dummy", [](const Event &) {
-        // Register a dummy event so the event map is initialized properly
-    });
     for (const auto &plugin : plugins) {
         plugin->setup(controller, this);
     }
@@ -16,55 +17,120 @@ void PluginManager::setup(Controller *controller) {
 void PluginManager::loop() {
     if (!initialized)
         return;
-    for (auto &plugin : plugins) {
-        plugin->loop();
+    for (size_t i = 0; i < plugins.size(); i++) {
+        PROFILE_ZONE_SCOPE(pluginZones[i]);
+        plugins[i]->loop();
     }
+    deliverLatest();
+}
+
+void PluginManager::on(EventId id, const EventCallback &callback) {
+    ESP_LOGV("PluginManager", "Registering listener: %s", getEventName(id));
+    bus.on(id, callback);
 }
 
-void PluginManager::on(const String &eventId, const EventCallback &callback) {
-    ESP_LOGV("PluginManager", "Registering listener: %s", eventId.c_str());
-    listeners[std::string(eventId.c_str())].push_back(callback);
+void PluginManager::onLatest(EventId id, const EventCallback &callback, unsigned long interval) {
+    if (id >= EventId::EVENT_COUNT)
+        return;
+    ESP_LOGV("PluginManager", "Registering latest value listener: %s", getEventName(id));
+    LatestSlot *&slot = latestSlots[static_cast<uint8_t>(id)];
+    if (slot == nullptr) {
+        slot = new LatestSlot();
+    }
+    latestListeners.push_back(LatestListener{id, callback, interval});
 }
 
-Event PluginManager::trigger(const String &eventId) {
+Event PluginManager::trigger(EventId id) {
     Event event;
-    event.id = eventId;
+    event.id = id;
     trigger(event);
     return event;
 }
 
-Event PluginManager::trigger(const String &eventId, const String &key, const String &value) {
+Event PluginManager::trigger(EventId id, const char *key, const char *value) {
     Event event;
-    event.id = eventId;
+    event.id = id;
     event.setString(key, value);
     trigger(event);
     return event;
 }
 
-Event PluginManager::trigger(const String &eventId, const String &key, const int value) {
+Event PluginManager::trigger(EventId id, const char *key, const String &value) { return trigger(id, key, value.c_str()); }
+
+Event PluginManager::trigger(EventId id, const char *key, const int value) {
     Event event;
-    event.id = eventId;
+    event.id = id;
     event.setInt(key, value);
     trigger(event);
     return event;
 }
 
-Event PluginManager::trigger(const String &eventId, const String &key, const float value) {
+Event PluginManager::trigger(EventId id, const char *key, const float value) {
     Event event;
-    event.id = eventId;
+    event.id = id;
     event.setFloat(key, value);
     trigger(event);
     return event;
 }
 
 void PluginManager::trigger(Event &event) {
-    ESP_LOGV("PluginManager", "Triggering event: %s", event.id.c_str());
-    if (listeners.count(std::string(event.id.c_str()))) {
-        for (auto const &callback : listeners[std::string(event.id.c_str())]) {
-            callback(event);
-            if (event.stopPropagation) {
-                break;
-            }
+    ESP_LOGV("PluginManager", "Triggering event: %s", getEventName(event.id));
+    PROFILE_ZONE_SCOPE(getEventZone(event.id));
+    TRACE_SCOPE("event", getEventName(event.id));
+    bus.dispatch(event);
+    if (!event.stopPropagation) {
+        storeLatest(event);
+    }
+}
+
+void PluginManager::storeLatest(const Event &event) {
+    if (event.id >= EventId::EVENT_COUNT)
+        return;
+    LatestSlot *slot = latestSlots[static_cast<uint8_t>(event.id)];
+    if (slot == nullptr)
+        return;
+    Event latest = event;
+    // String values point to the caller's data and don't outlive the trigger
+    for (uint8_t i = 0; i < latest.size; i++) {
+        if (latest.data[i].type == EventDataType::EVENT_TYPE_STRING) {
+            latest.data[i].stringValue = "";
+        }
+    }
+    portENTER_CRITICAL(&slot->mux);
+    slot->event = latest;
+    slot->version++;
+    portEXIT_CRITICAL(&slot->mux);
+}
+
+void PluginManager::deliverLatest() {
+    const unsigned long now = millis();
+    for (auto &listener : latestListeners) {
+        if (listener.lastDelivered != 0 && now - listener.lastDelivered < listener.interval)
+            continue;
+        LatestSlot *slot = latestSlots[static_cast<uint8_t>(listener.id)];
+        Event event;
+        bool changed = false;
+        portENTER_CRITICAL(&slot->mux);
+        if (slot->version != listener.seen) {
+            event = slot->event;
+            listener.seen = slot->version;
+            changed = true;
         }
+        portEXIT_CRITICAL(&slot->mux);
+        if (changed) {
+            TRACE_SCOPE("latest", getEventName(listener.id));
+            listener.lastDelivered = now;
+            listener.callback(event);
+        }
+    }
+}
+
+ProfileZone *PluginManager::getEventZone(EventId id) {
+    if (!PROFILER_ENABLED || id >= EventId::EVENT_COUNT)
+        return nullptr;
+    ProfileZone *&zone = eventZones[static_cast<uint8_t>(id)];
+    if (zone == nullptr) {
+        zone = Profiler::getZone(std::string("event:") + getEventName(id));
     }
+    return zone;
 }
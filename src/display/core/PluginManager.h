@@ -1,35 +1,62 @@
 #ifndef PLUGINMANAGER_H
 #define PLUGINMANAGER_H
 #include "Event.h"
+#include "EventBus.h"
 #include "Plugin.h"
+#include "Profiler.h"
 
-#include <functional>
-#include <map>
-#include <string>
 #include <vector>
 
-using EventCallback = std::function<void(Event &)>;
-
 class Controller;
 class PluginManager {
   public:
-    void registerPlugin(Plugin *plugin);
+    // The name labels the plugin's loop in the profiler
+    void registerPlugin(Plugin *plugin, const char *name = "plugin");
 
     void setup(Controller *controller);
     void loop();
 
-    void on(const String &eventId, const EventCallback &callback);
-
-    Event trigger(const String &eventId);
-    Event trigger(const String &eventId, const String &key, const String &value);
-    Event trigger(const String &eventId, const String &key, int value);
-    Event trigger(const String &eventId, const String &key, float value);
+    void on(EventId id, const EventCallback &callback);
+    // Receives only the newest value of an event, from loop() and at most every interval ms instead of on the
+    // triggering task. For consumers too slow to run inside high rate events like sensor updates, string values are
+    // not kept.
+    void onLatest(EventId id, const EventCallback &callback, unsigned long interval = 0);
+
+    // String values are passed by pointer, they are only valid in listeners and not in the returned event
+    Event trigger(EventId id);
+    Event trigger(EventId id, const char *key, const char *value);
+    Event trigger(EventId id, const char *key, const String &value);
+    Event trigger(EventId id, const char *key, int value);
+    Event trigger(EventId id, const char *key, float value);
     void trigger(Event &event);
 
   private:
+    struct LatestSlot {
+        Event event;
+        uint32_t version = 0;
+        portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+    };
+
+    struct LatestListener {
+        EventId id;
+        EventCallback callback;
+        unsigned long interval;
+        unsigned long lastDelivered = 0;
+        uint32_t seen = 0;
+    };
+
+    ProfileZone *getEventZone(EventId id);
+    void storeLatest(const Event &event);
+    void deliverLatest();
+
     bool initialized = false;
     std::vector<Plugin *> plugins;
-    std::map<std::string, std::vector<EventCallback>> listeners = {};
+    std::vector<ProfileZone *> pluginZones;
+    ProfileZone *eventZones[EVENT_ID_COUNT] = {};
+    EventBus bus;
+    // Created by onLatest() during setup, written by trigger() from any task
+    LatestSlot *latestSlots[EVENT_ID_COUNT] = {};
+    std::vector<LatestListener> latestListeners;
 };
 
 #endif // PLUGINMANAGER_H
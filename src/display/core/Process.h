@@ -1,14 +1,21 @@
 #ifndef PROCESS_H
 #define PROCESS_H
 
-#include <display/models/profile.h>
-
+#include "CompiledProfile.h"
+#include "Trace.h"
 #include "constants.h"
 #include "predictive.h"
 
 constexpr double PREDICTIVE_TIME = 4000.0; // time window for the prediction
 // constexpr double PREDICTIVE_TIME_MS = 1000.0;
 
+// Machine resources a process needs exclusive access to. Processes with disjoint resources can run at the same time.
+constexpr uint8_t PROCESS_RESOURCE_PUMP = 1 << 0;
+constexpr uint8_t PROCESS_RESOURCE_VALVE = 1 << 1;
+constexpr uint8_t PROCESS_RESOURCE_ALT_RELAY = 1 << 2;
+constexpr uint8_t PROCESS_RESOURCE_HEATER = 1 << 3; // Process decides the boiler setpoint
+constexpr uint8_t PROCESS_RESOURCE_SCALE = 1 << 4;  // Process needs a tared scale for itself
+
 class Process {
   public:
     Process() = default;
@@ -28,7 +35,12 @@ class Process {
 
     virtual int getType() = 0;
 
-    virtual void updateVolume(double volume) = 0;
+    // time is when the volume was measured, on the millis() clock
+    virtual void updateVolume(double volume, unsigned long time) = 0;
+
+    virtual void updateSensors(float pressure, float flow) = 0;
+
+    virtual uint8_t getResources() = 0;
 };
 
 enum class ProcessTarget { VOLUMETRIC, TIME };
@@ -37,67 +49,89 @@ enum class ProcessPhase { RUNNING, FINISHED };
 
 class BrewProcess : public Process {
   public:
-    Profile profile;
+    std::shared_ptr<const CompiledProfile> profile;
     ProcessTarget target;
     double brewDelay;
     unsigned int phaseIndex = 0;
-    Phase currentPhase;
+    const CompiledPhase *currentPhase;
     ProcessPhase processPhase = ProcessPhase::RUNNING;
     unsigned long processStarted = 0;
     unsigned long currentPhaseStarted = 0;
     unsigned long previousPhaseFinished = 0;
     unsigned long finished = 0;
     double currentVolume = 0; // most recent volume pushed
-    VolumetricRateCalculator *volumetricRateCalculator = nullptr;
-
-    explicit BrewProcess(Profile profile, ProcessTarget target, double brewDelay = 0.0)
-        : profile(profile), target(target), brewDelay(brewDelay),
-          volumetricRateCalculator(new VolumetricRateCalculator(PREDICTIVE_TIME)) {
-        currentPhase = profile.phases.at(phaseIndex);
+    unsigned long lastVolumeUpdate = 0;
+    unsigned long maxVolumeGap = 0; // longest time without a scale measurement since the first one
+    float currentPressure = 0.0f;
+    float currentFlow = 0.0f;
+    // Setpoints at the start of the current phase, the phase transition moves from these to the phase targets
+    float phaseStartPump = 0.0f;
+    float phaseStartPressure = 0.0f;
+    float phaseStartFlow = 0.0f;
+    std::unique_ptr<VolumePredictor> volumePredictor;
+    // Set when the controller board executes the phases itself. Phase changes then arrive through onRemoteProgress
+    // and the display only decides volumetric exits, which it requests through takeAdvanceRequest.
+    bool remote = false;
+    bool advanceRequested = false;
+    int advanceRequestPhase = -1;
+
+    explicit BrewProcess(std::shared_ptr<const CompiledProfile> profile, ProcessTarget target, double brewDelay = 0.0,
+                         VolumePredictorType predictorType = VolumePredictorType::LINEAR)
+        : profile(std::move(profile)), target(target), brewDelay(brewDelay),
+          volumePredictor(createVolumePredictor(predictorType, PREDICTIVE_TIME)) {
+        currentPhase = &this->profile->phases[phaseIndex];
         processStarted = millis();
         currentPhaseStarted = millis();
     }
 
-    void updateVolume(double volume) override { // called even after the Process is no longer active
+    void updateVolume(double volume, unsigned long time) override { // called even after the Process is no longer active
+        const long gap = static_cast<long>(time - lastVolumeUpdate); // negative for a sample older than the last one
+        if (lastVolumeUpdate != 0 && gap > static_cast<long>(maxVolumeGap)) {
+            maxVolumeGap = gap;
+        }
+        lastVolumeUpdate = time;
         currentVolume = volume;
         if (processPhase != ProcessPhase::FINISHED) { // only store measurements while active
-            volumetricRateCalculator->addMeasurement(volume);
+            volumePredictor->addMeasurement(volume, time);
         }
     }
 
-    unsigned long getTotalDuration() const { return profile.getTotalDuration() * 1000L; }
+    void updateSensors(float pressure, float flow) override {
+        currentPressure = pressure;
+        currentFlow = flow;
+    }
+
+    unsigned long getTotalDuration() const { return profile->totalDuration * 1000L; }
 
-    unsigned long getPhaseDuration() const { return static_cast<long>(currentPhase.duration) * 1000L; }
+    unsigned long getPhaseDuration() const { return static_cast<long>(currentPhase->duration) * 1000L; }
 
     bool isCurrentPhaseFinished() {
-        if (target == ProcessTarget::VOLUMETRIC && currentPhase.hasVolumetricTarget()) {
-            if (millis() - currentPhaseStarted > BREW_SAFETY_DURATION_MS) {
-                return true;
-            }
-            double currentRate = volumetricRateCalculator->getRate();
-            const double predictedAddedVolume = currentRate * brewDelay;
-            Target target = currentPhase.getVolumetricTarget();
-            return currentVolume + predictedAddedVolume >= target.value;
+        if (processPhase == ProcessPhase::FINISHED) {
+            return true;
         }
-        if (processPhase != ProcessPhase::FINISHED) {
-            return millis() - currentPhaseStarted > getPhaseDuration();
+        const unsigned long phaseTime = millis() - currentPhaseStarted;
+        if (phaseTime > BREW_SAFETY_DURATION_MS) {
+            return true;
         }
-        return true;
-    }
-
-    double getBrewVolume() const {
-        double brewVolume = 0;
-        for (const auto &phase : profile.phases) {
-            if (phase.hasVolumetricTarget()) {
-                Target target = phase.getVolumetricTarget();
-                brewVolume = target.value;
-            }
+        const PhaseExit &exit = currentPhase->getExit(target == ProcessTarget::VOLUMETRIC);
+        PhaseExitInputs inputs;
+        inputs.set(TargetType::TARGET_TYPE_TIME, static_cast<float>(phaseTime) / 1000.0f);
+        inputs.set(TargetType::TARGET_TYPE_PRESSURE, currentPressure);
+        inputs.set(TargetType::TARGET_TYPE_FLOW, currentFlow);
+        if (exit.has(TargetType::TARGET_TYPE_VOLUMETRIC)) {
+            const double predictedVolume = volumePredictor->predictVolume(millis(), brewDelay);
+            inputs.set(TargetType::TARGET_TYPE_VOLUMETRIC, static_cast<float>(predictedVolume));
+        }
+        if (remote) {
+            return exit.isMet(inputs, 1 << static_cast<uint8_t>(TargetType::TARGET_TYPE_VOLUMETRIC));
         }
-        return brewVolume;
+        return exit.isMet(inputs);
     }
 
+    double getBrewVolume() const { return profile->brewVolume; }
+
     double getNewDelayTime() const {
-        double newDelay = brewDelay + volumetricRateCalculator->getOvershootAdjustMillis(double(getBrewVolume()), currentVolume);
+        double newDelay = brewDelay + volumePredictor->getOvershootAdjustMillis(double(getBrewVolume()), currentVolume);
         if (newDelay < 0.0)
             newDelay = 0.0;
         if (newDelay > PREDICTIVE_TIME)
@@ -105,11 +139,20 @@ class BrewProcess : public Process {
         return newDelay;
     }
 
+    // A shot only teaches the stop delay if the scale reported throughout and the result did not hit the clamp
+    bool isDelaySampleValid() const {
+        if (lastVolumeUpdate == 0 || maxVolumeGap > SCALE_DROPOUT_MS || millis() - lastVolumeUpdate > SCALE_DROPOUT_MS) {
+            return false;
+        }
+        const double newDelay = getNewDelayTime();
+        return newDelay > 0.0 && newDelay < PREDICTIVE_TIME;
+    }
+
     bool isRelayActive() override {
         if (processPhase == ProcessPhase::FINISHED) {
             return false;
         }
-        return currentPhase.valve;
+        return currentPhase->valve;
     }
 
     bool isAltRelayActive() override { return false; }
@@ -118,35 +161,92 @@ class BrewProcess : public Process {
         if (processPhase == ProcessPhase::FINISHED) {
             return 0.0f;
         }
-        return currentPhase.pumpIsSimple ? currentPhase.pumpSimple : 100.0f;
+        if (!currentPhase->pumpIsSimple) {
+            return 100.0f;
+        }
+        return currentPhase->transition.interpolate(phaseStartPump, currentPhase->pumpSimple, getPhaseElapsed());
     }
 
-    bool isAdvancedPump() const { return processPhase != ProcessPhase::FINISHED && !currentPhase.pumpIsSimple; }
+    bool isAdvancedPump() const { return processPhase != ProcessPhase::FINISHED && !currentPhase->pumpIsSimple; }
+
+    bool isPressureTarget() const { return currentPhase->pumpAdvanced.target == PumpTarget::PUMP_TARGET_PRESSURE; }
 
     float getPumpTargetPressure() const {
         if (isAdvancedPump()) {
-            return currentPhase.pumpAdvanced.pressure;
+            return currentPhase->transition.interpolate(phaseStartPressure, currentPhase->pumpAdvanced.pressure,
+                                                        getPhaseElapsed());
+        }
+        return 0.0f;
+    }
+
+    float getPumpTargetFlow() const {
+        if (isAdvancedPump()) {
+            return currentPhase->transition.interpolate(phaseStartFlow, currentPhase->pumpAdvanced.flow, getPhaseElapsed());
         }
         return 0.0f;
     }
 
+    float getPhaseElapsed() const { return static_cast<float>(millis() - currentPhaseStarted) / 1000.0f; }
+
     void progress() override {
         // Progress should be called around every 100ms, as defined in PROGRESS_INTERVAL, while the Process is active
         if (isCurrentPhaseFinished() && processPhase == ProcessPhase::RUNNING) {
-            previousPhaseFinished = millis();
-            if (phaseIndex + 1 < profile.phases.size()) {
-                phaseIndex++;
-                currentPhase = profile.phases.at(phaseIndex);
-                currentPhaseStarted = millis();
-            } else {
-                processPhase = ProcessPhase::FINISHED;
-                finished = millis();
+            if (!remote) {
+                nextPhase();
+            } else if (millis() - currentPhaseStarted > BREW_SAFETY_DURATION_MS) {
+                // The controller board stopped reporting, end the shot on the display side
+                finish();
+            } else if (advanceRequestPhase != static_cast<int>(phaseIndex)) {
+                advanceRequestPhase = static_cast<int>(phaseIndex);
+                advanceRequested = true;
             }
         }
     }
 
+    // Called with the phase the controller board is executing, running is false once it finished the program
+    void onRemoteProgress(uint8_t phase, bool running) {
+        while (processPhase == ProcessPhase::RUNNING && phaseIndex < phase) {
+            nextPhase();
+        }
+        if (!running && processPhase == ProcessPhase::RUNNING) {
+            finish();
+        }
+    }
+
+    // Returns true once for every phase whose exit was decided on the display side
+    bool takeAdvanceRequest() {
+        if (!advanceRequested) {
+            return false;
+        }
+        advanceRequested = false;
+        return true;
+    }
+
     bool isActive() override { return processPhase == ProcessPhase::RUNNING; }
 
+    void nextPhase() {
+        previousPhaseFinished = millis();
+        advanceRequested = false;
+        if (phaseIndex + 1 < profile->phaseCount) {
+            phaseStartPump = getPumpValue();
+            phaseStartPressure = isAdvancedPump() ? getPumpTargetPressure() : currentPressure;
+            phaseStartFlow = isAdvancedPump() ? getPumpTargetFlow() : currentFlow;
+            phaseIndex++;
+            currentPhase = &profile->phases[phaseIndex];
+            currentPhaseStarted = millis();
+            TRACE_INSTANT("process", "brew phase", static_cast<int32_t>(phaseIndex));
+        } else {
+            finish();
+        }
+    }
+
+    void finish() {
+        previousPhaseFinished = millis();
+        processPhase = ProcessPhase::FINISHED;
+        finished = millis();
+        TRACE_INSTANT("process", "brew finished", static_cast<int32_t>(phaseIndex));
+    }
+
     bool isComplete() override {
         if (target == ProcessTarget::TIME) {
             return !isActive();
@@ -155,6 +255,14 @@ class BrewProcess : public Process {
     }
 
     int getType() override { return MODE_BREW; }
+
+    uint8_t getResources() override {
+        uint8_t resources = PROCESS_RESOURCE_PUMP | PROCESS_RESOURCE_VALVE | PROCESS_RESOURCE_HEATER;
+        if (target == ProcessTarget::VOLUMETRIC) {
+            resources |= PROCESS_RESOURCE_SCALE;
+        }
+        return resources;
+    }
 };
 
 class SteamProcess : public Process {
@@ -187,15 +295,23 @@ class SteamProcess : public Process {
 
     int getType() override { return MODE_STEAM; }
 
-    void updateVolume(double volume) override {};
+    void updateVolume(double volume, unsigned long time) override {};
+
+    void updateSensors(float pressure, float flow) override {};
+
+    uint8_t getResources() override { return PROCESS_RESOURCE_PUMP | PROCESS_RESOURCE_HEATER; }
 };
 
 class PumpProcess : public Process {
   public:
     int duration;
+    bool ownsHeater;
     unsigned long started;
 
-    explicit PumpProcess(int duration = HOT_WATER_SAFETY_DURATION_MS) : duration(duration) { started = millis(); }
+    explicit PumpProcess(int duration = HOT_WATER_SAFETY_DURATION_MS, bool ownsHeater = true)
+        : duration(duration), ownsHeater(ownsHeater) {
+        started = millis();
+    }
 
     bool isRelayActive() override { return false; };
 
@@ -216,7 +332,11 @@ class PumpProcess : public Process {
 
     int getType() override { return MODE_WATER; }
 
-    void updateVolume(double volume) override {};
+    void updateVolume(double volume, unsigned long time) override {};
+
+    void updateSensors(float pressure, float flow) override {};
+
+    uint8_t getResources() override { return ownsHeater ? PROCESS_RESOURCE_PUMP | PROCESS_RESOURCE_HEATER : PROCESS_RESOURCE_PUMP; }
 };
 
 class GrindProcess : public Process {
@@ -237,13 +357,15 @@ class GrindProcess : public Process {
         started = millis();
     }
 
-    void updateVolume(double volume) override {
+    void updateVolume(double volume, unsigned long time) override {
         currentVolume = volume;
         if (active) { // only store measurements while active
-            volumetricRateCalculator->addMeasurement(volume);
+            volumetricRateCalculator->addMeasurement(volume, time);
         }
     }
 
+    void updateSensors(float pressure, float flow) override {};
+
     bool isRelayActive() override { return false; }
 
     bool isAltRelayActive() override { return active; }
@@ -255,7 +377,7 @@ class GrindProcess : public Process {
         if (target == ProcessTarget::TIME) {
             active = millis() - started < time;
         } else {
-            double currentRate = volumetricRateCalculator->getRate();
+            double currentRate = volumetricRateCalculator->getRate(millis());
             ESP_LOGI("GrindProcess", "Current rate: %f, Current volume: %f, Expected Offset: %f", currentRate, currentVolume,
                      currentRate * grindDelay);
             if (currentVolume + currentRate * grindDelay > grindVolume && active) {
@@ -290,6 +412,10 @@ class GrindProcess : public Process {
     }
 
     int getType() override { return MODE_GRIND; }
+
+    uint8_t getResources() override {
+        return target == ProcessTarget::VOLUMETRIC ? PROCESS_RESOURCE_ALT_RELAY | PROCESS_RESOURCE_SCALE : PROCESS_RESOURCE_ALT_RELAY;
+    }
 };
 
 #endif // PROCESS_H
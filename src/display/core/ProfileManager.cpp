@@ -11,7 +11,7 @@ void ProfileManager::setup() {
         migrate();
         _settings.setProfilesMigrated(true);
     }
-    loadSelectedProfile(selectedProfile);
+    reloadSelectedProfile();
 }
 
 bool ProfileManager::ensureDirectory() {
@@ -146,12 +146,11 @@ bool ProfileManager::saveProfile(Profile &profile) {
 
     bool ok = serializeJson(doc, file) > 0;
     file.close();
-    if (profile.id == selectedProfile.id) {
-        selectedProfile = Profile{};
-        loadSelectedProfile(selectedProfile);
+    if (profile.id == getSelectedProfile().id) {
+        reloadSelectedProfile();
     }
     selectProfile(_settings.getSelectedProfile());
-    _plugin_manager->trigger("profiles:profile:save", "id", profile.id);
+    _plugin_manager->trigger(EventId::PROFILES_PROFILE_SAVE, "id", profile.id);
     return ok;
 }
 
@@ -165,12 +164,29 @@ bool ProfileManager::profileExists(const String &uuid) { return _fs.exists(profi
 void ProfileManager::selectProfile(const String &uuid) {
     ESP_LOGI("ProfileManager", "Selecting profile %s", uuid.c_str());
     _settings.setSelectedProfile(uuid);
-    selectedProfile = Profile{};
-    loadSelectedProfile(selectedProfile);
-    _plugin_manager->trigger("profiles:profile:select", "id", uuid);
+    reloadSelectedProfile();
+    _plugin_manager->trigger(EventId::PROFILES_PROFILE_SELECT, "id", uuid);
 }
 
-Profile ProfileManager::getSelectedProfile() const { return selectedProfile; }
+Profile ProfileManager::getSelectedProfile() const {
+    std::lock_guard<std::mutex> lock(selectedMutex);
+    return selectedProfile;
+}
+
+std::shared_ptr<const CompiledProfile> ProfileManager::getCompiledProfile() const {
+    std::lock_guard<std::mutex> lock(selectedMutex);
+    return compiledProfile;
+}
+
+void ProfileManager::reloadSelectedProfile() {
+    // Loaded and compiled outside the lock, readers only wait for the swap
+    Profile profile{};
+    loadSelectedProfile(profile);
+    std::shared_ptr<const CompiledProfile> compiled = compileProfile(profile);
+    std::lock_guard<std::mutex> lock(selectedMutex);
+    selectedProfile = std::move(profile);
+    compiledProfile = std::move(compiled);
+}
 
 void ProfileManager::loadSelectedProfile(Profile &outProfile) { loadProfile(_settings.getSelectedProfile(), outProfile); }
 
@@ -1,11 +1,13 @@
 #pragma once
 #ifndef PROFILEMANAGER_H
 #define PROFILEMANAGER_H
+#include "CompiledProfile.h"
 #include "PluginManager.h"
 #include <FS.h>
 #include <display/core/Settings.h>
 #include <display/core/utils.h>
 #include <display/models/profile.h>
+#include <mutex>
 
 class ProfileManager {
   public:
@@ -18,12 +20,16 @@ class ProfileManager {
     bool deleteProfile(const String &uuid);
     bool profileExists(const String &uuid);
     void selectProfile(const String &uuid);
+    // Both are copies taken under the lock, the UI and the web server select profiles while other tasks read them
     Profile getSelectedProfile() const;
+    std::shared_ptr<const CompiledProfile> getCompiledProfile() const;
     void loadSelectedProfile(Profile &outProfile);
     std::vector<String> getFavoritedProfiles();
 
   private:
     Profile selectedProfile{};
+    std::shared_ptr<const CompiledProfile> compiledProfile;
+    mutable std::mutex selectedMutex;
     PluginManager *_plugin_manager;
     Settings &_settings;
     fs::FS &_fs;
@@ -31,6 +37,7 @@ class ProfileManager {
     bool ensureDirectory();
     String profilePath(const String &uuid);
     void migrate();
+    void reloadSelectedProfile();
 };
 
 #endif // PROFILEMANAGER_H
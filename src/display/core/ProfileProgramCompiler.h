@@ -0,0 +1,48 @@
+#ifndef PROFILEPROGRAMCOMPILER_H
+#define PROFILEPROGRAMCOMPILER_H
+
+#include "CompiledProfile.h"
+#include <ProfileProgram.h>
+
+// FNV-1a of the profile id, lets the display match progress reports to the uploaded program
+inline uint32_t getProgramId(const CompiledProfile &profile) {
+    uint32_t hash = 2166136261u;
+    for (const char *c = profile.id; *c != '\0'; c++) {
+        hash ^= static_cast<uint8_t>(*c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Converts a compiled profile into the program executed by the controller board. Volumetric exit conditions are
+// left out, the display evaluates them against the scale and asks the controller to advance.
+inline ProfileProgram compileProfileProgram(const CompiledProfile &profile, bool volumetric) {
+    ProfileProgram program{};
+    program.id = getProgramId(profile);
+    program.phaseCount = profile.phaseCount < PROGRAM_MAX_PHASES ? profile.phaseCount : PROGRAM_MAX_PHASES;
+    for (uint8_t i = 0; i < program.phaseCount; i++) {
+        const CompiledPhase &phase = profile.phases[i];
+        ProgramPhase &out = program.phases[i];
+        out.valve = phase.valve;
+        out.advanced = !phase.pumpIsSimple;
+        out.pressureTarget = phase.pumpAdvanced.target == PumpTarget::PUMP_TARGET_PRESSURE;
+        out.pump = phase.pumpSimple;
+        out.pressure = phase.pumpAdvanced.pressure;
+        out.flow = phase.pumpAdvanced.flow;
+        out.transition = static_cast<uint8_t>(phase.transition.type);
+        out.transitionDuration = phase.transition.duration;
+        const PhaseExit &exit = phase.getExit(volumetric);
+        for (uint8_t j = 0; j < exit.count && out.exitCount < PROGRAM_MAX_EXITS; j++) {
+            if (exit.types[j] == static_cast<uint8_t>(TargetType::TARGET_TYPE_VOLUMETRIC)) {
+                continue;
+            }
+            ProgramExit &programExit = out.exits[out.exitCount++];
+            programExit.type = exit.types[j];
+            programExit.lte = exit.operators[j] == static_cast<uint8_t>(TargetOperator::OPERATOR_LTE);
+            programExit.value = exit.values[j];
+        }
+    }
+    return program;
+}
+
+#endif // PROFILEPROGRAMCOMPILER_H
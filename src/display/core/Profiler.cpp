@@ -0,0 +1,54 @@
+#include "Profiler.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+std::mutex zonesMutex;
+std::vector<std::unique_ptr<ProfileZone>> zones;
+// Separate from zonesMutex so recording never waits for a zone to be created
+std::mutex statsMutex;
+} // namespace
+
+ProfileZone *Profiler::getZone(const std::string &name) {
+    std::lock_guard<std::mutex> lock(zonesMutex);
+    for (const auto &zone : zones) {
+        if (zone->name == name)
+            return zone.get();
+    }
+    zones.emplace_back(new ProfileZone());
+    zones.back()->name = name;
+    return zones.back().get();
+}
+
+void Profiler::record(ProfileZone *zone, uint32_t duration) {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    zone->add(duration);
+}
+
+void Profiler::forEach(const std::function<void(const ProfileZone &zone)> &callback) {
+    std::vector<ProfileZone> copies;
+    {
+        std::lock_guard<std::mutex> zonesLock(zonesMutex);
+        copies.reserve(zones.size());
+        std::lock_guard<std::mutex> statsLock(statsMutex);
+        for (const auto &zone : zones) {
+            copies.push_back(*zone);
+        }
+    }
+    for (const auto &zone : copies) {
+        callback(zone);
+    }
+}
+
+// Clears the statistics but keeps the zones, scopes hold on to their zone pointers
+void Profiler::reset() {
+    std::lock_guard<std::mutex> zonesLock(zonesMutex);
+    std::lock_guard<std::mutex> statsLock(statsMutex);
+    for (const auto &zone : zones) {
+        const std::string name = zone->name;
+        *zone = ProfileZone{};
+        zone->name = name;
+    }
+}
@@ -0,0 +1,108 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// Scoped profiler for the display firmware, enabled with -DGAGGIMATE_PROFILER. Without the flag the PROFILE_SCOPE
+// macro expands to nothing and no zones exist. Time is taken from the CPU cycle counter on the ESP32 and from
+// steady_clock on the host, so scopes must not span a migration between cores on unpinned tasks.
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <chrono>
+#endif
+
+constexpr uint8_t PROFILER_HISTOGRAM_BUCKETS = 16; // bucket i counts durations below 2^i us, the last one the rest
+
+// Statistics of one zone. Not synchronized itself, scopes go through Profiler::record and readers get copies.
+struct ProfileZone {
+    std::string name;
+    uint32_t count = 0;
+    uint32_t min = UINT32_MAX; // us
+    uint32_t max = 0;          // us
+    uint64_t total = 0;        // us
+    uint32_t histogram[PROFILER_HISTOGRAM_BUCKETS] = {};
+
+    void add(uint32_t duration) {
+        count++;
+        total += duration;
+        if (duration < min)
+            min = duration;
+        if (duration > max)
+            max = duration;
+        uint8_t bucket = 0;
+        while (bucket < PROFILER_HISTOGRAM_BUCKETS - 1 && duration >= (1u << bucket)) {
+            bucket++;
+        }
+        histogram[bucket]++;
+    }
+
+    uint32_t average() const { return count > 0 ? static_cast<uint32_t>(total / count) : 0; }
+};
+
+class Profiler {
+  public:
+    // Returns the zone with this name, creating it on first use. Zones are never removed, times are inclusive of
+    // nested zones.
+    static ProfileZone *getZone(const std::string &name);
+    // Scopes end on the loop, BLE and web tasks, all updates and reads of the statistics share one lock
+    static void record(ProfileZone *zone, uint32_t duration);
+    // Calls the callback with a copy of every zone, taken under the lock so the callback never blocks a scope
+    static void forEach(const std::function<void(const ProfileZone &zone)> &callback);
+    static void reset();
+
+    static uint32_t now() {
+#ifdef ARDUINO
+        return ESP.getCycleCount();
+#else
+        return static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    static uint32_t toMicros(uint32_t ticks) {
+#ifdef ARDUINO
+        return ticks / ESP.getCpuFreqMHz();
+#else
+        return ticks / 1000;
+#endif
+    }
+};
+
+class ProfileScope {
+  public:
+    explicit ProfileScope(ProfileZone *zone) : zone(zone), started(Profiler::now()) {}
+    ~ProfileScope() {
+        if (zone != nullptr)
+            Profiler::record(zone, Profiler::toMicros(Profiler::now() - started));
+    }
+
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+  private:
+    ProfileZone *zone;
+    uint32_t started;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef GAGGIMATE_PROFILER
+#define PROFILER_ENABLED true
+// Times the rest of the enclosing block under a fixed zone name
+#define PROFILE_SCOPE(name)                                                                                                  \
+    static ProfileZone *PROFILE_CONCAT(profileZone, __LINE__) = Profiler::getZone(name);                                    \
+    ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(PROFILE_CONCAT(profileZone, __LINE__))
+// Times the rest of the enclosing block under a zone looked up beforehand, for names only known at runtime
+#define PROFILE_ZONE_SCOPE(zone) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(zone)
+#else
+#define PROFILER_ENABLED false
+#define PROFILE_SCOPE(name)
+#define PROFILE_ZONE_SCOPE(zone)
+#endif
+
+#endif // PROFILER_H
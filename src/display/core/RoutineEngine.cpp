@@ -0,0 +1,244 @@
+#include "RoutineEngine.h"
+#include "Controller.h"
+#include <display/core/constants.h>
+
+RoutineEngine::RoutineEngine(Controller *controller, PluginManager *pluginManager)
+    : controller(controller), pluginManager(pluginManager) {}
+
+bool RoutineEngine::start(const String &id) {
+    if (isRunning() || id.isEmpty()) {
+        return false;
+    }
+    requestedId = id;
+    stopRequested = false;
+    state = RoutineState::STARTING;
+    return true;
+}
+
+void RoutineEngine::stop() {
+    if (isRunning()) {
+        stopRequested = true;
+    }
+}
+
+void RoutineEngine::loop() {
+    if (state == RoutineState::IDLE) {
+        return;
+    }
+    if (stopRequested) {
+        if (state == RoutineState::STARTING) {
+            // Stopped before it was even loaded
+            stopRequested = false;
+            state = RoutineState::IDLE;
+            return;
+        }
+        if (state == RoutineState::RUNNING) {
+            stopStepProcess();
+        }
+        finish(false);
+        return;
+    }
+    if (state == RoutineState::STARTING) {
+        if (!load()) {
+            state = RoutineState::IDLE;
+            return;
+        }
+        ESP_LOGI("RoutineEngine", "Starting routine %s", routine.id.c_str());
+        pluginManager->trigger(EventId::ROUTINES_ROUTINE_START, "id", routine.id);
+        enterStep(0);
+    }
+    const unsigned long now = millis();
+    for (uint8_t i = 0; i < ROUTINE_MAX_STEPS_PER_LOOP && state != RoutineState::IDLE; i++) {
+        if (!advance(now)) {
+            break;
+        }
+    }
+}
+
+bool RoutineEngine::load() {
+    routine = Routine{};
+    if (!controller->getRoutineManager()->loadRoutine(requestedId, routine)) {
+        ESP_LOGW("RoutineEngine", "Routine %s not found", requestedId.c_str());
+        return false;
+    }
+    if (routine.steps.empty()) {
+        ESP_LOGW("RoutineEngine", "Routine %s has no steps", requestedId.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Returns true if the state changed in a way that should be evaluated again right away
+bool RoutineEngine::advance(unsigned long now) {
+    const RoutineStep &step = routine.steps[stepIndex];
+    if (state == RoutineState::PREPARING) {
+        // Waiting for the boiler is user intent, don't let the standby timeout kick in
+        controller->updateLastAction();
+        if (!isConditionMet(step.condition)) {
+            conditionMet = 0;
+            return false;
+        }
+        if (conditionMet == 0) {
+            conditionMet = now;
+        }
+        if (now - conditionMet < static_cast<unsigned long>(step.delay * 1000.0f)) {
+            return false;
+        }
+        return startStep(now);
+    }
+
+    const bool timedOut = step.duration > 0.0f && now - stepStarted >= static_cast<unsigned long>(step.duration * 1000.0f);
+    if (step.type != RoutineStepType::ROUTINE_STEP_WAIT) {
+        if (controller->getProcess(getProcessType(step)) != nullptr) {
+            if (!timedOut) {
+                return false;
+            }
+            stopStepProcess();
+        }
+    } else if (!timedOut) {
+        return false;
+    }
+    enterStep(stepIndex + 1);
+    return true;
+}
+
+void RoutineEngine::enterStep(size_t index) {
+    if (index >= routine.steps.size()) {
+        finish(true);
+        return;
+    }
+    stepIndex = index;
+    state = RoutineState::PREPARING;
+    conditionMet = 0;
+    const RoutineStep &step = routine.steps[stepIndex];
+    // Before the mode change, so the boiler already heats to the temperature of the step profile
+    controller->setProfileOverride(loadStepProfile(step));
+    // Switch modes right away so the boiler heats up while the step waits for its condition
+    const int mode = getStepMode(step);
+    if (mode >= 0 && controller->getMode() != mode) {
+        controller->setMode(mode);
+    }
+    Event event;
+    event.id = EventId::ROUTINES_STEP_CHANGE;
+    event.setString("id", routine.id);
+    event.setInt("index", static_cast<int>(stepIndex));
+    event.setString("type", routineStepTypeToString(step.type));
+    pluginManager->trigger(event);
+}
+
+bool RoutineEngine::startStep(unsigned long now) {
+    const RoutineStep &step = routine.steps[stepIndex];
+    stepStarted = now;
+    state = RoutineState::RUNNING;
+    // The mode might have been changed on the screen while waiting
+    const int mode = getStepMode(step);
+    if (mode >= 0 && controller->getMode() != mode) {
+        controller->setMode(mode);
+    }
+    switch (step.type) {
+    case RoutineStepType::ROUTINE_STEP_FLUSH:
+        controller->onFlush();
+        break;
+    case RoutineStepType::ROUTINE_STEP_BREW:
+    case RoutineStepType::ROUTINE_STEP_STEAM:
+    case RoutineStepType::ROUTINE_STEP_WATER:
+        controller->activate();
+        break;
+    case RoutineStepType::ROUTINE_STEP_GRIND:
+        controller->activateGrind();
+        break;
+    case RoutineStepType::ROUTINE_STEP_MODE:
+        controller->setMode(step.mode);
+        enterStep(stepIndex + 1);
+        return true;
+    case RoutineStepType::ROUTINE_STEP_WAIT:
+        // Without a duration the step only waits for its condition and delay
+        if (step.duration <= 0.0f) {
+            enterStep(stepIndex + 1);
+        }
+        return true;
+    }
+    if (controller->getProcess(getProcessType(step)) == nullptr) {
+        ESP_LOGW("RoutineEngine", "Step %d of routine %s could not be started", static_cast<int>(stepIndex), routine.id.c_str());
+        finish(false);
+    }
+    return false;
+}
+
+void RoutineEngine::stopStepProcess() const {
+    const RoutineStep &step = routine.steps[stepIndex];
+    if (step.type == RoutineStepType::ROUTINE_STEP_GRIND) {
+        controller->deactivateGrind();
+    } else if (step.type != RoutineStepType::ROUTINE_STEP_WAIT && step.type != RoutineStepType::ROUTINE_STEP_MODE) {
+        controller->deactivate();
+    }
+}
+
+// Brew steps with a profile run it without selecting it, the profile the user selected stays untouched
+std::shared_ptr<const CompiledProfile> RoutineEngine::loadStepProfile(const RoutineStep &step) const {
+    if (step.type != RoutineStepType::ROUTINE_STEP_BREW || step.profile.isEmpty()) {
+        return nullptr;
+    }
+    Profile profile;
+    if (!controller->getProfileManager()->loadProfile(step.profile, profile)) {
+        ESP_LOGW("RoutineEngine", "Profile %s of routine %s not found, brewing the selected one", step.profile.c_str(),
+                 routine.id.c_str());
+        return nullptr;
+    }
+    return compileProfile(profile);
+}
+
+void RoutineEngine::finish(bool completed) {
+    ESP_LOGI("RoutineEngine", "Routine %s %s", routine.id.c_str(), completed ? "completed" : "aborted");
+    controller->setProfileOverride(nullptr);
+    state = RoutineState::IDLE;
+    stopRequested = false;
+    Event event;
+    event.id = EventId::ROUTINES_ROUTINE_END;
+    event.setString("id", routine.id);
+    event.setInt("completed", completed ? 1 : 0);
+    pluginManager->trigger(event);
+}
+
+bool RoutineEngine::isConditionMet(const RoutineCondition &condition) const {
+    float value;
+    switch (condition.type) {
+    case RoutineConditionType::CONDITION_TEMPERATURE:
+        value = static_cast<float>(controller->getCurrentTemp());
+        break;
+    case RoutineConditionType::CONDITION_PRESSURE:
+        value = controller->getCurrentPressure();
+        break;
+    default:
+        return true;
+    }
+    return condition.op == TargetOperator::OPERATOR_LTE ? value <= condition.value : value >= condition.value;
+}
+
+int RoutineEngine::getStepMode(const RoutineStep &step) {
+    switch (step.type) {
+    case RoutineStepType::ROUTINE_STEP_FLUSH:
+    case RoutineStepType::ROUTINE_STEP_BREW:
+        return MODE_BREW;
+    case RoutineStepType::ROUTINE_STEP_STEAM:
+        return MODE_STEAM;
+    case RoutineStepType::ROUTINE_STEP_WATER:
+        return MODE_WATER;
+    default:
+        // Grinding runs next to whatever mode is active
+        return -1;
+    }
+}
+
+int RoutineEngine::getProcessType(const RoutineStep &step) {
+    switch (step.type) {
+    case RoutineStepType::ROUTINE_STEP_STEAM:
+        return MODE_STEAM;
+    case RoutineStepType::ROUTINE_STEP_WATER:
+        return MODE_WATER;
+    case RoutineStepType::ROUTINE_STEP_GRIND:
+        return MODE_GRIND;
+    default:
+        return MODE_BREW;
+    }
+}
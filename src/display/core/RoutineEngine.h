@@ -0,0 +1,63 @@
+#ifndef ROUTINEENGINE_H
+#define ROUTINEENGINE_H
+
+#include "CompiledProfile.h"
+#include "PluginManager.h"
+#include <atomic>
+#include <display/models/routine.h>
+
+class Controller;
+
+// Maximum number of steps the engine walks through in a single loop call, steps like mode changes finish instantly
+constexpr uint8_t ROUTINE_MAX_STEPS_PER_LOOP = 8;
+
+enum class RoutineState {
+    IDLE,      // No routine running
+    STARTING,  // Routine was requested and will be loaded and started by the next loop
+    PREPARING, // Mode of the step is set, waiting for the start condition and delay
+    RUNNING    // Process of the step is running
+};
+
+// Runs a routine step by step from the controller loop. Each step switches the machine into its mode as soon as it
+// is entered, so the boiler is already heating while the engine waits for the start condition, and the next step is
+// entered in the same loop call that saw the previous process end.
+class RoutineEngine {
+  public:
+    RoutineEngine(Controller *controller, PluginManager *pluginManager);
+
+    // Requests are picked up by the next loop call, so they can be made from any task. The routine is only loaded
+    // there, the file system is not touched from the BLE or web tasks.
+    bool start(const String &id);
+    void stop();
+    void loop();
+
+    bool isRunning() const { return state != RoutineState::IDLE; }
+    RoutineState getState() const { return state; }
+    const Routine &getRoutine() const { return routine; }
+    size_t getStepIndex() const { return stepIndex; }
+
+  private:
+    bool load();
+    bool advance(unsigned long now);
+    void enterStep(size_t index);
+    std::shared_ptr<const CompiledProfile> loadStepProfile(const RoutineStep &step) const;
+    bool startStep(unsigned long now);
+    void stopStepProcess() const;
+    void finish(bool completed);
+    bool isConditionMet(const RoutineCondition &condition) const;
+    static int getStepMode(const RoutineStep &step);
+    static int getProcessType(const RoutineStep &step);
+
+    Controller *controller;
+    PluginManager *pluginManager;
+    Routine routine;
+    // Written by the requesting task before the state is published as STARTING
+    String requestedId;
+    std::atomic<RoutineState> state{RoutineState::IDLE};
+    size_t stepIndex = 0;
+    unsigned long conditionMet = 0;
+    unsigned long stepStarted = 0;
+    bool stopRequested = false;
+};
+
+#endif // ROUTINEENGINE_H
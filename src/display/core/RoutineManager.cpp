@@ -0,0 +1,77 @@
+#include "RoutineManager.h"
+#include <ArduinoJson.h>
+
+RoutineManager::RoutineManager(fs::FS &fs, char *dir, PluginManager *plugin_manager)
+    : _plugin_manager(plugin_manager), _fs(fs), _dir(dir) {}
+
+void RoutineManager::setup() { ensureDirectory(); }
+
+bool RoutineManager::ensureDirectory() {
+    if (!_fs.exists(_dir)) {
+        return _fs.mkdir(_dir);
+    }
+    return true;
+}
+
+String RoutineManager::routinePath(const String &uuid) { return _dir + "/" + uuid + ".json"; }
+
+std::vector<String> RoutineManager::listRoutines() {
+    std::vector<String> uuids;
+    File root = _fs.open(_dir);
+    if (!root || !root.isDirectory())
+        return uuids;
+
+    File file = root.openNextFile();
+    while (file) {
+        String name = file.name();
+        if (name.endsWith(".json")) {
+            int start = name.lastIndexOf('/') + 1;
+            int end = name.lastIndexOf('.');
+            uuids.push_back(name.substring(start, end));
+        }
+        file = root.openNextFile();
+    }
+    return uuids;
+}
+
+bool RoutineManager::loadRoutine(const String &uuid, Routine &outRoutine) {
+    File file = _fs.open(routinePath(uuid), "r");
+    if (!file)
+        return false;
+
+    JsonDocument doc;
+    DeserializationError err = deserializeJson(doc, file);
+    file.close();
+    if (err)
+        return false;
+
+    return parseRoutine(doc.as<JsonObject>(), outRoutine);
+}
+
+bool RoutineManager::saveRoutine(Routine &routine) {
+    if (!ensureDirectory())
+        return false;
+
+    ESP_LOGI("RoutineManager", "Saving routine %s", routine.id.c_str());
+
+    if (routine.id.isEmpty()) {
+        routine.id = generateShortID();
+    }
+
+    File file = _fs.open(routinePath(routine.id), "w");
+    if (!file)
+        return false;
+
+    JsonDocument doc;
+    JsonObject obj = doc.to<JsonObject>();
+    writeRoutine(obj, routine);
+
+    bool ok = serializeJson(doc, file) > 0;
+    file.close();
+    _plugin_manager->trigger(EventId::ROUTINES_ROUTINE_SAVE, "id", routine.id);
+    return ok;
+}
+
+bool RoutineManager::deleteRoutine(const String &uuid) { return _fs.remove(routinePath(uuid)); }
+
+bool RoutineManager::routineExists(const String &uuid) { return _fs.exists(routinePath(uuid)); }
@@ -0,0 +1,28 @@
+#pragma once
+#ifndef ROUTINEMANAGER_H
+#define ROUTINEMANAGER_H
+#include "PluginManager.h"
+#include <FS.h>
+#include <display/core/utils.h>
+#include <display/models/routine.h>
+
+class RoutineManager {
+  public:
+    RoutineManager(fs::FS &fs, char *dir, PluginManager *plugin_manager);
+
+    void setup();
+    std::vector<String> listRoutines();
+    bool loadRoutine(const String &uuid, Routine &outRoutine);
+    bool saveRoutine(Routine &routine);
+    bool deleteRoutine(const String &uuid);
+    bool routineExists(const String &uuid);
+
+  private:
+    PluginManager *_plugin_manager;
+    fs::FS &_fs;
+    String _dir;
+    bool ensureDirectory();
+    String routinePath(const String &uuid);
+};
+
+#endif // ROUTINEMANAGER_H
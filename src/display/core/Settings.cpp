@@ -15,6 +15,7 @@ Settings::Settings() {
     brewDelay = preferences.getDouble("del_br", 1000.0);
     grindDelay = preferences.getDouble("del_gd", 1000.0);
     delayAdjust = preferences.getBool("del_ad", true);
+    volumePredictor = preferences.getInt("vp", 0);
     temperatureOffset = preferences.getInt("to", DEFAULT_TEMPERATURE_OFFSET);
     pressureScaling = preferences.getFloat("ps", DEFAULT_PRESSURE_SCALING);
     pid = preferences.getString("pid", DEFAULT_PID);
@@ -29,6 +30,7 @@ Settings::Settings() {
     pressurizeTime = preferences.getInt("pt", 0);
     savedScale = preferences.getString("ssc", "");
     momentaryButtons = preferences.getBool("mb", false);
+    brewButtonRoutine = preferences.getString("br_r", "");
     boilerFillActive = preferences.getBool("bf_a", false);
     startupFillTime = preferences.getInt("bf_su", 5000);
     steamFillTime = preferences.getInt("bf_st", 5000);
@@ -125,6 +127,11 @@ void Settings::setDelayAdjust(bool delay_adjust) {
     save();
 }
 
+void Settings::setVolumePredictor(int volume_predictor) {
+    volumePredictor = volume_predictor;
+    save();
+}
+
 void Settings::setStartupMode(const int startup_mode) {
     startupMode = startup_mode;
     save();
@@ -248,6 +255,11 @@ void Settings::setMomentaryButtons(bool momentary_buttons) {
     save();
 }
 
+void Settings::setBrewButtonRoutine(String brew_button_routine) {
+    brewButtonRoutine = std::move(brew_button_routine);
+    save();
+}
+
 void Settings::setTimezone(String timezone) {
     this->timezone = std::move(timezone);
     save();
@@ -302,6 +314,7 @@ void Settings::doSave() {
     preferences.putDouble("del_br", brewDelay);
     preferences.putDouble("del_gd", grindDelay);
     preferences.putBool("del_ad", delayAdjust);
+    preferences.putInt("vp", volumePredictor);
     preferences.putInt("to", temperatureOffset);
     preferences.putFloat("ps", pressureScaling);
     preferences.putString("pid", pid);
@@ -333,6 +346,7 @@ void Settings::doSave() {
     preferences.putInt("sbt", standbyTimeout);
     preferences.putBool("pm", profilesMigrated);
     preferences.putInt("mb", momentaryButtons);
+    preferences.putString("br_r", brewButtonRoutine);
     preferences.putString("fp", implode(favoritedProfiles, ","));
     preferences.end();
 }
@@ -37,6 +37,7 @@ class Settings {
     double getBrewDelay() const { return brewDelay; }
     double getGrindDelay() const { return grindDelay; }
     bool isDelayAdjust() const { return delayAdjust; }
+    int getVolumePredictor() const { return volumePredictor; }
     String getPid() const { return pid; }
     String getWifiSsid() const { return wifiSsid; }
     String getWifiPassword() const { return wifiPassword; }
@@ -57,6 +58,7 @@ class Settings {
     String getHomeAssistantPassword() const { return homeAssistantPassword; }
     int getHomeAssistantPort() const { return homeAssistantPort; }
     bool isMomentaryButtons() const { return momentaryButtons; }
+    String getBrewButtonRoutine() const { return brewButtonRoutine; }
     String getTimezone() const { return timezone; }
     bool isClock24hFormat() const { return clock24hFormat; }
     String getSelectedProfile() const { return selectedProfile; }
@@ -79,6 +81,7 @@ class Settings {
     void setBrewDelay(double brewDelay);
     void setGrindDelay(double grindDelay);
     void setDelayAdjust(bool delay_adjust);
+    void setVolumePredictor(int volume_predictor);
     void setPid(const String &pid);
     void setWifiSsid(const String &wifiSsid);
     void setWifiPassword(const String &wifiPassword);
@@ -99,6 +102,7 @@ class Settings {
     void setHomeAssistantIP(const String &homeAssistantIP);
     void setHomeAssistantPort(int homeAssistantPort);
     void setMomentaryButtons(bool momentary_buttons);
+    void setBrewButtonRoutine(String brew_button_routine);
     void setTimezone(String timezone);
     void setClockFormat(bool format_24h);
     void setSelectedProfile(String selected_profile);
@@ -122,6 +126,7 @@ class Settings {
     double brewDelay = 1000.0;
     double grindDelay = 1000.0;
     bool delayAdjust = true;
+    int volumePredictor = 0;
     int startupMode = MODE_STANDBY;
     int standbyTimeout = DEFAULT_STANDBY_TIMEOUT_MS;
     String pid = DEFAULT_PID;
@@ -144,6 +149,7 @@ class Settings {
     String homeAssistantIP = "";
     int homeAssistantPort = 1883;
     bool momentaryButtons = false;
+    String brewButtonRoutine = "";
     String timezone = DEFAULT_TIMEZONE;
     bool clock24hFormat = true;
     String otaChannel = DEFAULT_OTA_CHANNEL;
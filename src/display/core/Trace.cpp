@@ -0,0 +1,189 @@
+#include "Trace.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <chrono>
+#include <functional>
+#include <thread>
+#endif
+
+Trace::Entry *Trace::entries = nullptr;
+size_t Trace::capacity = 0;
+std::atomic<uint32_t> Trace::head{0};
+std::atomic<bool> TraceExport::exporting{false};
+
+namespace {
+void *allocate(size_t size) {
+#ifdef ARDUINO
+    return ps_malloc(size);
+#else
+    return malloc(size);
+#endif
+}
+
+uint64_t now() {
+#ifdef ARDUINO
+    return static_cast<uint64_t>(esp_timer_get_time());
+#else
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+void currentThread(uint32_t &id, char *name) {
+#ifdef ARDUINO
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    id = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(task));
+    strncpy(name, pcTaskGetName(task), TRACE_THREAD_NAME_LENGTH - 1);
+#else
+    id = static_cast<uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    strncpy(name, "main", TRACE_THREAD_NAME_LENGTH - 1);
+#endif
+    name[TRACE_THREAD_NAME_LENGTH - 1] = '\0';
+}
+} // namespace
+
+bool Trace::begin(size_t size) {
+    if (entries != nullptr)
+        return true;
+    if (size == 0 || (size & (size - 1)) != 0)
+        return false;
+    void *memory = allocate(size * sizeof(Entry));
+    if (memory == nullptr)
+        return false;
+    Entry *ring = static_cast<Entry *>(memory);
+    for (size_t i = 0; i < size; i++) {
+        new (&ring[i].sequence) std::atomic<uint32_t>(0);
+    }
+    capacity = size;
+    entries = ring;
+    return true;
+}
+
+void Trace::record(char phase, const char *category, const char *name, int32_t value) {
+    if (entries == nullptr)
+        return;
+    const uint32_t index = head.fetch_add(1, std::memory_order_relaxed);
+    Entry &entry = entries[index & (capacity - 1)];
+    entry.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    TraceRecord &record = entry.record;
+    record.timestamp = now();
+    record.category = category;
+    record.name = name;
+    record.value = value;
+    record.phase = phase;
+    currentThread(record.thread, record.threadName);
+    entry.sequence.store(index + 1, std::memory_order_release);
+}
+
+size_t Trace::snapshot(TraceRecord *out, size_t max) {
+    if (entries == nullptr)
+        return 0;
+    const uint32_t end = head.load(std::memory_order_acquire);
+    size_t available = end < capacity ? end : capacity;
+    if (available > max)
+        available = max;
+    size_t count = 0;
+    for (uint32_t index = end - available; index != end; index++) {
+        const Entry &entry = entries[index & (capacity - 1)];
+        if (entry.sequence.load(std::memory_order_acquire) != index + 1)
+            continue;
+        out[count] = entry.record;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // Overwritten while copying, the slot now belongs to a newer entry
+        if (entry.sequence.load(std::memory_order_relaxed) != index + 1)
+            continue;
+        count++;
+    }
+    return count;
+}
+
+TraceExport::TraceExport() {
+    const size_t capacity = Trace::getCapacity();
+    if (capacity == 0)
+        return;
+    if (exporting.exchange(true, std::memory_order_acquire)) {
+        valid = false;
+        return;
+    }
+    claimed = true;
+    records = static_cast<TraceRecord *>(allocate(capacity * sizeof(TraceRecord)));
+    if (records == nullptr) {
+        valid = false;
+        return;
+    }
+    count = Trace::snapshot(records, capacity);
+    for (size_t i = 0; i < count && threadCount < MAX_THREADS; i++) {
+        bool known = false;
+        for (size_t t = 0; t < threadCount && !known; t++) {
+            known = records[threads[t]].thread == records[i].thread;
+        }
+        if (!known)
+            threads[threadCount++] = i;
+    }
+}
+
+TraceExport::~TraceExport() {
+    free(records);
+    if (claimed)
+        exporting.store(false, std::memory_order_release);
+}
+
+bool TraceExport::next() {
+    pendingOffset = 0;
+    pendingLength = 0;
+    int written;
+    if (!headerWritten) {
+        headerWritten = true;
+        written = snprintf(pending, sizeof(pending), R"({"displayTimeUnit":"ms","traceEvents":[)");
+    } else if (threadIndex < threadCount) {
+        const TraceRecord &record = records[threads[threadIndex++]];
+        written = snprintf(pending, sizeof(pending), R"(%s{"name":"thread_name","ph":"M","pid":1,"tid":%u,"args":{"name":"%s"}})",
+                           first ? "" : ",", static_cast<unsigned>(record.thread), record.threadName);
+        first = false;
+    } else if (index < count) {
+        const TraceRecord &record = records[index++];
+        written = snprintf(pending, sizeof(pending), R"(%s{"name":"%s","cat":"%s","ph":"%c","ts":%.0f,"pid":1,"tid":%u)",
+                           first ? "" : ",", record.name, record.category, record.phase,
+                           static_cast<double>(record.timestamp), static_cast<unsigned>(record.thread));
+        first = false;
+        const bool fits = written > 0 && static_cast<size_t>(written) < sizeof(pending);
+        if (fits && record.phase == 'i') {
+            written += snprintf(pending + written, sizeof(pending) - written, R"(,"s":"t","args":{"value":%d}})",
+                                static_cast<int>(record.value));
+        } else if (fits) {
+            written += snprintf(pending + written, sizeof(pending) - written, "}");
+        }
+    } else if (!footerWritten) {
+        footerWritten = true;
+        written = snprintf(pending, sizeof(pending), "]}");
+    } else {
+        return false;
+    }
+    if (written < 0)
+        written = 0;
+    pendingLength = static_cast<size_t>(written) < sizeof(pending) ? written : sizeof(pending) - 1;
+    return true;
+}
+
+size_t TraceExport::read(char *buffer, size_t length) {
+    size_t total = 0;
+    while (total < length) {
+        if (pendingOffset == pendingLength && !next())
+            break;
+        size_t chunk = pendingLength - pendingOffset;
+        if (chunk > length - total)
+            chunk = length - total;
+        memcpy(buffer + total, pending + pendingOffset, chunk);
+        pendingOffset += chunk;
+        total += chunk;
+    }
+    return total;
+}
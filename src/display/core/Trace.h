@@ -0,0 +1,119 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Timeline of what happened across tasks, recorded into a fixed size ring buffer in PSRAM and exported in the Chrome
+// trace event format at /api/trace (open in chrome://tracing or ui.perfetto.dev). Recording is lock-free: writers
+// claim a slot with an atomic increment and publish it with a sequence number, the oldest entries are overwritten.
+// Names and categories are stored by pointer and must be string literals or otherwise live forever.
+// Enabled with -DGAGGIMATE_TRACE, without the flag the TRACE_ macros expand to nothing and no buffer is allocated.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+constexpr size_t TRACE_CAPACITY = 4096; // entries, must be a power of two
+constexpr size_t TRACE_THREAD_NAME_LENGTH = 16;
+
+struct TraceRecord {
+    uint64_t timestamp; // us since boot
+    const char *category;
+    const char *name;
+    uint32_t thread;
+    int32_t value; // passed as argument of instant events
+    char phase;    // 'B' begin, 'E' end, 'i' instant
+    char threadName[TRACE_THREAD_NAME_LENGTH];
+};
+
+class Trace {
+  public:
+    // Allocates the ring buffer, without it every record call returns right away
+    static bool begin(size_t capacity = TRACE_CAPACITY);
+    static bool isEnabled() { return entries != nullptr; }
+
+    static void record(char phase, const char *category, const char *name, int32_t value = 0);
+    static void instant(const char *category, const char *name, int32_t value = 0) { record('i', category, name, value); }
+
+    // Copies up to max of the newest entries into out, oldest first, skipping entries that are being written
+    static size_t snapshot(TraceRecord *out, size_t max);
+    static size_t getCapacity() { return capacity; }
+
+  private:
+    struct Entry {
+        std::atomic<uint32_t> sequence; // claimed index + 1 once written, 0 while being written
+        TraceRecord record;
+    };
+
+    static Entry *entries;
+    static size_t capacity;
+    static std::atomic<uint32_t> head;
+};
+
+// Records a begin event now and the matching end event when the scope is left
+class TraceScope {
+  public:
+    TraceScope(const char *category, const char *name) : category(category), name(name) { Trace::record('B', category, name); }
+    ~TraceScope() { Trace::record('E', category, name); }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+  private:
+    const char *category;
+    const char *name;
+};
+
+// Serializes a snapshot of the ring buffer as Chrome trace event JSON in pieces of any size, for chunked responses
+class TraceExport {
+  public:
+    TraceExport();
+    ~TraceExport();
+
+    TraceExport(const TraceExport &) = delete;
+    TraceExport &operator=(const TraceExport &) = delete;
+
+    // False if there was no memory for the snapshot or another export is still being sent
+    bool isValid() const { return valid; }
+
+    // Writes up to length bytes of the document, returns 0 once everything has been written
+    size_t read(char *buffer, size_t length);
+
+  private:
+    // Formats the next piece of the document into pending, returns false at the end
+    bool next();
+
+    static constexpr size_t MAX_THREADS = 24;
+
+    // Only one snapshot exists at a time, each one takes as much memory as the ring buffer
+    static std::atomic<bool> exporting;
+
+    bool valid = true;
+    bool claimed = false;
+    TraceRecord *records = nullptr;
+    size_t count = 0;
+    size_t index = 0;
+    size_t threads[MAX_THREADS]; // index of the first record of every thread, for the thread name metadata
+    size_t threadCount = 0;
+    size_t threadIndex = 0;
+    bool headerWritten = false;
+    bool footerWritten = false;
+    bool first = true;
+    char pending[192];
+    size_t pendingLength = 0;
+    size_t pendingOffset = 0;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#ifdef GAGGIMATE_TRACE
+#define TRACE_ENABLED true
+// Traces the rest of the enclosing block
+#define TRACE_SCOPE(category, name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(category, name)
+#define TRACE_INSTANT(category, name, value) Trace::instant(category, name, value)
+#else
+#define TRACE_ENABLED false
+#define TRACE_SCOPE(category, name)
+#define TRACE_INSTANT(category, name, value)
+#endif
+
+#endif // TRACE_H
@@ -0,0 +1,86 @@
+#ifndef TRANSITIONCURVE_H
+#define TRANSITIONCURVE_H
+
+#include <cmath>
+#include <display/models/profile.h>
+
+constexpr uint8_t TRANSITION_MAX_SEGMENTS = 4;
+constexpr float TRANSITION_EXPONENTIAL_RATE = 5.0f;
+
+// Normalized transition shape from 0 to 1, tabulated as equally spaced cubic segments when the profile is compiled
+// so the current setpoint can be evaluated in constant time while brewing.
+struct TransitionCurve {
+    TransitionType type = TransitionType::TRANSITION_TYPE_INSTANT;
+    float duration = 0.0f; // seconds, 0 means the setpoint changes instantly
+    uint8_t segments = 0;
+    float coefficients[TRANSITION_MAX_SEGMENTS][4] = {};
+
+    float evaluate(float elapsed) const {
+        if (segments == 0 || elapsed >= duration) {
+            return 1.0f;
+        }
+        if (elapsed <= 0.0f) {
+            return 0.0f;
+        }
+        const float position = elapsed / duration * segments;
+        const auto segment = static_cast<uint8_t>(position);
+        if (segment >= segments) {
+            return 1.0f;
+        }
+        const float t = position - segment;
+        const float *c = coefficients[segment];
+        return ((c[3] * t + c[2]) * t + c[1]) * t + c[0];
+    }
+
+    // Interpolates between the previous and the current setpoint
+    float interpolate(float from, float to, float elapsed) const { return from + (to - from) * evaluate(elapsed); }
+};
+
+// Cubic Hermite segment through (y0, m0) and (y1, m1) with slopes scaled to the segment width
+inline void setHermiteSegment(float *c, float y0, float y1, float m0, float m1) {
+    c[0] = y0;
+    c[1] = m0;
+    c[2] = 3.0f * (y1 - y0) - 2.0f * m0 - m1;
+    c[3] = 2.0f * (y0 - y1) + m0 + m1;
+}
+
+inline TransitionCurve compileTransition(const Transition &transition) {
+    TransitionCurve curve{};
+    if (transition.type == TransitionType::TRANSITION_TYPE_INSTANT || transition.duration <= 0.0f) {
+        return curve;
+    }
+    curve.type = transition.type;
+    curve.duration = transition.duration;
+    switch (transition.type) {
+    case TransitionType::TRANSITION_TYPE_LINEAR:
+        curve.segments = 1;
+        setHermiteSegment(curve.coefficients[0], 0.0f, 1.0f, 1.0f, 1.0f);
+        break;
+    case TransitionType::TRANSITION_TYPE_EASE_IN_OUT:
+        curve.segments = 1;
+        setHermiteSegment(curve.coefficients[0], 0.0f, 1.0f, 0.0f, 0.0f);
+        break;
+    case TransitionType::TRANSITION_TYPE_EXPONENTIAL: {
+        // (1 - e^(-kx)) / (1 - e^(-k)) approximated piecewise, exact at the segment boundaries
+        curve.segments = TRANSITION_MAX_SEGMENTS;
+        const float k = TRANSITION_EXPONENTIAL_RATE;
+        const float scale = 1.0f / (1.0f - std::exp(-k));
+        const float width = 1.0f / curve.segments;
+        for (uint8_t i = 0; i < curve.segments; i++) {
+            const float x0 = i * width;
+            const float x1 = x0 + width;
+            const float y0 = (1.0f - std::exp(-k * x0)) * scale;
+            const float y1 = (1.0f - std::exp(-k * x1)) * scale;
+            const float m0 = k * std::exp(-k * x0) * scale * width;
+            const float m1 = k * std::exp(-k * x1) * scale * width;
+            setHermiteSegment(curve.coefficients[i], y0, y1, m0, m1);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    return curve;
+}
+
+#endif // TRANSITIONCURVE_H
@@ -4,6 +4,11 @@
 
 #define PING_INTERVAL 1000
 #define PROGRESS_INTERVAL 100
+#define CONTROL_FALLBACK_INTERVAL 100 // control writes without any event, keeps the controller board fed
+#define CONTROL_MIN_INTERVAL 20       // minimum time between two control writes when events arrive in bursts
+#define CONTROL_LATENCY_LOG_SAMPLES 100
+#define OUTPUT_KEEPALIVE_ACTIVE_MS 250 // unchanged output state is repeated this often while a process runs
+#define OUTPUT_KEEPALIVE_IDLE_MS 2000
 #define HOT_WATER_SAFETY_DURATION_MS 30000
 #define STEAM_SAFETY_DURATION_MS 60000
 #define BREW_MIN_DURATION_MS 5000
@@ -11,6 +16,7 @@
 #define BREW_SAFETY_DURATION_MS BREW_MAX_DURATION_MS
 #define BREW_MIN_VOLUMETRIC 5.0
 #define BREW_MAX_VOLUMETRIC 250.0
+#define SCALE_DROPOUT_MS 1000
 #define DEFAULT_STANDBY_TIMEOUT_MS 900000
 #define MIN_TEMP 0
 #define MAX_TEMP 160
@@ -27,6 +33,8 @@
 #define MODE_WATER 3
 #define MODE_GRIND 4
 
-#define WIFI_CONNECT_ATTEMPTS 10
+#define WIFI_CONNECT_TIMEOUT 5000
+#define BLE_CONNECT_JOB_TIMEOUT 10000
+#define BLE_CONNECT_RETRY_DELAY 500
 
 #endif // CONSTANTS_H
@@ -1,32 +1,89 @@
 #ifndef PREDICTIVE_H
 #define PREDICTIVE_H
 
+#ifdef ARDUINO
 #include <Arduino.h>
+#endif
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+enum class VolumePredictorType { LINEAR = 0, QUADRATIC = 1, KALMAN = 2 };
+
+// Estimates the final volume of a process from a stream of timestamped scale measurements.
+// All times are in milliseconds and passed explicitly so predictors can be replayed on the host.
+class VolumePredictor {
+  public:
+    virtual ~VolumePredictor() = default;
+
+    virtual void addMeasurement(double volume, double time) = 0;
+
+    // Current flow rate in volume per millisecond, never negative
+    virtual double getRate(double time) const = 0;
+
+    // Volume expected to be in the cup `delay` ms after `time` if the process keeps running until then
+    virtual double predictVolume(double time, double delay) const = 0;
+
+    double getOvershootAdjustMillis(double expectedVolume, double actualVolume) const {
+        if (!hasMeasurements)
+            return 0.0;
+        const double rate = getRate(lastTime);
+        if (rate <= 0.0)
+            return 0.0;
+        double overshoot = actualVolume - expectedVolume;
+        return overshoot / rate;
+    }
+
+  protected:
+    bool hasMeasurements = false;
+    double lastTime = 0.0;
+    double lastVolume = 0.0;
+
+    void recordMeasurement(double volume, double time) {
+        hasMeasurements = true;
+        lastTime = time;
+        lastVolume = volume;
+    }
+};
 
-class VolumetricRateCalculator {
+// Least squares fit over a sliding window, shared by the linear and quadratic predictors
+class WindowedVolumePredictor : public VolumePredictor {
   public:
-    explicit VolumetricRateCalculator(double window_duration) : windowDuration(window_duration) {}
+    explicit WindowedVolumePredictor(double window_duration) : windowDuration(window_duration) {}
 
-    void addMeasurement(double volume) {
+    void addMeasurement(double volume, double time) override {
         measurements.emplace_back(volume);
-        measurementTimes.emplace_back(millis());
+        measurementTimes.emplace_back(time);
+        recordMeasurement(volume, time);
     }
 
-    double getRate(double time = 0) const {
-        if (time == 0) {
-            time = millis();
-        }
-        // perform a linear fit through the last PREDICTIVE_TIME (ms) of data time & measurement data and return the slope
-        if (measurements.size() < 2)
-            return 0.0;
+  protected:
+    std::vector<double> measurements;
+    std::vector<double> measurementTimes;
+    const double windowDuration;
 
+    // Index of the first measurement inside the window ending at time
+    size_t windowStart(double time) const {
         size_t i = measurementTimes.size();
         double cutoff = time - windowDuration;
-        while (measurementTimes[i - 1] > cutoff) { // check from the most recent time
+        while (i > 0 && measurementTimes[i - 1] > cutoff) { // check from the most recent time
             i--;
         }
-        // i is the index of the first entry after the cutoff
+        return i;
+    }
+};
+
+class VolumetricRateCalculator : public WindowedVolumePredictor {
+  public:
+    explicit VolumetricRateCalculator(double window_duration) : WindowedVolumePredictor(window_duration) {}
 
+    double getRate(double time) const override {
+        // perform a linear fit through the last windowDuration (ms) of data time & measurement data and return the slope
+        if (measurements.size() < 2)
+            return 0.0;
+
+        size_t i = windowStart(time);
         if (measurements.size() - i < 2)
             return 0.0;
 
@@ -42,24 +99,145 @@ class VolumetricRateCalculator {
         double tdev2 = 0.0;
         double tdev_vdev = 0.0;
         for (size_t j = i; j < measurements.size(); j++) {
-            tdev_vdev += (measurementTimes[i] - t_mean) * (measurements[i] - v_mean);
-            tdev2 += pow(measurementTimes[i] - t_mean, 2.0);
+            tdev_vdev += (measurementTimes[j] - t_mean) * (measurements[j] - v_mean);
+            tdev2 += pow(measurementTimes[j] - t_mean, 2.0);
         }
+        if (tdev2 <= 0.0)
+            return 0.0;
         double volumePerMilliSecond = tdev_vdev / tdev2;              // the slope (volume per millisecond) of the linear best fit
-        return volumePerMilliSecond > 0 ? volumePerMilliSecond : 0.0; // return 0 if it is not positive, convert to seconds
+        return volumePerMilliSecond > 0 ? volumePerMilliSecond : 0.0; // return 0 if it is not positive
     }
 
-    double getOvershootAdjustMillis(double expectedVolume, double actualVolume) {
-        if (measurementTimes.size() < 2)
+    double predictVolume(double time, double delay) const override { return lastVolume + getRate(time) * delay; }
+};
+
+// Fits v(t) = a + b*t + c*t^2 over the window, which follows accelerating and tapering flow.
+// The extrapolated flow is not allowed to drop below zero during the prediction horizon.
+class QuadraticVolumePredictor : public WindowedVolumePredictor {
+  public:
+    explicit QuadraticVolumePredictor(double window_duration) : WindowedVolumePredictor(window_duration) {}
+
+    double getRate(double time) const override {
+        double b, c;
+        if (!fit(time, b, c))
             return 0.0;
-        double overshoot = actualVolume - expectedVolume;
-        return overshoot / getRate(measurementTimes.back());
+        return b > 0.0 ? b : 0.0;
+    }
+
+    double predictVolume(double time, double delay) const override {
+        double b, c;
+        if (!fit(time, b, c))
+            return lastVolume;
+        if (b <= 0.0)
+            return lastVolume;
+        double horizon = delay;
+        if (c < 0.0) {
+            // stop extrapolating once the fitted flow reaches zero
+            const double zeroFlow = -b / (2.0 * c);
+            if (zeroFlow < horizon)
+                horizon = zeroFlow;
+        }
+        return lastVolume + b * horizon + c * horizon * horizon;
     }
 
   private:
-    std::vector<double> measurements;
-    std::vector<double> measurementTimes;
-    const double windowDuration;
+    // Returns the slope b and curvature c at the end of the window, with time measured relative to the last sample
+    bool fit(double time, double &b, double &c) const {
+        size_t i = windowStart(time);
+        const size_t n = measurements.size() - i;
+        if (n < 3)
+            return false;
+        const double t0 = measurementTimes.back();
+        double s1 = 0, s2 = 0, s3 = 0, s4 = 0, sv = 0, stv = 0, st2v = 0;
+        for (size_t j = i; j < measurements.size(); j++) {
+            const double t = measurementTimes[j] - t0;
+            const double t2 = t * t;
+            s1 += t;
+            s2 += t2;
+            s3 += t2 * t;
+            s4 += t2 * t2;
+            sv += measurements[j];
+            stv += t * measurements[j];
+            st2v += t2 * measurements[j];
+        }
+        // Solve the 3x3 normal equations with Cramer's rule
+        const double s0 = static_cast<double>(n);
+        const double det = s0 * (s2 * s4 - s3 * s3) - s1 * (s1 * s4 - s3 * s2) + s2 * (s1 * s3 - s2 * s2);
+        if (std::fabs(det) < 1e-12)
+            return false;
+        b = (s0 * (stv * s4 - s3 * st2v) - sv * (s1 * s4 - s3 * s2) + s2 * (s1 * st2v - stv * s2)) / det;
+        c = (s0 * (s2 * st2v - stv * s3) - s1 * (s1 * st2v - stv * s2) + sv * (s1 * s3 - s2 * s2)) / det;
+        return true;
+    }
 };
 
+// Constant flow Kalman filter over the state [volume, flow]. The flow is modelled as a random walk, so the filter
+// tracks changing flow without keeping a history of measurements.
+class KalmanVolumePredictor : public VolumePredictor {
+  public:
+    // processNoise is the flow variance added per ms, measurementNoise the scale variance
+    explicit KalmanVolumePredictor(double processNoise = 1e-9, double measurementNoise = 0.04)
+        : processNoise(processNoise), measurementNoise(measurementNoise) {}
+
+    void addMeasurement(double volume, double time) override {
+        if (!hasMeasurements) {
+            volumeEstimate = volume;
+            recordMeasurement(volume, time);
+            return;
+        }
+        const double dt = time - lastTime;
+        if (dt > 0.0) {
+            // predict
+            volumeEstimate += flowEstimate * dt;
+            p00 += dt * (p10 + p01) + dt * dt * p11 + processNoise * dt * dt * dt / 3.0;
+            p01 += dt * p11 + processNoise * dt * dt / 2.0;
+            p10 = p01;
+            p11 += processNoise * dt;
+        }
+        // update
+        const double innovation = volume - volumeEstimate;
+        const double s = p00 + measurementNoise;
+        const double k0 = p00 / s;
+        const double k1 = p10 / s;
+        volumeEstimate += k0 * innovation;
+        flowEstimate += k1 * innovation;
+        const double n00 = (1.0 - k0) * p00;
+        const double n01 = (1.0 - k0) * p01;
+        const double n11 = p11 - k1 * p01;
+        p00 = n00;
+        p01 = n01;
+        p10 = n01;
+        p11 = n11;
+        recordMeasurement(volume, time);
+    }
+
+    // Constant velocity model, the estimate holds until the next measurement
+    double getRate(double) const override { return flowEstimate > 0.0 ? flowEstimate : 0.0; }
+
+    double predictVolume(double time, double delay) const override {
+        if (!hasMeasurements)
+            return 0.0;
+        const double horizon = time - lastTime + delay;
+        return volumeEstimate + getRate(time) * horizon;
+    }
+
+  private:
+    const double processNoise;
+    const double measurementNoise;
+    double volumeEstimate = 0.0;
+    double flowEstimate = 0.0;
+    double p00 = 1.0, p01 = 0.0, p10 = 0.0, p11 = 1e-6;
+};
+
+inline std::unique_ptr<VolumePredictor> createVolumePredictor(VolumePredictorType type, double windowDuration) {
+    switch (type) {
+    case VolumePredictorType::QUADRATIC:
+        return std::unique_ptr<VolumePredictor>(new QuadraticVolumePredictor(windowDuration));
+    case VolumePredictorType::KALMAN:
+        return std::unique_ptr<VolumePredictor>(new KalmanVolumePredictor());
+    default:
+        return std::unique_ptr<VolumePredictor>(new VolumetricRateCalculator(windowDuration));
+    }
+}
+
 #endif
@@ -4,13 +4,39 @@
 #include <Arduino.h>
 #include <ArduinoJson.h>
 
-enum class TargetType { TARGET_TYPE_VOLUMETRIC, TARGET_TYPE_PRESSURE };
+enum class TargetType { TARGET_TYPE_VOLUMETRIC, TARGET_TYPE_PRESSURE, TARGET_TYPE_FLOW, TARGET_TYPE_TIME };
+
+enum class TargetOperator { OPERATOR_GTE, OPERATOR_LTE };
 
 struct Target {
     TargetType type;
     float value;
+    TargetOperator op = TargetOperator::OPERATOR_GTE;
 };
 
+inline TargetType parseTargetType(const String &type) {
+    if (type == "volumetric")
+        return TargetType::TARGET_TYPE_VOLUMETRIC;
+    if (type == "flow")
+        return TargetType::TARGET_TYPE_FLOW;
+    if (type == "time")
+        return TargetType::TARGET_TYPE_TIME;
+    return TargetType::TARGET_TYPE_PRESSURE;
+}
+
+inline const char *targetTypeToString(TargetType type) {
+    switch (type) {
+    case TargetType::TARGET_TYPE_VOLUMETRIC:
+        return "volumetric";
+    case TargetType::TARGET_TYPE_FLOW:
+        return "flow";
+    case TargetType::TARGET_TYPE_TIME:
+        return "time";
+    default:
+        return "pressure";
+    }
+}
+
 enum class PumpTarget { PUMP_TARGET_PRESSURE, PUMP_TARGET_FLOW };
 
 struct PumpAdvanced {
@@ -21,6 +47,37 @@ struct PumpAdvanced {
 
 enum class PhaseType { PHASE_TYPE_PREINFUSION, PHASE_TYPE_BREW };
 
+enum class TransitionType { TRANSITION_TYPE_INSTANT, TRANSITION_TYPE_LINEAR, TRANSITION_TYPE_EXPONENTIAL, TRANSITION_TYPE_EASE_IN_OUT };
+
+// Curve used to move the pump setpoints from the previous phase to this one
+struct Transition {
+    TransitionType type = TransitionType::TRANSITION_TYPE_INSTANT;
+    float duration = 0.0f; // seconds
+};
+
+inline TransitionType parseTransitionType(const String &type) {
+    if (type == "linear")
+        return TransitionType::TRANSITION_TYPE_LINEAR;
+    if (type == "exponential")
+        return TransitionType::TRANSITION_TYPE_EXPONENTIAL;
+    if (type == "ease-in-out")
+        return TransitionType::TRANSITION_TYPE_EASE_IN_OUT;
+    return TransitionType::TRANSITION_TYPE_INSTANT;
+}
+
+inline const char *transitionTypeToString(TransitionType type) {
+    switch (type) {
+    case TransitionType::TRANSITION_TYPE_LINEAR:
+        return "linear";
+    case TransitionType::TRANSITION_TYPE_EXPONENTIAL:
+        return "exponential";
+    case TransitionType::TRANSITION_TYPE_EASE_IN_OUT:
+        return "ease-in-out";
+    default:
+        return "instant";
+    }
+}
+
 struct Phase {
     String name;
     PhaseType phase; // "preinfusion" | "brew"
@@ -29,7 +86,9 @@ struct Phase {
     bool pumpIsSimple;
     int pumpSimple; // Used if pumpIsSimple == true
     PumpAdvanced pumpAdvanced;
+    Transition transition;
     std::vector<Target> targets;
+    bool timeExitFolded = false; // a time exit of an older profile shortened the duration
 
     bool hasVolumetricTarget() const {
         for (const auto &target : targets) {
@@ -112,13 +171,27 @@ inline bool parseProfile(const JsonObject &obj, Profile &profile) {
             phase.pumpAdvanced.flow = pump["flow"].as<float>();
         }
 
+        if (p["transition"].is<JsonObject>()) {
+            auto transition = p["transition"].as<JsonObject>();
+            phase.transition.type = parseTransitionType(transition["type"].as<String>());
+            phase.transition.duration = transition["duration"].as<float>();
+        }
+
         if (p["targets"].is<JsonArray>()) {
             auto targetsArray = p["targets"].as<JsonArray>();
             for (JsonObject t : targetsArray) {
                 Target target{};
-                target.type = t["type"].as<String>() == "volumetric" ? TargetType::TARGET_TYPE_VOLUMETRIC
-                                                                     : TargetType::TARGET_TYPE_PRESSURE;
+                target.type = parseTargetType(t["type"].as<String>());
                 target.value = t["value"].as<float>();
+                target.op = t["operator"].as<String>() == "lte" ? TargetOperator::OPERATOR_LTE : TargetOperator::OPERATOR_GTE;
+                if (target.type == TargetType::TARGET_TYPE_TIME) {
+                    // Older profiles had time exits next to the duration, whichever was shorter ended the phase
+                    if (target.op == TargetOperator::OPERATOR_GTE && target.value < phase.duration) {
+                        phase.duration = target.value;
+                        phase.timeExitFolded = true;
+                    }
+                    continue;
+                }
                 phase.targets.push_back(target);
             }
         }
@@ -155,12 +228,19 @@ inline void writeProfile(JsonObject &obj, const Profile &profile) {
             pump["flow"] = phase.pumpAdvanced.flow;
         }
 
+        if (phase.transition.type != TransitionType::TRANSITION_TYPE_INSTANT) {
+            auto transition = p["transition"].to<JsonObject>();
+            transition["type"] = transitionTypeToString(phase.transition.type);
+            transition["duration"] = phase.transition.duration;
+        }
+
         if (!phase.targets.empty()) {
             JsonArray targets = p["targets"].to<JsonArray>();
             for (const Target &t : phase.targets) {
                 auto tObj = targets.add<JsonObject>();
-                tObj["type"] = t.type == TargetType::TARGET_TYPE_VOLUMETRIC ? "volumetric" : "pressure";
+                tObj["type"] = targetTypeToString(t.type);
                 tObj["value"] = t.value;
+                tObj["operator"] = t.op == TargetOperator::OPERATOR_LTE ? "lte" : "gte";
             }
         }
     }
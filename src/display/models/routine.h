@@ -0,0 +1,137 @@
+#ifndef ROUTINE_H
+#define ROUTINE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <display/models/profile.h>
+
+enum class RoutineStepType {
+    ROUTINE_STEP_FLUSH,
+    ROUTINE_STEP_BREW,
+    ROUTINE_STEP_STEAM,
+    ROUTINE_STEP_WATER,
+    ROUTINE_STEP_GRIND,
+    ROUTINE_STEP_MODE,
+    ROUTINE_STEP_WAIT
+};
+
+enum class RoutineConditionType { CONDITION_NONE, CONDITION_TEMPERATURE, CONDITION_PRESSURE };
+
+// Condition that has to be met before a step starts, e.g. boiler temperature >= 140
+struct RoutineCondition {
+    RoutineConditionType type = RoutineConditionType::CONDITION_NONE;
+    TargetOperator op = TargetOperator::OPERATOR_GTE;
+    float value = 0.0f;
+};
+
+struct RoutineStep {
+    RoutineStepType type = RoutineStepType::ROUTINE_STEP_WAIT;
+    String profile;        // Brew only, profile to select before brewing, empty keeps the selected profile
+    int mode = 0;          // Mode only, the mode to switch to
+    float delay = 0.0f;    // seconds to wait after the condition is met
+    float duration = 0.0f; // seconds, length of a wait step or maximum run time of a process, 0 runs until it ends
+    RoutineCondition condition;
+};
+
+struct Routine {
+    String id;
+    String label;
+    String description;
+    std::vector<RoutineStep> steps;
+};
+
+inline RoutineStepType parseRoutineStepType(const String &type) {
+    if (type == "flush")
+        return RoutineStepType::ROUTINE_STEP_FLUSH;
+    if (type == "brew")
+        return RoutineStepType::ROUTINE_STEP_BREW;
+    if (type == "steam")
+        return RoutineStepType::ROUTINE_STEP_STEAM;
+    if (type == "water")
+        return RoutineStepType::ROUTINE_STEP_WATER;
+    if (type == "grind")
+        return RoutineStepType::ROUTINE_STEP_GRIND;
+    if (type == "mode")
+        return RoutineStepType::ROUTINE_STEP_MODE;
+    return RoutineStepType::ROUTINE_STEP_WAIT;
+}
+
+inline const char *routineStepTypeToString(RoutineStepType type) {
+    switch (type) {
+    case RoutineStepType::ROUTINE_STEP_FLUSH:
+        return "flush";
+    case RoutineStepType::ROUTINE_STEP_BREW:
+        return "brew";
+    case RoutineStepType::ROUTINE_STEP_STEAM:
+        return "steam";
+    case RoutineStepType::ROUTINE_STEP_WATER:
+        return "water";
+    case RoutineStepType::ROUTINE_STEP_GRIND:
+        return "grind";
+    case RoutineStepType::ROUTINE_STEP_MODE:
+        return "mode";
+    default:
+        return "wait";
+    }
+}
+
+inline bool parseRoutine(const JsonObject &obj, Routine &routine) {
+    if (obj["id"].is<String>())
+        routine.id = obj["id"].as<String>();
+    routine.label = obj["label"].as<String>();
+    routine.description = obj["description"].as<String>();
+
+    auto stepsArray = obj["steps"].as<JsonArray>();
+    for (JsonObject s : stepsArray) {
+        RoutineStep step;
+        step.type = parseRoutineStepType(s["type"].as<String>());
+        if (s["profile"].is<String>())
+            step.profile = s["profile"].as<String>();
+        step.mode = s["mode"] | 0;
+        step.delay = s["delay"] | 0.0f;
+        step.duration = s["duration"] | 0.0f;
+
+        if (s["condition"].is<JsonObject>()) {
+            auto condition = s["condition"].as<JsonObject>();
+            const String type = condition["type"].as<String>();
+            if (type == "temperature")
+                step.condition.type = RoutineConditionType::CONDITION_TEMPERATURE;
+            else if (type == "pressure")
+                step.condition.type = RoutineConditionType::CONDITION_PRESSURE;
+            step.condition.op =
+                condition["operator"].as<String>() == "lte" ? TargetOperator::OPERATOR_LTE : TargetOperator::OPERATOR_GTE;
+            step.condition.value = condition["value"].as<float>();
+        }
+
+        routine.steps.push_back(step);
+    }
+
+    return true;
+}
+
+inline void writeRoutine(JsonObject &obj, const Routine &routine) {
+    obj["id"] = routine.id;
+    obj["label"] = routine.label;
+    obj["description"] = routine.description;
+
+    auto stepsArray = obj["steps"].to<JsonArray>();
+    for (const RoutineStep &step : routine.steps) {
+        auto s = stepsArray.add<JsonObject>();
+        s["type"] = routineStepTypeToString(step.type);
+        if (step.type == RoutineStepType::ROUTINE_STEP_BREW && !step.profile.isEmpty())
+            s["profile"] = step.profile;
+        if (step.type == RoutineStepType::ROUTINE_STEP_MODE)
+            s["mode"] = step.mode;
+        s["delay"] = step.delay;
+        s["duration"] = step.duration;
+
+        if (step.condition.type != RoutineConditionType::CONDITION_NONE) {
+            auto condition = s["condition"].to<JsonObject>();
+            condition["type"] = step.condition.type == RoutineConditionType::CONDITION_TEMPERATURE ? "temperature" : "pressure";
+            condition["operator"] = step.condition.op == TargetOperator::OPERATOR_LTE ? "lte" : "gte";
+            condition["value"] = step.condition.value;
+        }
+    }
+}
+
+#endif // ROUTINE_H
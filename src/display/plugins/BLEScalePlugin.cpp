@@ -31,9 +31,9 @@ void BLEScalePlugin::setup(Controller *controller, PluginManager *manager) {
     TimemoreScalesPlugin::apply();
     VariaScalesPlugin::apply();
     this->scanner = new RemoteScalesScanner();
-    manager->on("controller:brew:start", [this](Event const &) { onProcessStart(); });
-    manager->on("controller:grind:start", [this](Event const &) { onProcessStart(); });
-    manager->on("controller:mode:change", [this](Event const &event) {
+    manager->on(EventId::CONTROLLER_BREW_START, [this](Event const &) { onProcessStart(MODE_BREW); });
+    manager->on(EventId::CONTROLLER_GRIND_START, [this](Event const &) { onProcessStart(MODE_GRIND); });
+    manager->on(EventId::CONTROLLER_MODE_CHANGE, [this](Event const &event) {
         if (event.getInt("value") != MODE_STANDBY) {
             ESP_LOGI("BLEScalePlugin", "Resuming scanning");
             scan();
@@ -52,6 +52,12 @@ void BLEScalePlugin::loop() {
         establishConnection();
     }
     const unsigned long now = millis();
+    if (tareAt != 0 && static_cast<long>(now - tareAt) >= 0) {
+        tareAt = 0;
+        if (scale != nullptr && scale->isConnected()) {
+            scale->tare();
+        }
+    }
     if (now - lastUpdate > UPDATE_INTERVAL_MS) {
         lastUpdate = now;
         update();
@@ -84,7 +90,11 @@ void BLEScalePlugin::update() {
 void BLEScalePlugin::connect(const std::string &uuid) {
     doConnect = true;
     this->uuid = uuid;
-    controller->getSettings().setSavedScale(uuid.data());
+    if (controller->getSettings().getSavedScale() != uuid.c_str()) {
+        // The learned stop delays include the latency of the scale that measured them
+        controller->getDelayLearner().resetAll();
+        controller->getSettings().setSavedScale(uuid.data());
+    }
 }
 
 void BLEScalePlugin::scan() const {
@@ -103,11 +113,17 @@ void BLEScalePlugin::disconnect() {
     }
 }
 
-void BLEScalePlugin::onProcessStart() const {
+void BLEScalePlugin::onProcessStart(int type) {
+    // Don't tare while another process is still weighing
+    for (Process *process : controller->getProcesses()) {
+        if (process->getType() != type && (process->getResources() & PROCESS_RESOURCE_SCALE)) {
+            return;
+        }
+    }
     if (scale != nullptr && scale->isConnected()) {
         scale->tare();
-        delay(50);
-        scale->tare();
+        // Tare again from loop() once the scale settled
+        tareAt = millis() + BLE_SCALE_TARE_SETTLE_MS;
     }
 }
 
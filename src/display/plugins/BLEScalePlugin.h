@@ -8,6 +8,7 @@ void on_ble_measurement(float value);
 
 constexpr unsigned long UPDATE_INTERVAL_MS = 1000;
 constexpr unsigned int RECONNECTION_TRIES = 15;
+constexpr unsigned long BLE_SCALE_TARE_SETTLE_MS = 50;
 
 class BLEScalePlugin : public Plugin {
   public:
@@ -29,7 +30,7 @@ class BLEScalePlugin : public Plugin {
 
   private:
     void update();
-    void onProcessStart() const;
+    void onProcessStart(int type);
 
     void establishConnection();
 
@@ -38,6 +39,7 @@ class BLEScalePlugin : public Plugin {
     std::string uuid;
 
     unsigned long lastUpdate = 0;
+    unsigned long tareAt = 0; // time of the pending second tare, 0 if none
     unsigned int reconnectionTries = 0;
 
     Controller *controller = nullptr;
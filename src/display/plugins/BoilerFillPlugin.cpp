@@ -5,13 +5,13 @@
 
 void BoilerFillPlugin::setup(Controller *controller, PluginManager *pluginManager) {
     this->controller = controller;
-    pluginManager->on("controller:ready", [this](Event const &event) {
-        this->controller->startProcess(new PumpProcess(this->controller->getSettings().getStartupFillTime()));
+    pluginManager->on(EventId::CONTROLLER_READY, [this](Event const &event) {
+        this->controller->startProcess(new PumpProcess(this->controller->getSettings().getStartupFillTime(), false));
     });
-    pluginManager->on("controller:mode:change", [this](Event const &event) {
+    pluginManager->on(EventId::CONTROLLER_MODE_CHANGE, [this](Event const &event) {
         int newMode = event.getInt("value");
         if (newMode == MODE_BREW && this->controller->getMode() == MODE_STEAM) {
-            this->controller->startProcess(new PumpProcess(this->controller->getSettings().getSteamFillTime()));
+            this->controller->startProcess(new PumpProcess(this->controller->getSettings().getSteamFillTime(), false));
         }
     });
 }
@@ -55,7 +55,7 @@ void HomekitPlugin::clearAction() { actionRequired = false; }
 void HomekitPlugin::setup(Controller *controller, PluginManager *pluginManager) {
     this->controller = controller;
 
-    pluginManager->on("controller:wifi:connect", [this](Event &event) {
+    pluginManager->on(EventId::CONTROLLER_WIFI_CONNECT, [this](Event &event) {
         int apMode = event.getInt("AP");
         if (apMode)
             return;
@@ -70,19 +70,22 @@ void HomekitPlugin::setup(Controller *controller, PluginManager *pluginManager)
         homeSpan.autoPoll();
     });
 
-    pluginManager->on("boiler:targetTemperature:change", [this](Event const &event) {
+    pluginManager->on(EventId::BOILER_TARGET_TEMPERATURE_CHANGE, [this](Event const &event) {
         if (accessory == nullptr)
             return;
         accessory->setTargetTemperature(event.getInt("value"));
     });
 
-    pluginManager->on("boiler:currentTemperature:change", [this](Event const &event) {
-        if (accessory == nullptr)
-            return;
-        accessory->setCurrentTemperature(event.getFloat("value"));
-    });
+    pluginManager->onLatest(
+        EventId::BOILER_CURRENT_TEMPERATURE_CHANGE,
+        [this](Event const &event) {
+            if (accessory == nullptr)
+                return;
+            accessory->setCurrentTemperature(event.getFloat("value"));
+        },
+        HOMEKIT_TEMPERATURE_INTERVAL);
 
-    pluginManager->on("controller:mode:change", [this](Event const &event) {
+    pluginManager->on(EventId::CONTROLLER_MODE_CHANGE, [this](Event const &event) {
         if (accessory == nullptr)
             return;
         accessory->setState(event.getInt("value") != MODE_STANDBY);
@@ -24,8 +24,40 @@ bool MQTTPlugin::connect(Controller *controller) {
     return false;
 }
 
+// Connecting retries with delays, so it runs on the connect worker and the setup continues on the loop task
+void MQTTPlugin::requestConnect() {
+    if (connecting)
+        return;
+    connecting = true;
+    lastConnectAttempt = millis();
+    const bool posted = connectWorker.post(
+        "mqtt:connect", [this]() { return connect(controller); },
+        [this](bool success) {
+            connecting = false;
+            if (success)
+                onConnected();
+        },
+        0, MQTT_CONNECTION_TIMEOUT);
+    if (!posted)
+        connecting = false;
+}
+
+void MQTTPlugin::onConnected() {
+    subscribe("routine/start");
+    subscribe("routine/stop");
+    char json[500];
+    String mac = WiFi.macAddress();
+    mac.replace(":", "_");
+    const char *cmac = mac.c_str();
+    snprintf(
+        json, sizeof(json),
+        R"***({"dev":{"ids":"%s","name":"GaggiMate","mf":"GaggiMate","mdl":"GaggiMate","sw":"1.0","sn":"%s","hw":"1.0"},"o":{"name":"GaggiMate","sw":"v0.3.0","url":"https://gaggimate.eu/"},"cmps":{"boiler":{"p":"sensor","device_class":"temperature","unit_of_measurement":"°C","value_template":"{{ value_json.temperature }}","unique_id":"boiler0Tmp","state_topic":"gaggimate/%s/boilers/0/temperature"}},"state_topic":"gaggimate/%s/state","qos":2})***",
+        cmac, cmac, cmac, cmac);
+    publish("config", json);
+}
+
 void MQTTPlugin::publish(const std::string &topic, const std::string &message) {
-    if (!client.connected())
+    if (connecting || !client.connected())
         return;
     String mac = WiFi.macAddress();
     mac.replace(":", "_");
@@ -34,6 +66,28 @@ void MQTTPlugin::publish(const std::string &topic, const std::string &message) {
     snprintf(publishTopic, sizeof(publishTopic), "gaggimate/%s/%s", cmac, topic.c_str());
     client.publish(publishTopic, message.c_str());
 }
+
+void MQTTPlugin::subscribe(const std::string &topic) {
+    String mac = WiFi.macAddress();
+    mac.replace(":", "_");
+    char subscribeTopic[80];
+    snprintf(subscribeTopic, sizeof(subscribeTopic), "gaggimate/%s/%s", mac.c_str(), topic.c_str());
+    client.subscribe(subscribeTopic);
+}
+
+void MQTTPlugin::loop() {
+    connectWorker.loop();
+    if (connecting)
+        return;
+    if (!client.connected()) {
+        if (wifiConnected && millis() - lastConnectAttempt > MQTT_RECONNECT_INTERVAL)
+            requestConnect();
+        return;
+    }
+    // Needed to receive routine commands, publishing is event based
+    client.loop();
+}
+
 void MQTTPlugin::publishBrewState(const char *state) {
     char json[100];
     std::time_t now = std::time(nullptr); // Get current timestame
@@ -41,41 +95,53 @@ void MQTTPlugin::publishBrewState(const char *state) {
     publish("controller/brew/state", json);
 }
 
+void MQTTPlugin::publishRoutineState(const char *state, const String &id, int step) {
+    char json[120];
+    std::time_t now = std::time(nullptr);
+    snprintf(json, sizeof(json), R"({"state":"%s","routine":"%s","step":%d,"timestamp":%ld})", state, id.c_str(), step, now);
+    publish("controller/routine/state", json);
+}
+
 void MQTTPlugin::setup(Controller *controller, PluginManager *pluginManager) {
-    pluginManager->on("controller:wifi:connect", [this, controller](const Event &) {
-        if (!connect(controller))
-            return;
-        char json[500];
-        String mac = WiFi.macAddress();
-        mac.replace(":", "_");
-        const char *cmac = mac.c_str();
-        snprintf(
-            json, sizeof(json),
-            R"***({"dev":{"ids":"%s","name":"GaggiMate","mf":"GaggiMate","mdl":"GaggiMate","sw":"1.0","sn":"%s","hw":"1.0"},"o":{"name":"GaggiMate","sw":"v0.3.0","url":"https://gaggimate.eu/"},"cmps":{"boiler":{"p":"sensor","device_class":"temperature","unit_of_measurement":"°C","value_template":"{{ value_json.temperature }}","unique_id":"boiler0Tmp","state_topic":"gaggimate/%s/boilers/0/temperature"}},"state_topic":"gaggimate/%s/state","qos":2})***",
-            cmac, cmac, cmac, cmac);
-        publish("config", json);
+    this->controller = controller;
+    connectWorker.setup();
+    // Payload of routine/start is the id of the routine to run
+    client.onMessage([controller](String &topic, String &payload) {
+        if (topic.endsWith("/routine/start")) {
+            controller->startRoutine(payload);
+        } else if (topic.endsWith("/routine/stop")) {
+            controller->stopRoutine();
+        }
     });
 
-    pluginManager->on("boiler:currentTemperature:change", [this](Event const &event) {
-        if (!client.connected())
-            return;
-        char json[50];
-        const float temp = event.getFloat("value");
-        if (temp != lastTemperature) {
-            snprintf(json, sizeof(json), R"***({"temperature":%02f})***", temp);
-            publish("boilers/0/temperature", json);
-        }
-        lastTemperature = temp;
+    pluginManager->on(EventId::CONTROLLER_WIFI_CONNECT, [this](const Event &) {
+        wifiConnected = true;
+        requestConnect();
     });
-    pluginManager->on("boiler:targetTemperature:change", [this](Event const &event) {
-        if (!client.connected())
+
+    pluginManager->onLatest(
+        EventId::BOILER_CURRENT_TEMPERATURE_CHANGE,
+        [this](Event const &event) {
+            if (connecting || !client.connected())
+                return;
+            char json[50];
+            const float temp = event.getFloat("value");
+            if (temp != lastTemperature) {
+                snprintf(json, sizeof(json), R"***({"temperature":%02f})***", temp);
+                publish("boilers/0/temperature", json);
+            }
+            lastTemperature = temp;
+        },
+        MQTT_TEMPERATURE_INTERVAL);
+    pluginManager->on(EventId::BOILER_TARGET_TEMPERATURE_CHANGE, [this](Event const &event) {
+        if (connecting || !client.connected())
             return;
         char json[50];
         const float temp = event.getInt("value");
         snprintf(json, sizeof(json), R"***({"temperature":%02f})***", temp);
         publish("boilers/0/targetTemperature", json);
     });
-    pluginManager->on("controller:mode:change", [this](Event const &event) {
+    pluginManager->on(EventId::CONTROLLER_MODE_CHANGE, [this](Event const &event) {
         int newMode = event.getInt("value");
         const char *modeStr;
         switch (newMode) {
@@ -102,7 +168,14 @@ void MQTTPlugin::setup(Controller *controller, PluginManager *pluginManager) {
         snprintf(json, sizeof(json), R"({"mode":%d,"mode_str":"%s"})", newMode, modeStr);
         publish("controller/mode", json);
     });
-    pluginManager->on("controller:brew:start", [this](Event const &) { publishBrewState("brewing"); });
+    pluginManager->on(EventId::CONTROLLER_BREW_START, [this](Event const &) { publishBrewState("brewing"); });
 
-    pluginManager->on("controller:brew:end", [this](Event const &) { publishBrewState("not brewing"); });
+    pluginManager->on(EventId::CONTROLLER_BREW_END, [this](Event const &) { publishBrewState("not brewing"); });
+
+    pluginManager->on(EventId::ROUTINES_STEP_CHANGE, [this](Event const &event) {
+        publishRoutineState("running", event.getString("id"), event.getInt("index"));
+    });
+    pluginManager->on(EventId::ROUTINES_ROUTINE_END, [this](Event const &event) {
+        publishRoutineState(event.getInt("completed") ? "completed" : "aborted", event.getString("id"), -1);
+    });
 }
\ No newline at end of file
@@ -1,27 +1,41 @@
 #ifndef MQTTPLUGIN_H
 #define MQTTPLUGIN_H
+#include "../core/JobWorker.h"
 #include "../core/Plugin.h"
 #include <MQTT.h>
 #include <WiFi.h>
 
 constexpr int MQTT_CONNECTION_RETRIES = 5;
 constexpr int MQTT_CONNECTION_DELAY = 1000;
+constexpr unsigned long MQTT_CONNECTION_TIMEOUT = MQTT_CONNECTION_RETRIES * (MQTT_CONNECTION_DELAY + 5000);
+constexpr unsigned long MQTT_RECONNECT_INTERVAL = 30000;
+constexpr unsigned long MQTT_TEMPERATURE_INTERVAL = 1000;
 
 class MQTTPlugin : public Plugin {
   public:
     void setup(Controller *controller, PluginManager *pluginManager) override;
     bool connect(Controller *controller);
-    void loop() override {
-        // Event based plugin, no loop needed
-    };
+    void loop() override;
 
   private:
+    void requestConnect();
+    void onConnected();
     void publish(const std::string &topic, const std::string &message);
+    void subscribe(const std::string &topic);
+    void publishRoutineState(const char *state, const String &id, int step);
     void publishBrewState(const char *state);
     MQTTClient client;
     WiFiClient net;
+    // An unreachable broker keeps a connect busy for up to MQTT_CONNECTION_TIMEOUT, it gets its own worker so the
+    // shared one stays free for jobs that can't wait that long
+    JobWorker connectWorker;
 
+    Controller *controller = nullptr;
     float lastTemperature = 0;
+    // The client is only touched by the connect worker while connecting, the loop task leaves it alone until then
+    volatile bool connecting = false;
+    bool wifiConnected = false;
+    unsigned long lastConnectAttempt = 0;
 };
 
 #endif // MQTTPLUGIN_H
@@ -7,33 +7,47 @@
 
 void SmartGrindPlugin::setup(Controller *controller, PluginManager *pluginManager) {
     this->controller = controller;
-    pluginManager->on("controller:grind:start", [this](Event const &event) { start(); });
-    pluginManager->on("controller:grind:end", [this](Event const &event) { stop(); });
+    pluginManager->on(EventId::CONTROLLER_GRIND_START, [this](Event const &event) { start(); });
+    pluginManager->on(EventId::CONTROLLER_GRIND_END, [this](Event const &event) { stop(); });
 }
 
 void SmartGrindPlugin::start() {
     Settings &settings = this->controller->getSettings();
     if (settings.getSmartGrindMode() == SG_MODE_ON_OFF) {
-        controlRelay(COMMAND_ON);
+        postRelayCommand(COMMAND_ON);
     }
 }
 
 void SmartGrindPlugin::stop() {
     Settings &settings = controller->getSettings();
-    controlRelay(COMMAND_OFF);
+    // Leaving the grinder running is worse than switching it off late, so this one never expires
+    postRelayCommand(COMMAND_OFF, 0, false);
     if (settings.getSmartGrindMode() == SG_MODE_OFF_ON) {
-        delay(500);
-        controlRelay(COMMAND_ON);
+        // Jobs run one at a time, so the relay is switched back on after the off request went through
+        postRelayCommand(COMMAND_ON, SG_RESTART_DELAY_MS);
     }
 }
 
-void SmartGrindPlugin::controlRelay(String command) {
+void SmartGrindPlugin::postRelayCommand(const String &command, unsigned long delay, bool expires) {
+    const String ip = controller->getSettings().getSmartGrindIp();
+    controller->getJobWorker()->post(
+        "smartgrind:relay", [this, ip, command]() { return controlRelay(ip, command); },
+        [](bool success) {
+            if (!success) {
+                printf("Failed to switch Relay\n");
+            }
+        },
+        delay, SG_REQUEST_TIMEOUT_MS * 2, expires);
+}
+
+// Runs on the job worker
+bool SmartGrindPlugin::controlRelay(const String &ip, const String &command) {
     HTTPClient http;
-    Settings &settings = controller->getSettings();
-    String serverPath = "http://" + settings.getSmartGrindIp() + "/cm?cmnd=" + command;
+    String serverPath = "http://" + ip + "/cm?cmnd=" + command;
+    http.setConnectTimeout(SG_REQUEST_TIMEOUT_MS);
+    http.setTimeout(SG_REQUEST_TIMEOUT_MS);
     http.begin(serverPath);
     int responseCode = http.GET();
-    if (responseCode != 200) {
-        printf("Failed to switch Relay\n");
-    }
+    http.end();
+    return responseCode == 200;
 }
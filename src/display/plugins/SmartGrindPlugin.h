@@ -10,6 +10,9 @@ constexpr int SG_MODE_OFF = 0;
 constexpr int SG_MODE_OFF_ON = 1;
 constexpr int SG_MODE_ON_OFF = 2;
 
+constexpr unsigned long SG_REQUEST_TIMEOUT_MS = 2000;
+constexpr unsigned long SG_RESTART_DELAY_MS = 500;
+
 struct Event;
 
 class SmartGrindPlugin : public Plugin {
@@ -20,7 +23,8 @@ class SmartGrindPlugin : public Plugin {
   private:
     void start();
     void stop();
-    void controlRelay(String command);
+    void postRelayCommand(const String &command, unsigned long delay = 0, bool expires = true);
+    bool controlRelay(const String &ip, const String &command);
 
     Controller *controller = nullptr;
 };
@@ -3,7 +3,9 @@
 #include <SPIFFS.h>
 #include <display/core/Controller.h>
 #include <display/core/ProfileManager.h>
+#include <display/core/Trace.h>
 #include <display/models/profile.h>
+#include <display/models/routine.h>
 
 #include "BLEScalePlugin.h"
 
@@ -17,52 +19,67 @@ void WebUIPlugin::setup(Controller *_controller, PluginManager *_pluginManager)
         BUILD_GIT_VERSION, controller->getSystemInfo().version,
         RELEASE_URL + (controller->getSettings().getOTAChannel() == "latest" ? "latest" : "tag/nightly"),
         [this](uint8_t phase) {
-            pluginManager->trigger("ota:update:phase", "phase", phase);
+            pluginManager->trigger(EventId::OTA_UPDATE_PHASE, "phase", phase);
             updateOTAProgress(phase, 0);
         },
         [this](uint8_t phase, int progress) {
-            pluginManager->trigger("ota:update:progress", "progress", progress);
+            pluginManager->trigger(EventId::OTA_UPDATE_PROGRESS, "progress", progress);
             updateOTAProgress(phase, progress);
         },
         "display-firmware.bin", "display-filesystem.bin", "board-firmware.bin");
-    pluginManager->on("controller:wifi:connect", [this](Event const &event) {
+    pluginManager->on(EventId::CONTROLLER_WIFI_CONNECT, [this](Event const &event) {
         const int apMode = event.getInt("AP");
         start(apMode);
     });
-    pluginManager->on("controller:ready", [this](Event const &) {
+    pluginManager->on(EventId::CONTROLLER_READY, [this](Event const &) {
         ota->setControllerVersion(controller->getSystemInfo().version);
         ota->init(controller->getClientController()->getClient());
     });
-    pluginManager->on("controller:autotune:result", [this](Event const &event) { sendAutotuneResult(); });
+    pluginManager->on(EventId::CONTROLLER_AUTOTUNE_RESULT, [this](Event const &event) { sendAutotuneResult(); });
 }
 
 void WebUIPlugin::loop() {
     if (updating) {
-        pluginManager->trigger("ota:update:start");
+        pluginManager->trigger(EventId::OTA_UPDATE_START);
         ota->update(updateComponent != "display", updateComponent != "controller");
-        pluginManager->trigger("ota:update:end");
+        pluginManager->trigger(EventId::OTA_UPDATE_END);
         updating = false;
     }
     const long now = millis();
     if (lastUpdateCheck == 0 || now > lastUpdateCheck + UPDATE_CHECK_INTERVAL) {
         ota->checkForUpdates();
-        pluginManager->trigger("ota:update:status", "value", ota->isUpdateAvailable());
+        pluginManager->trigger(EventId::OTA_UPDATE_STATUS, "value", ota->isUpdateAvailable());
         lastUpdateCheck = now;
         updateOTAStatus(ota->getCurrentVersion());
     }
     if (now > lastStatus + STATUS_PERIOD) {
         lastStatus = now;
+        const MachineState state = controller->getState();
         JsonDocument doc;
         doc["tp"] = "evt:status";
-        doc["ct"] = controller->getCurrentTemp();
-        doc["tt"] = controller->getTargetTemp();
-        doc["pr"] = controller->getCurrentPressure();
-        doc["fl"] = controller->getCurrentFlow();
-        doc["pt"] = controller->getTargetPressure();
-        doc["m"] = controller->getMode();
-        doc["p"] = controller->getProfileManager()->getSelectedProfile().label;
+        doc["ct"] = state.currentTemp;
+        doc["tt"] = state.targetTemp;
+        doc["pr"] = state.pressure;
+        doc["fl"] = state.flow;
+        doc["pt"] = state.targetPressure;
+        doc["m"] = state.mode;
+        doc["p"] = state.profileLabel;
         doc["cp"] = controller->getSystemInfo().capabilities.pressure;
         doc["cd"] = controller->getSystemInfo().capabilities.dimming;
+        auto processes = doc["ps"].to<JsonArray>();
+        for (uint8_t i = 0; i < state.processCount; i++) {
+            auto p = processes.add<JsonObject>();
+            p["t"] = state.processes[i].type;
+            p["a"] = state.processes[i].active;
+            p["r"] = state.processes[i].resources;
+        }
+        if (state.routine.running) {
+            auto routine = doc["rt"].to<JsonObject>();
+            routine["id"] = state.routine.id;
+            routine["l"] = state.routine.label;
+            routine["s"] = state.routine.step;
+            routine["w"] = state.routine.waiting;
+        }
         ws.textAll(doc.as<String>());
     }
     if (now > lastCleanup + CLEANUP_PERIOD) {
@@ -97,13 +114,17 @@ void WebUIPlugin::start(bool apMode) {
     server.on("/api/settings", [this](AsyncWebServerRequest *request) { handleSettings(request); });
     server.on("/api/status", [this](AsyncWebServerRequest *request) {
         AsyncResponseStream *response = request->beginResponseStream("application/json");
+        // Runs on the AsyncTCP task, read the published state instead of the controller fields
+        const MachineState state = controller->getState();
         JsonDocument doc;
-        doc["mode"] = controller->getMode();
-        doc["tt"] = controller->getTargetTemp();
-        doc["ct"] = controller->getCurrentTemp();
+        doc["mode"] = state.mode;
+        doc["tt"] = state.targetTemp;
+        doc["ct"] = state.currentTemp;
         serializeJson(doc, *response);
         request->send(response);
     });
+    server.on("/api/metrics", [this](AsyncWebServerRequest *request) { handleMetrics(request); });
+    server.on("/api/trace", [this](AsyncWebServerRequest *request) { handleTrace(request); });
     server.on("/api/scales/list", [this](AsyncWebServerRequest *request) { handleBLEScaleList(request); });
     server.on("/api/scales/connect", [this](AsyncWebServerRequest *request) { handleBLEScaleConnect(request); });
     server.on("/api/scales/scan", [this](AsyncWebServerRequest *request) { handleBLEScaleScan(request); });
@@ -111,6 +132,7 @@ void WebUIPlugin::start(bool apMode) {
     server.on("/ota", [](AsyncWebServerRequest *request) { request->send(SPIFFS, "/w/index.html"); });
     server.on("/settings", [](AsyncWebServerRequest *request) { request->send(SPIFFS, "/w/index.html"); });
     server.on("/scales", [](AsyncWebServerRequest *request) { request->send(SPIFFS, "/w/index.html"); });
+    server.on("/routines", [](AsyncWebServerRequest *request) { request->send(SPIFFS, "/w/index.html"); });
     server.serveStatic("/", SPIFFS, "/w").setDefaultFile("index.html").setCacheControl("max-age=0");
     ws.onEvent(
         [this](AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len) {
@@ -131,6 +153,8 @@ void WebUIPlugin::start(bool apMode) {
                             String msgType = doc["tp"].as<String>();
                             if (msgType.startsWith("req:profiles:")) {
                                 handleProfileRequest(client->id(), doc);
+                            } else if (msgType.startsWith("req:routines:")) {
+                                handleRoutineRequest(client->id(), doc);
                             } else if (msgType == "req:ota-settings") {
                                 handleOTASettings(client->id(), doc);
                             } else if (msgType == "req:ota-start") {
@@ -194,6 +218,13 @@ void WebUIPlugin::handleProfileRequest(uint32_t clientId, JsonDocument &request)
             profileManager->loadProfile(id, profile);
             auto p = arr.add<JsonObject>();
             writeProfile(p, profile);
+            const LearnedDelay learned = controller->getDelayLearner().get(profile.id.c_str());
+            if (learned.samples > 0) {
+                auto learnedDelay = p["learnedDelay"].to<JsonObject>();
+                learnedDelay["delay"] = learned.mean;
+                learnedDelay["deviation"] = sqrtf(learned.variance);
+                learnedDelay["shots"] = learned.samples;
+            }
         }
     } else if (type == "req:profiles:load") {
         auto id = request["id"].as<String>();
@@ -217,10 +248,15 @@ void WebUIPlugin::handleProfileRequest(uint32_t clientId, JsonDocument &request)
         auto id = request["id"].as<String>();
         if (!profileManager->deleteProfile(id)) {
             response["error"] = "Delete failed";
+        } else {
+            controller->getDelayLearner().reset(id.c_str());
         }
     } else if (type == "req:profiles:select") {
         auto id = request["id"].as<String>();
         profileManager->selectProfile(id);
+    } else if (type == "req:profiles:reset-delay") {
+        auto id = request["id"].as<String>();
+        controller->getDelayLearner().reset(id.c_str());
     } else if (type == "req:profiles:favorite") {
         auto id = request["id"].as<String>();
         controller->getSettings().addFavoritedProfile(id);
@@ -234,6 +270,59 @@ void WebUIPlugin::handleProfileRequest(uint32_t clientId, JsonDocument &request)
     ws.text(clientId, msg);
 }
 
+void WebUIPlugin::handleRoutineRequest(uint32_t clientId, JsonDocument &request) {
+    JsonDocument response;
+    auto type = request["tp"].as<String>();
+    ESP_LOGI("WebUIPlugin", "Handling request: %s", type.c_str());
+    response["tp"] = String("res:") + type.substring(4);
+    response["rid"] = request["rid"].as<String>();
+    RoutineManager *routineManager = controller->getRoutineManager();
+
+    if (type == "req:routines:list") {
+        auto arr = response["routines"].to<JsonArray>();
+        for (auto const &id : routineManager->listRoutines()) {
+            Routine routine{};
+            routineManager->loadRoutine(id, routine);
+            auto r = arr.add<JsonObject>();
+            writeRoutine(r, routine);
+        }
+    } else if (type == "req:routines:load") {
+        auto id = request["id"].as<String>();
+        Routine routine;
+        if (routineManager->loadRoutine(id, routine)) {
+            auto obj = response["routine"].to<JsonObject>();
+            writeRoutine(obj, routine);
+        } else {
+            response["error"] = "Routine not found";
+        }
+    } else if (type == "req:routines:save") {
+        auto obj = request["routine"].as<JsonObject>();
+        Routine routine;
+        parseRoutine(obj, routine);
+        if (!routineManager->saveRoutine(routine)) {
+            response["error"] = "Save failed";
+        }
+        auto respObj = response["routine"].to<JsonObject>();
+        writeRoutine(respObj, routine);
+    } else if (type == "req:routines:delete") {
+        auto id = request["id"].as<String>();
+        if (!routineManager->deleteRoutine(id)) {
+            response["error"] = "Delete failed";
+        }
+    } else if (type == "req:routines:start") {
+        auto id = request["id"].as<String>();
+        if (!controller->startRoutine(id)) {
+            response["error"] = "Routine could not be started";
+        }
+    } else if (type == "req:routines:stop") {
+        controller->stopRoutine();
+    }
+
+    String msg;
+    serializeJson(response, msg);
+    ws.text(clientId, msg);
+}
+
 void WebUIPlugin::handleSettings(AsyncWebServerRequest *request) const {
     if (request->method() == HTTP_POST) {
         controller->getSettings().batchUpdate([request](Settings *settings) {
@@ -276,9 +365,13 @@ void WebUIPlugin::handleSettings(AsyncWebServerRequest *request) const {
             if (request->hasArg("haPort"))
                 settings->setHomeAssistantPort(request->arg("haPort").toInt());
             settings->setMomentaryButtons(request->hasArg("momentaryButtons"));
+            if (request->hasArg("brewButtonRoutine"))
+                settings->setBrewButtonRoutine(request->arg("brewButtonRoutine"));
             settings->setDelayAdjust(request->hasArg("delayAdjust"));
             if (request->hasArg("brewDelay"))
                 settings->setBrewDelay(request->arg("brewDelay").toDouble());
+            if (request->hasArg("volumePredictor"))
+                settings->setVolumePredictor(request->arg("volumePredictor").toInt());
             if (request->hasArg("grindDelay"))
                 settings->setGrindDelay(request->arg("grindDelay").toDouble());
             if (request->hasArg("timezone"))
@@ -316,9 +409,11 @@ void WebUIPlugin::handleSettings(AsyncWebServerRequest *request) const {
     doc["smartGrindIp"] = settings.getSmartGrindIp();
     doc["smartGrindMode"] = settings.getSmartGrindMode();
     doc["momentaryButtons"] = settings.isMomentaryButtons();
+    doc["brewButtonRoutine"] = settings.getBrewButtonRoutine();
     doc["brewDelay"] = settings.getBrewDelay();
     doc["grindDelay"] = settings.getGrindDelay();
     doc["delayAdjust"] = settings.isDelayAdjust();
+    doc["volumePredictor"] = settings.getVolumePredictor();
     doc["timezone"] = settings.getTimezone();
     doc["clock24hFormat"] = settings.isClock24hFormat();
     doc["standbyTimeout"] = settings.getStandbyTimeout() / 1000;
@@ -380,6 +475,115 @@ void WebUIPlugin::handleBLEScaleInfo(AsyncWebServerRequest *request) {
     request->send(response);
 }
 
+// Profiler zones in microseconds, ?reset=1 clears them after reading. Control latencies are always collected, "link"
+// has the clock offset of the controller board and the BLE round trip and sensor latencies, histograms as in zones.
+void WebUIPlugin::handleMetrics(AsyncWebServerRequest *request) const {
+    JsonDocument doc;
+    doc["enabled"] = PROFILER_ENABLED;
+    doc["freq"] = ESP.getCpuFreqMHz();
+    doc["heap"] = ESP.getFreeHeap();
+    auto zones = doc["zones"].to<JsonObject>();
+    Profiler::forEach([&zones](const ProfileZone &zone) {
+        auto z = zones[zone.name].to<JsonObject>();
+        z["count"] = zone.count;
+        z["min"] = zone.count > 0 ? zone.min : 0;
+        z["avg"] = zone.average();
+        z["max"] = zone.max;
+        auto histogram = z["hist"].to<JsonArray>();
+        for (uint32_t bucket : zone.histogram) {
+            histogram.add(bucket);
+        }
+    });
+    auto addLatency = [](JsonObject l, const LatencyStats &stats) {
+        l["count"] = stats.count;
+        l["last"] = stats.last;
+        l["avg"] = stats.average();
+        l["max"] = stats.max;
+        auto histogram = l["hist"].to<JsonArray>();
+        for (uint32_t bucket : stats.histogram) {
+            histogram.add(bucket);
+        }
+    };
+    auto latency = doc["control"].to<JsonObject>();
+    const struct {
+        ControlEvent event;
+        const char *name;
+    } events[] = {{ControlEvent::SENSOR, "sensor"}, {ControlEvent::BUTTON, "button"}};
+    for (const auto &event : events) {
+        addLatency(latency[event.name].to<JsonObject>(), controller->getControlLatency(event.event));
+    }
+    auto link = doc["link"].to<JsonObject>();
+    const ClockSync clock = controller->getClockSync();
+    link["synced"] = clock.isSynced();
+    link["offset"] = clock.getOffset();
+    link["rtt"] = clock.getRoundTrip();
+    link["jitter"] = clock.getJitter();
+    link["exchanges"] = clock.getExchanges();
+    addLatency(link["roundTrip"].to<JsonObject>(), controller->getRoundTripLatency());
+    addLatency(link["sensor"].to<JsonObject>(), controller->getSensorLatency());
+    const NimBLEClientController *clientController = controller->getClientController();
+    link["mode"] = getLinkModeName(clientController->getLinkMode());
+    auto modes = link["modes"].to<JsonObject>();
+    for (uint8_t i = 0; i < BLE_LINK_MODE_COUNT; i++) {
+        const auto linkMode = static_cast<BLELinkMode>(i);
+        const BLEConnectionParams &params = getLinkModeParams(linkMode);
+        auto m = modes[getLinkModeName(linkMode)].to<JsonObject>();
+        m["interval"] = params.maxInterval * 1250; // µs, the longest interval of the range
+        m["latency"] = params.latency;
+        addLatency(m["notify"].to<JsonObject>(), controller->getNotifyLatency(linkMode));
+    }
+    auto tasks = doc["tasks"].to<JsonObject>();
+    for (uint8_t i = 0; i < controller->getTaskDiagnosticsCount(); i++) {
+        const TaskDiagnostics diagnostics = controller->getTaskDiagnostics(i);
+        auto t = tasks[diagnostics.name].to<JsonObject>();
+        t["period"] = diagnostics.period;
+        t["count"] = diagnostics.count;
+        t["missed"] = diagnostics.missed;
+        t["periodAvg"] = diagnostics.periodAvg;
+        t["periodMax"] = diagnostics.periodMax;
+        t["execAvg"] = diagnostics.execAvg;
+        t["execMax"] = diagnostics.execMax;
+        auto jitter = t["jitter"].to<JsonArray>();
+        auto exec = t["exec"].to<JsonArray>();
+        for (uint8_t b = 0; b < TASK_DIAGNOSTICS_BUCKETS; b++) {
+            jitter.add(diagnostics.jitter[b]);
+            exec.add(diagnostics.exec[b]);
+        }
+    }
+    auto boot = doc["boot"].to<JsonArray>();
+    for (uint8_t i = 0; i < BootTrace::getCount(); i++) {
+        const BootStage stage = BootTrace::get(i);
+        auto b = boot.add<JsonObject>();
+        b["stage"] = stage.name;
+        b["ms"] = stage.time;
+    }
+    if (request->hasParam("reset")) {
+        Profiler::reset();
+    }
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+    serializeJson(doc, *response);
+    request->send(response);
+}
+
+void WebUIPlugin::handleTrace(AsyncWebServerRequest *request) const {
+    if (!Trace::isEnabled()) {
+        request->send(404, "text/plain", "Tracing is not enabled in this build");
+        return;
+    }
+    // The snapshot lives in PSRAM until the response has been sent, the document is too large to build in memory
+    auto exporter = std::make_shared<TraceExport>();
+    if (!exporter->isValid()) {
+        request->send(503);
+        return;
+    }
+    AsyncWebServerResponse *response =
+        request->beginChunkedResponse("application/json", [exporter](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+            return exporter->read(reinterpret_cast<char *>(buffer), maxLen);
+        });
+    response->addHeader("Content-Disposition", "attachment; filename=\"gaggimate-trace.json\"");
+    request->send(response);
+}
+
 void WebUIPlugin::updateOTAStatus(const String &version) {
     Settings const &settings = controller->getSettings();
     JsonDocument doc;
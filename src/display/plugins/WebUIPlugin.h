@@ -35,6 +35,7 @@ class WebUIPlugin : public Plugin {
     void handleOTAStart(uint32_t clientId, JsonDocument &request);
     void handleAutotuneStart(uint32_t clientId, JsonDocument &request);
     void handleProfileRequest(uint32_t clientId, JsonDocument &request);
+    void handleRoutineRequest(uint32_t clientId, JsonDocument &request);
 
     // HTTP handlers
     void handleSettings(AsyncWebServerRequest *request) const;
@@ -42,6 +43,8 @@ class WebUIPlugin : public Plugin {
     void handleBLEScaleScan(AsyncWebServerRequest *request);
     void handleBLEScaleConnect(AsyncWebServerRequest *request);
     void handleBLEScaleInfo(AsyncWebServerRequest *request);
+    void handleMetrics(AsyncWebServerRequest *request) const;
+    void handleTrace(AsyncWebServerRequest *request) const;
     void updateOTAStatus(const String &version);
     void updateOTAProgress(uint8_t phase, int progress);
     void sendAutotuneResult();
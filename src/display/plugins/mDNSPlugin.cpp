@@ -6,7 +6,7 @@
 
 void mDNSPlugin::setup(Controller *controller, PluginManager *pluginManager) {
     this->controller = controller;
-    pluginManager->on("controller:wifi:connect", [this](Event const &event) { start(event); });
+    pluginManager->on(EventId::CONTROLLER_WIFI_CONNECT, [this](Event const &event) { start(event); });
 }
 void mDNSPlugin::start(Event const &event) const {
     const int apMode = event.getInt("AP");
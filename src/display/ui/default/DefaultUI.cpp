@@ -3,6 +3,7 @@
 #include <WiFi.h>
 #include <display/core/Controller.h>
 #include <display/core/Process.h>
+#include <display/core/Trace.h>
 #include <display/drivers/LilyGoDriver.h>
 #include <display/drivers/WaveshareDriver.h>
 #include <display/drivers/common/LV_Helper.h>
@@ -10,6 +11,21 @@
 
 static EffectManager effect_mgr;
 
+static const char *getProcessName(int type) {
+    switch (type) {
+    case MODE_BREW:
+        return "BREW";
+    case MODE_STEAM:
+        return "STEAM";
+    case MODE_WATER:
+        return "WATER";
+    case MODE_GRIND:
+        return "GRIND";
+    default:
+        return "";
+    }
+}
+
 int16_t calculate_angle(int set_temp, int range, int offset) {
     const double percentage = static_cast<double>(set_temp) / static_cast<double>(MAX_TEMP);
     return (percentage * ((double)range)) - range / 2 - offset;
@@ -22,30 +38,31 @@ DefaultUI::DefaultUI(Controller *controller, PluginManager *pluginManager)
 
 void DefaultUI::init() {
     auto triggerRender = [this](Event const &) { rerender = true; };
-    pluginManager->on("boiler:currentTemperature:change", [=](Event const &event) {
+    // Sensor values only need to be current when the next frame renders
+    pluginManager->onLatest(EventId::BOILER_CURRENT_TEMPERATURE_CHANGE, [=](Event const &event) {
         currentTemp = event.getFloat("value");
         rerender = true;
     });
-    pluginManager->on("boiler:pressure:change", [=](Event const &event) {
+    pluginManager->onLatest(EventId::BOILER_PRESSURE_CHANGE, [=](Event const &event) {
         pressure = event.getFloat("value");
         rerender = true;
     });
-    pluginManager->on("boiler:targetTemperature:change", [=](Event const &event) {
+    pluginManager->on(EventId::BOILER_TARGET_TEMPERATURE_CHANGE, [=](Event const &event) {
         targetTemp = event.getInt("value");
         rerender = true;
     });
-    pluginManager->on("controller:grindDuration:change", [=](Event const &event) {
+    pluginManager->on(EventId::CONTROLLER_GRIND_DURATION_CHANGE, [=](Event const &event) {
         grindDuration = event.getInt("value");
         rerender = true;
     });
-    pluginManager->on("controller:grindVolume:change", [=](Event const &event) {
+    pluginManager->on(EventId::CONTROLLER_GRIND_VOLUME_CHANGE, [=](Event const &event) {
         grindVolume = event.getFloat("value");
         rerender = true;
     });
-    pluginManager->on("controller:grind:end", triggerRender);
-    pluginManager->on("controller:grind:start", triggerRender);
-    pluginManager->on("controller:brew:start", triggerRender);
-    pluginManager->on("controller:mode:change", [this](Event const &event) {
+    pluginManager->on(EventId::CONTROLLER_GRIND_END, triggerRender);
+    pluginManager->on(EventId::CONTROLLER_GRIND_START, triggerRender);
+    pluginManager->on(EventId::CONTROLLER_BREW_START, triggerRender);
+    pluginManager->on(EventId::CONTROLLER_MODE_CHANGE, [this](Event const &event) {
         switch (int mode = event.getInt("value")) {
         case MODE_STANDBY:
             changeScreen(&ui_StandbyScreen, &ui_StandbyScreen_screen_init);
@@ -66,14 +83,14 @@ void DefaultUI::init() {
             break;
         };
     });
-    pluginManager->on("controller:brew:start",
+    pluginManager->on(EventId::CONTROLLER_BREW_START,
                       [this](Event const &event) { changeScreen(&ui_StatusScreen, &ui_StatusScreen_screen_init); });
-    pluginManager->on("controller:brew:clear", [this](Event const &event) {
+    pluginManager->on(EventId::CONTROLLER_BREW_CLEAR, [this](Event const &event) {
         if (lv_scr_act() == ui_StatusScreen) {
             changeScreen(&ui_BrewScreen, &ui_BrewScreen_screen_init);
         }
     });
-    pluginManager->on("controller:bluetooth:connect", [this](Event const &) {
+    pluginManager->on(EventId::CONTROLLER_BLUETOOTH_CONNECT, [this](Event const &) {
         rerender = true;
         if (lv_scr_act() == ui_InitScreen) {
             Settings &settings = controller->getSettings();
@@ -82,34 +99,34 @@ void DefaultUI::init() {
         }
         pressureAvailable = controller->getSystemInfo().capabilities.pressure ? 1 : 0;
     });
-    pluginManager->on("controller:wifi:connect", [this](Event const &event) {
+    pluginManager->on(EventId::CONTROLLER_WIFI_CONNECT, [this](Event const &event) {
         rerender = true;
         apActive = event.getInt("AP");
     });
-    pluginManager->on("ota:update:start", [this](Event const &) {
+    pluginManager->on(EventId::OTA_UPDATE_START, [this](Event const &) {
         updateActive = true;
         rerender = true;
         changeScreen(&ui_InitScreen, &ui_InitScreen_screen_init);
     });
-    pluginManager->on("ota:update:end", [this](Event const &) {
+    pluginManager->on(EventId::OTA_UPDATE_END, [this](Event const &) {
         updateActive = false;
         rerender = true;
         changeScreen(&ui_InitScreen, &ui_InitScreen_screen_init);
     });
-    pluginManager->on("ota:update:status", [this](Event const &event) {
+    pluginManager->on(EventId::OTA_UPDATE_STATUS, [this](Event const &event) {
         rerender = true;
         updateAvailable = event.getInt("value");
     });
-    pluginManager->on("controller:error", [this](Event const &) {
+    pluginManager->on(EventId::CONTROLLER_ERROR, [this](Event const &) {
         rerender = true;
         changeScreen(&ui_InitScreen, &ui_InitScreen_screen_init);
     });
-    pluginManager->on("controller:autotune:start",
+    pluginManager->on(EventId::CONTROLLER_AUTOTUNE_START,
                       [this](Event const &) { changeScreen(&ui_InitScreen, &ui_InitScreen_screen_init); });
-    pluginManager->on("controller:autotune:result",
+    pluginManager->on(EventId::CONTROLLER_AUTOTUNE_RESULT,
                       [this](Event const &) { changeScreen(&ui_StandbyScreen, &ui_StandbyScreen_screen_init); });
 
-    pluginManager->on("profiles:profile:select", [this](Event const &event) {
+    pluginManager->on(EventId::PROFILES_PROFILE_SELECT, [this](Event const &event) {
         selectedProfileId = event.getString("id");
         profileManager->loadSelectedProfile(selectedProfile);
     });
@@ -122,31 +139,37 @@ void DefaultUI::init() {
 void DefaultUI::loop() {
     const unsigned long now = millis();
     const unsigned long diff = now - lastRender;
-    if ((controller->isActive() && diff > RERENDER_INTERVAL_ACTIVE) || diff > RERENDER_INTERVAL_IDLE) {
+    const MachineState state = controller->getState();
+    const bool processActive = state.active || state.grindActive;
+    if ((processActive && diff > RERENDER_INTERVAL_ACTIVE) || diff > RERENDER_INTERVAL_IDLE) {
         rerender = true;
     }
     if (rerender) {
+        PROFILE_SCOPE("ui:render");
+        TRACE_SCOPE("ui", "render");
         rerender = false;
         lastRender = now;
-        error = controller->isErrorState();
-        autotuning = controller->isAutotuning();
+        error = state.error > 0;
+        autotuning = state.autotuning;
         const Settings &settings = controller->getSettings();
         volumetricAvailable = controller->isVolumetricAvailable();
         volumetricMode = volumetricAvailable && settings.isVolumetricTarget();
-        grindActive = controller->isGrindActive();
-        active = controller->isActive();
-        if (controller->isErrorState()) {
+        grindActive = state.grindActive;
+        active = state.active;
+        if (state.error > 0) {
             changeScreen(&ui_InitScreen, &ui_InitScreen_screen_init);
         }
         handleScreenChange();
         currentScreen = lv_scr_act();
         if (lv_scr_act() == ui_StandbyScreen)
-            updateStandbyScreen();
+            updateStandbyScreen(state);
         if (lv_scr_act() == ui_StatusScreen)
-            updateStatusScreen();
+            updateStatusScreen(state);
         effect_mgr.evaluate_all();
     }
 
+    PROFILE_SCOPE("ui:lvgl");
+    TRACE_SCOPE("ui", "lvgl");
     lv_task_handler();
 }
 
@@ -198,17 +221,18 @@ void DefaultUI::setupPanel() const {
 }
 
 void DefaultUI::setupState() {
-    error = controller->isErrorState();
-    autotuning = controller->isAutotuning();
+    const MachineState state = controller->getState();
+    error = state.error > 0;
+    autotuning = state.autotuning;
     const Settings &settings = controller->getSettings();
     volumetricAvailable = controller->isVolumetricAvailable();
     volumetricMode = volumetricAvailable && settings.isVolumetricTarget();
-    grindActive = controller->isGrindActive();
-    active = controller->isActive();
-    mode = controller->getMode();
-    currentTemp = controller->getCurrentTemp();
-    targetTemp = controller->getTargetTemp();
-    targetDuration = controller->getTargetDuration();
+    grindActive = state.grindActive;
+    active = state.active;
+    mode = state.mode;
+    currentTemp = state.currentTemp;
+    targetTemp = state.targetTemp;
+    targetDuration = state.targetDuration;
     targetVolume = settings.getTargetVolume();
     grindDuration = settings.getTargetGrindDuration();
     grindVolume = settings.getTargetGrindVolume();
@@ -527,7 +551,7 @@ void DefaultUI::handleScreenChange() {
     }
 }
 
-void DefaultUI::updateStandbyScreen() const {
+void DefaultUI::updateStandbyScreen(const MachineState &state) const {
     if (!apActive && WiFi.status() == WL_CONNECTED) {
         tm timeinfo;
         if (getLocalTime(&timeinfo, 50)) {
@@ -542,78 +566,80 @@ void DefaultUI::updateStandbyScreen() const {
     } else {
         lv_obj_add_flag(ui_StandbyScreen_time, LV_OBJ_FLAG_HIDDEN);
     }
-    controller->getClientController()->isConnected() ? lv_obj_clear_flag(ui_StandbyScreen_bluetoothIcon, LV_OBJ_FLAG_HIDDEN)
-                                                     : lv_obj_add_flag(ui_StandbyScreen_bluetoothIcon, LV_OBJ_FLAG_HIDDEN);
+    state.connected ? lv_obj_clear_flag(ui_StandbyScreen_bluetoothIcon, LV_OBJ_FLAG_HIDDEN)
+                    : lv_obj_add_flag(ui_StandbyScreen_bluetoothIcon, LV_OBJ_FLAG_HIDDEN);
     !apActive &&WiFi.status() == WL_CONNECTED ? lv_obj_clear_flag(ui_StandbyScreen_wifiIcon, LV_OBJ_FLAG_HIDDEN)
                                               : lv_obj_add_flag(ui_StandbyScreen_wifiIcon, LV_OBJ_FLAG_HIDDEN);
 }
 
-void DefaultUI::updateStatusScreen() const {
-    Process *process = controller->getProcess();
-    if (process == nullptr) {
-        process = controller->getLastProcess();
-    }
-    if (process->getType() != MODE_BREW) {
+void DefaultUI::updateStatusScreen(const MachineState &state) const {
+    const BrewSnapshot &brew = state.brew;
+    if (!brew.valid) {
         return;
     }
-    auto *brewProcess = static_cast<BrewProcess *>(process);
-    const auto phase = brewProcess->currentPhase;
 
     unsigned long now = millis();
-    if (!process->isActive()) {
-        now = brewProcess->finished;
+    if (!brew.active) {
+        now = brew.finished;
     }
 
-    lv_label_set_text(ui_StatusScreen_stepLabel, phase.phase == PhaseType::PHASE_TYPE_BREW ? "BREW" : "INFUSION");
-    lv_label_set_text(ui_StatusScreen_phaseLabel, brewProcess->isActive() ? phase.name.c_str() : "Finished");
+    // Processes running next to the brew, like grinding the next dose, are listed after the phase type
+    char stepText[32];
+    int stepLength =
+        snprintf(stepText, sizeof(stepText), "%s", brew.phaseType == PhaseType::PHASE_TYPE_BREW ? "BREW" : "INFUSION");
+    for (uint8_t i = 0; i < state.processCount; i++) {
+        const ProcessSnapshot &process = state.processes[i];
+        if (process.active && process.type != MODE_BREW && stepLength < static_cast<int>(sizeof(stepText))) {
+            stepLength += snprintf(stepText + stepLength, sizeof(stepText) - stepLength, " + %s", getProcessName(process.type));
+        }
+    }
+    lv_label_set_text(ui_StatusScreen_stepLabel, stepText);
+    lv_label_set_text(ui_StatusScreen_phaseLabel, brew.active ? brew.phaseName : "Finished");
 
-    const unsigned long processDuration = now - brewProcess->processStarted;
+    const unsigned long processDuration = now - brew.processStarted;
     const double processSecondsDouble = processDuration / 1000.0;
     const auto processMinutes = static_cast<int>(processSecondsDouble / 60.0);
     const auto processSeconds = static_cast<int>(processSecondsDouble) % 60;
     lv_label_set_text_fmt(ui_StatusScreen_currentDuration, "%2d:%02d", processMinutes, processSeconds);
 
-    if (brewProcess->target == ProcessTarget::VOLUMETRIC && phase.hasVolumetricTarget()) {
-        Target target = phase.getVolumetricTarget();
-        lv_bar_set_value(ui_StatusScreen_brewBar, brewProcess->currentVolume, LV_ANIM_OFF);
-        lv_bar_set_range(ui_StatusScreen_brewBar, 0, target.value + 1);
-        lv_label_set_text_fmt(ui_StatusScreen_brewLabel, "%.1fg", target.value);
+    if (brew.volumetric && brew.phaseVolumetricTarget > 0.0f) {
+        lv_bar_set_value(ui_StatusScreen_brewBar, brew.currentVolume, LV_ANIM_OFF);
+        lv_bar_set_range(ui_StatusScreen_brewBar, 0, brew.phaseVolumetricTarget + 1);
+        lv_label_set_text_fmt(ui_StatusScreen_brewLabel, "%.1fg", brew.phaseVolumetricTarget);
     } else {
-        const unsigned long progress = now - brewProcess->currentPhaseStarted;
+        const unsigned long progress = now - brew.phaseStarted;
         lv_bar_set_value(ui_StatusScreen_brewBar, progress / 1000, LV_ANIM_OFF);
-        lv_bar_set_range(ui_StatusScreen_brewBar, 0, brewProcess->getPhaseDuration() / 1000);
-        lv_label_set_text_fmt(ui_StatusScreen_brewLabel, "%ds", brewProcess->getPhaseDuration() / 1000);
+        lv_bar_set_range(ui_StatusScreen_brewBar, 0, brew.phaseDuration / 1000);
+        lv_label_set_text_fmt(ui_StatusScreen_brewLabel, "%ds", brew.phaseDuration / 1000);
     }
 
-    if (brewProcess->target == ProcessTarget::TIME) {
-        const unsigned long targetDuration = brewProcess->getTotalDuration();
+    if (!brew.volumetric) {
+        const unsigned long targetDuration = brew.totalDuration;
         const double targetSecondsDouble = targetDuration / 1000.0;
         const auto targetMinutes = static_cast<int>(targetSecondsDouble / 60.0);
         const auto targetSeconds = static_cast<int>(targetSecondsDouble) % 60;
         lv_label_set_text_fmt(ui_StatusScreen_targetDuration, "%2d:%02d", targetMinutes, targetSeconds);
     } else {
-        lv_label_set_text_fmt(ui_StatusScreen_targetDuration, "%.1fg", brewProcess->getBrewVolume());
+        lv_label_set_text_fmt(ui_StatusScreen_targetDuration, "%.1fg", brew.brewVolume);
     }
-    lv_img_set_src(ui_StatusScreen_Image8, brewProcess->target == ProcessTarget::TIME ? &ui_img_360122106 : &ui_img_1424216268);
+    lv_img_set_src(ui_StatusScreen_Image8, !brew.volumetric ? &ui_img_360122106 : &ui_img_1424216268);
 
-    if (brewProcess->isAdvancedPump()) {
-        float pressure = brewProcess->getPumpTargetPressure();
-        ESP_LOGI("DefaultUI", "%.2f", pressure);
-        const double percentage = 1.0 - static_cast<double>(pressure) / static_cast<double>(pressureScaling);
+    if (brew.advancedPump) {
+        const double percentage = 1.0 - static_cast<double>(brew.targetPressure) / static_cast<double>(pressureScaling);
         int16_t angle = percentage * 1360.0 - 1360.0 / 2.0 + 900.0;
         lv_img_set_angle(uic_StatusScreen_dials_pressureTarget, angle);
     }
 
     // Brew finished adjustments
-    if (process->isActive()) {
+    if (brew.active) {
         lv_obj_add_flag(ui_StatusScreen_brewVolume, LV_OBJ_FLAG_HIDDEN);
     } else {
-        if (brewProcess->target == ProcessTarget::VOLUMETRIC) {
+        if (brew.volumetric) {
             lv_obj_clear_flag(ui_StatusScreen_brewVolume, LV_OBJ_FLAG_HIDDEN);
         }
         lv_obj_add_flag(ui_StatusScreen_barContainer, LV_OBJ_FLAG_HIDDEN);
         lv_obj_add_flag(ui_StatusScreen_labelContainer, LV_OBJ_FLAG_HIDDEN);
-        lv_label_set_text_fmt(ui_StatusScreen_brewVolume, "%.1lfg", brewProcess->currentVolume);
+        lv_label_set_text_fmt(ui_StatusScreen_brewVolume, "%.1lfg", brew.currentVolume);
         lv_imgbtn_set_src(ui_StatusScreen_pauseButton, LV_IMGBTN_STATE_RELEASED, nullptr, &ui_img_631115820, nullptr);
     }
 }
@@ -1,6 +1,7 @@
 #ifndef DEFAULTUI_H
 #define DEFAULTUI_H
 
+#include <display/core/MachineSnapshot.h>
 #include <display/core/PluginManager.h>
 #include <display/core/ProfileManager.h>
 #include <display/core/constants.h>
@@ -38,8 +39,8 @@ class DefaultUI {
 
     void handleScreenChange();
 
-    void updateStandbyScreen() const;
-    void updateStatusScreen() const;
+    void updateStandbyScreen(const MachineState &state) const;
+    void updateStatusScreen(const MachineState &state) const;
 
     void adjustDials(lv_obj_t *dials);
 
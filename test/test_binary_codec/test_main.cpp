@@ -0,0 +1,385 @@
+// Round-trips every message of the binary BLE codec through its encoder and decoder, including edge values, and makes
+// sure every truncated message is rejected.
+//
+// Usage: pio test -e native
+
+// The codec has no platform dependencies, it is compiled in directly instead of building the whole library
+#include <BinaryCodec.cpp>
+
+#include <cmath>
+#include <cstring>
+#include <initializer_list>
+#include <unity.h>
+
+void setUp() {}
+
+void tearDown() {}
+
+// Decodes every prefix of the message, all of them have to fail
+template <typename F> static void checkTruncated(const BinaryWriter &writer, F &&decode) {
+    for (size_t length = 0; length < writer.size(); length++) {
+        BinaryReader reader(writer.data(), length);
+        TEST_ASSERT_FALSE(decode(reader));
+    }
+}
+
+static void testPrimitives() {
+    BinaryWriter writer;
+    writer.u8(0xAB);
+    writer.u16(0xBEEF);
+    writer.u32(0xDEADBEEF);
+    writer.i32(-123456);
+    writer.f32(-0.5f);
+    writer.str("pump", 15);
+    TEST_ASSERT_TRUE(writer.ok());
+    TEST_ASSERT_TRUE(writer.data()[0] == BLE_BINARY_MARKER);
+    TEST_ASSERT_TRUE(writer.data()[2] == 0xEF && writer.data()[3] == 0xBE); // little-endian
+
+    BinaryReader reader(writer.data(), writer.size());
+    TEST_ASSERT_TRUE(reader.u8() == 0xAB);
+    TEST_ASSERT_TRUE(reader.u16() == 0xBEEF);
+    TEST_ASSERT_TRUE(reader.u32() == 0xDEADBEEF);
+    TEST_ASSERT_TRUE(reader.i32() == -123456);
+    TEST_ASSERT_TRUE(reader.f32() == -0.5f);
+    char name[8];
+    reader.str(name, sizeof(name));
+    TEST_ASSERT_TRUE(strcmp(name, "pump") == 0);
+    TEST_ASSERT_TRUE(reader.ok());
+    reader.u8();
+    TEST_ASSERT_FALSE(reader.ok());
+
+    // Longer strings are cut to the buffer but the reader stays aligned
+    BinaryWriter longString;
+    longString.str("a name that does not fit", 24);
+    longString.u8(7);
+    BinaryReader longReader(longString.data(), longString.size());
+    longReader.str(name, sizeof(name));
+    TEST_ASSERT_TRUE(strcmp(name, "a name ") == 0);
+    TEST_ASSERT_TRUE(longReader.u8() == 7 && longReader.ok());
+
+    BinaryWriter full;
+    for (size_t i = 0; i < BLE_BINARY_MAX_LENGTH; i++) {
+        full.u8(1);
+    }
+    TEST_ASSERT_FALSE(full.ok());
+    TEST_ASSERT_TRUE(full.size() == BLE_BINARY_MAX_LENGTH);
+
+    const char *text = "93.250,9.000,2.100";
+    TEST_ASSERT_FALSE(isBinaryMessage(reinterpret_cast<const uint8_t *>(text), strlen(text)));
+    TEST_ASSERT_FALSE(isBinaryMessage(nullptr, 0));
+    BinaryReader textReader(reinterpret_cast<const uint8_t *>(text), strlen(text));
+    TEST_ASSERT_FALSE(textReader.ok());
+}
+
+static void testSimpleMessages() {
+    for (bool value : {false, true}) {
+        BinaryWriter writer;
+        encodeBool(writer, value);
+        BinaryReader reader(writer.data(), writer.size());
+        bool decoded = !value;
+        TEST_ASSERT_TRUE(decodeBool(reader, decoded) && decoded == value);
+        checkTruncated(writer, [](BinaryReader &r) {
+            bool v;
+            return decodeBool(r, v);
+        });
+    }
+    for (float value : {0.0f, -1.5f, 1234.5678f, INFINITY}) {
+        BinaryWriter writer;
+        encodeFloat(writer, value);
+        BinaryReader reader(writer.data(), writer.size());
+        float decoded;
+        TEST_ASSERT_TRUE(decodeFloat(reader, decoded) && decoded == value);
+    }
+    for (int32_t value : {0, 5, -1, INT32_MAX, INT32_MIN}) {
+        BinaryWriter writer;
+        encodeInt(writer, value);
+        BinaryReader reader(writer.data(), writer.size());
+        int32_t decoded;
+        TEST_ASSERT_TRUE(decodeInt(reader, decoded) && decoded == value);
+    }
+
+    BinaryWriter sensorWriter;
+    encodeSensorData(sensorWriter, SensorData{93.25f, 9.125f, 2.5f});
+    BinaryReader sensorReader(sensorWriter.data(), sensorWriter.size());
+    SensorData sensor;
+    TEST_ASSERT_TRUE(decodeSensorData(sensorReader, sensor));
+    TEST_ASSERT_TRUE(sensor.temperature == 93.25f && sensor.pressure == 9.125f && sensor.flow == 2.5f);
+    checkTruncated(sensorWriter, [](BinaryReader &r) {
+        SensorData d;
+        return decodeSensorData(r, d);
+    });
+
+    BinaryWriter pidWriter;
+    encodePidSettings(pidWriter, PidSettings{2.4f, 0.0305f, 21.0f});
+    BinaryReader pidReader(pidWriter.data(), pidWriter.size());
+    PidSettings pid;
+    TEST_ASSERT_TRUE(decodePidSettings(pidReader, pid) && pid.Kp == 2.4f && pid.Ki == 0.0305f && pid.Kd == 21.0f);
+
+    BinaryWriter autotuneWriter;
+    encodeAutotune(autotuneWriter, 60, 4);
+    BinaryReader autotuneReader(autotuneWriter.data(), autotuneWriter.size());
+    int32_t testTime, samples;
+    TEST_ASSERT_TRUE(decodeAutotune(autotuneReader, testTime, samples) && testTime == 60 && samples == 4);
+
+    BinaryWriter pingWriter;
+    encodePing(pingWriter, 0x0123456789ABCDEFULL);
+    BinaryReader pingReader(pingWriter.data(), pingWriter.size());
+    uint64_t sent = 0;
+    TEST_ASSERT_TRUE(decodePing(pingReader, sent) && sent == 0x0123456789ABCDEFULL);
+    const BinaryWriter legacyWriter; // marker only, from displays before clock sync
+    BinaryReader legacyPing(legacyWriter.data(), legacyWriter.size());
+    TEST_ASSERT_FALSE(decodePing(legacyPing, sent));
+
+    ClockExchange exchange;
+    exchange.sent = 1000;
+    exchange.received = 5000000000ULL;
+    exchange.replied = 5000000250ULL;
+    BinaryWriter pongWriter;
+    encodePong(pongWriter, exchange);
+    BinaryReader pongReader(pongWriter.data(), pongWriter.size());
+    ClockExchange decodedExchange;
+    TEST_ASSERT_TRUE(decodePong(pongReader, decodedExchange));
+    TEST_ASSERT_TRUE(decodedExchange.sent == exchange.sent && decodedExchange.received == exchange.received &&
+          decodedExchange.replied == exchange.replied);
+    checkTruncated(pongWriter, [](BinaryReader &r) {
+        ClockExchange e;
+        return decodePong(r, e);
+    });
+}
+
+static void testOutputControl() {
+    OutputControl simple;
+    simple.valve = true;
+    simple.pump = 42.5f;
+    simple.boilerSetpoint = 93.0f;
+    BinaryWriter simpleWriter;
+    encodeOutputControl(simpleWriter, simple);
+    BinaryReader simpleReader(simpleWriter.data(), simpleWriter.size());
+    OutputControl decoded;
+    TEST_ASSERT_TRUE(decodeOutputControl(simpleReader, decoded));
+    TEST_ASSERT_TRUE(decoded.valve && !decoded.advanced && decoded.pump == 42.5f && decoded.boilerSetpoint == 93.0f);
+
+    OutputControl advanced;
+    advanced.advanced = true;
+    advanced.pressureTarget = true;
+    advanced.boilerSetpoint = 94.5f;
+    advanced.pressure = 9.0f;
+    advanced.flow = 12.345f; // does not fit the 30 byte text buffer with a three digit setpoint
+    BinaryWriter advancedWriter;
+    encodeOutputControl(advancedWriter, advanced);
+    BinaryReader advancedReader(advancedWriter.data(), advancedWriter.size());
+    TEST_ASSERT_TRUE(decodeOutputControl(advancedReader, decoded));
+    TEST_ASSERT_TRUE(!decoded.valve && decoded.advanced && decoded.pressureTarget);
+    TEST_ASSERT_TRUE(decoded.boilerSetpoint == 94.5f && decoded.pressure == 9.0f && decoded.flow == 12.345f);
+    checkTruncated(advancedWriter, [](BinaryReader &r) {
+        OutputControl c;
+        return decodeOutputControl(r, c);
+    });
+}
+
+static void testProgram() {
+    ProfileProgram program;
+    program.id = 0xFFFFFFF0;
+    program.phaseCount = PROGRAM_MAX_PHASES;
+    for (uint8_t i = 0; i < program.phaseCount; i++) {
+        ProgramPhase &phase = program.phases[i];
+        phase.valve = i % 2;
+        phase.advanced = i % 3 == 0;
+        phase.pressureTarget = i % 4 == 0;
+        phase.pump = i * 10.0f;
+        phase.pressure = i * 0.5f;
+        phase.flow = i * 0.25f;
+        phase.transition = i % 4;
+        phase.transitionDuration = i * 1.5f;
+        phase.exitCount = PROGRAM_MAX_EXITS;
+        for (uint8_t e = 0; e < phase.exitCount; e++) {
+            phase.exits[e].type = e % 4;
+            phase.exits[e].lte = e % 2;
+            phase.exits[e].value = i + e * 0.1f;
+        }
+    }
+
+    ProfileProgram received;
+    BinaryWriter commit;
+    encodeProgramCommit(commit);
+
+    // A commit with a phase missing is rejected
+    BinaryWriter begin;
+    encodeProgramBegin(begin, program);
+    BinaryReader beginReader(begin.data(), begin.size());
+    TEST_ASSERT_FALSE(decodeProgramMessage(beginReader, received));
+    TEST_ASSERT_TRUE(received.id == program.id && received.phaseCount == program.phaseCount);
+    for (uint8_t i = 1; i < program.phaseCount; i++) {
+        BinaryWriter phase;
+        encodeProgramPhase(phase, i, program.phases[i]);
+        TEST_ASSERT_TRUE(phase.ok());
+        BinaryReader phaseReader(phase.data(), phase.size());
+        TEST_ASSERT_FALSE(decodeProgramMessage(phaseReader, received));
+    }
+    BinaryReader incompleteReader(commit.data(), commit.size());
+    TEST_ASSERT_FALSE(decodeProgramMessage(incompleteReader, received));
+
+    // and accepted once every phase arrived
+    BinaryWriter first;
+    encodeProgramPhase(first, 0, program.phases[0]);
+    BinaryReader firstReader(first.data(), first.size());
+    TEST_ASSERT_FALSE(decodeProgramMessage(firstReader, received));
+    BinaryReader commitReader(commit.data(), commit.size());
+    TEST_ASSERT_TRUE(decodeProgramMessage(commitReader, received));
+    for (uint8_t i = 0; i < program.phaseCount; i++) {
+        const ProgramPhase &a = program.phases[i];
+        const ProgramPhase &b = received.phases[i];
+        TEST_ASSERT_TRUE(a.valve == b.valve && a.advanced == b.advanced && a.pressureTarget == b.pressureTarget);
+        TEST_ASSERT_TRUE(a.pump == b.pump && a.pressure == b.pressure && a.flow == b.flow);
+        TEST_ASSERT_TRUE(a.transition == b.transition && a.transitionDuration == b.transitionDuration);
+        TEST_ASSERT_TRUE(a.exitCount == b.exitCount);
+        for (uint8_t e = 0; e < a.exitCount; e++) {
+            TEST_ASSERT_TRUE(a.exits[e].type == b.exits[e].type && a.exits[e].lte == b.exits[e].lte && a.exits[e].value == b.exits[e].value);
+        }
+    }
+
+    // A truncated phase keeps the previous content
+    BinaryWriter phase;
+    ProgramPhase changed = program.phases[1];
+    changed.pump = 99.0f;
+    encodeProgramPhase(phase, 1, changed);
+    BinaryReader truncated(phase.data(), phase.size() - 1);
+    TEST_ASSERT_FALSE(decodeProgramMessage(truncated, received));
+    TEST_ASSERT_TRUE(received.phases[1].pump == program.phases[1].pump);
+
+    // Phases outside of the announced count are rejected
+    BinaryWriter outside;
+    encodeProgramPhase(outside, PROGRAM_MAX_PHASES, changed);
+    BinaryReader outsideReader(outside.data(), outside.size());
+    TEST_ASSERT_FALSE(decodeProgramMessage(outsideReader, received));
+
+    for (ProgramCommand command : {ProgramCommand::START, ProgramCommand::ADVANCE, ProgramCommand::STOP}) {
+        BinaryWriter writer;
+        encodeProgramCommand(writer, command, 3);
+        BinaryReader reader(writer.data(), writer.size());
+        ProgramCommand decodedCommand;
+        uint8_t decodedPhase;
+        TEST_ASSERT_TRUE(decodeProgramCommand(reader, decodedCommand, decodedPhase) && decodedCommand == command && decodedPhase == 3);
+    }
+    BinaryWriter invalidCommand;
+    invalidCommand.u8(17);
+    invalidCommand.u8(0);
+    BinaryReader invalidReader(invalidCommand.data(), invalidCommand.size());
+    ProgramCommand command;
+    uint8_t phaseIndex;
+    TEST_ASSERT_FALSE(decodeProgramCommand(invalidReader, command, phaseIndex));
+
+    ProgramProgress progress;
+    progress.id = 123456789;
+    progress.phase = 7;
+    progress.phaseElapsed = 45678;
+    progress.running = true;
+    BinaryWriter progressWriter;
+    encodeProgramProgress(progressWriter, progress);
+    BinaryReader progressReader(progressWriter.data(), progressWriter.size());
+    ProgramProgress decodedProgress;
+    TEST_ASSERT_TRUE(decodeProgramProgress(progressReader, decodedProgress));
+    TEST_ASSERT_TRUE(decodedProgress.id == progress.id && decodedProgress.phase == progress.phase &&
+          decodedProgress.phaseElapsed == progress.phaseElapsed && decodedProgress.running);
+    checkTruncated(progressWriter, [](BinaryReader &r) {
+        ProgramProgress p;
+        return decodeProgramProgress(r, p);
+    });
+}
+
+static void testTaskDiagnostics() {
+    TaskDiagnostics diagnostics;
+    strcpy(diagnostics.name, "thermocouple123");
+    diagnostics.period = 250;
+    diagnostics.count = 4000000000UL;
+    diagnostics.missed = 3;
+    diagnostics.periodAvg = 250012;
+    diagnostics.periodMax = 262144;
+    diagnostics.execAvg = 812;
+    diagnostics.execMax = 9000;
+    for (uint8_t i = 0; i < TASK_DIAGNOSTICS_BUCKETS; i++) {
+        diagnostics.jitter[i] = 65535 - i;
+        diagnostics.exec[i] = i * 100;
+    }
+    BinaryWriter writer;
+    encodeTaskDiagnostics(writer, diagnostics);
+    TEST_ASSERT_TRUE(writer.ok());
+    BinaryReader reader(writer.data(), writer.size());
+    TaskDiagnostics decoded;
+    TEST_ASSERT_TRUE(decodeTaskDiagnostics(reader, decoded));
+    TEST_ASSERT_TRUE(strcmp(decoded.name, diagnostics.name) == 0);
+    TEST_ASSERT_TRUE(decoded.period == diagnostics.period && decoded.count == diagnostics.count && decoded.missed == diagnostics.missed);
+    TEST_ASSERT_TRUE(decoded.periodAvg == diagnostics.periodAvg && decoded.periodMax == diagnostics.periodMax);
+    TEST_ASSERT_TRUE(decoded.execAvg == diagnostics.execAvg && decoded.execMax == diagnostics.execMax);
+    TEST_ASSERT_TRUE(memcmp(decoded.jitter, diagnostics.jitter, sizeof(decoded.jitter)) == 0);
+    TEST_ASSERT_TRUE(memcmp(decoded.exec, diagnostics.exec, sizeof(decoded.exec)) == 0);
+    checkTruncated(writer, [](BinaryReader &r) {
+        TaskDiagnostics d;
+        return decodeTaskDiagnostics(r, d);
+    });
+}
+
+static void testSensorFrame() {
+    TEST_ASSERT_TRUE(sensorFrameCapacity(20) == 1); // default MTU of 23
+    TEST_ASSERT_TRUE(sensorFrameCapacity(15) == 0);
+    TEST_ASSERT_TRUE(sensorFrameCapacity(1000) == SENSOR_FRAME_MAX_SAMPLES);
+
+    SensorSample samples[SENSOR_FRAME_MAX_SAMPLES];
+    for (uint8_t i = 0; i < SENSOR_FRAME_MAX_SAMPLES; i++) {
+        samples[i].time = 0xFFFFFF00UL + i * 30; // wraps around
+        samples[i].temperature = 93.0f + i * 0.01f;
+        samples[i].pressure = 8.999f - i * 0.5f;
+        samples[i].flow = 2.55f - i;
+        samples[i].volume = 12.3f + i;
+    }
+    BinaryWriter writer;
+    encodeSensorFrame(writer, samples, SENSOR_FRAME_MAX_SAMPLES);
+    TEST_ASSERT_TRUE(writer.ok());
+    TEST_ASSERT_TRUE(writer.size() == SENSOR_FRAME_HEADER_LENGTH + SENSOR_FRAME_MAX_SAMPLES * SENSOR_FRAME_SAMPLE_LENGTH);
+    BinaryReader reader(writer.data(), writer.size());
+    SensorFrame frame;
+    TEST_ASSERT_TRUE(decodeSensorFrame(reader, frame));
+    TEST_ASSERT_TRUE(frame.count == SENSOR_FRAME_MAX_SAMPLES);
+    for (uint8_t i = 0; i < frame.count; i++) {
+        const SensorSample &a = samples[i];
+        const SensorSample &b = frame.samples[i];
+        TEST_ASSERT_TRUE(a.time == b.time);
+        TEST_ASSERT_TRUE(fabsf(a.temperature - b.temperature) <= 0.005f);
+        TEST_ASSERT_TRUE(fabsf(a.pressure - b.pressure) <= 0.0005f);
+        TEST_ASSERT_TRUE(fabsf(a.flow - b.flow) <= 0.005f);
+        TEST_ASSERT_TRUE(fabsf(a.volume - b.volume) <= 0.05f);
+    }
+    checkTruncated(writer, [](BinaryReader &r) {
+        SensorFrame f;
+        return decodeSensorFrame(r, f);
+    });
+
+    // Out of range values are clamped instead of wrapping
+    SensorSample extreme;
+    extreme.temperature = -5.0f;
+    extreme.pressure = 40.0f;
+    extreme.flow = -400.0f;
+    extreme.volume = 1e9f;
+    BinaryWriter extremeWriter;
+    encodeSensorFrame(extremeWriter, &extreme, 1);
+    BinaryReader extremeReader(extremeWriter.data(), extremeWriter.size());
+    TEST_ASSERT_TRUE(decodeSensorFrame(extremeReader, frame) && frame.count == 1);
+    TEST_ASSERT_TRUE(frame.samples[0].temperature == 0.0f && frame.samples[0].pressure == 32.767f);
+    TEST_ASSERT_TRUE(frame.samples[0].flow == -327.68f && frame.samples[0].volume == 6553.5f);
+
+    BinaryWriter empty;
+    encodeSensorFrame(empty, samples, 0);
+    BinaryReader emptyReader(empty.data(), empty.size());
+    TEST_ASSERT_FALSE(decodeSensorFrame(emptyReader, frame));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(testPrimitives);
+    RUN_TEST(testSimpleMessages);
+    RUN_TEST(testOutputControl);
+    RUN_TEST(testProgram);
+    RUN_TEST(testTaskDiagnostics);
+    RUN_TEST(testSensorFrame);
+    return UNITY_END();
+}
@@ -0,0 +1,37 @@
+// Checks the exit comparison both boards use to end a phase.
+//
+// Usage: pio test -e native
+
+#include <ProfileProgram.h>
+
+#include <unity.h>
+
+void setUp() {}
+
+void tearDown() {}
+
+static void testGreaterOrEqual() {
+    TEST_ASSERT_FALSE(isExitMet(false, 8.9f, 9.0f));
+    TEST_ASSERT_TRUE(isExitMet(false, 9.0f, 9.0f));
+    TEST_ASSERT_TRUE(isExitMet(false, 9.5f, 9.0f));
+}
+
+static void testLessOrEqual() {
+    TEST_ASSERT_FALSE(isExitMet(true, 2.5f, 1.0f));
+    TEST_ASSERT_TRUE(isExitMet(true, 1.0f, 1.0f));
+    TEST_ASSERT_TRUE(isExitMet(true, 0.5f, 1.0f));
+}
+
+// A low flow preinfusion with flow <= 1 starts below its exit value, the phase has to end on the first check
+static void testLessOrEqualMetAtPhaseStart() {
+    const ProgramExit exit{PROGRAM_EXIT_FLOW, true, 1.0f};
+    TEST_ASSERT_TRUE(isExitMet(exit.lte, 0.0f, exit.value));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(testGreaterOrEqual);
+    RUN_TEST(testLessOrEqual);
+    RUN_TEST(testLessOrEqualMetAtPhaseStart);
+    return UNITY_END();
+}
@@ -15,6 +15,7 @@ import { Navigation } from './components/Navigation.jsx';
 import { ProfileList } from './pages/ProfileList/index.jsx';
 import { ProfileEdit } from './pages/ProfileEdit/index.jsx';
 import { Autotune } from './pages/Autotune/index.jsx';
+import { Routines } from './pages/Routines/index.jsx';
 
 const apiService = new ApiService();
 
@@ -40,6 +41,7 @@ export function App() {
                         <Route path="/" component={Home} />
                         <Route path="/profiles" component={ProfileList} />
                         <Route path="/profiles/:id" component={ProfileEdit} />
+                        <Route path="/routines" component={Routines} />
                         <Route path="/settings" component={Settings} />
                         <Route path="/ota" component={OTA} />
                         <Route path="/scales" component={Scales} />
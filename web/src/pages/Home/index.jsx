@@ -23,6 +23,12 @@ const modeMap = {
 };
 
 const status = computed(() => machine.value.status);
+const runningProcesses = computed(() =>
+  (status.value.processes || [])
+    .filter((process) => process.a)
+    .map((process) => modeMap[process.t])
+    .join(', ')
+);
 
 export function Home() {
   const apiService = useContext(ApiServiceContext);
@@ -39,6 +45,11 @@ export function Home() {
             <dd className="text-sm font-medium text-slate-500">
               Mode
             </dd>
+            {runningProcesses.value && (
+              <dd className="text-sm font-medium text-slate-500">
+                Running: {runningProcesses.value}
+              </dd>
+            )}
           </dl>
         </div>
         <div
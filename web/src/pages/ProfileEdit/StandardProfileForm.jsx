@@ -5,6 +5,9 @@ import { computed } from '@preact/signals';
 
 const capabilities = computed(() => machine.value.capabilities);
 
+// Phases the display compiles a profile into, see COMPILED_PROFILE_MAX_PHASES
+const MAX_PHASES = 12;
+
 export function StandardProfileForm({ data, onChange, onSave, saving = true }) {
   const onFieldChange = (field, value) => {
     onChange({
@@ -21,6 +24,9 @@ export function StandardProfileForm({ data, onChange, onSave, saving = true }) {
   };
 
   const onPhaseAdd = () => {
+    if (data.phases.length >= MAX_PHASES) {
+      return;
+    }
     onChange({
       ...data,
       phases: [
@@ -111,10 +117,16 @@ export function StandardProfileForm({ data, onChange, onSave, saving = true }) {
             ))
           }
           <div className="pt-4 flex flex-row justify-center">
-            <div className="flex flex-row gap-4 menu-button" onClick={() => onPhaseAdd()}>
-              <i className="fa fa-plus text-xl" />
-              <span className="text-lg">Add phase</span>
-            </div>
+            {
+              data.phases.length < MAX_PHASES ? (
+                <div className="flex flex-row gap-4 menu-button" onClick={() => onPhaseAdd()}>
+                  <i className="fa fa-plus text-xl" />
+                  <span className="text-lg">Add phase</span>
+                </div>
+              ) : (
+                <span className="text-sm text-gray-500">A profile can have up to {MAX_PHASES} phases</span>
+              )
+            }
           </div>
         </div>
         <div className="px-6 py-2">
@@ -137,21 +149,31 @@ function Phase({ phase, onChange, onRemove }) {
     });
   };
   const onVolumetricTargetChange = (value) => {
-    if (value === 0) {
-      onChange({
-        ...phase,
-        targets: null
-      });
-      return;
-    }
+    const exitTargets = (phase?.targets || []).filter(t => t.type !== 'volumetric');
+    const newTargets = parseFloat(value) > 0 ? [{ type: 'volumetric', value: value }, ...exitTargets] : exitTargets;
     onChange({
       ...phase,
-      targets: [
-        {
-          type: 'volumetric',
-          value: value
-        }
-      ],
+      targets: newTargets.length ? newTargets : null,
+    });
+  };
+  const onExitTargetsChange = (exitTargets) => {
+    const volumetricTargets = (phase?.targets || []).filter(t => t.type === 'volumetric');
+    const newTargets = [...volumetricTargets, ...exitTargets];
+    onChange({
+      ...phase,
+      targets: newTargets.length ? newTargets : null,
+    });
+  };
+  const onTransitionChange = (field, value) => {
+    const transition = {
+      type: 'instant',
+      duration: 0,
+      ...phase.transition,
+      [field]: value,
+    };
+    onChange({
+      ...phase,
+      transition: transition.type === 'instant' ? undefined : transition,
     });
   };
   const onPumpPressureSetting = (value) => {
@@ -174,6 +196,7 @@ function Phase({ phase, onChange, onRemove }) {
   const targets = phase?.targets || [];
   const volumetricTarget = targets.find(t => t.type === 'volumetric') || {};
   const targetWeight = volumetricTarget?.value || 0;
+  const exitTargets = targets.filter(t => t.type !== 'volumetric');
   return (
     <div className="bg-gray-50 border-[#ccc] border p-2 lg:p-4 rounded-md grid grid-cols-12 gap-4 dark:bg-slate-700 dark:border-slate-800">
       <div className="col-span-12 md:col-span-4 flex flex-row items-center">
@@ -243,6 +266,36 @@ function Phase({ phase, onChange, onRemove }) {
           <span className="input-addition">s</span>
         </div>
       </div>
+      {
+        !!phase.pump && (
+          <div className="col-span-12 flex flex-col">
+            <label className="block mb-2 text-sm font-medium text-gray-900 dark:text-gray-300">Transition</label>
+            <div className="flex flex-row gap-2">
+              <select className="select-field" onChange={(e) => onTransitionChange('type', e.target.value)}>
+                <option value="instant" selected={!phase.transition || phase.transition.type === 'instant'}>Instant</option>
+                <option value="linear" selected={phase.transition?.type === 'linear'}>Linear</option>
+                <option value="exponential" selected={phase.transition?.type === 'exponential'}>Exponential</option>
+                <option value="ease-in-out" selected={phase.transition?.type === 'ease-in-out'}>Ease in/out</option>
+              </select>
+              {
+                phase.transition && phase.transition.type !== 'instant' && (
+                  <div className="flex">
+                    <input
+                      className="input-field addition"
+                      type="number"
+                      min="0"
+                      step="0.1"
+                      value={phase.transition.duration}
+                      onChange={(e) => onTransitionChange('duration', e.target.value)}
+                    />
+                    <span className="input-addition">s</span>
+                  </div>
+                )
+              }
+            </div>
+          </div>
+        )
+      }
       {
         phase.phase === 'brew' && <div className="col-span-12 flex flex-col">
           <label className="block mb-2 text-sm font-medium text-gray-900 dark:text-gray-300">Volumetric Target</label>
@@ -274,6 +327,7 @@ function Phase({ phase, onChange, onRemove }) {
           </div>
         )
       }
+      <ExitConditions targets={exitTargets} onChange={onExitTargetsChange} />
       <div className="block md:hidden col-span-12 mb-2">
         <a
           href="javascript:void(0)"
@@ -286,3 +340,73 @@ function Phase({ phase, onChange, onRemove }) {
     </div>
   );
 }
+
+const ExitTargetUnits = {
+  pressure: 'bar',
+  flow: 'ml/s',
+};
+
+function ExitConditions({ targets, onChange }) {
+  const onTargetChange = (index, field, value) => {
+    const newTargets = [...targets];
+    newTargets[index] = {
+      ...newTargets[index],
+      [field]: value,
+    };
+    onChange(newTargets);
+  };
+  const onTargetAdd = () => {
+    onChange([
+      ...targets,
+      {
+        type: 'pressure',
+        operator: 'gte',
+        value: 0,
+      },
+    ]);
+  };
+  const onTargetRemove = (index) => {
+    onChange(targets.filter((_, i) => i !== index));
+  };
+  return (
+    <div className="col-span-12 flex flex-col gap-2">
+      <label className="block text-sm font-medium text-gray-900 dark:text-gray-300">Exit conditions</label>
+      {
+        targets.map((target, index) => (
+          <div className="flex flex-row gap-2" key={index}>
+            <select className="select-field" onChange={(e) => onTargetChange(index, 'type', e.target.value)}>
+              <option value="pressure" selected={target.type === 'pressure'}>Pressure</option>
+              <option value="flow" selected={target.type === 'flow'}>Flow</option>
+            </select>
+            <select className="select-field" onChange={(e) => onTargetChange(index, 'operator', e.target.value)}>
+              <option value="gte" selected={target.operator !== 'lte'}>&ge;</option>
+              <option value="lte" selected={target.operator === 'lte'}>&le;</option>
+            </select>
+            <div className="flex">
+              <input
+                className="input-field addition"
+                type="number"
+                step="0.1"
+                value={target.value}
+                onChange={(e) => onTargetChange(index, 'value', e.target.value)}
+              />
+              <span className="input-addition">{ExitTargetUnits[target.type]}</span>
+            </div>
+            <a
+              href="javascript:void(0)"
+              onClick={() => onTargetRemove(index)}
+              className="flex items-center rounded-md border border-transparent px-2.5 py-2 text-sm font-semibold text-red-600 hover:bg-red-100 active:border-red-200"
+            >
+              <span className="fa fa-trash" />
+            </a>
+          </div>
+        ))
+      }
+      <div>
+        <a href="javascript:void(0)" className="text-sm font-semibold" onClick={() => onTargetAdd()}>
+          <i className="fa fa-plus" /> Add exit condition
+        </a>
+      </div>
+    </div>
+  );
+}
@@ -25,7 +25,7 @@ const PhaseLabels = {
 
 const connected = computed(() => machine.value.connected);
 
-function ProfileCard({ data, onDelete, onSelect, onFavorite, onUnfavorite, favoriteDisabled, unfavoriteDisabled }) {
+function ProfileCard({ data, onDelete, onSelect, onFavorite, onUnfavorite, onResetDelay, favoriteDisabled, unfavoriteDisabled }) {
   const bookmarkClass = data.favorite ? 'text-yellow-400' : '';
   const typeText = data.type === 'pro' ? 'Pro' : 'Simple';
   const typeClass = data.type === 'pro' ? 'bg-blue-100 text-blue-800' : 'bg-gray-100 text-gray-800';
@@ -44,6 +44,7 @@ function ProfileCard({ data, onDelete, onSelect, onFavorite, onUnfavorite, favor
     delete download.id;
     delete download.selected;
     delete download.favorite;
+    delete download.learnedDelay;
     var dataStr = "data:text/json;charset=utf-8," + encodeURIComponent(JSON.stringify(download, undefined, 2));
     var downloadAnchorNode = document.createElement('a');
     downloadAnchorNode.setAttribute("href",     dataStr);
@@ -120,6 +121,19 @@ function ProfileCard({ data, onDelete, onSelect, onFavorite, onUnfavorite, favor
         <div className="flex flex-row gap-2 py-4 items-center overflow-auto">
           {data.type === 'pro' ? <ExtendedContent data={data} /> : <SimpleContent data={data} />}
         </div>
+        {
+          data.learnedDelay && (
+            <div className="flex flex-row gap-2 items-center text-sm text-gray-600 dark:text-gray-400">
+              <span>
+                Learned stop delay: {Math.round(data.learnedDelay.delay)}ms ± {Math.round(data.learnedDelay.deviation)}ms
+                over {data.learnedDelay.shots} shots
+              </span>
+              <a href="javascript:void(0)" className="font-semibold text-blue-600" onClick={() => onResetDelay(data.id)}>
+                Reset
+              </a>
+            </div>
+          )
+        }
       </div>
     </div>
   );
@@ -205,6 +219,12 @@ export function ProfileList() {
     await loadProfiles();
   }, [apiService, setLoading]);
 
+  const onResetDelay = useCallback(async(id) => {
+    setLoading(true);
+    await apiService.request({ tp: 'req:profiles:reset-delay', id });
+    await loadProfiles();
+  }, [apiService, setLoading]);
+
   const onExport = useCallback(() => {
     const exportedProfiles = profiles.map(p => {
       const ep = {
@@ -213,6 +233,7 @@ export function ProfileList() {
       delete ep.id;
       delete ep.selected;
       delete ep.favorite;
+      delete ep.learnedDelay;
       return ep;
     });
     var dataStr = "data:text/json;charset=utf-8," + encodeURIComponent(JSON.stringify(exportedProfiles, undefined, 2));
@@ -278,6 +299,7 @@ export function ProfileList() {
             unfavoriteDisabled={unfavoriteDisabled}
             onUnfavorite={onUnfavorite}
             onFavorite={onFavorite}
+            onResetDelay={onResetDelay}
           />
         ))}
 
@@ -0,0 +1,427 @@
+import { useContext } from 'react';
+import { useCallback, useEffect, useState } from 'preact/hooks';
+import { computed } from '@preact/signals';
+import Card from '../../components/Card.jsx';
+import { Spinner } from '../../components/Spinner.jsx';
+import { ApiServiceContext, machine } from '../../services/ApiService.js';
+
+const connected = computed(() => machine.value.connected);
+const activeRoutine = computed(() => machine.value.status.routine);
+
+const StepLabels = {
+  flush: 'Flush',
+  brew: 'Brew',
+  steam: 'Steam',
+  water: 'Hot water',
+  grind: 'Grind',
+  mode: 'Switch mode',
+  wait: 'Wait',
+};
+
+const ModeLabels = {
+  0: 'Standby',
+  1: 'Brew',
+  2: 'Steam',
+  3: 'Water',
+  4: 'Grind',
+};
+
+const emptyRoutine = () => ({
+  label: 'New Routine',
+  description: '',
+  steps: [{ type: 'flush', delay: 0, duration: 0 }],
+});
+
+function StepSummary({ step, active, waiting }) {
+  const activeClass = active ? 'border-green-600' : 'border-gray-200 dark:border-slate-800';
+  return (
+    <div className={`bg-white border p-2 rounded flex flex-col dark:bg-slate-700 ${activeClass}`}>
+      <span className="text-sm font-bold">
+        {StepLabels[step.type]}
+        {step.type === 'mode' && `: ${ModeLabels[step.mode]}`}
+      </span>
+      <div className="text-sm italic flex flex-col">
+        {step.condition && (
+          <span>
+            When {step.condition.type} {step.condition.operator === 'lte' ? '≤' : '≥'} {step.condition.value}
+            {step.condition.type === 'temperature' ? '°C' : ' bar'}
+          </span>
+        )}
+        {step.delay > 0 && <span>Delay: {step.delay}s</span>}
+        {step.duration > 0 && <span>{step.type === 'wait' ? 'Wait' : 'Max'}: {step.duration}s</span>}
+        {active && waiting && <span>Waiting...</span>}
+      </div>
+    </div>
+  );
+}
+
+function RoutineCard({ data, onStart, onStop, onEdit, onDelete }) {
+  const running = activeRoutine.value?.id === data.id;
+  return (
+    <div className="rounded-lg border flex flex-col border-slate-200 bg-white p-4 sm:col-span-12 dark:bg-gray-800 dark:border-gray-600">
+      <div className="flex flex-row gap-2 items-center">
+        <span className="font-bold text-xl leading-tight flex-grow">{data.label}</span>
+        {running ? (
+          <button
+            tooltip="Stop"
+            tooltip-position="left"
+            onClick={() => onStop()}
+            className="group inline-block items-center justify-between gap-2 rounded-md border border-transparent px-2.5 py-2 text-sm font-semibold text-red-600 hover:bg-red-100 active:border-red-200"
+          >
+            <span className="fa fa-stop" />
+          </button>
+        ) : (
+          <button
+            tooltip="Start"
+            tooltip-position="left"
+            onClick={() => onStart(data.id)}
+            disabled={!!activeRoutine.value}
+            className="group inline-block items-center justify-between gap-2 rounded-md border border-transparent px-2.5 py-2 text-sm font-semibold text-green-600 hover:bg-green-100 active:border-green-200"
+          >
+            <span className="fa fa-play" />
+          </button>
+        )}
+        <button
+          tooltip="Edit"
+          tooltip-position="left"
+          onClick={() => onEdit(data)}
+          className="group inline-block items-center justify-between gap-2 rounded-md border border-transparent px-2.5 py-2 text-sm font-semibold text-slate-900 dark:text-indigo-100 hover:bg-indigo-100 hover:text-indigo-600 active:border-indigo-200"
+        >
+          <span className="fa fa-pen" />
+        </button>
+        <button
+          tooltip="Delete"
+          tooltip-position="left"
+          onClick={() => onDelete(data.id)}
+          className="group inline-block items-center justify-between gap-2 rounded-md border border-transparent px-2.5 py-2 text-sm font-semibold text-red-600 hover:bg-red-100 active:border-red-200"
+        >
+          <span className="fa fa-trash" />
+        </button>
+      </div>
+      {data.description && <span className="text-sm">{data.description}</span>}
+      <div className="flex flex-row gap-2 py-4 items-center overflow-auto">
+        {data.steps.map((step, i) => (
+          <>
+            {i > 0 && <i className="fa-solid fa-chevron-right" />}
+            <StepSummary
+              key={i}
+              step={step}
+              active={running && activeRoutine.value.s === i}
+              waiting={running && activeRoutine.value.w}
+            />
+          </>
+        ))}
+      </div>
+    </div>
+  );
+}
+
+function StepForm({ step, profiles, onChange, onRemove }) {
+  const onFieldChange = (field, value) => {
+    onChange({
+      ...step,
+      [field]: value,
+    });
+  };
+  const onConditionChange = (field, value) => {
+    const condition = {
+      type: 'temperature',
+      operator: 'gte',
+      value: 0,
+      ...step.condition,
+      [field]: value,
+    };
+    onChange({
+      ...step,
+      condition: condition.type === 'none' ? undefined : condition,
+    });
+  };
+  return (
+    <div className="bg-gray-50 border-[#ccc] border p-2 lg:p-4 rounded-md grid grid-cols-12 gap-4 dark:bg-slate-700 dark:border-slate-800">
+      <div className="col-span-12 md:col-span-4 flex flex-row items-center">
+        <select className="select-field" onChange={(e) => onFieldChange('type', e.target.value)}>
+          {Object.keys(StepLabels).map((type) => (
+            <option value={type} selected={step.type === type}>
+              {StepLabels[type]}
+            </option>
+          ))}
+        </select>
+      </div>
+      <div className="col-span-12 md:col-span-8 flex flex-row gap-2 align-center">
+        {step.type === 'brew' && (
+          <select className="select-field" onChange={(e) => onFieldChange('profile', e.target.value)}>
+            <option value="" selected={!step.profile}>
+              Selected profile
+            </option>
+            {profiles.map((profile) => (
+              <option value={profile.id} selected={step.profile === profile.id}>
+                {profile.label}
+              </option>
+            ))}
+          </select>
+        )}
+        {step.type === 'mode' && (
+          <select className="select-field" onChange={(e) => onFieldChange('mode', parseInt(e.target.value, 10))}>
+            {Object.keys(ModeLabels).map((mode) => (
+              <option value={mode} selected={`${step.mode || 0}` === mode}>
+                {ModeLabels[mode]}
+              </option>
+            ))}
+          </select>
+        )}
+        <span className="flex-grow" />
+        <a
+          href="javascript:void(0)"
+          tooltip="Delete this step"
+          onClick={() => onRemove()}
+          className="flex group items-center justify-between gap-2 rounded-md border border-transparent px-2.5 py-2 text-sm font-semibold text-red-600 hover:bg-red-100 active:border-red-200"
+        >
+          <span className="fa fa-trash" />
+        </a>
+      </div>
+      <div className="col-span-12 md:col-span-4 flex flex-col">
+        <label className="block mb-2 text-sm font-medium text-gray-900 dark:text-gray-300">Start when</label>
+        <select className="select-field" onChange={(e) => onConditionChange('type', e.target.value)}>
+          <option value="none" selected={!step.condition}>
+            Immediately
+          </option>
+          <option value="temperature" selected={step.condition?.type === 'temperature'}>
+            Temperature
+          </option>
+          <option value="pressure" selected={step.condition?.type === 'pressure'}>
+            Pressure
+          </option>
+        </select>
+      </div>
+      {step.condition && (
+        <div className="col-span-12 md:col-span-8 flex flex-row gap-2 items-end">
+          <select className="select-field" onChange={(e) => onConditionChange('operator', e.target.value)}>
+            <option value="gte" selected={step.condition.operator !== 'lte'}>
+              ≥
+            </option>
+            <option value="lte" selected={step.condition.operator === 'lte'}>
+              ≤
+            </option>
+          </select>
+          <div className="flex">
+            <input
+              className="input-field addition"
+              type="number"
+              step="any"
+              value={step.condition.value}
+              onChange={(e) => onConditionChange('value', parseFloat(e.target.value))}
+            />
+            <span className="input-addition">{step.condition.type === 'temperature' ? '°C' : 'bar'}</span>
+          </div>
+        </div>
+      )}
+      <div className="col-span-6 flex flex-col">
+        <label className="block mb-2 text-sm font-medium text-gray-900 dark:text-gray-300">Delay</label>
+        <div className="flex">
+          <input
+            className="input-field addition"
+            type="number"
+            min="0"
+            value={step.delay}
+            onChange={(e) => onFieldChange('delay', parseFloat(e.target.value))}
+          />
+          <span className="input-addition">s</span>
+        </div>
+      </div>
+      {step.type !== 'mode' && (
+        <div className="col-span-6 flex flex-col">
+          <label className="block mb-2 text-sm font-medium text-gray-900 dark:text-gray-300">
+            {step.type === 'wait' ? 'Duration' : 'Maximum duration (0 = until done)'}
+          </label>
+          <div className="flex">
+            <input
+              className="input-field addition"
+              type="number"
+              min="0"
+              value={step.duration}
+              onChange={(e) => onFieldChange('duration', parseFloat(e.target.value))}
+            />
+            <span className="input-addition">s</span>
+          </div>
+        </div>
+      )}
+    </div>
+  );
+}
+
+function RoutineForm({ data, profiles, onChange, onSave, onCancel, saving }) {
+  const onStepChange = (index, value) => {
+    const steps = [...data.steps];
+    steps[index] = value;
+    onChange({ ...data, steps });
+  };
+  const onStepAdd = () => {
+    onChange({ ...data, steps: [...data.steps, { type: 'wait', delay: 0, duration: 0 }] });
+  };
+  const onStepRemove = (index) => {
+    onChange({ ...data, steps: data.steps.filter((_, i) => i !== index) });
+  };
+  return (
+    <Card sm={12}>
+      <div className="pb-3 flex flex-col gap-2 p-2 lg:p-6">
+        <div>
+          <label htmlFor="label" className="block mb-2 text-sm font-medium text-gray-900 dark:text-gray-300">
+            Label
+          </label>
+          <input
+            id="label"
+            name="label"
+            className="input-field"
+            value={data.label}
+            onChange={(e) => onChange({ ...data, label: e.target.value })}
+          />
+        </div>
+        <div>
+          <label htmlFor="description" className="block mb-2 text-sm font-medium text-gray-900 dark:text-gray-300">
+            Description
+          </label>
+          <input
+            id="description"
+            name="description"
+            className="input-field"
+            value={data.description}
+            onChange={(e) => onChange({ ...data, description: e.target.value })}
+          />
+        </div>
+      </div>
+      <div className="p-2 lg:p-6 flex flex-col">
+        {data.steps.map((step, index) => (
+          <>
+            {index > 0 && (
+              <div className="p-2 flex flex-col items-center">
+                <i className="fa fa-chevron-down text-lg" />
+              </div>
+            )}
+            <StepForm
+              key={index}
+              step={step}
+              profiles={profiles}
+              onChange={(value) => onStepChange(index, value)}
+              onRemove={() => onStepRemove(index)}
+            />
+          </>
+        ))}
+        <div className="pt-4 flex flex-row justify-center">
+          <div className="flex flex-row gap-4 menu-button" onClick={() => onStepAdd()}>
+            <i className="fa fa-plus text-xl" />
+            <span className="text-lg">Add step</span>
+          </div>
+        </div>
+      </div>
+      <div className="px-6 py-2 flex flex-row gap-2">
+        <button type="submit" className="menu-button flex flex-row gap-2" onClick={() => onSave(data)} disabled={saving}>
+          <span>Save</span>
+          {saving && <Spinner size={4} />}
+        </button>
+        <button className="menu-button" onClick={() => onCancel()}>
+          Cancel
+        </button>
+      </div>
+    </Card>
+  );
+}
+
+export function Routines() {
+  const apiService = useContext(ApiServiceContext);
+  const [routines, setRoutines] = useState([]);
+  const [profiles, setProfiles] = useState([]);
+  const [editing, setEditing] = useState(null);
+  const [saving, setSaving] = useState(false);
+  const [loading, setLoading] = useState(true);
+
+  const loadRoutines = async () => {
+    const response = await apiService.request({ tp: 'req:routines:list' });
+    setRoutines(response.routines);
+    setLoading(false);
+  };
+  useEffect(async () => {
+    if (connected.value) {
+      const response = await apiService.request({ tp: 'req:profiles:list' });
+      setProfiles(response.profiles);
+      await loadRoutines();
+    }
+  }, [connected.value]);
+
+  const onStart = useCallback(
+    async (id) => {
+      await apiService.request({ tp: 'req:routines:start', id });
+    },
+    [apiService],
+  );
+
+  const onStop = useCallback(async () => {
+    await apiService.request({ tp: 'req:routines:stop' });
+  }, [apiService]);
+
+  const onDelete = useCallback(
+    async (id) => {
+      setLoading(true);
+      await apiService.request({ tp: 'req:routines:delete', id });
+      await loadRoutines();
+    },
+    [apiService, setLoading],
+  );
+
+  const onSave = useCallback(
+    async (routine) => {
+      setSaving(true);
+      await apiService.request({ tp: 'req:routines:save', routine });
+      setSaving(false);
+      setEditing(null);
+      await loadRoutines();
+    },
+    [apiService, setSaving],
+  );
+
+  if (loading) {
+    return (
+      <div class="flex flex-row py-16 items-center justify-center w-full">
+        <Spinner size={8} />
+      </div>
+    );
+  }
+
+  return (
+    <div className="grid grid-cols-1 gap-2 sm:grid-cols-12 md:gap-2">
+      <div className="sm:col-span-12 flex flex-row">
+        <h2 className="text-2xl font-bold flex-grow">Routines</h2>
+      </div>
+
+      {editing ? (
+        <RoutineForm
+          data={editing}
+          profiles={profiles}
+          onChange={setEditing}
+          onSave={onSave}
+          onCancel={() => setEditing(null)}
+          saving={saving}
+        />
+      ) : (
+        <>
+          {routines.map((data) => (
+            <RoutineCard
+              data={data}
+              key={data.id}
+              onStart={onStart}
+              onStop={onStop}
+              onEdit={(routine) => setEditing(JSON.parse(JSON.stringify(routine)))}
+              onDelete={onDelete}
+            />
+          ))}
+          <div
+            onClick={() => setEditing(emptyRoutine())}
+            className="relative rounded-lg border sm:col-span-12 flex flex-col gap-2 items-center justify-center border-slate-200 bg-white p-2 cursor-pointer text-slate-900 hover:bg-indigo-100 hover:text-indigo-600 active:border-indigo-200 dark:text-indigo-100 dark:bg-gray-800 dark:border-gray-600"
+          >
+            <i className="fa fa-plus text-3xl" />
+            <span className="text-sm">Add new</span>
+          </div>
+        </>
+      )}
+    </div>
+  );
+}
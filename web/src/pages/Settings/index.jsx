@@ -1,15 +1,21 @@
 import './style.css';
 import { useQuery } from 'preact-fetching';
 import { Spinner } from '../../components/Spinner.jsx';
-import { useState, useEffect, useCallback, useRef } from 'preact/hooks';
+import { useState, useEffect, useCallback, useRef, useContext } from 'preact/hooks';
+import { computed } from '@preact/signals';
 import homekitImage from '../../assets/homekit.png';
 import Card from '../../components/Card.jsx';
 import { timezones } from '../../config/zones.js';
+import { ApiServiceContext, machine } from '../../services/ApiService.js';
+
+const connected = computed(() => machine.value.connected);
 
 export function Settings() {
   const [submitting, setSubmitting] = useState(false);
   const [gen, setGen] = useState(0);
   const [formData, setFormData] = useState({});
+  const [routines, setRoutines] = useState([]);
+  const apiService = useContext(ApiServiceContext);
   const {
     isLoading,
     isError,
@@ -27,6 +33,13 @@ export function Settings() {
     setFormData(fetchedSettings || {});
   }, [fetchedSettings]);
 
+  useEffect(async () => {
+    if (connected.value) {
+      const response = await apiService.request({ tp: 'req:routines:list' });
+      setRoutines(response.routines);
+    }
+  }, [connected.value]);
+
   const onChange = (key) => {
     return (e) => {
       let value = e.currentTarget.value;
@@ -276,6 +289,22 @@ export function Settings() {
               />
             </div>
           </div>
+          <div>
+            <label htmlFor="volumePredictor" className="block font-medium text-gray-700 dark:text-gray-400">
+              Volume Prediction
+            </label>
+            <select id="volumePredictor" name="volumePredictor" className="input-field" onChange={onChange('volumePredictor')}>
+              <option value="0" selected={formData.volumePredictor?.toString() === '0'}>
+                Linear
+              </option>
+              <option value="1" selected={formData.volumePredictor?.toString() === '1'}>
+                Quadratic
+              </option>
+              <option value="2" selected={formData.volumePredictor?.toString() === '2'}>
+                Kalman
+              </option>
+            </select>
+          </div>
 
           <div>
             <b>Switch control</b>
@@ -296,6 +325,21 @@ export function Settings() {
             </label>
             <p>Use momentary switches</p>
           </div>
+          <div>
+            <label htmlFor="brewButtonRoutine" className="block font-medium text-gray-700 dark:text-gray-400">
+              Brew button routine
+            </label>
+            <select id="brewButtonRoutine" name="brewButtonRoutine" className="input-field" onChange={onChange('brewButtonRoutine')}>
+              <option value="" selected={!formData.brewButtonRoutine}>
+                None, brew with the selected profile
+              </option>
+              {routines.map((routine) => (
+                <option value={routine.id} selected={formData.brewButtonRoutine === routine.id}>
+                  {routine.label}
+                </option>
+              ))}
+            </select>
+          </div>
 
         </Card>
         <Card xs={12} lg={6} title="System preferences">
@@ -95,6 +95,8 @@ export default class ApiService {
       currentFlow: message.fl,
       mode: message.m,
       selectedProfile: message.p,
+      routine: message.rt || null,
+      processes: message.ps || [],
       timestamp: new Date(),
     };
     const newValue = {
@@ -127,7 +129,8 @@ export const machine = signal({
     currentTemperature: 0,
     targetTemperature: 0,
     mode: 0,
-    selectedProfile: ''
+    selectedProfile: '',
+    routine: null,
   },
   capabilities: {
     pressure: false,